@@ -23,6 +23,8 @@
 #include <linux/i2c.h>
 #include <linux/regmap.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <linux/slab.h>
 #include <linux/of.h>
 #include <linux/regulator/consumer.h>
@@ -32,6 +34,8 @@
 #include <linux/gpio.h>
 
 #include "ac107_accessory_impl_linux.h"
+#include "t507_clk_plan.h"
+#include "t507_regsnap_uapi.h"
 #include "audio_accessory_base.h"
 #include "audio_stream_dispatch.h"
 #include "audio_driver_log.h"
@@ -78,6 +82,7 @@ struct ac107_priv {
     struct snd_soc_component *component;
     struct ac107_voltage_supply vol_supply;
     int reset_gpio;
+    struct dentry *debugfs_dir;
 };
 
 static const struct regmap_config ac107_regmap_config = {
@@ -769,7 +774,7 @@ static int ac107_hw_params(enum AudioStreamType streamType, enum AudioFormat for
 int32_t Ac107DaiHwParams(const struct AudioCard *card, const struct AudioPcmHwParams *param)
 {
     int ret;
-    uint32_t freq_point;
+    struct T507ClkPlan plan;
 
     uint32_t dai_fmt = 0;
     dai_fmt |= SND_SOC_DAIFMT_I2S;
@@ -783,33 +788,13 @@ int32_t Ac107DaiHwParams(const struct AudioCard *card, const struct AudioPcmHwPa
         return HDF_SUCCESS;
     }
 
-    /* set pll clk */
-    switch (param->rate) {
-        case 8000:
-        case 12000:
-        case 16000:
-        case 24000:
-        case 32000:
-        case 48000:
-        case 64000:
-        case 96000:
-        case 192000:
-            freq_point = 24576000;
-            break;
-        case 11025:
-        case 22050:
-        case 44100:
-        case 88200:
-        case 176400:
-            freq_point = 22579200;
-            break;
-        default:
-            AUDIO_DRIVER_LOG_ERR("rate: %d is not define.", param->rate);
-            return HDF_FAILURE;
+    /* pll clk follows the ahub mclk family */
+    if (T507ClkPlanLookup(param->rate, 0, 0, &plan) != HDF_SUCCESS) {
+        return HDF_FAILURE;
     }
-    AUDIO_DRIVER_LOG_DEBUG(" freq_point %u", freq_point);
+    AUDIO_DRIVER_LOG_DEBUG(" freq_point %u", plan.freqPoint);
 
-    ret = ac107_set_pll(freq_point);
+    ret = ac107_set_pll(plan.freqPoint);
     if (ret) {
         AUDIO_DRIVER_LOG_ERR("ac107_set_pll failed");
         return HDF_FAILURE;
@@ -1012,20 +997,119 @@ static ssize_t ac107_store(struct device *dev, struct device_attribute *attr, co
     return count;
 }
 
+/*
+ * Register snapshot over i2c, read in one pass and formatted after, same layout
+ * as the ahub. The first failed read ends the bus accesses, so a chip that is
+ * off or gone costs one error line rather than one per register; *valid is
+ * the number of registers actually read.
+ */
+static size_t ac107_reg_snapshot(struct i2c_client *i2c, uint8_t *vals, size_t *valid)
+{
+    size_t i;
+
+    *valid = 0;
+    for (i = 0; i < ARRAY_SIZE(g_reg_labels) && g_reg_labels[i].name != NULL; i++) {
+        vals[i] = 0;
+        if (*valid == i && ac107_read(g_reg_labels[i].address, &vals[i], i2c) == 0) {
+            (*valid)++;
+        }
+    }
+
+    return i;
+}
+
+static int ac107_regs_show(struct seq_file *m, void *v)
+{
+    struct ac107_priv *ac107 = m->private;
+    uint8_t vals[ARRAY_SIZE(g_reg_labels)];
+    size_t num, valid, i;
+
+    (void)v;
+
+    num = ac107_reg_snapshot(ac107->i2c, vals, &valid);
+    for (i = 0; i < num; i++) {
+        if (i < valid) {
+            seq_printf(m, "0x%02x 0x%02x %s\n", g_reg_labels[i].address, vals[i], g_reg_labels[i].name);
+        } else {
+            seq_printf(m, "0x%02x ---- %s\n", g_reg_labels[i].address, g_reg_labels[i].name);
+        }
+    }
+
+    return 0;
+}
+
+static int ac107_regs_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, ac107_regs_show, inode->i_private);
+}
+
+static const struct file_operations g_ac107_regs_fops = {
+    .owner      = THIS_MODULE,
+    .open       = ac107_regs_open,
+    .read       = seq_read,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
+/* the same snapshot in the binary layout of t507_regsnap_uapi.h, id is the chip's i2c address */
+static int ac107_regs_bin_show(struct seq_file *m, void *v)
+{
+    struct ac107_priv *ac107 = m->private;
+    uint8_t vals[ARRAY_SIZE(g_reg_labels)];
+    struct T507RegSnapHeader hdr;
+    struct T507RegSnapEntry entry;
+    size_t num, valid, i;
+
+    (void)v;
+
+    num = ac107_reg_snapshot(ac107->i2c, vals, &valid);
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.tstampNs = ktime_get_ns();
+    hdr.magic = T507_REGSNAP_MAGIC;
+    hdr.version = T507_REGSNAP_VERSION;
+    hdr.count = (__u16)num;
+    hdr.block = T507_REGSNAP_AC107;
+    hdr.valBytes = sizeof(vals[0]);
+    hdr.id = ac107->i2c->addr;
+    seq_write(m, &hdr, sizeof(hdr));
+    for (i = 0; i < num; i++) {
+        entry.addr = (__u16)g_reg_labels[i].address;
+        entry.flags = (i < valid) ? 0 : T507_REGSNAP_F_NOREAD;
+        entry.val = vals[i];
+        seq_write(m, &entry, sizeof(entry));
+    }
+
+    return 0;
+}
+
+static int ac107_regs_bin_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, ac107_regs_bin_show, inode->i_private);
+}
+
+static const struct file_operations g_ac107_regs_bin_fops = {
+    .owner      = THIS_MODULE,
+    .open       = ac107_regs_bin_open,
+    .read       = seq_read,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
 static ssize_t ac107_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
     struct ac107_priv *ac107 = dev_get_drvdata(dev);
-    size_t count = 0, i = 0;
-    uint8_t reg_val;
-    uint32_t size = ARRAY_SIZE(g_reg_labels);
-
-    while ((i < size) && (g_reg_labels[i].name != NULL)) {
-        ac107_read(g_reg_labels[i].address, &reg_val, ac107->i2c);
-        pr_info("%-30s [0x%03x]: 0x%8x save_val:0x%x",
-                g_reg_labels[i].name,
-                g_reg_labels[i].address, reg_val,
-                g_reg_labels[i].value);
-        i++;
+    uint8_t vals[ARRAY_SIZE(g_reg_labels)];
+    size_t count = 0, i, num, valid;
+
+    num = ac107_reg_snapshot(ac107->i2c, vals, &valid);
+    for (i = 0; i < num; i++) {
+        if (i < valid) {
+            count += scnprintf(buf + count, PAGE_SIZE - count, "0x%02x 0x%02x %s\n",
+                g_reg_labels[i].address, vals[i], g_reg_labels[i].name);
+        } else {
+            count += scnprintf(buf + count, PAGE_SIZE - count, "0x%02x ---- %s\n",
+                g_reg_labels[i].address, g_reg_labels[i].name);
+        }
     }
 
     return count;
@@ -1127,6 +1211,13 @@ static int ac107_i2c_probe(struct i2c_client *i2c, const struct i2c_device_id *i
         AUDIO_DRIVER_LOG_ERR("failed to create attr group");
     }
 
+    /* one directory per chip, named after the i2c client */
+    ac107->debugfs_dir = debugfs_create_dir(dev_name(&i2c->dev), NULL);
+    if (!IS_ERR_OR_NULL(ac107->debugfs_dir)) {
+        debugfs_create_file("regs", 0444, ac107->debugfs_dir, ac107, &g_ac107_regs_fops);
+        debugfs_create_file("regs.bin", 0444, ac107->debugfs_dir, ac107, &g_ac107_regs_bin_fops);
+    }
+
     AUDIO_DRIVER_LOG_DEBUG("register ac107-codec codec success");
 
     return ret;
@@ -1134,8 +1225,13 @@ static int ac107_i2c_probe(struct i2c_client *i2c, const struct i2c_device_id *i
 
 static int ac107_i2c_remove(struct i2c_client *i2c)
 {
+    struct ac107_priv *ac107 = dev_get_drvdata(&i2c->dev);
+
     /* change:used alsa */
 
+    if (ac107 != NULL) {
+        debugfs_remove_recursive(ac107->debugfs_dir);
+    }
     sysfs_remove_group(&i2c->dev.kobj, &ac107_debug_attr_group);
     return 0;
 }
@@ -30,6 +30,7 @@ extern "C" {
 #endif /* __cplusplus */
 
 #define SUNXI_DAC_DPC       0x00
+#define SUNXI_DAC_VOL_CTRL  0x04
 #define SUNXI_DAC_FIFO_CTL  0x10
 #define SUNXI_DAC_FIFO_STA  0x14
 
@@ -48,6 +49,37 @@ extern "C" {
 #define SUNXI_DAC_DAP_CTL   0xf0
 #define SUNXI_ADC_DAP_CTL   0xf8
 
+/* DAC DRC, 32 bit coefficients split over a high and a low 16 bit register */
+#define AC_DAC_DRC_CTRL     0x108
+#define AC_DAC_DRC_LPFHAT   0x10c
+#define AC_DAC_DRC_LPFLAT   0x110
+#define AC_DAC_DRC_RPFHAT   0x114
+#define AC_DAC_DRC_RPFLAT   0x118
+#define AC_DAC_DRC_LPFHRT   0x11c
+#define AC_DAC_DRC_LPFLRT   0x120
+#define AC_DAC_DRC_RPFHRT   0x124
+#define AC_DAC_DRC_RPFLRT   0x128
+#define AC_DAC_DRC_LRMSHAT  0x12c
+#define AC_DAC_DRC_LRMSLAT  0x130
+#define AC_DAC_DRC_RRMSHAT  0x134
+#define AC_DAC_DRC_RRMSLAT  0x138
+#define AC_DAC_DRC_HCT      0x13c
+#define AC_DAC_DRC_LCT      0x140
+#define AC_DAC_DRC_HKC      0x144
+#define AC_DAC_DRC_LKC      0x148
+#define AC_DAC_DRC_HOPC     0x14c
+#define AC_DAC_DRC_LOPC     0x150
+#define AC_DAC_DRC_HLT      0x154
+#define AC_DAC_DRC_LLT      0x158
+#define AC_DAC_DRC_HKI      0x15c
+#define AC_DAC_DRC_LKI      0x160
+#define AC_DAC_DRC_HOPL     0x164
+#define AC_DAC_DRC_LOPL     0x168
+#define AC_DAC_DRC_SFHAT    0x18c
+#define AC_DAC_DRC_SFLAT    0x190
+#define AC_DAC_DRC_SFHRT    0x194
+#define AC_DAC_DRC_SFLRT    0x198
+
 /* DAC */
 #define AC_DAC_REG          0x310
 #define AC_MIXER_REG        0x314
@@ -62,6 +94,20 @@ extern "C" {
 #define DVOL                12
 #define DAC_HUB_EN          0
 
+/* SUNXI_DAC_VOL_CTRL:0x04 */
+#define DAC_VOL_SEL         16
+#define DAC_VOL_L           8
+#define DAC_VOL_R           0
+
+/* SUNXI_DAC_DAP_CTL:0xf0 */
+#define DDAP_EN             31
+#define DDAP_DRC_EN         29
+#define DDAP_HPF_EN         28
+
+/* AC_DAC_DRC_CTRL:0x108 */
+#define DRC_LT_EN           1
+#define DRC_ET_EN           0
+
 /* SUNXI_DAC_FIFO_CTL:0x10 */
 #define DAC_FS              29
 #define FIR_VER             28
@@ -164,6 +210,9 @@ int32_t T507CodecImplSetCtrlOps(const struct AudioKcontrol *kcontrol, const stru
 int32_t T507CodecImplStartup(enum AudioStreamType streamType);
 int32_t T507CodecImplHwParams(enum AudioStreamType streamType, enum AudioFormat format, uint32_t channels, uint32_t rate);
 int32_t T507CodecImplTrigger(enum AudioStreamType streamType, bool enable);
+bool T507CodecImplXrunCheck(enum AudioStreamType streamType);
+int32_t T507CodecImplXrunRecover(enum AudioStreamType streamType);
+uint32_t T507CodecImplFifoAvail(enum AudioStreamType streamType, uint32_t *count);
 
 int32_t T507CodecImplRegDefaultInit(struct AudioRegCfgGroupNode **regCfgGroup);
 
@@ -23,10 +23,22 @@
 #include <linux/device.h>
 #include <linux/ioport.h>
 #include <linux/regmap.h>
+#include <linux/pm.h>
+#include <linux/pm_runtime.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/of_address.h>
 #include <linux/of_gpio.h>
 
 #include "t507_codec_impl_linux.h"
+#include "t507_clk_plan.h"
+#include "t507_audio_trace.h"
+#include "t507_dma_ops.h"
+#include "t507_regsnap_uapi.h"
 #include "audio_control.h"
 #include "audio_core.h"
 #include "audio_driver_log.h"
@@ -38,14 +50,40 @@
 
 #define DRV_NAME    "sunxi-snd-codec"
 
+#define SUNXI_CODEC_AUTOSUSPEND_MS      2000    /* idle time before clocks and avcc are gated */
+#define SUNXI_CODEC_RESUME_BUDGET_US    5000    /* stream start after autosuspend must stay below */
+#define SUNXI_CODEC_VOL_RAMP_US         1000    /* dwell per lineout volume code, 1.5 dB */
+
 static struct platform_device *g_codec_pdev;
 
+/* fifo status, data and count, and the fifo ctl with its self-clearing flush bit */
+static bool sunxi_codec_volatile_reg(struct device *dev, unsigned int reg)
+{
+    (void)dev;
+
+    switch (reg) {
+        case SUNXI_DAC_FIFO_CTL:
+        case SUNXI_DAC_FIFO_STA:
+        case SUNXI_DAC_TXDATA:
+        case SUNXI_DAC_CNT:
+        case SUNXI_ADC_FIFO_CTL:
+        case SUNXI_ADC_FIFO_STA:
+        case SUNXI_ADC_RXDATA:
+        case SUNXI_ADC_CNT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* cached so kcontrol writes land while runtime suspended and are synced on resume */
 static struct regmap_config g_codec_regmap_config = {
     .reg_bits = 32,
     .reg_stride = 4,
     .val_bits = 32,
     .max_register = SUNXI_AUDIO_MAX_REG,
-    .cache_type = REGCACHE_NONE,
+    .volatile_reg = sunxi_codec_volatile_reg,
+    .cache_type = REGCACHE_RBTREE,
 };
 
 struct sunxi_codec_mem_info {
@@ -67,6 +105,33 @@ struct sunxi_codec_rglt_info {
 
 struct sunxi_codec_dts_info {
     uint32_t lineout_vol;
+    uint32_t autosuspend_ms;
+    uint32_t vol_ramp_us;
+    bool init_verify;
+};
+
+/* the codec kcontrols, index into g_codec_kctrls and sunxi_codec_info.kctrl */
+enum sunxi_codec_kctrl_idx {
+    KCTRL_RENDER_VOL = 0,
+    KCTRL_RENDER_MUTE,
+    KCTRL_DAC_VOL_L,
+    KCTRL_DAC_VOL_R,
+    KCTRL_DAC_HPF,
+    KCTRL_DAC_SWAP,
+    KCTRL_DAC_MONO_MIX,
+    KCTRL_DRC_ENABLE,
+    KCTRL_DRC_COMP_THR,
+    KCTRL_DRC_COMP_RATIO,
+    KCTRL_DRC_LIMIT_THR,
+    KCTRL_DRC_ATTACK,
+    KCTRL_DRC_RELEASE,
+    KCTRL_DRC_PRESET,
+    KCTRL_NUM,
+};
+
+struct sunxi_codec_kctrl_val {
+    uint32_t value;
+    bool dirty;
 };
 
 struct sunxi_codec_info {
@@ -77,6 +142,37 @@ struct sunxi_codec_info {
     struct sunxi_codec_rglt_info rglt_info;
     struct sunxi_codec_dts_info dts_info;
 
+    struct dentry *debugfs_dir;
+
+    /* runtime pm: each direction holds a reference from trigger start to stop */
+    bool render_on;
+    bool capture_on;
+    u32 resume_last_us;
+    u32 resume_max_us;
+    u32 resume_over_budget;
+
+    /* boot path: probe start to default registers applied, and what the batch did */
+    u64 probe_start_ns;
+    u32 init_ready_us;
+    u32 init_written;
+    u32 init_skipped;
+    u32 init_mismatch;
+
+    /* kcontrol values and lineout ramp against trigger */
+    struct mutex ctrl_lock;
+    struct sunxi_codec_kctrl_val kctrl[KCTRL_NUM];
+    /*
+     * lineout volume as currently programmed; vol_work moves it from vol_from
+     * toward vol_target at one code per vol_ramp_us counted from vol_start_ns
+     */
+    uint32_t vol_cur;
+    uint32_t vol_target;
+    uint32_t vol_from;
+    u64 vol_start_ns;
+    struct delayed_work vol_work;
+    /* rate the drc coefficients are computed for */
+    uint32_t drc_rate;
+
     /* uint32_t pa_pin_max; */
     /* struct pa_config *pa_cfg; */
 };
@@ -90,54 +186,324 @@ struct reg_label {
 };
 static struct reg_label g_reg_labels[] = {
     REG_LABEL(SUNXI_DAC_DPC),
+    REG_LABEL(SUNXI_DAC_VOL_CTRL),
     REG_LABEL(SUNXI_DAC_FIFO_CTL),
     REG_LABEL(SUNXI_DAC_FIFO_STA),
     REG_LABEL(SUNXI_DAC_CNT),
     REG_LABEL(SUNXI_DAC_DG_REG),
+    REG_LABEL(SUNXI_ADC_FIFO_CTL),
+    REG_LABEL(SUNXI_ADC_FIFO_STA),
+    REG_LABEL(SUNXI_ADC_CNT),
+    REG_LABEL(SUNXI_ADC_DG_REG),
     REG_LABEL(AC_DAC_REG),
     REG_LABEL(AC_MIXER_REG),
     REG_LABEL(AC_RAMP_REG),
     REG_LABEL_END,
 };
 
+/*
+ * The one list of codec rates: DAC_FS/ADC_FS code and whether the adc takes
+ * it. 64 kHz has no fs code and the adc decimator stops at 48 kHz; the clock
+ * plan carries the same per-user subset. Checked against it at probe.
+ *
+ * The fs code only picks a divider of the module clock (g_codec_fs_div), it
+ * does not name a rate. 88.2k/176.4k use the 96k/192k codes (7/6), and every
+ * 44.1k family rate the code of its 48k sibling, which is only right while the
+ * module clock runs at 2 x 22.5792 MHz for them: the clock plan must put
+ * those rates on T507_CLK_FREQ_44K1_FAMILY. sunxi_codec_rate_table_check
+ * asserts rate * divider == family for every entry.
+ */
 struct sample_rate {
     uint32_t samplerate;
     uint32_t rate_bit;
+    bool capture;
 };
 static const struct sample_rate g_sample_rate_conv[] = {
-    {44100, 0},
-    {48000, 0},
-    {8000, 5},
-    {32000, 1},
-    {22050, 2},
-    {24000, 2},
-    {16000, 3},
-    {11025, 4},
-    {12000, 4},
-    {192000, 6},
-    {96000, 7},
+    {8000,   5, true},
+    {11025,  4, true},
+    {12000,  4, true},
+    {16000,  3, true},
+    {22050,  2, true},
+    {24000,  2, true},
+    {32000,  1, true},
+    {44100,  0, true},
+    {48000,  0, true},
+    {88200,  7, false},
+    {96000,  7, false},
+    {176400, 6, false},
+    {192000, 6, false},
 };
 
+/* family clock / fs for each DAC_FS/ADC_FS code */
+static const uint32_t g_codec_fs_div[] = {512, 768, 1024, 1536, 2048, 3072, 128, 256};
+
+static const struct sample_rate *sunxi_codec_rate_find(uint32_t rate)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_sample_rate_conv); i++) {
+        if (g_sample_rate_conv[i].samplerate == rate) {
+            return &g_sample_rate_conv[i];
+        }
+    }
+
+    return NULL;
+}
+
+static const struct sample_rate *sunxi_codec_rate_lookup(enum AudioStreamType streamType, uint32_t rate)
+{
+    const struct sample_rate *conv = sunxi_codec_rate_find(rate);
+
+    if (conv != NULL && (streamType == AUDIO_RENDER_STREAM || conv->capture)) {
+        return conv;
+    }
+
+    AUDIO_DRIVER_LOG_ERR("%s rate: %u is not support.", streamType == AUDIO_CAPTURE_STREAM ? "capture" : "render",
+        rate);
+    return NULL;
+}
+
+/* both directions of the codec table agree with the clock plan, and the fs code divides the planned family */
+static int sunxi_codec_rate_table_check(void)
+{
+    size_t i;
+    uint32_t idx, rate;
+    struct T507ClkPlan plan;
+    const struct sample_rate *conv = NULL;
+
+    for (i = 0; i < ARRAY_SIZE(g_sample_rate_conv); i++) {
+        conv = &g_sample_rate_conv[i];
+        if (T507ClkPlanLookup(conv->samplerate, 0, 0, &plan) != HDF_SUCCESS) {
+            AUDIO_DRIVER_LOG_ERR("rate %u has no clock plan", conv->samplerate);
+            return -EINVAL;
+        }
+        if (conv->rate_bit >= ARRAY_SIZE(g_codec_fs_div) ||
+            conv->samplerate * g_codec_fs_div[conv->rate_bit] != plan.freqPoint) {
+            AUDIO_DRIVER_LOG_ERR("rate %u: fs code %u does not divide pll %u", conv->samplerate,
+                conv->rate_bit, plan.freqPoint);
+            return -EINVAL;
+        }
+    }
+
+    for (idx = 0; (rate = T507ClkPlanRateAt(T507_CLK_CODEC_RENDER, idx)) != 0; idx++) {
+        if (sunxi_codec_rate_find(rate) == NULL) {
+            AUDIO_DRIVER_LOG_ERR("clock plan gives the codec %u Hz, it has no fs code", rate);
+            return -EINVAL;
+        }
+    }
+    if (idx != ARRAY_SIZE(g_sample_rate_conv)) {
+        AUDIO_DRIVER_LOG_ERR("codec has %zu rates, clock plan %u", ARRAY_SIZE(g_sample_rate_conv), idx);
+        return -EINVAL;
+    }
+    for (idx = 0; (rate = T507ClkPlanRateAt(T507_CLK_CODEC_CAPTURE, idx)) != 0; idx++) {
+        conv = sunxi_codec_rate_find(rate);
+        if (conv == NULL || !conv->capture) {
+            AUDIO_DRIVER_LOG_ERR("clock plan gives the adc %u Hz, it can not run it", rate);
+            return -EINVAL;
+        }
+    }
+    for (i = 0; i < ARRAY_SIZE(g_sample_rate_conv); i++) {
+        idx -= g_sample_rate_conv[i].capture ? 1 : 0;
+    }
+    if (idx != 0) {
+        AUDIO_DRIVER_LOG_ERR("codec capture rates and clock plan differ");
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+enum sunxi_codec_kctrl_kind {
+    SUNXI_KCTRL_FIELD = 0,  /* a register field */
+    SUNXI_KCTRL_RAMP,       /* lineout gain and mute, stepped by sunxi_codec_vol_ramp */
+    SUNXI_KCTRL_DRC,        /* drc parameter, compiled into coefficients */
+    SUNXI_KCTRL_PRESET,     /* loads a set of drc parameters */
+};
+
+/* drc presets for the speaker path, in the units of the drc kcontrols */
+struct sunxi_codec_drc_preset {
+    const char *name;
+    uint32_t enable;
+    uint32_t comp_thr;
+    uint32_t comp_ratio;
+    uint32_t limit_thr;
+    uint32_t attack;
+    uint32_t release;
+};
+
+static const struct sunxi_codec_drc_preset g_drc_presets[] = {
+    {"off",     0, 24, 3, 3,  10, 100},
+    {"speaker", 1, 24, 3, 3,  10, 100},
+    {"night",   1, 40, 6, 12, 10, 300},
+    {"limiter", 1, 6,  1, 1,  5,  50},
+};
+
+/*
+ * codec_config.hcs names a kcontrol by reg/shift (rreg/rshift). A register
+ * field keeps its register offset and field shift, as vendor configs have it.
+ * Lineout volume and mute keep the 0x00/0x02 ids of the original driver.
+ * The drc parameters have no register and sit above the register map.
+ */
 #define KCONTROL_RENDER_VOL     0x00
 #define KCONTROL_RENDER_MUTE    0x02
+#define KCONTROL_VIRT_BASE      0x1000
+#define KCONTROL_DRC_COMP_THR   (KCONTROL_VIRT_BASE + 0x00)     /* dB below full scale */
+#define KCONTROL_DRC_COMP_RATIO (KCONTROL_VIRT_BASE + 0x04)     /* n:1 */
+#define KCONTROL_DRC_LIMIT_THR  (KCONTROL_VIRT_BASE + 0x08)     /* dB below full scale */
+#define KCONTROL_DRC_ATTACK     (KCONTROL_VIRT_BASE + 0x0c)     /* 0.1 ms */
+#define KCONTROL_DRC_RELEASE    (KCONTROL_VIRT_BASE + 0x10)     /* ms */
+#define KCONTROL_DRC_PRESET     (KCONTROL_VIRT_BASE + 0x14)     /* index into g_drc_presets */
 
-struct KcontrolRender {
-    uint32_t vol;
-    uint32_t mute;
+/*
+ * One codec control: the field is value * unit in reg, with extra bits set
+ * alongside. unit is normally 1 << shift; mono mix sets both cross-mix bits
+ * with one unit. Values live in sunxi_codec_info.kctrl, gets never read the
+ * hardware, sets mark the value dirty and sunxi_codec_kctrl_flush writes all
+ * dirty fields in one batch: at once while rendering, else at the next
+ * render start.
+ */
+struct sunxi_codec_kctrl {
+    uint32_t reg;
+    uint32_t shift;
+    enum sunxi_codec_kctrl_kind kind;
+    uint32_t unit;
+    uint32_t max;
+    uint32_t set;
+    uint32_t def;
+};
 
-    uint32_t todo;
+static const struct sunxi_codec_kctrl g_codec_kctrls[KCTRL_NUM] = {
+    [KCTRL_RENDER_VOL] = {KCONTROL_RENDER_VOL, 0, SUNXI_KCTRL_RAMP, 0, 0x1f, 0, 0x1f},
+    [KCTRL_RENDER_MUTE] = {KCONTROL_RENDER_MUTE, 0, SUNXI_KCTRL_RAMP, 0, 1, 0, 0},
+    [KCTRL_DAC_VOL_L] = {SUNXI_DAC_VOL_CTRL, DAC_VOL_L, SUNXI_KCTRL_FIELD, 1 << DAC_VOL_L, 0xff,
+        1 << DAC_VOL_SEL, 0xa0},
+    [KCTRL_DAC_VOL_R] = {SUNXI_DAC_VOL_CTRL, DAC_VOL_R, SUNXI_KCTRL_FIELD, 1 << DAC_VOL_R, 0xff,
+        1 << DAC_VOL_SEL, 0xa0},
+    [KCTRL_DAC_HPF] = {SUNXI_DAC_DPC, HPF_EN, SUNXI_KCTRL_FIELD, 1 << HPF_EN, 1, 0, 0},
+    [KCTRL_DAC_SWAP] = {SUNXI_DAC_DG_REG, DA_SWP, SUNXI_KCTRL_FIELD, 1 << DA_SWP, 1, 0, 0},
+    [KCTRL_DAC_MONO_MIX] = {AC_MIXER_REG, RMIX_LDAC, SUNXI_KCTRL_FIELD, (1 << LMIX_RDAC) | (1 << RMIX_LDAC), 1, 0, 0},
+    [KCTRL_DRC_ENABLE] = {SUNXI_DAC_DAP_CTL, DDAP_DRC_EN, SUNXI_KCTRL_FIELD, (1 << DDAP_EN) | (1 << DDAP_DRC_EN), 1,
+        0, 0},
+    [KCTRL_DRC_COMP_THR] = {KCONTROL_DRC_COMP_THR, 0, SUNXI_KCTRL_DRC, 0, 60, 0, 24},
+    [KCTRL_DRC_COMP_RATIO] = {KCONTROL_DRC_COMP_RATIO, 0, SUNXI_KCTRL_DRC, 0, 32, 0, 3},
+    [KCTRL_DRC_LIMIT_THR] = {KCONTROL_DRC_LIMIT_THR, 0, SUNXI_KCTRL_DRC, 0, 30, 0, 3},
+    [KCTRL_DRC_ATTACK] = {KCONTROL_DRC_ATTACK, 0, SUNXI_KCTRL_DRC, 0, 1000, 0, 10},
+    [KCTRL_DRC_RELEASE] = {KCONTROL_DRC_RELEASE, 0, SUNXI_KCTRL_DRC, 0, 2000, 0, 100},
+    [KCTRL_DRC_PRESET] = {KCONTROL_DRC_PRESET, 0, SUNXI_KCTRL_PRESET, 0, ARRAY_SIZE(g_drc_presets) - 1, 0, 0},
 };
 
-struct KcontrolRender g_KctrlRender = {
-    .vol = 0x1f,
-    .mute = false,
+/* hcs reg/shift to a table index, -1 for a control the codec does not have */
+static int sunxi_codec_kctrl_find(uint32_t reg, uint32_t shift)
+{
+    int i;
+
+    for (i = 0; i < KCTRL_NUM; i++) {
+        if (g_codec_kctrls[i].reg == reg && g_codec_kctrls[i].shift == shift) {
+            return i;
+        }
+    }
 
-    .todo = 0,
-};
+    AUDIO_DRIVER_LOG_ERR("kcontrol reg 0x%x shift %u is not define.", reg, shift);
+    return -1;
+}
+
+/* register access outside a running stream, wakes the codec and rearms autosuspend on put */
+static int sunxi_codec_pm_get(struct sunxi_codec_info *codec_info)
+{
+    int ret;
+
+    ret = pm_runtime_get_sync(&codec_info->pdev->dev);
+    if (ret < 0) {
+        pm_runtime_put_noidle(&codec_info->pdev->dev);
+        AUDIO_DRIVER_LOG_ERR("runtime resume failed %d", ret);
+        return ret;
+    }
+
+    return 0;
+}
+
+static void sunxi_codec_pm_put(struct sunxi_codec_info *codec_info)
+{
+    pm_runtime_mark_last_busy(&codec_info->pdev->dev);
+    pm_runtime_put_autosuspend(&codec_info->pdev->dev);
+}
+
+/* volume the user asked for, 0 is lineout mute */
+static uint32_t sunxi_codec_vol_target(const struct sunxi_codec_info *codec_info)
+{
+    if (codec_info->kctrl[KCTRL_RENDER_MUTE].value) {
+        return 0;
+    }
+    return codec_info->kctrl[KCTRL_RENDER_VOL].value;
+}
+
+static void sunxi_codec_vol_write(struct sunxi_codec_info *codec_info, uint32_t vol)
+{
+    codec_info->vol_cur = vol;
+    regmap_update_bits(codec_info->mem_info.regmap, AC_DAC_REG, 0x1F << LINEOUT_VOL, vol << LINEOUT_VOL);
+}
+
+/*
+ * Move LINEOUT_VOL to target. A smooth change is handed to vol_work, so the
+ * caller never sleeps; otherwise the value is written at once and any ramp
+ * in flight is dropped. Call with ctrl_lock held.
+ */
+static void sunxi_codec_vol_ramp(struct sunxi_codec_info *codec_info, uint32_t target, bool smooth)
+{
+    codec_info->vol_target = target;
+    if (!smooth || codec_info->dts_info.vol_ramp_us == 0) {
+        cancel_delayed_work(&codec_info->vol_work);
+        sunxi_codec_vol_write(codec_info, target);
+        return;
+    }
+    if (codec_info->vol_cur == target) {
+        cancel_delayed_work(&codec_info->vol_work);
+        return;
+    }
+    codec_info->vol_from = codec_info->vol_cur;
+    codec_info->vol_start_ns = ktime_get_ns();
+    mod_delayed_work(system_wq, &codec_info->vol_work, 0);
+}
+
+/*
+ * The work runs at jiffy granularity (4-10 ms), far coarser than the
+ * 1000 us per code default. Each run writes the code the ramp should have
+ * reached by now, so a full 31-code fade takes 31 x vol_ramp_us plus at most
+ * one tick instead of 31 ticks; the steps just get coarser at low HZ.
+ */
+static void sunxi_codec_vol_work(struct work_struct *work)
+{
+    struct sunxi_codec_info *codec_info = container_of(to_delayed_work(work), struct sunxi_codec_info, vol_work);
+    uint64_t step_ns = (uint64_t)codec_info->dts_info.vol_ramp_us * NSEC_PER_USEC;
+    uint64_t elapsed;
+    uint32_t codes, dist, next;
+
+    mutex_lock(&codec_info->ctrl_lock);
+    /* the first code goes out at once */
+    elapsed = ktime_get_ns() - codec_info->vol_start_ns;
+    codes = (uint32_t)min_t(uint64_t, div_u64(elapsed, step_ns) + 1, 0x1f);
+    if (codec_info->vol_from < codec_info->vol_target) {
+        dist = codec_info->vol_target - codec_info->vol_from;
+        next = codec_info->vol_from + min(codes, dist);
+    } else {
+        dist = codec_info->vol_from - codec_info->vol_target;
+        next = codec_info->vol_from - min(codes, dist);
+    }
+    if (next != codec_info->vol_cur) {
+        sunxi_codec_vol_write(codec_info, next);
+    }
+    if (codes < dist) {
+        /* due time of the next code, the timer rounds it up to a jiffy */
+        elapsed = (uint64_t)codes * step_ns - elapsed;
+        schedule_delayed_work(&codec_info->vol_work, max(nsecs_to_jiffies(elapsed), 1UL));
+    }
+    mutex_unlock(&codec_info->ctrl_lock);
+}
 
 /*******************************************************************************
  *  for adm api
  ******************************************************************************/
+/* kcontrol access, while suspended the regmap answers and collects from its cache */
 void T507CodecImplRegmapWrite(uint32_t reg, uint32_t val)
 {
     struct sunxi_codec_info *codec_info = dev_get_drvdata(&g_codec_pdev->dev);
@@ -156,9 +522,9 @@ void T507CodecImplRegmapRead(uint32_t reg, uint32_t *val)
 
 int32_t T507CodecImplGetCtrlOps(const struct AudioKcontrol *kcontrol, struct AudioCtrlElemValue *elemValue)
 {
-    uint32_t curValue;
-    uint32_t rcurValue;
+    int idx, ridx;
     struct AudioMixerControl *mixerCtrl = NULL;
+    struct sunxi_codec_info *codec_info = dev_get_drvdata(&g_codec_pdev->dev);
 
     AUDIO_DRIVER_LOG_DEBUG("");
 
@@ -172,23 +538,15 @@ int32_t T507CodecImplGetCtrlOps(const struct AudioKcontrol *kcontrol, struct Aud
         return HDF_FAILURE;
     }
 
-    switch (mixerCtrl->reg) {
-        case KCONTROL_RENDER_VOL:
-            curValue = g_KctrlRender.vol;
-            rcurValue = g_KctrlRender.vol;
-            break;
-        case KCONTROL_RENDER_MUTE:
-            curValue = g_KctrlRender.mute;
-            rcurValue = g_KctrlRender.mute;
-            break;
-        default:
-            curValue = g_KctrlRender.todo;
-            rcurValue = g_KctrlRender.todo;
-            break;
+    idx = sunxi_codec_kctrl_find(mixerCtrl->reg, mixerCtrl->shift);
+    ridx = sunxi_codec_kctrl_find(mixerCtrl->rreg, mixerCtrl->rshift);
+    if (idx < 0 || ridx < 0) {
+        return HDF_ERR_NOT_SUPPORT;
     }
 
-    if (AudioGetCtrlOpsReg(elemValue, mixerCtrl, curValue) != HDF_SUCCESS ||
-        AudioGetCtrlOpsRReg(elemValue, mixerCtrl, rcurValue) != HDF_SUCCESS) {
+    /* the base helpers take the field where the hcs shift says it is */
+    if (AudioGetCtrlOpsReg(elemValue, mixerCtrl, codec_info->kctrl[idx].value << mixerCtrl->shift) != HDF_SUCCESS ||
+        AudioGetCtrlOpsRReg(elemValue, mixerCtrl, codec_info->kctrl[ridx].value << mixerCtrl->rshift) != HDF_SUCCESS) {
         AUDIO_DRIVER_LOG_ERR("Audio codec get kcontrol reg and rreg failed.");
         return HDF_FAILURE;
     }
@@ -196,42 +554,259 @@ int32_t T507CodecImplGetCtrlOps(const struct AudioKcontrol *kcontrol, struct Aud
     return HDF_SUCCESS;
 }
 
-static void T507CodecImplUpdateRegBits(const struct AudioMixerControl *mixerControl, uint32_t value)
+static void sunxi_codec_kctrl_set(struct sunxi_codec_info *codec_info, int idx, uint32_t value)
 {
-    struct sunxi_codec_info *codec_info = dev_get_drvdata(&g_codec_pdev->dev);
-    struct regmap *regmap = codec_info->mem_info.regmap;
+    struct sunxi_codec_kctrl_val *val = &codec_info->kctrl[idx];
 
-    if (mixerControl == NULL) {
-        AUDIO_DRIVER_LOG_ERR("param mixerControl is null.");
-        return;
+    if (val->value != value) {
+        val->value = value;
+        val->dirty = true;
     }
+}
 
-    AUDIO_DRIVER_LOG_DEBUG("value -> %u", value);
+/* a preset only rewrites the drc kcontrols, they stay readable and can be tuned on top */
+static void sunxi_codec_drc_preset(struct sunxi_codec_info *codec_info, uint32_t index)
+{
+    const struct sunxi_codec_drc_preset *preset = &g_drc_presets[index];
+
+    AUDIO_DRIVER_LOG_DEBUG("drc preset %s", preset->name);
+    sunxi_codec_kctrl_set(codec_info, KCTRL_DRC_ENABLE, preset->enable);
+    sunxi_codec_kctrl_set(codec_info, KCTRL_DRC_COMP_THR, preset->comp_thr);
+    sunxi_codec_kctrl_set(codec_info, KCTRL_DRC_COMP_RATIO, preset->comp_ratio);
+    sunxi_codec_kctrl_set(codec_info, KCTRL_DRC_LIMIT_THR, preset->limit_thr);
+    sunxi_codec_kctrl_set(codec_info, KCTRL_DRC_ATTACK, preset->attack);
+    sunxi_codec_kctrl_set(codec_info, KCTRL_DRC_RELEASE, preset->release);
+}
 
-    switch (mixerControl->reg) {
-        case KCONTROL_RENDER_VOL:
-            g_KctrlRender.vol = value;
-            break;
-        case KCONTROL_RENDER_MUTE:
-            g_KctrlRender.mute = value;
-            break;
-        default:
+static int32_t sunxi_codec_kctrl_update(struct sunxi_codec_info *codec_info, int idx, uint32_t value)
+{
+    const struct sunxi_codec_kctrl *ctrl = &g_codec_kctrls[idx];
+
+    if (value > ctrl->max) {
+        AUDIO_DRIVER_LOG_ERR("kcontrol 0x%x value %u over %u", ctrl->reg, value, ctrl->max);
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    AUDIO_DRIVER_LOG_DEBUG("kcontrol 0x%x value -> %u", ctrl->reg, value);
+    sunxi_codec_kctrl_set(codec_info, idx, value);
+    if (ctrl->kind == SUNXI_KCTRL_PRESET) {
+        sunxi_codec_drc_preset(codec_info, value);
+    }
+
+    return HDF_SUCCESS;
+}
+
+/* 14 split coefficients plus the ctrl register, see sunxi_codec_drc_compile */
+#define SUNXI_DRC_REG_NUM           29
+#define SUNXI_CODEC_KCTRL_BATCH     (KCTRL_NUM + SUNXI_DRC_REG_NUM)
+
+#define SUNXI_DRC_ONE               (1U << 24)  /* coefficients are Q24 */
+#define SUNXI_DRC_RMS_US            10000       /* level detector averaging */
+#define SUNXI_DRC_KI                0x00222222  /* limiter slope above its threshold */
+
+struct sunxi_codec_batch {
+    struct reg_sequence seq[SUNXI_CODEC_KCTRL_BATCH];
+    uint32_t mask[SUNXI_CODEC_KCTRL_BATCH];
+    int num;
+};
+
+/* merge a field into the batch, one entry per register */
+static void sunxi_codec_batch_add(struct sunxi_codec_batch *batch, uint32_t reg, uint32_t mask, uint32_t val)
+{
+    int j;
+
+    for (j = 0; j < batch->num; j++) {
+        if (batch->seq[j].reg == reg) {
             break;
+        }
+    }
+    if (j == batch->num) {
+        batch->seq[j].reg = reg;
+        batch->seq[j].def = 0;
+        batch->seq[j].delay_us = 0;
+        batch->mask[j] = 0;
+        batch->num++;
     }
+    batch->mask[j] |= mask;
+    batch->seq[j].def = (batch->seq[j].def & ~mask) | (val & mask);
+}
 
-    if (g_KctrlRender.mute) {
-        regmap_update_bits(regmap, AC_DAC_REG, 0x1F << LINEOUT_VOL, 0 << LINEOUT_VOL);
-    } else {
-        regmap_update_bits(regmap, AC_DAC_REG, 0x1F << LINEOUT_VOL, g_KctrlRender.vol << LINEOUT_VOL);
+static void sunxi_codec_batch_add32(struct sunxi_codec_batch *batch, uint32_t hreg, uint32_t lreg, uint32_t val)
+{
+    sunxi_codec_batch_add(batch, hreg, 0xffff, val >> 16);
+    sunxi_codec_batch_add(batch, lreg, 0xffff, val);
+}
+
+/* level in dB below full scale to the drc log2 format, 6.0206 dB per unit */
+static uint32_t sunxi_drc_level(uint32_t mdb)
+{
+    return (uint32_t)div_u64((u64)mdb * 10 * SUNXI_DRC_ONE, 60206);
+}
+
+/*
+ * 1 - exp(-2.2 / (fs * t)) in Q24. x is halved until the fourth order
+ * series for exp(-x) is exact, then squared back, since
+ * exp(-x) = exp(-x / 2^n)^(2^n). x reaches 2.75 at 8k with 100 us, so up
+ * to seven squarings double the rounding error each: the work is done in
+ * Q30 and rounded to Q24 at the end, which keeps the whole rate table and
+ * 100 us .. 2 s within 1 lsb. fs * t passes 2^32 from 90 ms at 48k on,
+ * hence the 64 bit divisor.
+ */
+#define SUNXI_DRC_TIME_Q            30
+#define SUNXI_DRC_TIME_ONE          (1ULL << SUNXI_DRC_TIME_Q)
+
+static uint32_t sunxi_drc_time(uint32_t rate, uint32_t us)
+{
+    u64 x = div64_u64((u64)22 * 100000 * SUNXI_DRC_TIME_ONE, (u64)rate * us);
+    u64 x2, x3, x4, e;
+    uint32_t n = 0;
+
+    while (x > (SUNXI_DRC_TIME_ONE >> 5)) {
+        x >>= 1;
+        n++;
+    }
+    x2 = (x * x) >> SUNXI_DRC_TIME_Q;
+    x3 = (x2 * x) >> SUNXI_DRC_TIME_Q;
+    x4 = (x3 * x) >> SUNXI_DRC_TIME_Q;
+    e = SUNXI_DRC_TIME_ONE - x + x2 / 2 - x3 / 6 + x4 / 24;
+    while (n-- > 0) {
+        e = (e * e + (SUNXI_DRC_TIME_ONE >> 1)) >> SUNXI_DRC_TIME_Q;
     }
+
+    return (uint32_t)((SUNXI_DRC_TIME_ONE - e + (1 << (SUNXI_DRC_TIME_Q - 25))) >> (SUNXI_DRC_TIME_Q - 24));
+}
+
+/*
+ * The drc kcontrols as coefficients at the render rate: peak detector
+ * attack/release, rms detector, gain smoothing, then the compressor
+ * (threshold, slope, output at threshold) and the limiter above it.
+ */
+static void sunxi_codec_drc_compile(struct sunxi_codec_info *codec_info, struct sunxi_codec_batch *batch)
+{
+    uint32_t rate = codec_info->drc_rate;
+    const struct sunxi_codec_kctrl_val *val = codec_info->kctrl;
+    uint32_t ct = val[KCTRL_DRC_COMP_THR].value * 1000;
+    uint32_t ratio = max_t(uint32_t, val[KCTRL_DRC_COMP_RATIO].value, 1);
+    uint32_t lt = min_t(uint32_t, val[KCTRL_DRC_LIMIT_THR].value * 1000, ct);
+    uint32_t attack = max_t(uint32_t, val[KCTRL_DRC_ATTACK].value, 1) * 100;
+    uint32_t release = max_t(uint32_t, val[KCTRL_DRC_RELEASE].value, 1) * 1000;
+    uint32_t coef, lct, llt;
+
+    coef = sunxi_drc_time(rate, attack);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_LPFHAT, AC_DAC_DRC_LPFLAT, coef);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_RPFHAT, AC_DAC_DRC_RPFLAT, coef);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_SFHAT, AC_DAC_DRC_SFLAT, coef);
+
+    coef = SUNXI_DRC_ONE - sunxi_drc_time(rate, release);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_LPFHRT, AC_DAC_DRC_LPFLRT, coef);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_RPFHRT, AC_DAC_DRC_RPFLRT, coef);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_SFHRT, AC_DAC_DRC_SFLRT, sunxi_drc_time(rate, release));
+
+    coef = sunxi_drc_time(rate, SUNXI_DRC_RMS_US);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_LRMSHAT, AC_DAC_DRC_LRMSLAT, coef);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_RRMSHAT, AC_DAC_DRC_RRMSLAT, coef);
+
+    /* the limiter output level is divided in the log domain, ratios rarely divide whole millidB */
+    lct = sunxi_drc_level(ct);
+    llt = sunxi_drc_level(lt);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_HCT, AC_DAC_DRC_LCT, lct);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_HKC, AC_DAC_DRC_LKC, SUNXI_DRC_ONE / ratio);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_HOPC, AC_DAC_DRC_LOPC, -lct);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_HLT, AC_DAC_DRC_LLT, llt);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_HKI, AC_DAC_DRC_LKI, SUNXI_DRC_KI);
+    sunxi_codec_batch_add32(batch, AC_DAC_DRC_HOPL, AC_DAC_DRC_LOPL, -(lct - DIV_ROUND_CLOSEST(lct - llt, ratio)));
+
+    sunxi_codec_batch_add(batch, AC_DAC_DRC_CTRL, (1 << DRC_LT_EN) | (1 << DRC_ET_EN), 1 << DRC_LT_EN);
+}
+
+/*
+ * Write every dirty field, merged per register into one multi-register
+ * write against the regmap cache. While runtime suspended it lands in the
+ * cache and goes out with the resume sync. Entries stay dirty if the batch
+ * can not be written. Call with ctrl_lock held.
+ */
+static int32_t sunxi_codec_kctrl_flush(struct sunxi_codec_info *codec_info)
+{
+    int i, j;
+    uint32_t old = 0;
+    bool ramp = false;
+    bool drc = false;
+    struct sunxi_codec_batch batch;
+    struct regmap *regmap = codec_info->mem_info.regmap;
+
+    batch.num = 0;
+    for (i = 0; i < KCTRL_NUM; i++) {
+        const struct sunxi_codec_kctrl *ctrl = &g_codec_kctrls[i];
+        uint32_t value = codec_info->kctrl[i].value;
+
+        if (!codec_info->kctrl[i].dirty) {
+            continue;
+        }
+        switch (ctrl->kind) {
+            case SUNXI_KCTRL_RAMP:
+                ramp = true;
+                break;
+            case SUNXI_KCTRL_DRC:
+                drc = true;
+                break;
+            case SUNXI_KCTRL_FIELD:
+                sunxi_codec_batch_add(&batch, ctrl->reg, ctrl->max * ctrl->unit | ctrl->set,
+                    value * ctrl->unit | ctrl->set);
+                break;
+            default:
+                break;
+        }
+    }
+    if (drc) {
+        sunxi_codec_drc_compile(codec_info, &batch);
+    }
+
+    for (j = 0; j < batch.num; j++) {
+        if (regmap_read(regmap, batch.seq[j].reg, &old) != 0) {
+            AUDIO_DRIVER_LOG_ERR("kcontrol read 0x%x failed", batch.seq[j].reg);
+            return HDF_FAILURE;
+        }
+        batch.seq[j].def |= old & ~batch.mask[j];
+    }
+    if (batch.num > 0 && regmap_multi_reg_write(regmap, batch.seq, batch.num) != 0) {
+        AUDIO_DRIVER_LOG_ERR("kcontrol write failed");
+        return HDF_FAILURE;
+    }
+    for (i = 0; i < KCTRL_NUM; i++) {
+        codec_info->kctrl[i].dirty = false;
+    }
+
+    /* while stopped only remember it, trigger start ramps up from silence */
+    if (ramp && codec_info->render_on) {
+        sunxi_codec_vol_ramp(codec_info, sunxi_codec_vol_target(codec_info), true);
+    }
+
+    return HDF_SUCCESS;
+}
+
+/* coefficients follow the render rate, recompiled by the flush at render start */
+static void sunxi_codec_drc_set_rate(struct sunxi_codec_info *codec_info, uint32_t rate)
+{
+    mutex_lock(&codec_info->ctrl_lock);
+    if (codec_info->drc_rate != rate) {
+        codec_info->drc_rate = rate;
+        codec_info->kctrl[KCTRL_DRC_COMP_THR].dirty = true;
+        if (codec_info->render_on) {
+            sunxi_codec_kctrl_flush(codec_info);
+        }
+    }
+    mutex_unlock(&codec_info->ctrl_lock);
 }
 
 int32_t T507CodecImplSetCtrlOps(const struct AudioKcontrol *kcontrol, const struct AudioCtrlElemValue *elemValue)
 {
+    int32_t ret;
+    int idx, ridx;
     uint32_t value;
     uint32_t rvalue;
     bool updateRReg = false;
     struct AudioMixerControl *mixerCtrl = NULL;
+    struct sunxi_codec_info *codec_info = dev_get_drvdata(&g_codec_pdev->dev);
 
     AUDIO_DRIVER_LOG_DEBUG("");
 
@@ -245,24 +820,92 @@ int32_t T507CodecImplSetCtrlOps(const struct AudioKcontrol *kcontrol, const stru
         AUDIO_DRIVER_LOG_ERR("AudioSetCtrlOpsReg is failed.");
         return HDF_ERR_INVALID_OBJECT;
     }
-    T507CodecImplUpdateRegBits(mixerCtrl, value);
-
     if (AudioSetCtrlOpsRReg(elemValue, mixerCtrl, &rvalue, &updateRReg) != HDF_SUCCESS) {
         AUDIO_DRIVER_LOG_ERR("AudioSetCtrlOpsRReg is failed.");
         return HDF_ERR_INVALID_OBJECT;
     }
-    if (updateRReg) {
-        T507CodecImplUpdateRegBits(mixerCtrl, rvalue);
+
+    /*
+     * both channels of a stereo control go out in the same batch; while the
+     * render path is stopped sets only collect, trigger start writes them
+     */
+    idx = sunxi_codec_kctrl_find(mixerCtrl->reg, mixerCtrl->shift);
+    ridx = sunxi_codec_kctrl_find(mixerCtrl->rreg, mixerCtrl->rshift);
+    if (idx < 0 || ridx < 0) {
+        return HDF_ERR_NOT_SUPPORT;
+    }
+    mutex_lock(&codec_info->ctrl_lock);
+    ret = sunxi_codec_kctrl_update(codec_info, idx, value);
+    if (ret == HDF_SUCCESS && updateRReg) {
+        ret = sunxi_codec_kctrl_update(codec_info, ridx, rvalue);
+    }
+    if (ret == HDF_SUCCESS && codec_info->render_on) {
+        ret = sunxi_codec_kctrl_flush(codec_info);
     }
+    mutex_unlock(&codec_info->ctrl_lock);
 
-    return HDF_SUCCESS;
+    return ret;
+}
+
+/* register fields start from what the hcs defaults left in the registers, the rest from the table */
+static void sunxi_codec_kctrl_load(struct sunxi_codec_info *codec_info)
+{
+    struct regmap *regmap = codec_info->mem_info.regmap;
+    int i;
+    uint32_t val;
+
+    for (i = 0; i < KCTRL_NUM; i++) {
+        const struct sunxi_codec_kctrl *ctrl = &g_codec_kctrls[i];
+
+        codec_info->kctrl[i].dirty = false;
+        if (ctrl->kind != SUNXI_KCTRL_FIELD) {
+            continue;
+        }
+        regmap_read(regmap, ctrl->reg, &val);
+        codec_info->kctrl[i].value = (val & (ctrl->max * ctrl->unit)) / ctrl->unit;
+    }
+    codec_info->kctrl[KCTRL_DRC_COMP_THR].dirty = true;
+    sunxi_codec_kctrl_flush(codec_info);
 }
 
-/* ops api: read default reg value form codec_config.hcs */
+/* bring-up aid: read the batch back from the hardware, volatile registers are skipped */
+static uint32_t sunxi_codec_init_verify(struct regmap *regmap, const struct reg_sequence *seq, int num)
+{
+    int i;
+    uint32_t val;
+    uint32_t mismatch = 0;
+
+    regcache_cache_bypass(regmap, true);
+    for (i = 0; i < num; i++) {
+        if (sunxi_codec_volatile_reg(NULL, seq[i].reg)) {
+            continue;
+        }
+        regmap_read(regmap, seq[i].reg, &val);
+        if (val != seq[i].def) {
+            AUDIO_DRIVER_LOG_ERR("reg 0x%x reads 0x%x, wrote 0x%x", seq[i].reg, val, seq[i].def);
+            mismatch++;
+        }
+    }
+    regcache_cache_bypass(regmap, false);
+
+    return mismatch;
+}
+
+/*
+ * ops api: read default reg value form codec_config.hcs
+ *
+ * Items already holding their value (cache or first hardware read) are
+ * dropped, the rest go out as one multi-register write under a single
+ * regmap lock. "init-verify" in the dts reads the batch back.
+ */
 int32_t T507CodecImplRegDefaultInit(struct AudioRegCfgGroupNode **regCfgGroup)
 {
     int32_t i;
+    int num = 0;
+    int ret;
+    uint32_t val;
     struct AudioAddrConfig *regAttr = NULL;
+    struct reg_sequence *seq = NULL;
 
     struct sunxi_codec_info *codec_info = dev_get_drvdata(&g_codec_pdev->dev);
     struct regmap *regmap = codec_info->mem_info.regmap;
@@ -276,8 +919,47 @@ int32_t T507CodecImplRegDefaultInit(struct AudioRegCfgGroupNode **regCfgGroup)
     }
     regAttr = regCfgGroup[AUDIO_INIT_GROUP]->addrCfgItem;
 
+    seq = kcalloc(regCfgGroup[AUDIO_INIT_GROUP]->itemNum, sizeof(*seq), GFP_KERNEL);
+    if (seq == NULL) {
+        return HDF_ERR_MALLOC_FAIL;
+    }
+
+    if (sunxi_codec_pm_get(codec_info) < 0) {
+        kfree(seq);
+        return HDF_FAILURE;
+    }
     for (i = 0; i < regCfgGroup[AUDIO_INIT_GROUP]->itemNum; i++) {
-        regmap_write(regmap, regAttr[i].addr, regAttr[i].value);
+        if (!sunxi_codec_volatile_reg(NULL, regAttr[i].addr) &&
+            regmap_read(regmap, regAttr[i].addr, &val) == 0 && val == regAttr[i].value) {
+            continue;
+        }
+        seq[num].reg = regAttr[i].addr;
+        seq[num].def = regAttr[i].value;
+        num++;
+    }
+    ret = (num > 0) ? regmap_multi_reg_write(regmap, seq, num) : 0;
+    if (ret == 0 && codec_info->dts_info.init_verify) {
+        codec_info->init_mismatch = sunxi_codec_init_verify(regmap, seq, num);
+    }
+    mutex_lock(&codec_info->ctrl_lock);
+    sunxi_codec_kctrl_load(codec_info);
+    mutex_unlock(&codec_info->ctrl_lock);
+    sunxi_codec_pm_put(codec_info);
+    kfree(seq);
+
+    if (ret != 0) {
+        AUDIO_DRIVER_LOG_ERR("default regs write failed %d", ret);
+        return HDF_FAILURE;
+    }
+
+    codec_info->init_written = num;
+    codec_info->init_skipped = regCfgGroup[AUDIO_INIT_GROUP]->itemNum - num;
+    codec_info->init_ready_us = (u32)div_u64(ktime_get_ns() - codec_info->probe_start_ns, NSEC_PER_USEC);
+    AUDIO_DRIVER_LOG_DEBUG("%u written, %u skipped, ready %u us after probe", codec_info->init_written,
+        codec_info->init_skipped, codec_info->init_ready_us);
+    if (codec_info->init_mismatch != 0) {
+        AUDIO_DRIVER_LOG_ERR("%u default regs did not read back", codec_info->init_mismatch);
+        return HDF_FAILURE;
     }
 
     AUDIO_DRIVER_LOG_DEBUG("success.");
@@ -286,64 +968,57 @@ int32_t T507CodecImplRegDefaultInit(struct AudioRegCfgGroupNode **regCfgGroup)
 
 int32_t T507CodecImplStartup(enum AudioStreamType streamType)
 {
-    AUDIO_DRIVER_LOG_DEBUG("");
+    AUDIO_DRIVER_LOG_DEBUG("streamType %d", streamType);
 
-    if (streamType == AUDIO_CAPTURE_STREAM) {
-        /* audiocodec unsupport capture */
-        return HDF_SUCCESS;
+    AUDIO_DRIVER_LOG_DEBUG("success.");
+    return HDF_SUCCESS;
+}
+
+/* format and channels both fifos take, checked before any clock or register is touched */
+static int32_t sunxi_codec_params_check(enum AudioFormat format, uint32_t channels)
+{
+    if (format != AUDIO_FORMAT_PCM_16_BIT && format != AUDIO_FORMAT_PCM_24_BIT) {
+        AUDIO_DRIVER_LOG_ERR("format: %d is not define.", format);
+        return HDF_FAILURE;
+    }
+    if (channels != 1 && channels != 2) {
+        AUDIO_DRIVER_LOG_ERR("channel: %d is not define.", channels);
+        return HDF_FAILURE;
     }
 
-    AUDIO_DRIVER_LOG_DEBUG("success.");
     return HDF_SUCCESS;
 }
 
-int32_t T507CodecImplHwParams(enum AudioStreamType streamType, enum AudioFormat format, uint32_t channels, uint32_t rate)
+static int32_t sunxi_codec_render_hw_params(struct sunxi_codec_info *codec_info, enum AudioFormat format,
+    uint32_t channels, uint32_t rate)
 {
-    int i;
-    uint32_t freq_point;
-    struct sunxi_codec_info *codec_info = dev_get_drvdata(&g_codec_pdev->dev);
+    int32_t ret;
+    struct T507ClkPlan plan;
+    const struct sample_rate *conv;
     struct sunxi_codec_clk_info *clk_info = &codec_info->clk_info;
     struct regmap *regmap = codec_info->mem_info.regmap;
 
-    AUDIO_DRIVER_LOG_DEBUG("");
-
-    if (streamType == AUDIO_CAPTURE_STREAM) {
-        /* audiocodec unsupport capture */
-        return HDF_SUCCESS;
+    conv = sunxi_codec_rate_lookup(AUDIO_RENDER_STREAM, rate);
+    if (conv == NULL) {
+        return HDF_ERR_NOT_SUPPORT;
+    }
+    if (sunxi_codec_params_check(format, channels) != HDF_SUCCESS) {
+        return HDF_FAILURE;
     }
 
-    /* set pll clk */
-    switch (rate) {
-        case 8000:
-        case 12000:
-        case 16000:
-        case 24000:
-        case 32000:
-        case 48000:
-        case 64000:
-        case 96000:
-        case 192000:
-            freq_point = 24576000;
-            break;
-        case 11025:
-        case 22050:
-        case 44100:
-        case 88200:
-        case 176400:
-            freq_point = 22579200;
-            break;
-        default:
-            AUDIO_DRIVER_LOG_ERR("rate: %d is not define.", rate);
-            return HDF_FAILURE;
+    /* set pll clk, refused if the ahub runs on the other pll family */
+    ret = T507ClkPlanPrepare(T507_CLK_CODEC_RENDER, rate, 0, 0, &plan);
+    if (ret != HDF_SUCCESS) {
+        return ret;
     }
-    AUDIO_DRIVER_LOG_DEBUG(" freq_point %u", freq_point);
+    AUDIO_DRIVER_LOG_DEBUG(" freq_point %u", plan.freqPoint);
 
     /* moduleclk freq = 49.152/45.1584M, audio clk source = 98.304/90.3168M, own sun50iw9 */
-    if (clk_set_rate(clk_info->clk_pll_audiox4, freq_point * 4)) {
-        AUDIO_DRIVER_LOG_ERR("clk pllaudio set rate failed");
-        return -EINVAL;
+    ret = T507ClkPlanCommit(T507_CLK_CODEC_RENDER, &plan, clk_info->clk_pll_audiox4);
+    if (ret != HDF_SUCCESS) {
+        return ret;
     }
-    if (clk_set_rate(clk_info->clk_audio, freq_point * 2)) {
+    if (clk_set_rate(clk_info->clk_audio, plan.freqPoint * 2)) {
         AUDIO_DRIVER_LOG_ERR("clk audio set rate failed");
         return -EINVAL;
     }
@@ -366,12 +1041,8 @@ int32_t T507CodecImplHwParams(enum AudioStreamType streamType, enum AudioFormat
     }
 
     /* set rate */
-    i = 0;
-    for (i = 0; i < ARRAY_SIZE(g_sample_rate_conv); i++) {
-        if (g_sample_rate_conv[i].samplerate == rate)
-        break;
-    }
-    regmap_update_bits(regmap, SUNXI_DAC_FIFO_CTL, 0x7 << DAC_FS, g_sample_rate_conv[i].rate_bit << DAC_FS);
+    regmap_update_bits(regmap, SUNXI_DAC_FIFO_CTL, 0x7 << DAC_FS, conv->rate_bit << DAC_FS);
+    sunxi_codec_drc_set_rate(codec_info, rate);
     AUDIO_DRIVER_LOG_DEBUG(" rate %u", rate);
 
     /* set channels */
@@ -397,6 +1068,105 @@ int32_t T507CodecImplHwParams(enum AudioStreamType streamType, enum AudioFormat
     return HDF_SUCCESS;
 }
 
+/* adc fifo, rate and channels; the analog input itself is routed by sapm (MIC -> PGA -> ADC) */
+static int32_t sunxi_codec_capture_hw_params(struct sunxi_codec_info *codec_info, enum AudioFormat format,
+    uint32_t channels, uint32_t rate)
+{
+    int32_t ret;
+    struct T507ClkPlan plan;
+    const struct sample_rate *conv;
+    struct sunxi_codec_clk_info *clk_info = &codec_info->clk_info;
+    struct regmap *regmap = codec_info->mem_info.regmap;
+
+    conv = sunxi_codec_rate_lookup(AUDIO_CAPTURE_STREAM, rate);
+    if (conv == NULL) {
+        return HDF_ERR_NOT_SUPPORT;
+    }
+    if (sunxi_codec_params_check(format, channels) != HDF_SUCCESS) {
+        return HDF_FAILURE;
+    }
+
+    /* dac and adc share the module clock, so a running render pins the family */
+    ret = T507ClkPlanPrepare(T507_CLK_CODEC_CAPTURE, rate, 0, 0, &plan);
+    if (ret != HDF_SUCCESS) {
+        return ret;
+    }
+    ret = T507ClkPlanCommit(T507_CLK_CODEC_CAPTURE, &plan, clk_info->clk_pll_audiox4);
+    if (ret != HDF_SUCCESS) {
+        return ret;
+    }
+    if (clk_set_rate(clk_info->clk_audio, plan.freqPoint * 2)) {
+        AUDIO_DRIVER_LOG_ERR("clk audio set rate failed");
+        return -EINVAL;
+    }
+
+    /* set bits */
+    switch (format) {
+        case AUDIO_FORMAT_PCM_16_BIT:
+            regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0x1 << RX_FIFO_MODE, 0x1 << RX_FIFO_MODE);
+            regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0x1 << RX_SAMPLE_BITS, 0x0 << RX_SAMPLE_BITS);
+            AUDIO_DRIVER_LOG_DEBUG(" format 16");
+            break;
+        case AUDIO_FORMAT_PCM_24_BIT:
+            regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0x1 << RX_FIFO_MODE, 0x0 << RX_FIFO_MODE);
+            regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0x1 << RX_SAMPLE_BITS, 0x1 << RX_SAMPLE_BITS);
+            AUDIO_DRIVER_LOG_DEBUG(" format 24");
+            break;
+        default:
+            AUDIO_DRIVER_LOG_ERR("format: %d is not define.", format);
+            return HDF_FAILURE;
+    }
+
+    /* set rate */
+    regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0x7 << ADC_FS, conv->rate_bit << ADC_FS);
+    AUDIO_DRIVER_LOG_DEBUG(" rate %u", rate);
+
+    /* set channels, left only for mono */
+    switch (channels) {
+        case 1:
+            regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0xf << ADC_CHAN_SEL, 0x1 << ADC_CHAN_SEL);
+            break;
+        case 2:
+            regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0xf << ADC_CHAN_SEL, 0x3 << ADC_CHAN_SEL);
+            break;
+        default:
+            AUDIO_DRIVER_LOG_ERR("channel: %d is not define.", channels);
+            return HDF_FAILURE;
+    }
+    AUDIO_DRIVER_LOG_DEBUG(" channels %u", channels);
+
+    /* drq level matches the dma burst, see T507AudioDmaConfigChannel */
+    regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0xff << RX_FIFO_TRG_LEVEL, T507_CODEC_RXFIFO_LEVEL << RX_FIFO_TRG_LEVEL);
+
+    /* clear fifo */
+    regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0x1 << ADC_FIFO_FLUSH, 0x1 << ADC_FIFO_FLUSH);
+    regmap_write(regmap, SUNXI_ADC_FIFO_STA, 1 << ADC_RXA_INT | 1 << ADC_RXO_INT);
+    regmap_write(regmap, SUNXI_ADC_CNT, 0);
+
+    AUDIO_DRIVER_LOG_DEBUG("success.");
+    return HDF_SUCCESS;
+}
+
+int32_t T507CodecImplHwParams(enum AudioStreamType streamType, enum AudioFormat format, uint32_t channels, uint32_t rate)
+{
+    struct sunxi_codec_info *codec_info = dev_get_drvdata(&g_codec_pdev->dev);
+    int32_t ret;
+
+    AUDIO_DRIVER_LOG_DEBUG("");
+
+    if (sunxi_codec_pm_get(codec_info) < 0) {
+        return HDF_FAILURE;
+    }
+    if (streamType == AUDIO_CAPTURE_STREAM) {
+        ret = sunxi_codec_capture_hw_params(codec_info, format, channels, rate);
+    } else {
+        ret = sunxi_codec_render_hw_params(codec_info, format, channels, rate);
+    }
+    sunxi_codec_pm_put(codec_info);
+
+    return ret;
+}
+
 static void renderRouteCtrl(bool enable)
 {
     struct sunxi_codec_info *codec_info = dev_get_drvdata(&g_codec_pdev->dev);
@@ -421,6 +1191,141 @@ static void renderRouteCtrl(bool enable)
     }
 }
 
+/* called from the dma period callback: report and clear dac fifo over/underrun, adc overrun */
+bool T507CodecImplXrunCheck(enum AudioStreamType streamType)
+{
+    struct sunxi_codec_info *codec_info;
+    struct regmap *regmap = NULL;
+    uint32_t reg_val = 0;
+
+    if (g_codec_pdev == NULL) {
+        return false;
+    }
+    codec_info = dev_get_drvdata(&g_codec_pdev->dev);
+    if (IS_ERR_OR_NULL(codec_info)) {
+        return false;
+    }
+    regmap = codec_info->mem_info.regmap;
+
+    if (streamType == AUDIO_CAPTURE_STREAM) {
+        regmap_read(regmap, SUNXI_ADC_FIFO_STA, &reg_val);
+        reg_val &= 0x1 << ADC_RXO_INT;
+        if (reg_val != 0) {
+            regmap_write(regmap, SUNXI_ADC_FIFO_STA, reg_val);
+        }
+        return reg_val != 0;
+    }
+
+    regmap_read(regmap, SUNXI_DAC_FIFO_STA, &reg_val);
+    reg_val &= (0x1 << DAC_TXU_INT) | (0x1 << DAC_TXO_INT);
+    if (reg_val != 0) {
+        regmap_write(regmap, SUNXI_DAC_FIFO_STA, reg_val);
+    }
+
+    return reg_val != 0;
+}
+
+/* flush the dac or adc fifo after an xrun, the stream keeps running */
+int32_t T507CodecImplXrunRecover(enum AudioStreamType streamType)
+{
+    struct sunxi_codec_info *codec_info;
+
+    if (g_codec_pdev == NULL) {
+        return HDF_FAILURE;
+    }
+    codec_info = dev_get_drvdata(&g_codec_pdev->dev);
+    if (IS_ERR_OR_NULL(codec_info)) {
+        return HDF_FAILURE;
+    }
+
+    if (streamType == AUDIO_CAPTURE_STREAM) {
+        regmap_update_bits(codec_info->mem_info.regmap, SUNXI_ADC_FIFO_CTL,
+                           0x1 << ADC_FIFO_FLUSH, 0x1 << ADC_FIFO_FLUSH);
+        regmap_write(codec_info->mem_info.regmap, SUNXI_ADC_FIFO_STA, 0x1 << ADC_RXO_INT);
+        return HDF_SUCCESS;
+    }
+
+    regmap_update_bits(codec_info->mem_info.regmap, SUNXI_DAC_FIFO_CTL,
+                       0x1 << DAC_FIFO_FLUSH, 0x1 << DAC_FIFO_FLUSH);
+    regmap_write(codec_info->mem_info.regmap, SUNXI_DAC_FIFO_STA,
+                 (0x1 << DAC_TXU_INT) | (0x1 << DAC_TXO_INT));
+
+    return HDF_SUCCESS;
+}
+
+/* for tracing: free words in the dac fifo or ready words in the adc fifo, and the sample counter */
+uint32_t T507CodecImplFifoAvail(enum AudioStreamType streamType, uint32_t *count)
+{
+    struct sunxi_codec_info *codec_info;
+    struct regmap *regmap = NULL;
+    uint32_t reg_val = 0;
+
+    *count = 0;
+    if (g_codec_pdev == NULL) {
+        return 0;
+    }
+    codec_info = dev_get_drvdata(&g_codec_pdev->dev);
+    if (IS_ERR_OR_NULL(codec_info)) {
+        return 0;
+    }
+    regmap = codec_info->mem_info.regmap;
+
+    if (streamType == AUDIO_CAPTURE_STREAM) {
+        regmap_read(regmap, SUNXI_ADC_CNT, count);
+        regmap_read(regmap, SUNXI_ADC_FIFO_STA, &reg_val);
+        return (reg_val >> ADC_RXA_CNT) & 0x7fff;
+    }
+
+    regmap_read(regmap, SUNXI_DAC_CNT, count);
+    regmap_read(regmap, SUNXI_DAC_FIFO_STA, &reg_val);
+
+    return (reg_val >> DAC_TXE_CNT) & 0x7fff;
+}
+
+static void sunxi_codec_trace_trigger(enum AudioStreamType streamType, bool enable)
+{
+    uint32_t avail, count;
+
+    if (!trace_t507_audio_trigger_enabled()) {
+        return;
+    }
+    avail = T507CodecImplFifoAvail(streamType, &count);
+    trace_t507_audio_trigger("codec", streamType == AUDIO_RENDER_STREAM, enable, avail, count);
+}
+
+static int32_t sunxi_codec_capture_trigger(struct sunxi_codec_info *codec_info, bool enable)
+{
+    struct regmap *regmap = codec_info->mem_info.regmap;
+    int32_t ret;
+
+    if (enable == codec_info->capture_on) {
+        return HDF_SUCCESS;
+    }
+
+    if (enable) {
+        if (sunxi_codec_pm_get(codec_info) < 0) {
+            return HDF_FAILURE;
+        }
+        ret = T507ClkPlanSetRunning(T507_CLK_CODEC_CAPTURE, true);
+        if (ret != HDF_SUCCESS) {
+            sunxi_codec_pm_put(codec_info);
+            return ret;
+        }
+        regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0x1 << EN_AD, 0x1 << EN_AD);
+        regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0x1 << ADC_DRQ_EN, 0x1 << ADC_DRQ_EN);
+        sunxi_codec_trace_trigger(AUDIO_CAPTURE_STREAM, enable);
+    } else {
+        sunxi_codec_trace_trigger(AUDIO_CAPTURE_STREAM, enable);
+        regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0x1 << ADC_DRQ_EN, 0x0 << ADC_DRQ_EN);
+        regmap_update_bits(regmap, SUNXI_ADC_FIFO_CTL, 0x1 << EN_AD, 0x0 << EN_AD);
+        T507ClkPlanSetRunning(T507_CLK_CODEC_CAPTURE, false);
+        sunxi_codec_pm_put(codec_info);
+    }
+    codec_info->capture_on = enable;
+
+    return HDF_SUCCESS;
+}
+
 int32_t T507CodecImplTrigger(enum AudioStreamType streamType, bool enable)
 {
     struct sunxi_codec_info *codec_info = dev_get_drvdata(&g_codec_pdev->dev);
@@ -429,17 +1334,51 @@ int32_t T507CodecImplTrigger(enum AudioStreamType streamType, bool enable)
     AUDIO_DRIVER_LOG_DEBUG("");
 
     if (streamType == AUDIO_CAPTURE_STREAM) {
-        /* audiocodec unsupport capture */
+        return sunxi_codec_capture_trigger(codec_info, enable);
+    }
+
+    if (enable == codec_info->render_on) {
         return HDF_SUCCESS;
     }
+    if (enable && sunxi_codec_pm_get(codec_info) < 0) {
+        return HDF_FAILURE;
+    }
+    /* the pll may have moved to the other family since our hw_params */
+    if (enable && T507ClkPlanSetRunning(T507_CLK_CODEC_RENDER, true) != HDF_SUCCESS) {
+        sunxi_codec_pm_put(codec_info);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+    /* sampled while the path runs: before a stop, after a start */
+    if (!enable) {
+        sunxi_codec_trace_trigger(streamType, enable);
+    }
+
+    /*
+     * lineout comes up silent and vol_work fades it in once data flows; on
+     * stop the dma goes down right after us, so mute at once instead of fading
+     */
+    mutex_lock(&codec_info->ctrl_lock);
+    sunxi_codec_vol_ramp(codec_info, 0, false);
+    /* controls set while stopped, in one batch before the first sample */
+    if (enable && sunxi_codec_kctrl_flush(codec_info) != HDF_SUCCESS) {
+        AUDIO_DRIVER_LOG_ERR("kcontrol flush failed, start with the previous settings");
+    }
 
     renderRouteCtrl(enable);
+    if (!enable) {
+        T507ClkPlanSetRunning(T507_CLK_CODEC_RENDER, false);
+    }
 
     if (enable) {
         regmap_update_bits(regmap, SUNXI_DAC_FIFO_CTL, 1 << DAC_DRQ_EN, 1 << DAC_DRQ_EN);
+        sunxi_codec_vol_ramp(codec_info, sunxi_codec_vol_target(codec_info), true);
+        sunxi_codec_trace_trigger(streamType, enable);
     } else {
         regmap_update_bits(regmap, SUNXI_DAC_FIFO_CTL, 1 << DAC_DRQ_EN, 0 << DAC_DRQ_EN);
+        sunxi_codec_pm_put(codec_info);
     }
+    codec_info->render_on = enable;
+    mutex_unlock(&codec_info->ctrl_lock);
 
     AUDIO_DRIVER_LOG_DEBUG("success.");
     return HDF_SUCCESS;
@@ -455,8 +1394,8 @@ static void snd_sunxi_codec_clk_disable(struct platform_device *pdev, struct sun
 
 static int snd_sunxi_codec_rglt_init(struct platform_device *pdev, struct sunxi_codec_rglt_info *rglt_info);
 static void snd_sunxi_codec_rglt_exit(struct platform_device *pdev, struct sunxi_codec_rglt_info *rglt_info);
-/* static int snd_sunxi_codec_rglt_enable(struct platform_device *pdev, struct sunxi_codec_rglt_info *rglt_info); */
-/* static void snd_sunxi_codec_rglt_disable(struct platform_device *pdev, struct sunxi_codec_rglt_info *rglt_info); */
+static int snd_sunxi_codec_rglt_enable(struct platform_device *pdev, struct sunxi_codec_rglt_info *rglt_info);
+static void snd_sunxi_codec_rglt_disable(struct platform_device *pdev, struct sunxi_codec_rglt_info *rglt_info);
 
 static int snd_sunxi_codec_mem_init(struct platform_device *pdev, struct sunxi_codec_mem_info *mem_info)
 {
@@ -581,8 +1520,6 @@ static void snd_sunxi_codec_clk_exit(struct platform_device *pdev, struct sunxi_
 
 static int snd_sunxi_codec_clk_enable(struct platform_device *pdev, struct sunxi_codec_clk_info *clk_info)
 {
-    int ret = 0;
-
     AUDIO_DRIVER_LOG_DEBUG("");
 
     if (clk_prepare_enable(clk_info->clk_pll_audio)) {
@@ -607,7 +1544,7 @@ err_enable_clk_audio:
 err_enable_clk_pll_audiox4:
     clk_disable_unprepare(clk_info->clk_pll_audio);
 err_enable_clk_pll_audio:
-    return ret;
+    return -EBUSY;
 }
 
 static void snd_sunxi_codec_clk_disable(struct platform_device *pdev, struct sunxi_codec_clk_info *clk_info)
@@ -667,7 +1604,6 @@ static void snd_sunxi_codec_rglt_exit(struct platform_device *pdev, struct sunxi
     }
 }
 
-#if 0
 static int snd_sunxi_codec_rglt_enable(struct platform_device *pdev, struct sunxi_codec_rglt_info *rglt_info)
 {
     int ret;
@@ -696,7 +1632,6 @@ static void snd_sunxi_codec_rglt_disable(struct platform_device *pdev, struct su
         }
     }
 }
-#endif
 
 static void snd_sunxi_dts_params_init(struct platform_device *pdev, struct sunxi_codec_dts_info *dts_info)
 {
@@ -714,25 +1649,135 @@ static void snd_sunxi_dts_params_init(struct platform_device *pdev, struct sunxi
         dts_info->lineout_vol = temp_val;
     }
 
+    ret = of_property_read_u32(np, "autosuspend-delay-ms", &temp_val);
+    if (ret < 0) {
+        dts_info->autosuspend_ms = SUNXI_CODEC_AUTOSUSPEND_MS;
+    } else {
+        dts_info->autosuspend_ms = temp_val;
+    }
+
+    ret = of_property_read_u32(np, "volume-ramp-step-us", &temp_val);
+    if (ret < 0) {
+        dts_info->vol_ramp_us = SUNXI_CODEC_VOL_RAMP_US;
+    } else {
+        dts_info->vol_ramp_us = temp_val;
+    }
+
+    dts_info->init_verify = of_property_read_bool(np, "init-verify");
+
     AUDIO_DRIVER_LOG_DEBUG("lineout vol -> %u\n", dts_info->lineout_vol);
+    AUDIO_DRIVER_LOG_DEBUG("autosuspend -> %u ms\n", dts_info->autosuspend_ms);
+    AUDIO_DRIVER_LOG_DEBUG("volume ramp -> %u us/step\n", dts_info->vol_ramp_us);
+}
+
+/* register snapshot, read in one pass and formatted after, same layout as the ahub */
+static size_t snd_sunxi_reg_snapshot(struct regmap *regmap, uint32_t *vals)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_reg_labels) && g_reg_labels[i].name != NULL; i++) {
+        regmap_read(regmap, g_reg_labels[i].address, &vals[i]);
+    }
+
+    return i;
+}
+
+static int snd_sunxi_regs_show(struct seq_file *m, void *v)
+{
+    struct sunxi_codec_info *codec_info = m->private;
+    uint32_t vals[ARRAY_SIZE(g_reg_labels)];
+    size_t num, i;
+
+    (void)v;
+
+    if (sunxi_codec_pm_get(codec_info) < 0) {
+        return -EIO;
+    }
+    num = snd_sunxi_reg_snapshot(codec_info->mem_info.regmap, vals);
+    sunxi_codec_pm_put(codec_info);
+    for (i = 0; i < num; i++) {
+        seq_printf(m, "0x%03x 0x%08x %s\n", g_reg_labels[i].address, vals[i], g_reg_labels[i].name);
+    }
+
+    return 0;
 }
 
+static int snd_sunxi_regs_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, snd_sunxi_regs_show, inode->i_private);
+}
+
+static const struct file_operations g_codec_regs_fops = {
+    .owner      = THIS_MODULE,
+    .open       = snd_sunxi_regs_open,
+    .read       = seq_read,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
+/* the same snapshot in the binary layout of t507_regsnap_uapi.h */
+static int snd_sunxi_regs_bin_show(struct seq_file *m, void *v)
+{
+    struct sunxi_codec_info *codec_info = m->private;
+    uint32_t vals[ARRAY_SIZE(g_reg_labels)];
+    struct T507RegSnapHeader hdr;
+    struct T507RegSnapEntry entry;
+    size_t num, i;
+
+    (void)v;
+
+    if (sunxi_codec_pm_get(codec_info) < 0) {
+        return -EIO;
+    }
+    num = snd_sunxi_reg_snapshot(codec_info->mem_info.regmap, vals);
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.tstampNs = ktime_get_ns();
+    sunxi_codec_pm_put(codec_info);
+
+    hdr.magic = T507_REGSNAP_MAGIC;
+    hdr.version = T507_REGSNAP_VERSION;
+    hdr.count = (__u16)num;
+    hdr.block = T507_REGSNAP_CODEC;
+    hdr.valBytes = sizeof(vals[0]);
+    seq_write(m, &hdr, sizeof(hdr));
+    for (i = 0; i < num; i++) {
+        entry.addr = (__u16)g_reg_labels[i].address;
+        entry.flags = 0;
+        entry.val = vals[i];
+        seq_write(m, &entry, sizeof(entry));
+    }
+
+    return 0;
+}
+
+static int snd_sunxi_regs_bin_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, snd_sunxi_regs_bin_show, inode->i_private);
+}
+
+static const struct file_operations g_codec_regs_bin_fops = {
+    .owner      = THIS_MODULE,
+    .open       = snd_sunxi_regs_bin_open,
+    .read       = seq_read,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
 /* sysfs debug */
 static ssize_t snd_sunxi_debug_show_reg(struct device *dev, struct device_attribute *attr, char *buf)
 {
     struct sunxi_codec_info *codec_info = dev_get_drvdata(&g_codec_pdev->dev);
-    struct regmap *regmap = codec_info->mem_info.regmap;
-    size_t count = 0, i = 0;
-    uint32_t reg_val;
-    uint32_t size = ARRAY_SIZE(g_reg_labels);
+    uint32_t vals[ARRAY_SIZE(g_reg_labels)];
+    size_t count = 0, i, num;
 
-    while ((i < size) && (g_reg_labels[i].name != NULL)) {
-        regmap_read(regmap, g_reg_labels[i].address, &reg_val);
-        printk("%-30s [0x%03x]: 0x%8x save_val:0x%x\n",
-                g_reg_labels[i].name,
-                g_reg_labels[i].address, reg_val,
-                g_reg_labels[i].value);
-        i++;
+    if (sunxi_codec_pm_get(codec_info) < 0) {
+        return -EIO;
+    }
+    num = snd_sunxi_reg_snapshot(codec_info->mem_info.regmap, vals);
+    sunxi_codec_pm_put(codec_info);
+    for (i = 0; i < num; i++) {
+        count += scnprintf(buf + count, PAGE_SIZE - count, "0x%03x 0x%08x %s\n",
+            g_reg_labels[i].address, vals[i], g_reg_labels[i].name);
     }
 
     return count;
@@ -759,10 +1804,12 @@ static ssize_t snd_sunxi_debug_store_reg(struct device *dev, struct device_attri
         return count;
     }
 
+    if (sunxi_codec_pm_get(codec_info) < 0) {
+        return count;
+    }
     if (scanf_cnt == 1) {
         regmap_read(regmap, input_reg_offset, &reg_val);
         pr_info("reg[0x%03x]: 0x%x\n", input_reg_offset, reg_val);
-        return count;
     } else if (scanf_cnt == 2) {
         regmap_read(regmap, input_reg_offset, &reg_val);
         pr_info("reg[0x%03x]: 0x%x (old)\n", input_reg_offset, reg_val);
@@ -770,6 +1817,7 @@ static ssize_t snd_sunxi_debug_store_reg(struct device *dev, struct device_attri
         regmap_read(regmap, input_reg_offset, &reg_val);
         pr_info("reg[0x%03x]: 0x%x (new)\n", input_reg_offset, reg_val);
     }
+    sunxi_codec_pm_put(codec_info);
 
     return count;
 }
@@ -789,6 +1837,7 @@ static struct attribute_group debug_attr = {
 static int sunxi_internal_codec_dev_probe(struct platform_device *pdev)
 {
     int ret;
+    int i;
     struct device *dev = &pdev->dev;
     struct device_node *np = pdev->dev.of_node;
     struct sunxi_codec_info *codec_info;
@@ -799,6 +1848,11 @@ static int sunxi_internal_codec_dev_probe(struct platform_device *pdev)
 
     AUDIO_DRIVER_LOG_DEBUG("");
 
+    ret = sunxi_codec_rate_table_check();
+    if (ret) {
+        goto err_devm_kzalloc;
+    }
+
     /* sunxi codec info */
     codec_info = devm_kzalloc(dev, sizeof(struct sunxi_codec_info), GFP_KERNEL);
     if (!codec_info) {
@@ -807,10 +1861,18 @@ static int sunxi_internal_codec_dev_probe(struct platform_device *pdev)
         goto err_devm_kzalloc;
     }
     dev_set_drvdata(dev, codec_info);
+    codec_info->pdev = pdev;
     mem_info = &codec_info->mem_info;
     clk_info = &codec_info->clk_info;
     rglt_info = &codec_info->rglt_info;
     dts_info = &codec_info->dts_info;
+    codec_info->probe_start_ns = ktime_get_ns();
+    codec_info->drc_rate = 48000;
+    mutex_init(&codec_info->ctrl_lock);
+    INIT_DELAYED_WORK(&codec_info->vol_work, sunxi_codec_vol_work);
+    for (i = 0; i < KCTRL_NUM; i++) {
+        codec_info->kctrl[i].value = g_codec_kctrls[i].def;
+    }
 
     /* memio init */
     ret = snd_sunxi_codec_mem_init(pdev, mem_info);
@@ -843,6 +1905,27 @@ static int sunxi_internal_codec_dev_probe(struct platform_device *pdev)
     if (ret)
         AUDIO_DRIVER_LOG_ERR("sysfs debug create failed");
 
+    codec_info->debugfs_dir = debugfs_create_dir(DRV_NAME, NULL);
+    if (!IS_ERR_OR_NULL(codec_info->debugfs_dir)) {
+        debugfs_create_file("regs", 0444, codec_info->debugfs_dir, codec_info, &g_codec_regs_fops);
+        debugfs_create_file("regs.bin", 0444, codec_info->debugfs_dir, codec_info, &g_codec_regs_bin_fops);
+        debugfs_create_u32("resume_last_us", 0444, codec_info->debugfs_dir, &codec_info->resume_last_us);
+        debugfs_create_u32("resume_max_us", 0444, codec_info->debugfs_dir, &codec_info->resume_max_us);
+        debugfs_create_u32("resume_over_budget", 0444, codec_info->debugfs_dir, &codec_info->resume_over_budget);
+        debugfs_create_u32("init_ready_us", 0444, codec_info->debugfs_dir, &codec_info->init_ready_us);
+        debugfs_create_u32("init_written", 0444, codec_info->debugfs_dir, &codec_info->init_written);
+        debugfs_create_u32("init_skipped", 0444, codec_info->debugfs_dir, &codec_info->init_skipped);
+        debugfs_create_u32("init_mismatch", 0444, codec_info->debugfs_dir, &codec_info->init_mismatch);
+    }
+
+    /* clocks and avcc are on from probe, let them go after the idle delay */
+    pm_runtime_set_autosuspend_delay(dev, dts_info->autosuspend_ms);
+    pm_runtime_use_autosuspend(dev);
+    pm_runtime_set_active(dev);
+    pm_runtime_enable(dev);
+    pm_runtime_mark_last_busy(dev);
+    pm_request_autosuspend(dev);
+
     g_codec_pdev = pdev;
 
     AUDIO_DRIVER_LOG_DEBUG("register internal-codec codec success");
@@ -872,6 +1955,15 @@ static int sunxi_internal_codec_dev_remove(struct platform_device *pdev)
 
     AUDIO_DRIVER_LOG_DEBUG("");
 
+    cancel_delayed_work_sync(&codec_info->vol_work);
+
+    /* exit paths below disable clocks and avcc, so leave them on */
+    pm_runtime_get_sync(dev);
+    pm_runtime_disable(dev);
+    pm_runtime_dont_use_autosuspend(dev);
+    pm_runtime_put_noidle(dev);
+
+    debugfs_remove_recursive(codec_info->debugfs_dir);
     sysfs_remove_group(&pdev->dev.kobj, &debug_attr);
 
     snd_sunxi_codec_mem_exit(pdev, mem_info);
@@ -887,6 +1979,68 @@ static int sunxi_internal_codec_dev_remove(struct platform_device *pdev)
     return 0;
 }
 
+static int sunxi_internal_codec_runtime_suspend(struct device *dev)
+{
+    struct sunxi_codec_info *codec_info = dev_get_drvdata(dev);
+    struct regmap *regmap = codec_info->mem_info.regmap;
+
+    AUDIO_DRIVER_LOG_DEBUG("");
+
+    regcache_cache_only(regmap, true);
+    regcache_mark_dirty(regmap);
+    snd_sunxi_codec_clk_disable(codec_info->pdev, &codec_info->clk_info);
+    snd_sunxi_codec_rglt_disable(codec_info->pdev, &codec_info->rglt_info);
+
+    return 0;
+}
+
+static int sunxi_internal_codec_runtime_resume(struct device *dev)
+{
+    struct sunxi_codec_info *codec_info = dev_get_drvdata(dev);
+    struct regmap *regmap = codec_info->mem_info.regmap;
+    u64 start_ns = ktime_get_ns();
+    int ret;
+
+    AUDIO_DRIVER_LOG_DEBUG("");
+
+    ret = snd_sunxi_codec_rglt_enable(codec_info->pdev, &codec_info->rglt_info);
+    if (ret) {
+        return -EBUSY;
+    }
+    ret = snd_sunxi_codec_clk_enable(codec_info->pdev, &codec_info->clk_info);
+    if (ret) {
+        snd_sunxi_codec_rglt_disable(codec_info->pdev, &codec_info->rglt_info);
+        return ret;
+    }
+
+    regcache_cache_only(regmap, false);
+    ret = regcache_sync(regmap);
+    if (ret) {
+        AUDIO_DRIVER_LOG_ERR("regcache sync failed %d", ret);
+        snd_sunxi_codec_clk_disable(codec_info->pdev, &codec_info->clk_info);
+        snd_sunxi_codec_rglt_disable(codec_info->pdev, &codec_info->rglt_info);
+        regcache_cache_only(regmap, true);
+        return ret;
+    }
+
+    /* this is what a stream start pays on top of hw params after autosuspend */
+    codec_info->resume_last_us = (u32)div_u64(ktime_get_ns() - start_ns, NSEC_PER_USEC);
+    if (codec_info->resume_last_us > codec_info->resume_max_us) {
+        codec_info->resume_max_us = codec_info->resume_last_us;
+    }
+    if (codec_info->resume_last_us > SUNXI_CODEC_RESUME_BUDGET_US) {
+        codec_info->resume_over_budget++;
+        AUDIO_DRIVER_LOG_ERR("resume took %u us, budget %u us", codec_info->resume_last_us, SUNXI_CODEC_RESUME_BUDGET_US);
+    }
+
+    return 0;
+}
+
+static const struct dev_pm_ops sunxi_internal_codec_pm_ops = {
+    SET_RUNTIME_PM_OPS(sunxi_internal_codec_runtime_suspend, sunxi_internal_codec_runtime_resume, NULL)
+    SET_SYSTEM_SLEEP_PM_OPS(pm_runtime_force_suspend, pm_runtime_force_resume)
+};
+
 static const struct of_device_id sunxi_internal_codec_of_match[] = {
     { .compatible = "allwinner," DRV_NAME, },
     {},
@@ -898,6 +2052,7 @@ static struct platform_driver sunxi_internal_codec_driver = {
         .name   = DRV_NAME,
         .owner  = THIS_MODULE,
         .of_match_table = sunxi_internal_codec_of_match,
+        .pm     = &sunxi_internal_codec_pm_ops,
     },
     .probe  = sunxi_internal_codec_dev_probe,
     .remove = sunxi_internal_codec_dev_remove,
@@ -21,6 +21,7 @@
 #include "audio_stream_dispatch.h"
 
 #include "t507_codec_ops.h"
+#include "t507_dma_ops.h"
 
 #define HDF_LOG_TAG t507_codec_ops
 
@@ -35,6 +36,16 @@ static const struct AudioSapmRoute g_audioRoutes[] = {
     { "RPGA", "RPGA MIC Switch", "MIC"},
 };
 
+/* the adc only captures on cards whose platform reads the codec rx fifo */
+static bool T507CodecCaptureOnCard(const struct AudioCard *card)
+{
+    if (card == NULL || card->rtd == NULL || card->rtd->platform == NULL) {
+        return false;
+    }
+
+    return T507AudioDmaCaptureFromCodec(card->rtd->platform->devData);
+}
+
 int32_t T507CodecDeviceInit(struct AudioCard *audioCard, const struct CodecDevice *codec)
 {
     if (audioCard == NULL || codec == NULL || codec->devData == NULL ||
@@ -132,6 +143,11 @@ int32_t T507CodecDaiHwParams(const struct AudioCard *card, const struct AudioPcm
         return HDF_FAILURE;
     }
 
+    /* capture on the ahub cards is handled by the ahub dai and the ac107 */
+    if (param->streamType == AUDIO_CAPTURE_STREAM && !T507CodecCaptureOnCard(card)) {
+        return HDF_SUCCESS;
+    }
+
     ret = T507CodecImplHwParams(param->streamType, param->format, param->channels, param->rate);
     if (ret != HDF_SUCCESS) {
         return HDF_FAILURE;
@@ -147,13 +163,18 @@ int32_t T507CodecDaiStartup(const struct AudioCard *card, const struct DaiDevice
 
     AUDIO_DRIVER_LOG_DEBUG("");
 
-    (void)card;
     (void)device;
 
     ret = T507CodecImplStartup(AUDIO_RENDER_STREAM);    /* unuse */
     if (ret != HDF_SUCCESS) {
         return HDF_FAILURE;
     }
+    if (T507CodecCaptureOnCard(card)) {
+        ret = T507CodecImplStartup(AUDIO_CAPTURE_STREAM);
+        if (ret != HDF_SUCCESS) {
+            return HDF_FAILURE;
+        }
+    }
 
     return HDF_SUCCESS;
 }
@@ -164,7 +185,6 @@ int32_t T507CodecDaiTrigger(const struct AudioCard *card, int cmd, const struct
 
     AUDIO_DRIVER_LOG_DEBUG(" cmd -> %d", cmd);
 
-    (void)card;
     (void)device;
 
     switch (cmd) {
@@ -184,6 +204,9 @@ int32_t T507CodecDaiTrigger(const struct AudioCard *card, int cmd, const struct
             break;
         case AUDIO_DRV_PCM_IOCTL_CAPTURE_START:
         case AUDIO_DRV_PCM_IOCTL_CAPTURE_RESUME:
+            if (!T507CodecCaptureOnCard(card)) {
+                break;
+            }
             ret = T507CodecImplTrigger(AUDIO_CAPTURE_STREAM, true);
             if (ret != HDF_SUCCESS) {
                 return HDF_FAILURE;
@@ -191,6 +214,9 @@ int32_t T507CodecDaiTrigger(const struct AudioCard *card, int cmd, const struct
             break;
         case AUDIO_DRV_PCM_IOCTL_CAPTURE_STOP:
         case AUDIO_DRV_PCM_IOCTL_CAPTURE_PAUSE:
+            if (!T507CodecCaptureOnCard(card)) {
+                break;
+            }
             ret = T507CodecImplTrigger(AUDIO_CAPTURE_STREAM, false);
             if (ret != HDF_SUCCESS) {
                 return HDF_FAILURE;
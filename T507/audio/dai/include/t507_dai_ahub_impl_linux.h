@@ -100,6 +100,10 @@ extern "C" {
 
 #define SUNXI_AHUB_MAX_REG              SUNXI_AHUB_DAM_GAIN_CTL7(1)
 
+#define SUNXI_AHUB_APBIF_NUM            3
+#define SUNXI_AHUB_I2S_NUM              4
+#define SUNXI_AHUB_TDM_MAX_CH           16
+
 /* SUNXI_AHUB_CTL */
 #define HDMI_SRC_SEL            0x04
 
@@ -292,6 +296,11 @@ void T507AhubImplRegmapRead(uint32_t reg, uint32_t *val);
 int32_t T507AhubImplStartup(enum AudioStreamType streamType);
 int32_t T507AhubImplHwParams(enum AudioStreamType streamType, enum AudioFormat format, uint32_t channels, uint32_t rate);
 int32_t T507AhubImplTrigger(enum AudioStreamType streamType, bool enable);
+int32_t T507AhubImplCaptureTap(uint32_t apb_num, bool enable);
+bool T507AhubImplXrunCheck(enum AudioStreamType streamType);
+int32_t T507AhubImplXrunRecover(enum AudioStreamType streamType);
+uint32_t T507AhubImplFifoAvail(enum AudioStreamType streamType, uint32_t *count);
+int32_t T507AhubImplApbNum(uint32_t *apb_num);
 
 #ifdef __cplusplus
 #if __cplusplus
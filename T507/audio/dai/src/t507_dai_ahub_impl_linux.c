@@ -23,10 +23,20 @@
 #include <linux/device.h>
 #include <linux/ioport.h>
 #include <linux/regmap.h>
+#include <linux/pm.h>
+#include <linux/pm_runtime.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/of_address.h>
 #include <linux/of_gpio.h>
 
 #include "t507_dai_ahub_impl_linux.h"
+#include "t507_clk_plan.h"
+#include "t507_audio_trace.h"
+#include "t507_regsnap_uapi.h"
 #include "audio_control.h"
 #include "audio_core.h"
 #include "audio_driver_log.h"
@@ -36,14 +46,55 @@
 
 #define DRV_NAME    "sunxi-snd-ahub"
 
+#define SUNXI_AHUB_AUTOSUSPEND_MS   2000    /* idle time before clocks and regulator are gated */
+#define SUNXI_AHUB_RESUME_BUDGET_US 5000    /* stream start after autosuspend must stay below */
+
 static struct platform_device *g_ahub_pdev;
 
+/* status, fifo data/count and self-clearing flush bits must always hit the hardware */
+static bool sunxi_ahub_volatile_reg(struct device *dev, unsigned int reg)
+{
+    uint32_t n;
+
+    (void)dev;
+
+    if (reg == SUNXI_AHUB_VER) {
+        return true;
+    }
+
+    for (n = 0; n < SUNXI_AHUB_APBIF_NUM; n++) {
+        if (reg == SUNXI_AHUB_APBIF_TX_IRQ_STA(n) || reg == SUNXI_AHUB_APBIF_TXFIFO_CTL(n) ||
+            reg == SUNXI_AHUB_APBIF_TXFIFO_STA(n) || reg == SUNXI_AHUB_APBIF_TXFIFO(n) ||
+            reg == SUNXI_AHUB_APBIF_TXFIFO_CNT(n)) {
+            return true;
+        }
+        if (reg == SUNXI_AHUB_APBIF_RX_IRQ_STA(n) || reg == SUNXI_AHUB_APBIF_RXFIFO_CTL(n) ||
+            reg == SUNXI_AHUB_APBIF_RXFIFO_STA(n) || reg == SUNXI_AHUB_APBIF_RXFIFO(n) ||
+            reg == SUNXI_AHUB_APBIF_RXFIFO_CNT(n)) {
+            return true;
+        }
+    }
+
+    for (n = 0; n < SUNXI_AHUB_I2S_NUM; n++) {
+        if (reg == SUNXI_AHUB_I2S_IRQ_STA(n)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * rbtree rather than flat: without reg_defaults a flat cache would answer
+ * zero for registers never written, rbtree fills on the first read.
+ */
 static struct regmap_config g_regmap_config = {
     .reg_bits = 32,
     .reg_stride = 4,
     .val_bits = 32,
     .max_register = SUNXI_AHUB_MAX_REG,
-    .cache_type = REGCACHE_NONE,
+    .volatile_reg = sunxi_ahub_volatile_reg,
+    .cache_type = REGCACHE_RBTREE,
 };
 
 struct sunxi_ahub_mem_info {
@@ -74,6 +125,14 @@ struct sunxi_ahub_dts_info {
     uint32_t tx_pin;
     uint32_t rx_pin;
 
+    /* tdm frame: slots 0 means derive from the channel count */
+    uint32_t slots;
+    uint32_t slot_width;
+    uint32_t rx_slot_map[SUNXI_AHUB_TDM_MAX_CH];    /* channel n <- slot rx_slot_map[n] */
+    uint32_t tx_slot_map[SUNXI_AHUB_TDM_MAX_CH];    /* slot n <- channel tx_slot_map[n] */
+
+    uint32_t autosuspend_ms;
+
     /* value must be (2^n)Kbyte */
     size_t playback_cma;
     size_t playback_fifo_size;
@@ -86,6 +145,23 @@ struct sunxi_ahub_regulator_info {
     const char *regulator_name;
 };
 
+#define SUNXI_AHUB_STREAM_NUM   2    /* indexed by enum AudioStreamType */
+
+/*
+ * last configuration written by T507AhubImplHwParams, the i2s frame (clock,
+ * sample resolution, slots) is shared by tx and rx, only the apbif side and
+ * the channel count are per stream
+ */
+struct sunxi_ahub_hw_cfg {
+    bool valid;
+    enum AudioFormat format;
+    uint32_t rate;
+    uint32_t freq_point;
+    uint32_t slots;
+    uint32_t slot_width;
+    uint32_t channels[SUNXI_AHUB_STREAM_NUM];    /* 0 until that stream was set up */
+};
+
 struct sunxi_ahub_info {
     struct device *dev;
 
@@ -102,6 +178,21 @@ struct sunxi_ahub_info {
     uint32_t mclk_freq;
     uint32_t lrck_freq;
     uint32_t bclk_freq;
+    struct sunxi_ahub_hw_cfg applied;
+
+    /* i2s rx is shared by the main capture apbif and any capture taps, all under rx_lock */
+    struct mutex rx_lock;
+    uint32_t rx_users;
+    uint32_t tap_mask;
+    bool rx_main_on;
+    bool tx_on;
+
+    struct dentry *debugfs_dir;
+
+    /* runtime pm: resume cost seen by the next stream start */
+    u32 resume_last_us;
+    u32 resume_max_us;
+    u32 resume_over_budget;
 
     /* for hdmi audio */
     /* enum HDMI_FORMAT hdmi_fmt; */
@@ -154,25 +245,48 @@ static struct reg_label g_reg_labels[] = {
     REG_LABEL_END,
 };
 
+/* register access outside a running stream, wakes the block and rearms autosuspend on put */
+static int sunxi_ahub_pm_get(struct sunxi_ahub_info *ahub_info)
+{
+    int ret;
+
+    ret = pm_runtime_get_sync(ahub_info->dev);
+    if (ret < 0) {
+        pm_runtime_put_noidle(ahub_info->dev);
+        AUDIO_DRIVER_LOG_ERR("runtime resume failed %d", ret);
+        return ret;
+    }
+
+    return 0;
+}
+
+static void sunxi_ahub_pm_put(struct sunxi_ahub_info *ahub_info)
+{
+    pm_runtime_mark_last_busy(ahub_info->dev);
+    pm_runtime_put_autosuspend(ahub_info->dev);
+}
+
 /*******************************************************************************
  *  for adm api
  ******************************************************************************/
-void T507AhubImplDeviceInit(void)
+static void sunxi_ahub_device_init(struct sunxi_ahub_info *ahub_info)
 {
-    struct sunxi_ahub_info *ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
     struct regmap *regmap = ahub_info->mem_info.regmap;
     uint32_t apb_num = ahub_info->dts_info.apb_num;
     uint32_t tdm_num = ahub_info->dts_info.tdm_num;
     uint32_t tx_pin = ahub_info->dts_info.tx_pin;
     uint32_t rx_pin = ahub_info->dts_info.rx_pin;
 
-    uint32_t reg_val = 0;
-    uint32_t rx_pin_map = 0;
+    uint32_t tx_chmap[2] = {0};
+    uint32_t rx_chmap[4] = {0};
+    uint32_t i;
     uint32_t tdm_to_apb = 0;
     uint32_t apb_to_tdm = 0;
 
     AUDIO_DRIVER_LOG_DEBUG("");
 
+    ahub_info->applied.valid = false;
+
     regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << I2S_CTL_GEN, 0x1 << I2S_CTL_GEN);
     regmap_update_bits(regmap, SUNXI_AHUB_RST, 0x1 << (I2S0_RST - tdm_num), 0x1 << (I2S0_RST - tdm_num));
     regmap_update_bits(regmap, SUNXI_AHUB_GAT, 0x1 << (I2S0_GAT - tdm_num), 0x1 << (I2S0_GAT - tdm_num));
@@ -182,20 +296,21 @@ void T507AhubImplDeviceInit(void)
     regmap_update_bits(regmap, SUNXI_AHUB_RST, 0x1 << (APBIF_RXDIF0_RST - apb_num), 0x1 << (APBIF_RXDIF0_RST - apb_num));
     regmap_update_bits(regmap, SUNXI_AHUB_GAT, 0x1 << (APBIF_RXDIF0_GAT - apb_num), 0x1 << (APBIF_RXDIF0_GAT - apb_num));
 
-    /* tdm tx channels map */
-    regmap_write(regmap, SUNXI_AHUB_I2S_OUT_CHMAP0(tdm_num, tx_pin), 0x76543210);
-    regmap_write(regmap, SUNXI_AHUB_I2S_OUT_CHMAP1(tdm_num, tx_pin), 0xFEDCBA98);
-
-    /* tdm rx channels map */
-    rx_pin_map = (rx_pin << 4) | (rx_pin << 12) | (rx_pin << 20) | (rx_pin << 28);
-    reg_val = 0x03020100 | rx_pin_map;
-    regmap_write(regmap, SUNXI_AHUB_I2S_IN_CHMAP0(tdm_num), reg_val);
-    reg_val = 0x07060504 | rx_pin_map;
-    regmap_write(regmap, SUNXI_AHUB_I2S_IN_CHMAP1(tdm_num), reg_val);
-    reg_val = 0x0B0A0908 | rx_pin_map;
-    regmap_write(regmap, SUNXI_AHUB_I2S_IN_CHMAP2(tdm_num), reg_val);
-    reg_val = 0x0F0E0D0C | rx_pin_map;
-    regmap_write(regmap, SUNXI_AHUB_I2S_IN_CHMAP3(tdm_num), reg_val);
+    /* tdm tx channels map, one nibble per slot: channel */
+    for (i = 0; i < SUNXI_AHUB_TDM_MAX_CH; i++) {
+        tx_chmap[i / 8] |= (ahub_info->dts_info.tx_slot_map[i] & 0xf) << ((i % 8) * 4);
+    }
+    regmap_write(regmap, SUNXI_AHUB_I2S_OUT_CHMAP0(tdm_num, tx_pin), tx_chmap[0]);
+    regmap_write(regmap, SUNXI_AHUB_I2S_OUT_CHMAP1(tdm_num, tx_pin), tx_chmap[1]);
+
+    /* tdm rx channels map, one byte per channel: rx pin << 4 | slot */
+    for (i = 0; i < SUNXI_AHUB_TDM_MAX_CH; i++) {
+        rx_chmap[i / 4] |= ((rx_pin << 4) | (ahub_info->dts_info.rx_slot_map[i] & 0xf)) << ((i % 4) * 8);
+    }
+    regmap_write(regmap, SUNXI_AHUB_I2S_IN_CHMAP0(tdm_num), rx_chmap[0]);
+    regmap_write(regmap, SUNXI_AHUB_I2S_IN_CHMAP1(tdm_num), rx_chmap[1]);
+    regmap_write(regmap, SUNXI_AHUB_I2S_IN_CHMAP2(tdm_num), rx_chmap[2]);
+    regmap_write(regmap, SUNXI_AHUB_I2S_IN_CHMAP3(tdm_num), rx_chmap[3]);
 
     /* tdm tx & rx data fmt
      * 1. MSB first
@@ -252,6 +367,18 @@ void T507AhubImplDeviceInit(void)
     AUDIO_DRIVER_LOG_DEBUG("success!");
 }
 
+void T507AhubImplDeviceInit(void)
+{
+    struct sunxi_ahub_info *ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
+
+    if (sunxi_ahub_pm_get(ahub_info) < 0) {
+        return;
+    }
+    sunxi_ahub_device_init(ahub_info);
+    sunxi_ahub_pm_put(ahub_info);
+}
+
+/* kcontrol access, while suspended the regmap answers and collects from its cache */
 void T507AhubImplRegmapWrite(uint32_t reg, uint32_t val)
 {
     struct sunxi_ahub_info *ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
@@ -270,14 +397,8 @@ void T507AhubImplRegmapRead(uint32_t reg, uint32_t *val)
 
 int32_t T507AhubImplStartup(enum AudioStreamType streamType)
 {
-    AUDIO_DRIVER_LOG_DEBUG("");
+    AUDIO_DRIVER_LOG_DEBUG("streamType %d", streamType);
 
-    if (streamType == AUDIO_RENDER_STREAM) {
-    /* ahub unuse render */
-    return HDF_SUCCESS;
-    }
-
-    AUDIO_DRIVER_LOG_DEBUG("success!");
     return HDF_SUCCESS;
 }
 
@@ -758,18 +879,44 @@ static int sunxi_ahub_dai_prepare(enum AudioStreamType streamType)
     return 0;
 }
 
-int32_t T507AhubImplHwParams(enum AudioStreamType streamType, enum AudioFormat format, uint32_t channels, uint32_t rate)
+/*
+ * Slots per frame on the rx pin: the dts "tdm-slots" if it fits, otherwise the
+ * channel count rounded up to a power of two so the bclk divider stays exact.
+ * Returns 0 when the channels cannot be carried.
+ */
+static int sunxi_ahub_tdm_slots(const struct sunxi_ahub_dts_info *dts_info, uint32_t channels)
+{
+    uint32_t slots;
+
+    if (channels == 0 || channels > SUNXI_AHUB_TDM_MAX_CH) {
+        return 0;
+    }
+    if (dts_info->slots != 0) {
+        return (channels <= dts_info->slots) ? dts_info->slots : 0;
+    }
+
+    slots = roundup_pow_of_two(channels);
+
+    return (slots < 2) ? 2 : slots;
+}
+
+static int32_t sunxi_ahub_hw_params_apply(struct sunxi_ahub_info *ahub_info, enum AudioStreamType streamType,
+    enum AudioFormat format, uint32_t channels, uint32_t rate)
 {
     int ret;
     uint32_t freq_point;
-    struct sunxi_ahub_info *ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
     struct sunxi_ahub_clk_info *clk_info = &ahub_info->clk_info;
-    uint32_t cpu_bclk_ratio;
+    struct T507ClkPlan plan;
+    enum T507ClkUser clk_user;
 
-    uint32_t cpu_pll_fs = 4;
-    int slots = 2;
-    int slot_width = 32;
+    int slots;
+    int slot_width = ahub_info->dts_info.slot_width;
     uint32_t dai_fmt = 0;
+    struct sunxi_ahub_hw_cfg *applied = &ahub_info->applied;
+    bool peer_running;
+    bool clk_changed;
+    bool rate_changed;
+    bool fmt_changed;
     dai_fmt |= SND_SOC_DAIFMT_I2S;
     dai_fmt |= SND_SOC_DAIFMT_NB_NF;
     dai_fmt |= SND_SOC_DAIFMT_CBS_CFS;
@@ -791,85 +938,109 @@ int32_t T507AhubImplHwParams(enum AudioStreamType streamType, enum AudioFormat f
     AUDIO_DRIVER_LOG_DEBUG(" rate %u", rate);
     AUDIO_DRIVER_LOG_DEBUG(" channels %u", channels);
 
-    if (streamType == AUDIO_RENDER_STREAM) {
-        /* ahub unuse render */
-        return HDF_SUCCESS;
+    if (streamType != AUDIO_RENDER_STREAM && streamType != AUDIO_CAPTURE_STREAM) {
+        AUDIO_DRIVER_LOG_ERR("streamType: %d is not define.", streamType);
+        return HDF_FAILURE;
     }
 
-    /* set pll */
-    switch (rate) {
-        case 8000:
-        case 12000:
-        case 16000:
-        case 24000:
-        case 32000:
-        case 48000:
-        case 64000:
-        case 96000:
-        case 192000:
-            freq_point = 24576000;
-            break;
-        case 11025:
-        case 22050:
-        case 44100:
-        case 88200:
-        case 176400:
-            freq_point = 22579200;
-            break;
-        default:
-            AUDIO_DRIVER_LOG_ERR("rate: %d is not define.", rate);
-            return HDF_FAILURE;
+    /* tx and rx run on one i2s frame, join the running direction if there is one */
+    mutex_lock(&ahub_info->rx_lock);
+    peer_running = (streamType == AUDIO_RENDER_STREAM) ? (ahub_info->rx_users > 0) : ahub_info->tx_on;
+    mutex_unlock(&ahub_info->rx_lock);
+    if (peer_running && applied->valid && channels <= applied->slots) {
+        slots = applied->slots;
+    } else {
+        slots = sunxi_ahub_tdm_slots(&ahub_info->dts_info, channels);
     }
-    AUDIO_DRIVER_LOG_DEBUG(" freq_point %u", freq_point);
-
-    ahub_info->pllclk_freq = freq_point * cpu_pll_fs;
-    ahub_info->moduleclk_freq = ahub_info->pllclk_freq;
+    if (slots == 0) {
+        AUDIO_DRIVER_LOG_ERR("channels: %u is not support on one data pin.", channels);
+        return HDF_FAILURE;
+    }
+    AUDIO_DRIVER_LOG_DEBUG(" slots %d x %d bit", slots, slot_width);
 
-    if (clk_set_rate(clk_info->clk_pllx4, ahub_info->pllclk_freq)) {
-        AUDIO_DRIVER_LOG_ERR("clk pllaudio set rate failed");
-        return -EINVAL;
+    /* pll, mclk and bclk come from the shared plan, which refuses a pll family switch under a running stream */
+    clk_user = (streamType == AUDIO_RENDER_STREAM) ? T507_CLK_AHUB_RENDER : T507_CLK_AHUB_CAPTURE;
+    ret = T507ClkPlanPrepare(clk_user, rate, slots, slot_width, &plan);
+    if (ret != HDF_SUCCESS) {
+        return ret;
     }
-    if (clk_set_rate(clk_info->clk_module, ahub_info->moduleclk_freq)) {
-        AUDIO_DRIVER_LOG_ERR("clk audio set rate failed");
-        return -EINVAL;
+    freq_point = plan.freqPoint;
+    AUDIO_DRIVER_LOG_DEBUG(" freq_point %u", freq_point);
+
+    /* only redo what differs from the last open, a same-params restart is a fifo flush */
+    clk_changed = !applied->valid || applied->freq_point != freq_point || plan.pllRetune;
+    rate_changed = clk_changed || applied->rate != rate ||
+                   applied->slots != slots || applied->slot_width != slot_width;
+    fmt_changed = !applied->valid || applied->format != format || applied->channels[streamType] != channels;
+    if (peer_running && (rate_changed || applied->format != format)) {
+        AUDIO_DRIVER_LOG_ERR("%s running at %u Hz format %d, can not switch to %u Hz format %d",
+            (streamType == AUDIO_RENDER_STREAM) ? "capture" : "render", applied->rate, applied->format, rate, format);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+    if (rate_changed || applied->format != format) {
+        /* the other apbif was set up for the old frame */
+        applied->channels[AUDIO_CAPTURE_STREAM] = 0;
+        applied->channels[AUDIO_RENDER_STREAM] = 0;
+    }
+    applied->valid = false;
+
+    /* retunes pllx4 if needed, under the plan lock */
+    ret = T507ClkPlanCommit(clk_user, &plan, clk_info->clk_pllx4);
+    if (ret != HDF_SUCCESS) {
+        return ret;
     }
 
-    /* set mclk */
-    ahub_info->mclk_freq = freq_point / 2;    /* ac107 need mclk freq 12.288M or 11.2896MHz */
+    if (clk_changed) {
+        ahub_info->pllclk_freq = plan.pllx4Freq;
+        ahub_info->moduleclk_freq = ahub_info->pllclk_freq;
 
-    ret = sunxi_ahub_dai_set_sysclk(ahub_info->mclk_freq);
-    if (ret) {
-        AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_set_sysclk failed");
-        return HDF_FAILURE;
-    }
+        if (clk_set_rate(clk_info->clk_module, ahub_info->moduleclk_freq)) {
+            AUDIO_DRIVER_LOG_ERR("clk audio set rate failed");
+            return -EINVAL;
+        }
 
-    /* set bclk */
-    cpu_bclk_ratio = ahub_info->pllclk_freq / (slots * slot_width * rate);
-    ret = sunxi_ahub_dai_set_bclk_ratio(cpu_bclk_ratio);
-    if (ret) {
-        AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_set_bclk_ratio failed");
-        return HDF_FAILURE;
-    }
+        /* set mclk */
+        ahub_info->mclk_freq = plan.mclkFreq;
 
-    /* set fmt */
-    ret = sunxi_ahub_dai_set_fmt(dai_fmt);
-    if (ret) {
-        AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_set_fmt failed");
-        return HDF_FAILURE;
+        ret = sunxi_ahub_dai_set_sysclk(ahub_info->mclk_freq);
+        if (ret) {
+            AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_set_sysclk failed");
+            return HDF_FAILURE;
+        }
     }
 
-    /* set tdm slot */
-    ret = sunxi_ahub_dai_set_tdm_slot(slots, slot_width);
-    if (ret) {
-        AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_set_tdm_slot failed");
-        return HDF_FAILURE;
+    if (rate_changed) {
+        /* set bclk */
+        ahub_info->lrck_freq = plan.rate;
+        ahub_info->bclk_freq = plan.bclkFreq;
+        ret = sunxi_ahub_dai_set_bclk_ratio(plan.bclkRatio);
+        if (ret) {
+            AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_set_bclk_ratio failed");
+            return HDF_FAILURE;
+        }
+
+        /* set fmt */
+        ret = sunxi_ahub_dai_set_fmt(dai_fmt);
+        if (ret) {
+            AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_set_fmt failed");
+            return HDF_FAILURE;
+        }
+
+        /* set tdm slot */
+        ret = sunxi_ahub_dai_set_tdm_slot(slots, slot_width);
+        if (ret) {
+            AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_set_tdm_slot failed");
+            return HDF_FAILURE;
+        }
     }
 
-    /* set pcm info */
-    ret = sunxi_ahub_dai_hw_params(streamType, format, channels, rate);
-    if (ret) {
-        AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_hw_params failed");
-        return HDF_FAILURE;
+    if (fmt_changed) {
+        /* set pcm info */
+        ret = sunxi_ahub_dai_hw_params(streamType, format, channels, rate);
+        if (ret) {
+            AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_hw_params failed");
+            return HDF_FAILURE;
+        }
     }
 
     /* clear fifo */
@@ -879,59 +1050,389 @@ int32_t T507AhubImplHwParams(enum AudioStreamType streamType, enum AudioFormat f
         return HDF_FAILURE;
     }
 
+    applied->format = format;
+    applied->channels[streamType] = channels;
+    applied->rate = rate;
+    applied->freq_point = freq_point;
+    applied->slots = slots;
+    applied->slot_width = slot_width;
+    applied->valid = true;
+
     AUDIO_DRIVER_LOG_DEBUG("success!");
     return HDF_SUCCESS;
 }
 
-static void sunxi_ahub_dai_rx_route(struct sunxi_ahub_info *ahub_info, bool enable)
+int32_t T507AhubImplHwParams(enum AudioStreamType streamType, enum AudioFormat format, uint32_t channels, uint32_t rate)
+{
+    struct sunxi_ahub_info *ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
+    int32_t ret;
+
+    if (sunxi_ahub_pm_get(ahub_info) < 0) {
+        return HDF_FAILURE;
+    }
+    ret = sunxi_ahub_hw_params_apply(ahub_info, streamType, format, channels, rate);
+    sunxi_ahub_pm_put(ahub_info);
+
+    return ret;
+}
+
+/* a running direction holds a runtime pm reference from start to stop */
+static int32_t sunxi_ahub_dai_tx_route(struct sunxi_ahub_info *ahub_info, bool enable)
+{
+    struct regmap *regmap = ahub_info->mem_info.regmap;
+    uint32_t apb_num = ahub_info->dts_info.apb_num;
+    uint32_t tdm_num = ahub_info->dts_info.tdm_num;
+    uint32_t tx_pin = ahub_info->dts_info.tx_pin;
+
+    AUDIO_DRIVER_LOG_DEBUG("%s", enable ? "on" : "off");
+
+    if (enable == ahub_info->tx_on) {
+        return HDF_SUCCESS;
+    }
+
+    if (enable) {
+        if (sunxi_ahub_pm_get(ahub_info) < 0) {
+            return HDF_FAILURE;
+        }
+        if (T507ClkPlanSetRunning(T507_CLK_AHUB_RENDER, true) != HDF_SUCCESS) {
+            sunxi_ahub_pm_put(ahub_info);
+            return HDF_ERR_DEVICE_BUSY;
+        }
+        /* tdm tx first so the apbif fifo drains as soon as the drq fills it */
+        regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << (I2S_CTL_SDO0_EN + tx_pin), 0x1 << (I2S_CTL_SDO0_EN + tx_pin));
+        regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << I2S_CTL_TXEN, 0x1 << I2S_CTL_TXEN);
+        /* start apbif tx */
+        regmap_update_bits(regmap, SUNXI_AHUB_APBIF_TX_CTL(apb_num), 0x1 << APBIF_TX_START, 0x1 << APBIF_TX_START);
+        /* enable tx drq */
+        regmap_update_bits(regmap, SUNXI_AHUB_APBIF_TX_IRQ_CTL(apb_num), 0x1 << APBIF_TX_DRQ, 0x1 << APBIF_TX_DRQ);
+    } else {
+        /* disable tx drq */
+        regmap_update_bits(regmap, SUNXI_AHUB_APBIF_TX_IRQ_CTL(apb_num), 0x1 << APBIF_TX_DRQ, 0x0 << APBIF_TX_DRQ);
+        /* stop apbif tx */
+        regmap_update_bits(regmap, SUNXI_AHUB_APBIF_TX_CTL(apb_num), 0x1 << APBIF_TX_START, 0x0 << APBIF_TX_START);
+        regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << I2S_CTL_TXEN, 0x0 << I2S_CTL_TXEN);
+        regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << (I2S_CTL_SDO0_EN + tx_pin), 0x0 << (I2S_CTL_SDO0_EN + tx_pin));
+        T507ClkPlanSetRunning(T507_CLK_AHUB_RENDER, false);
+        sunxi_ahub_pm_put(ahub_info);
+    }
+    ahub_info->tx_on = enable;
+
+    return HDF_SUCCESS;
+}
+
+/* refcounted: the i2s keeps receiving while the main capture or any tap is running, caller holds rx_lock */
+static int32_t sunxi_ahub_i2s_rx_enable(struct sunxi_ahub_info *ahub_info, bool enable)
+{
+    struct regmap *regmap = ahub_info->mem_info.regmap;
+    uint32_t tdm_num = ahub_info->dts_info.tdm_num;
+    uint32_t rx_pin = ahub_info->dts_info.rx_pin;
+
+    if (enable) {
+        if (ahub_info->rx_users > 0) {
+            ahub_info->rx_users++;
+            return HDF_SUCCESS;
+        }
+        if (sunxi_ahub_pm_get(ahub_info) < 0) {
+            return HDF_FAILURE;
+        }
+        if (T507ClkPlanSetRunning(T507_CLK_AHUB_CAPTURE, true) != HDF_SUCCESS) {
+            sunxi_ahub_pm_put(ahub_info);
+            return HDF_ERR_DEVICE_BUSY;
+        }
+        ahub_info->rx_users = 1;
+        regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << (I2S_CTL_SDI0_EN + rx_pin), 0x1 << (I2S_CTL_SDI0_EN + rx_pin));
+        regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << I2S_CTL_RXEN, 0x1 << I2S_CTL_RXEN);
+    } else {
+        if (ahub_info->rx_users == 0 || --ahub_info->rx_users > 0) {
+            return HDF_SUCCESS;
+        }
+        regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << I2S_CTL_RXEN, 0x0 << I2S_CTL_RXEN);
+        regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << (I2S_CTL_SDI0_EN + rx_pin), 0x0 << (I2S_CTL_SDI0_EN + rx_pin));
+        T507ClkPlanSetRunning(T507_CLK_AHUB_CAPTURE, false);
+        sunxi_ahub_pm_put(ahub_info);
+    }
+
+    return HDF_SUCCESS;
+}
+
+static int32_t sunxi_ahub_dai_rx_route(struct sunxi_ahub_info *ahub_info, bool enable)
 {
     struct regmap *regmap = NULL;
-    uint32_t tdm_num, rx_pin;
     uint32_t apb_num;
 
     AUDIO_DRIVER_LOG_DEBUG("%s", enable ? "on" : "off");
 
     regmap = ahub_info->mem_info.regmap;
-    tdm_num = ahub_info->dts_info.tdm_num;
-    rx_pin = ahub_info->dts_info.rx_pin;
     apb_num = ahub_info->dts_info.apb_num;
 
+    mutex_lock(&ahub_info->rx_lock);
     if (enable)
         goto rx_route_enable;
     else
         goto rx_route_disable;
 
 rx_route_enable:
-    regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << (I2S_CTL_SDI0_EN + rx_pin), 0x1 << (I2S_CTL_SDI0_EN + rx_pin));
-    regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << I2S_CTL_RXEN, 0x1 << I2S_CTL_RXEN);
+    if (!ahub_info->rx_main_on) {
+        if (sunxi_ahub_i2s_rx_enable(ahub_info, true) != HDF_SUCCESS) {
+            mutex_unlock(&ahub_info->rx_lock);
+            return HDF_ERR_DEVICE_BUSY;
+        }
+        ahub_info->rx_main_on = true;
+    }
     /* start apbif rx */
     regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RX_CTL(apb_num), 0x1 << APBIF_RX_START, 0x1 << APBIF_RX_START);
     /* enable rx drq */
     regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RX_IRQ_CTL(apb_num), 0x1 << APBIF_RX_DRQ, 0x1 << APBIF_RX_DRQ);
-    return;
+    mutex_unlock(&ahub_info->rx_lock);
+    return HDF_SUCCESS;
 
 rx_route_disable:
-    regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << I2S_CTL_RXEN, 0x0 << I2S_CTL_RXEN);
-    regmap_update_bits(regmap, SUNXI_AHUB_I2S_CTL(tdm_num), 0x1 << (I2S_CTL_SDI0_EN + rx_pin), 0x0 << (I2S_CTL_SDI0_EN + rx_pin));
+    if (!ahub_info->rx_main_on) {
+        mutex_unlock(&ahub_info->rx_lock);
+        return HDF_SUCCESS;
+    }
     /* stop apbif rx */
     regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RX_CTL(apb_num), 0x1 << APBIF_RX_START, 0x0 << APBIF_RX_START);
     /* disable rx drq */
     regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RX_IRQ_CTL(apb_num), 0x1 << APBIF_RX_DRQ, 0x0 << APBIF_RX_DRQ);
-    return;
+    /* last, this may drop the pm reference */
+    ahub_info->rx_main_on = false;
+    sunxi_ahub_i2s_rx_enable(ahub_info, false);
+    mutex_unlock(&ahub_info->rx_lock);
+    return HDF_SUCCESS;
+}
+
+/*
+ * Route the configured tdm input to an extra apbif rx endpoint as well, so a
+ * second dma stream gets the same frames without a cpu copy. The tap copies
+ * the sample format and channel count of the main capture apbif and can be
+ * started and stopped on its own.
+ */
+int32_t T507AhubImplCaptureTap(uint32_t apb_num, bool enable)
+{
+    struct sunxi_ahub_info *ahub_info;
+    struct regmap *regmap = NULL;
+    uint32_t main_apb, tdm_num;
+    uint32_t reg_val = 0;
+    uint32_t mask;
+
+    if (g_ahub_pdev == NULL) {
+        return HDF_FAILURE;
+    }
+    ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
+    if (IS_ERR_OR_NULL(ahub_info)) {
+        AUDIO_DRIVER_LOG_ERR("ahub_info is null.");
+        return HDF_FAILURE;
+    }
+    regmap = ahub_info->mem_info.regmap;
+    main_apb = ahub_info->dts_info.apb_num;
+    tdm_num = ahub_info->dts_info.tdm_num;
+
+    if (apb_num >= SUNXI_AHUB_APBIF_NUM || apb_num == main_apb) {
+        AUDIO_DRIVER_LOG_ERR("apb num %u can not be a tap", apb_num);
+        return HDF_ERR_INVALID_PARAM;
+    }
+    mutex_lock(&ahub_info->rx_lock);
+    if (enable == ((ahub_info->tap_mask & (0x1 << apb_num)) != 0)) {
+        mutex_unlock(&ahub_info->rx_lock);
+        return HDF_SUCCESS;
+    }
+
+    if (!enable) {
+        regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RX_IRQ_CTL(apb_num), 0x1 << APBIF_RX_DRQ, 0x0 << APBIF_RX_DRQ);
+        regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RX_CTL(apb_num), 0x1 << APBIF_RX_START, 0x0 << APBIF_RX_START);
+        sunxi_ahub_i2s_rx_enable(ahub_info, false);
+        ahub_info->tap_mask &= ~(0x1 << apb_num);
+        mutex_unlock(&ahub_info->rx_lock);
+        return HDF_SUCCESS;
+    }
+
+    /* the i2s rx reference keeps the block awake once the tap runs */
+    if (sunxi_ahub_pm_get(ahub_info) < 0) {
+        mutex_unlock(&ahub_info->rx_lock);
+        return HDF_FAILURE;
+    }
+    regmap_update_bits(regmap, SUNXI_AHUB_RST, 0x1 << (APBIF_RXDIF0_RST - apb_num), 0x1 << (APBIF_RXDIF0_RST - apb_num));
+    regmap_update_bits(regmap, SUNXI_AHUB_GAT, 0x1 << (APBIF_RXDIF0_GAT - apb_num), 0x1 << (APBIF_RXDIF0_GAT - apb_num));
+
+    /* same source, word size, channels, fifo mode and level as the main apbif */
+    regmap_read(regmap, SUNXI_AHUB_APBIF_RXFIFO_CONT(main_apb), &reg_val);
+    regmap_write(regmap, SUNXI_AHUB_APBIF_RXFIFO_CONT(apb_num), reg_val);
+    mask = (0x7 << APBIF_RX_WS) | (0xf << APBIF_RX_CHAN_NUM);
+    regmap_read(regmap, SUNXI_AHUB_APBIF_RX_CTL(main_apb), &reg_val);
+    regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RX_CTL(apb_num), mask, reg_val & mask);
+    mask = (0x3 << APBIF_RX_RXOM) | (0x7f << APBIF_RX_LEVEL);
+    regmap_read(regmap, SUNXI_AHUB_APBIF_RXFIFO_CTL(main_apb), &reg_val);
+    regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RXFIFO_CTL(apb_num), mask, reg_val & mask);
+
+    /* clear fifo, irq and count */
+    regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RXFIFO_CTL(apb_num), 0x1 << APBIF_RX_FRX, 0x1 << APBIF_RX_FRX);
+    regmap_write(regmap, SUNXI_AHUB_APBIF_RX_IRQ_STA(apb_num), (0x1 << APBIF_RX_UV_PEND) | (0x1 << APBIF_RX_AV_PEND));
+    regmap_write(regmap, SUNXI_AHUB_APBIF_RXFIFO_CNT(apb_num), 0);
+
+    if (sunxi_ahub_i2s_rx_enable(ahub_info, true) != HDF_SUCCESS) {
+        sunxi_ahub_pm_put(ahub_info);
+        mutex_unlock(&ahub_info->rx_lock);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+    regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RX_CTL(apb_num), 0x1 << APBIF_RX_START, 0x1 << APBIF_RX_START);
+    regmap_update_bits(regmap, SUNXI_AHUB_APBIF_RX_IRQ_CTL(apb_num), 0x1 << APBIF_RX_DRQ, 0x1 << APBIF_RX_DRQ);
+    ahub_info->tap_mask |= 0x1 << apb_num;
+    sunxi_ahub_pm_put(ahub_info);
+    mutex_unlock(&ahub_info->rx_lock);
+
+    AUDIO_DRIVER_LOG_DEBUG("apbif %u tap on tdm %u", apb_num, tdm_num);
+    return HDF_SUCCESS;
+}
+
+/*
+ * called from the dma period callback: report and clear fifo over/underrun.
+ * Only the error flags are tested and written back; TX_EM/RX_AV are the
+ * normal drq levels and are set on every period.
+ */
+bool T507AhubImplXrunCheck(enum AudioStreamType streamType)
+{
+    struct sunxi_ahub_info *ahub_info;
+    struct regmap *regmap = NULL;
+    uint32_t apb_num;
+    uint32_t tdm_num;
+    uint32_t apb_val = 0;
+    uint32_t i2s_val = 0;
+
+    if (g_ahub_pdev == NULL) {
+        return false;
+    }
+    ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
+    if (IS_ERR_OR_NULL(ahub_info)) {
+        return false;
+    }
+    regmap = ahub_info->mem_info.regmap;
+    apb_num = ahub_info->dts_info.apb_num;
+    tdm_num = ahub_info->dts_info.tdm_num;
+
+    regmap_read(regmap, SUNXI_AHUB_I2S_IRQ_STA(tdm_num), &i2s_val);
+    if (streamType == AUDIO_RENDER_STREAM) {
+        regmap_read(regmap, SUNXI_AHUB_APBIF_TX_IRQ_STA(apb_num), &apb_val);
+        apb_val &= 0x1 << APBIF_TX_OV_PEND;
+        i2s_val &= 0x1 << I2S_IRQ_TXUV_PEND;
+        if (apb_val != 0) {
+            regmap_write(regmap, SUNXI_AHUB_APBIF_TX_IRQ_STA(apb_num), apb_val);
+        }
+    } else {
+        regmap_read(regmap, SUNXI_AHUB_APBIF_RX_IRQ_STA(apb_num), &apb_val);
+        apb_val &= 0x1 << APBIF_RX_UV_PEND;
+        i2s_val &= 0x1 << I2S_IRQ_RXOV_PEND;
+        if (apb_val != 0) {
+            regmap_write(regmap, SUNXI_AHUB_APBIF_RX_IRQ_STA(apb_num), apb_val);
+        }
+    }
+    if (i2s_val != 0) {
+        regmap_write(regmap, SUNXI_AHUB_I2S_IRQ_STA(tdm_num), i2s_val);
+    }
+
+    return apb_val != 0 || i2s_val != 0;
+}
+
+/* flush the apbif fifo after an xrun, the stream keeps running */
+int32_t T507AhubImplXrunRecover(enum AudioStreamType streamType)
+{
+    if (g_ahub_pdev == NULL) {
+        return HDF_FAILURE;
+    }
+
+    if (sunxi_ahub_dai_prepare(streamType) < 0) {
+        AUDIO_DRIVER_LOG_ERR("sunxi_ahub_dai_prepare failed.");
+        return HDF_FAILURE;
+    }
+
+    return HDF_SUCCESS;
+}
+
+/* main apbif from the dts apb-num, the dma side programs its fifo and drq from this */
+int32_t T507AhubImplApbNum(uint32_t *apb_num)
+{
+    struct sunxi_ahub_info *ahub_info;
+
+    if (g_ahub_pdev == NULL || apb_num == NULL) {
+        return HDF_FAILURE;
+    }
+    ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
+    if (IS_ERR_OR_NULL(ahub_info)) {
+        AUDIO_DRIVER_LOG_ERR("ahub_info is null.");
+        return HDF_FAILURE;
+    }
+    *apb_num = ahub_info->dts_info.apb_num;
+
+    return HDF_SUCCESS;
+}
+
+/*
+ * For tracing: words the dma can move on the main apbif right now, ready
+ * words for capture and free room for render, plus the apbif fifo counter.
+ */
+uint32_t T507AhubImplFifoAvail(enum AudioStreamType streamType, uint32_t *count)
+{
+    struct sunxi_ahub_info *ahub_info;
+    struct regmap *regmap = NULL;
+    uint32_t apb_num;
+    uint32_t reg_val = 0;
+
+    *count = 0;
+    if (g_ahub_pdev == NULL) {
+        return 0;
+    }
+    ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
+    if (IS_ERR_OR_NULL(ahub_info)) {
+        return 0;
+    }
+    regmap = ahub_info->mem_info.regmap;
+    apb_num = ahub_info->dts_info.apb_num;
+
+    if (streamType == AUDIO_RENDER_STREAM) {
+        regmap_read(regmap, SUNXI_AHUB_APBIF_TXFIFO_CNT(apb_num), count);
+        regmap_read(regmap, SUNXI_AHUB_APBIF_TXFIFO_STA(apb_num), &reg_val);
+        return (reg_val >> APBIF_TX_EMCNT) & 0xff;
+    }
+    regmap_read(regmap, SUNXI_AHUB_APBIF_RXFIFO_CNT(apb_num), count);
+    regmap_read(regmap, SUNXI_AHUB_APBIF_RXFIFO_STA(apb_num), &reg_val);
+
+    return (reg_val >> APBIF_RX_AVCNT) & 0xff;
+}
+
+static void sunxi_ahub_trace_trigger(enum AudioStreamType streamType, bool enable)
+{
+    uint32_t avail, count;
+
+    if (!trace_t507_audio_trigger_enabled()) {
+        return;
+    }
+    avail = T507AhubImplFifoAvail(streamType, &count);
+    trace_t507_audio_trigger("ahub", streamType == AUDIO_RENDER_STREAM, enable, avail, count);
 }
 
 int32_t T507AhubImplTrigger(enum AudioStreamType streamType, bool enable)
 {
     struct sunxi_ahub_info *ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
+    int32_t ret;
 
     AUDIO_DRIVER_LOG_DEBUG("");
 
+    /* sampled while the path runs: before a stop, after a start */
+    if (!enable) {
+        sunxi_ahub_trace_trigger(streamType, enable);
+    }
     if (streamType == AUDIO_RENDER_STREAM) {
-    /* ahub unuse render */
-    return HDF_SUCCESS;
+        ret = sunxi_ahub_dai_tx_route(ahub_info, enable);
+    } else {
+        ret = sunxi_ahub_dai_rx_route(ahub_info, enable);
+    }
+    if (ret != HDF_SUCCESS) {
+        AUDIO_DRIVER_LOG_ERR("%s start refused", (streamType == AUDIO_RENDER_STREAM) ? "render" : "capture");
+        return ret;
+    }
+    if (enable) {
+        sunxi_ahub_trace_trigger(streamType, enable);
     }
-
-    sunxi_ahub_dai_rx_route(ahub_info, enable);
 
     AUDIO_DRIVER_LOG_DEBUG("success!");
     return HDF_SUCCESS;
@@ -1062,6 +1563,39 @@ err_module_clk:
     return ret;
 }
 
+/* runtime pm gating, same order as clk_init */
+static int snd_sunxi_ahub_clk_enable(struct sunxi_ahub_clk_info *clk_info)
+{
+    if (clk_prepare_enable(clk_info->clk_pll)) {
+        AUDIO_DRIVER_LOG_ERR("clk_pll enable failed");
+        goto err_pll_clk_enable;
+    }
+    if (clk_prepare_enable(clk_info->clk_pllx4)) {
+        AUDIO_DRIVER_LOG_ERR("clk_pllx4 enable failed");
+        goto err_pllx4_clk_enable;
+    }
+    if (clk_prepare_enable(clk_info->clk_module)) {
+        AUDIO_DRIVER_LOG_ERR("clk_module enable failed");
+        goto err_module_clk_enable;
+    }
+
+    return 0;
+
+err_module_clk_enable:
+    clk_disable_unprepare(clk_info->clk_pllx4);
+err_pllx4_clk_enable:
+    clk_disable_unprepare(clk_info->clk_pll);
+err_pll_clk_enable:
+    return -EBUSY;
+}
+
+static void snd_sunxi_ahub_clk_disable(struct sunxi_ahub_clk_info *clk_info)
+{
+    clk_disable_unprepare(clk_info->clk_module);
+    clk_disable_unprepare(clk_info->clk_pllx4);
+    clk_disable_unprepare(clk_info->clk_pll);
+}
+
 static void snd_sunxi_clk_exit(struct sunxi_ahub_clk_info *clk_info)
 {
     AUDIO_DRIVER_LOG_DEBUG("");
@@ -1135,10 +1669,55 @@ static int snd_sunxi_ahub_dts_params_init(struct platform_device *pdev, struct s
         }
     }
 
+    ret = of_property_read_u32(np, "tdm-slots", &temp_val);
+    if (ret < 0) {
+        dts_info->slots = 0;
+    } else {
+        if (temp_val != 2 && temp_val != 4 && temp_val != 8 && temp_val != SUNXI_AHUB_TDM_MAX_CH) {
+            dts_info->slots = 0;
+            AUDIO_DRIVER_LOG_ERR("tdm-slots config invalid");
+        } else {
+            dts_info->slots = temp_val;
+        }
+    }
+    ret = of_property_read_u32(np, "tdm-slot-width", &temp_val);
+    if (ret < 0) {
+        dts_info->slot_width = 32;
+    } else {
+        if (temp_val < 8 || temp_val > 32 || (temp_val % 4) != 0) {
+            dts_info->slot_width = 32;
+            AUDIO_DRIVER_LOG_ERR("tdm-slot-width config invalid");
+        } else {
+            dts_info->slot_width = temp_val;
+        }
+    }
+    ret = of_property_read_u32_array(np, "rx-slot-map", dts_info->rx_slot_map, SUNXI_AHUB_TDM_MAX_CH);
+    if (ret < 0) {
+        for (temp_val = 0; temp_val < SUNXI_AHUB_TDM_MAX_CH; temp_val++) {
+            dts_info->rx_slot_map[temp_val] = temp_val;
+        }
+    }
+    ret = of_property_read_u32_array(np, "tx-slot-map", dts_info->tx_slot_map, SUNXI_AHUB_TDM_MAX_CH);
+    if (ret < 0) {
+        for (temp_val = 0; temp_val < SUNXI_AHUB_TDM_MAX_CH; temp_val++) {
+            dts_info->tx_slot_map[temp_val] = temp_val;
+        }
+    }
+
+    ret = of_property_read_u32(np, "autosuspend-delay-ms", &temp_val);
+    if (ret < 0) {
+        dts_info->autosuspend_ms = SUNXI_AHUB_AUTOSUSPEND_MS;
+    } else {
+        dts_info->autosuspend_ms = temp_val;
+    }
+
     AUDIO_DRIVER_LOG_DEBUG("apb-num      : %u", dts_info->apb_num);
     AUDIO_DRIVER_LOG_DEBUG("tdm-num      : %u", dts_info->tdm_num);
     AUDIO_DRIVER_LOG_DEBUG("tx-pin       : %u", dts_info->tx_pin);
     AUDIO_DRIVER_LOG_DEBUG("rx-pin       : %u", dts_info->rx_pin);
+    AUDIO_DRIVER_LOG_DEBUG("tdm-slots    : %u", dts_info->slots);
+    AUDIO_DRIVER_LOG_DEBUG("tdm-slot-w   : %u", dts_info->slot_width);
+    AUDIO_DRIVER_LOG_DEBUG("autosuspend  : %u ms", dts_info->autosuspend_ms);
 
     return 0;
 };
@@ -1236,6 +1815,27 @@ err_regulator_get:
     return ret;
 };
 
+static int snd_sunxi_ahub_regulator_enable(struct sunxi_ahub_regulator_info *rglt_info)
+{
+    if (IS_ERR_OR_NULL(rglt_info->regulator)) {
+        return 0;
+    }
+    if (regulator_enable(rglt_info->regulator) < 0) {
+        AUDIO_DRIVER_LOG_ERR("enable duaido vcc-pin failed");
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+static void snd_sunxi_ahub_regulator_disable(struct sunxi_ahub_regulator_info *rglt_info)
+{
+    if (IS_ERR_OR_NULL(rglt_info->regulator)) {
+        return;
+    }
+    regulator_disable(rglt_info->regulator);
+}
+
 static void snd_sunxi_ahub_regulator_exit(struct sunxi_ahub_regulator_info *rglt_info)
 {
     AUDIO_DRIVER_LOG_DEBUG("");
@@ -1248,22 +1848,118 @@ static void snd_sunxi_ahub_regulator_exit(struct sunxi_ahub_regulator_info *rglt
     }
 }
 
+/*
+ * Register snapshot: all labelled registers are read in one pass first and
+ * formatted after, one "addr value name" line each, so two snapshots diff
+ * line by line.
+ */
+static size_t sunxi_ahub_reg_snapshot(struct regmap *regmap, uint32_t *vals)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_reg_labels) && g_reg_labels[i].name != NULL; i++) {
+        regmap_read(regmap, g_reg_labels[i].address, &vals[i]);
+    }
+
+    return i;
+}
+
+static int sunxi_ahub_regs_show(struct seq_file *m, void *v)
+{
+    struct sunxi_ahub_info *ahub_info = m->private;
+    uint32_t vals[ARRAY_SIZE(g_reg_labels)];
+    size_t num, i;
+
+    (void)v;
+
+    if (sunxi_ahub_pm_get(ahub_info) < 0) {
+        return -EIO;
+    }
+    num = sunxi_ahub_reg_snapshot(ahub_info->mem_info.regmap, vals);
+    sunxi_ahub_pm_put(ahub_info);
+    for (i = 0; i < num; i++) {
+        seq_printf(m, "0x%03x 0x%08x %s\n", g_reg_labels[i].address, vals[i], g_reg_labels[i].name);
+    }
+
+    return 0;
+}
+
+static int sunxi_ahub_regs_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, sunxi_ahub_regs_show, inode->i_private);
+}
+
+static const struct file_operations g_ahub_regs_fops = {
+    .owner      = THIS_MODULE,
+    .open       = sunxi_ahub_regs_open,
+    .read       = seq_read,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
+/* the same snapshot packed as struct T507RegSnapHeader and entries, for tools/t507_regsnap.py */
+static int sunxi_ahub_regs_bin_show(struct seq_file *m, void *v)
+{
+    struct sunxi_ahub_info *ahub_info = m->private;
+    uint32_t vals[ARRAY_SIZE(g_reg_labels)];
+    struct T507RegSnapHeader hdr;
+    struct T507RegSnapEntry entry;
+    size_t num, i;
+
+    (void)v;
+
+    if (sunxi_ahub_pm_get(ahub_info) < 0) {
+        return -EIO;
+    }
+    num = sunxi_ahub_reg_snapshot(ahub_info->mem_info.regmap, vals);
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.tstampNs = ktime_get_ns();
+    sunxi_ahub_pm_put(ahub_info);
+
+    hdr.magic = T507_REGSNAP_MAGIC;
+    hdr.version = T507_REGSNAP_VERSION;
+    hdr.count = (__u16)num;
+    hdr.block = T507_REGSNAP_AHUB;
+    hdr.valBytes = sizeof(vals[0]);
+    seq_write(m, &hdr, sizeof(hdr));
+    for (i = 0; i < num; i++) {
+        entry.addr = (__u16)g_reg_labels[i].address;
+        entry.flags = 0;
+        entry.val = vals[i];
+        seq_write(m, &entry, sizeof(entry));
+    }
+
+    return 0;
+}
+
+static int sunxi_ahub_regs_bin_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, sunxi_ahub_regs_bin_show, inode->i_private);
+}
+
+static const struct file_operations g_ahub_regs_bin_fops = {
+    .owner      = THIS_MODULE,
+    .open       = sunxi_ahub_regs_bin_open,
+    .read       = seq_read,
+    .llseek     = seq_lseek,
+    .release    = single_release,
+};
+
 /* sysfs debug */
 static ssize_t snd_sunxi_debug_show_reg(struct device *dev, struct device_attribute *attr, char *buf)
 {
     struct sunxi_ahub_info *ahub_info = dev_get_drvdata(&g_ahub_pdev->dev);
-    struct regmap *regmap = ahub_info->mem_info.regmap;
-    size_t count = 0, i = 0;
-    uint32_t reg_val;
-    uint32_t size = ARRAY_SIZE(g_reg_labels);
+    uint32_t vals[ARRAY_SIZE(g_reg_labels)];
+    size_t count = 0, i, num;
 
-    while ((i < size) && (g_reg_labels[i].name != NULL)) {
-        regmap_read(regmap, g_reg_labels[i].address, &reg_val);
-        printk("%-30s [0x%03x]: 0x%8x save_val:0x%x\n",
-                g_reg_labels[i].name,
-                g_reg_labels[i].address, reg_val,
-                g_reg_labels[i].value);
-        i++;
+    if (sunxi_ahub_pm_get(ahub_info) < 0) {
+        return -EIO;
+    }
+    num = sunxi_ahub_reg_snapshot(ahub_info->mem_info.regmap, vals);
+    sunxi_ahub_pm_put(ahub_info);
+    for (i = 0; i < num; i++) {
+        count += scnprintf(buf + count, PAGE_SIZE - count, "0x%03x 0x%08x %s\n",
+            g_reg_labels[i].address, vals[i], g_reg_labels[i].name);
     }
 
     return count;
@@ -1290,10 +1986,12 @@ static ssize_t snd_sunxi_debug_store_reg(struct device *dev, struct device_attri
         return count;
     }
 
+    if (sunxi_ahub_pm_get(ahub_info) < 0) {
+        return count;
+    }
     if (scanf_cnt == 1) {
         regmap_read(regmap, input_reg_offset, &reg_val);
         pr_info("reg[0x%03x]: 0x%x\n", input_reg_offset, reg_val);
-        return count;
     } else if (scanf_cnt == 2) {
         regmap_read(regmap, input_reg_offset, &reg_val);
         pr_info("reg[0x%03x]: 0x%x (old)\n", input_reg_offset, reg_val);
@@ -1301,6 +1999,7 @@ static ssize_t snd_sunxi_debug_store_reg(struct device *dev, struct device_attri
         regmap_read(regmap, input_reg_offset, &reg_val);
         pr_info("reg[0x%03x]: 0x%x (new)\n", input_reg_offset, reg_val);
     }
+    sunxi_ahub_pm_put(ahub_info);
 
     return count;
 }
@@ -1338,6 +2037,7 @@ static int sunxi_ahub_dev_probe(struct platform_device *pdev)
     }
     dev_set_drvdata(&pdev->dev, ahub_info);
     ahub_info->dev = &pdev->dev;
+    mutex_init(&ahub_info->rx_lock);
     mem_info = &ahub_info->mem_info;
     clk_info = &ahub_info->clk_info;
     pin_info = &ahub_info->pin_info;
@@ -1384,6 +2084,24 @@ static int sunxi_ahub_dev_probe(struct platform_device *pdev)
         AUDIO_DRIVER_LOG_ERR("sysfs debug create failed");
     }
 
+    /* debugfs is optional, a missing snapshot file does not fail the probe */
+    ahub_info->debugfs_dir = debugfs_create_dir(DRV_NAME, NULL);
+    if (!IS_ERR_OR_NULL(ahub_info->debugfs_dir)) {
+        debugfs_create_file("regs", 0444, ahub_info->debugfs_dir, ahub_info, &g_ahub_regs_fops);
+        debugfs_create_file("regs.bin", 0444, ahub_info->debugfs_dir, ahub_info, &g_ahub_regs_bin_fops);
+        debugfs_create_u32("resume_last_us", 0444, ahub_info->debugfs_dir, &ahub_info->resume_last_us);
+        debugfs_create_u32("resume_max_us", 0444, ahub_info->debugfs_dir, &ahub_info->resume_max_us);
+        debugfs_create_u32("resume_over_budget", 0444, ahub_info->debugfs_dir, &ahub_info->resume_over_budget);
+    }
+
+    /* clocks and regulator are on from probe, let them go after the idle delay */
+    pm_runtime_set_autosuspend_delay(&pdev->dev, dts_info->autosuspend_ms);
+    pm_runtime_use_autosuspend(&pdev->dev);
+    pm_runtime_set_active(&pdev->dev);
+    pm_runtime_enable(&pdev->dev);
+    pm_runtime_mark_last_busy(&pdev->dev);
+    pm_request_autosuspend(&pdev->dev);
+
     g_ahub_pdev = pdev;
 
     AUDIO_DRIVER_LOG_DEBUG("register ahub platform success");
@@ -1413,6 +2131,13 @@ static int sunxi_ahub_dev_remove(struct platform_device *pdev)
 
     AUDIO_DRIVER_LOG_DEBUG("");
 
+    /* exit paths below disable clocks and regulator, so leave them on */
+    pm_runtime_get_sync(&pdev->dev);
+    pm_runtime_disable(&pdev->dev);
+    pm_runtime_dont_use_autosuspend(&pdev->dev);
+    pm_runtime_put_noidle(&pdev->dev);
+
+    debugfs_remove_recursive(ahub_info->debugfs_dir);
     sysfs_remove_group(&pdev->dev.kobj, &debug_attr);
 
     snd_sunxi_ahub_mem_exit(pdev, mem_info);
@@ -1424,6 +2149,87 @@ static int sunxi_ahub_dev_remove(struct platform_device *pdev)
     return 0;
 }
 
+static int sunxi_ahub_runtime_suspend(struct device *dev)
+{
+    struct sunxi_ahub_info *ahub_info = dev_get_drvdata(dev);
+    struct regmap *regmap = ahub_info->mem_info.regmap;
+
+    AUDIO_DRIVER_LOG_DEBUG("");
+
+    regcache_cache_only(regmap, true);
+    regcache_mark_dirty(regmap);
+    snd_sunxi_ahub_clk_disable(&ahub_info->clk_info);
+    snd_sunxi_ahub_regulator_disable(&ahub_info->rglt_info);
+
+    return 0;
+}
+
+static int sunxi_ahub_runtime_resume(struct device *dev)
+{
+    struct sunxi_ahub_info *ahub_info = dev_get_drvdata(dev);
+    struct regmap *regmap = ahub_info->mem_info.regmap;
+    u64 start_ns = ktime_get_ns();
+    int ret;
+
+    AUDIO_DRIVER_LOG_DEBUG("");
+
+    ret = snd_sunxi_ahub_regulator_enable(&ahub_info->rglt_info);
+    if (ret) {
+        return ret;
+    }
+    ret = snd_sunxi_ahub_clk_enable(&ahub_info->clk_info);
+    if (ret) {
+        snd_sunxi_ahub_regulator_disable(&ahub_info->rglt_info);
+        return ret;
+    }
+
+    regcache_cache_only(regmap, false);
+    ret = regcache_sync(regmap);
+    if (ret) {
+        AUDIO_DRIVER_LOG_ERR("regcache sync failed %d", ret);
+        snd_sunxi_ahub_clk_disable(&ahub_info->clk_info);
+        snd_sunxi_ahub_regulator_disable(&ahub_info->rglt_info);
+        regcache_cache_only(regmap, true);
+        return ret;
+    }
+
+    /* this is what a stream start pays on top of hw params after autosuspend */
+    ahub_info->resume_last_us = (u32)div_u64(ktime_get_ns() - start_ns, NSEC_PER_USEC);
+    if (ahub_info->resume_last_us > ahub_info->resume_max_us) {
+        ahub_info->resume_max_us = ahub_info->resume_last_us;
+    }
+    if (ahub_info->resume_last_us > SUNXI_AHUB_RESUME_BUDGET_US) {
+        ahub_info->resume_over_budget++;
+        AUDIO_DRIVER_LOG_ERR("resume took %u us, budget %u us", ahub_info->resume_last_us, SUNXI_AHUB_RESUME_BUDGET_US);
+    }
+
+    return 0;
+}
+
+static int sunxi_ahub_suspend(struct device *dev)
+{
+    struct sunxi_ahub_info *ahub_info = dev_get_drvdata(dev);
+
+    AUDIO_DRIVER_LOG_DEBUG("");
+
+    /* clocks may be reparented across suspend, reprogram everything next open */
+    ahub_info->applied.valid = false;
+
+    return pm_runtime_force_suspend(dev);
+}
+
+static int sunxi_ahub_resume(struct device *dev)
+{
+    AUDIO_DRIVER_LOG_DEBUG("");
+
+    return pm_runtime_force_resume(dev);
+}
+
+static const struct dev_pm_ops sunxi_ahub_pm_ops = {
+    SET_RUNTIME_PM_OPS(sunxi_ahub_runtime_suspend, sunxi_ahub_runtime_resume, NULL)
+    SET_SYSTEM_SLEEP_PM_OPS(sunxi_ahub_suspend, sunxi_ahub_resume)
+};
+
 static const struct of_device_id sunxi_ahub_of_match[] = {
     { .compatible = "allwinner," DRV_NAME, },
     {},
@@ -1435,6 +2241,7 @@ static struct platform_driver sunxi_ahub_driver = {
         .name           = DRV_NAME,
         .owner          = THIS_MODULE,
         .of_match_table = sunxi_ahub_of_match,
+        .pm             = &sunxi_ahub_pm_ops,
     },
     .probe  = sunxi_ahub_dev_probe,
     .remove = sunxi_ahub_dev_remove,
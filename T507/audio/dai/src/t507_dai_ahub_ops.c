@@ -23,9 +23,30 @@
 
 #include "t507_dai_ahub_impl_linux.h"
 #include "ac107_accessory_impl_linux.h"
+#include "t507_dma_ops.h"
 
 #define HDF_LOG_TAG t507_dai_ahub_ops
 
+/* render only goes through the ahub on cards whose platform feeds the ahub tx fifo */
+static bool T507AhubRenderOnCard(const struct AudioCard *card)
+{
+    if (card == NULL || card->rtd == NULL || card->rtd->platform == NULL) {
+        return false;
+    }
+
+    return T507AudioDmaRenderToAhub(card->rtd->platform->devData);
+}
+
+/* capture comes from the ahub (ac107 over i2s) unless the platform reads the codec adc */
+static bool T507AhubCaptureOnCard(const struct AudioCard *card)
+{
+    if (card == NULL || card->rtd == NULL || card->rtd->platform == NULL) {
+        return false;
+    }
+
+    return !T507AudioDmaCaptureFromCodec(card->rtd->platform->devData);
+}
+
 int32_t T507AhubDeviceInit(struct AudioCard *audioCard, const struct DaiDevice *dai)
 {
     int ret;
@@ -87,7 +108,6 @@ int32_t T507AhubDaiTrigger(const struct AudioCard *card, int cmd, const struct D
 {
     int ret;
 
-    (void)card;
     (void)device;
 
     AUDIO_DRIVER_LOG_DEBUG(" cmd -> %d", cmd);
@@ -95,6 +115,9 @@ int32_t T507AhubDaiTrigger(const struct AudioCard *card, int cmd, const struct D
     switch (cmd) {
         case AUDIO_DRV_PCM_IOCTL_RENDER_START:
         case AUDIO_DRV_PCM_IOCTL_RENDER_RESUME:
+            if (!T507AhubRenderOnCard(card)) {
+                break;
+            }
             ret = T507AhubImplTrigger(AUDIO_RENDER_STREAM, true);
             if (ret != HDF_SUCCESS) {
                 AUDIO_DRIVER_LOG_ERR("failed");
@@ -103,6 +126,9 @@ int32_t T507AhubDaiTrigger(const struct AudioCard *card, int cmd, const struct D
             break;
         case AUDIO_DRV_PCM_IOCTL_RENDER_STOP:
         case AUDIO_DRV_PCM_IOCTL_RENDER_PAUSE:
+            if (!T507AhubRenderOnCard(card)) {
+                break;
+            }
             ret = T507AhubImplTrigger(AUDIO_RENDER_STREAM, false);
             if (ret != HDF_SUCCESS) {
                 AUDIO_DRIVER_LOG_ERR("failed");
@@ -111,7 +137,10 @@ int32_t T507AhubDaiTrigger(const struct AudioCard *card, int cmd, const struct D
             break;
         case AUDIO_DRV_PCM_IOCTL_CAPTURE_START:
         case AUDIO_DRV_PCM_IOCTL_CAPTURE_RESUME:
-        ret = T507AhubImplTrigger(AUDIO_CAPTURE_STREAM, true);
+            if (!T507AhubCaptureOnCard(card)) {
+                break;
+            }
+            ret = T507AhubImplTrigger(AUDIO_CAPTURE_STREAM, true);
             if (ret != HDF_SUCCESS) {
                 AUDIO_DRIVER_LOG_ERR("failed");
                 return HDF_FAILURE;
@@ -119,6 +148,9 @@ int32_t T507AhubDaiTrigger(const struct AudioCard *card, int cmd, const struct D
             break;
         case AUDIO_DRV_PCM_IOCTL_CAPTURE_STOP:
         case AUDIO_DRV_PCM_IOCTL_CAPTURE_PAUSE:
+            if (!T507AhubCaptureOnCard(card)) {
+                break;
+            }
             ret = T507AhubImplTrigger(AUDIO_CAPTURE_STREAM, false);
             if (ret != HDF_SUCCESS) {
                 AUDIO_DRIVER_LOG_ERR("failed");
@@ -131,9 +163,11 @@ int32_t T507AhubDaiTrigger(const struct AudioCard *card, int cmd, const struct D
     }
 
     /* for capture */
-    ret = Ac107DaiTrigger(card, cmd, device);
-    if (ret != HDF_SUCCESS) {
-        return HDF_FAILURE;
+    if (T507AhubCaptureOnCard(card)) {
+        ret = Ac107DaiTrigger(card, cmd, device);
+        if (ret != HDF_SUCCESS) {
+            return HDF_FAILURE;
+        }
     }
 
     return HDF_SUCCESS;
@@ -145,11 +179,19 @@ int32_t T507AhubDaiStartup(const struct AudioCard *card, const struct DaiDevice
 
     AUDIO_DRIVER_LOG_DEBUG("");
 
-    (void)card;
     (void)device;
 
     /* for render */
-    ret = T507AhubImplStartup(AUDIO_CAPTURE_STREAM);    /* unuse */
+    if (T507AhubRenderOnCard(card)) {
+        ret = T507AhubImplStartup(AUDIO_RENDER_STREAM);
+        if (ret != HDF_SUCCESS) {
+            return HDF_FAILURE;
+        }
+    }
+    if (!T507AhubCaptureOnCard(card)) {
+        return HDF_SUCCESS;
+    }
+    ret = T507AhubImplStartup(AUDIO_CAPTURE_STREAM);
     if (ret != HDF_SUCCESS) {
         return HDF_FAILURE;
     }
@@ -175,10 +217,15 @@ int32_t T507AhubDaiHwParams(const struct AudioCard *card, const struct AudioPcmH
         return HDF_FAILURE;
     }
 
-    /* for render */
-    ret = T507AhubImplHwParams(param->streamType, param->format, param->channels, param->rate);
-    if (ret != HDF_SUCCESS) {
-        return HDF_FAILURE;
+    /* render on the codec card is handled by the codec dai alone */
+    if (param->streamType == AUDIO_CAPTURE_STREAM ? T507AhubCaptureOnCard(card) : T507AhubRenderOnCard(card)) {
+        ret = T507AhubImplHwParams(param->streamType, param->format, param->channels, param->rate);
+        if (ret != HDF_SUCCESS) {
+            return HDF_FAILURE;
+        }
+    }
+    if (!T507AhubCaptureOnCard(card)) {
+        return HDF_SUCCESS;
     }
 
     /* for capture */
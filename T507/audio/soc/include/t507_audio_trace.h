@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Audio path tracepoints, events/t507_audio in tracefs.
+ *
+ * avail is what the dma side can move at the sample point: words ready to
+ * read for capture, free words for render. count is the fifo counter of the
+ * same endpoint (APBIF_RXFIFO_CNT/TXFIFO_CNT, DAC_CNT), residue the dmaengine
+ * residue of the cyclic descriptor in bytes. tools/t507_fifo_hist.py turns a
+ * trace into occupancy histograms.
+ *
+ * Defined in t507_dma_ops.c, the including directory must be on the include
+ * path for define_trace.h.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM t507_audio
+
+#if !defined(T507_AUDIO_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define T507_AUDIO_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(t507_audio_trigger,
+    TP_PROTO(const char *dev, bool render, bool enable, uint32_t avail, uint32_t count),
+    TP_ARGS(dev, render, enable, avail, count),
+    TP_STRUCT__entry(
+        __string(dev, dev)
+        __field(bool, render)
+        __field(bool, enable)
+        __field(uint32_t, avail)
+        __field(uint32_t, count)
+    ),
+    TP_fast_assign(
+        __assign_str(dev, dev);
+        __entry->render = render;
+        __entry->enable = enable;
+        __entry->avail = avail;
+        __entry->count = count;
+    ),
+    TP_printk("dev=%s stream=%s %s avail=%u count=%u", __get_str(dev),
+        __entry->render ? "render" : "capture", __entry->enable ? "start" : "stop",
+        __entry->avail, __entry->count)
+);
+
+TRACE_EVENT(t507_audio_dma_period,
+    TP_PROTO(const char *dev, bool render, uint32_t hw_pos, uint32_t residue, uint32_t avail, uint32_t count),
+    TP_ARGS(dev, render, hw_pos, residue, avail, count),
+    TP_STRUCT__entry(
+        __string(dev, dev)
+        __field(bool, render)
+        __field(uint32_t, hw_pos)
+        __field(uint32_t, residue)
+        __field(uint32_t, avail)
+        __field(uint32_t, count)
+    ),
+    TP_fast_assign(
+        __assign_str(dev, dev);
+        __entry->render = render;
+        __entry->hw_pos = hw_pos;
+        __entry->residue = residue;
+        __entry->avail = avail;
+        __entry->count = count;
+    ),
+    TP_printk("dev=%s stream=%s hw_pos=%u residue=%u avail=%u count=%u", __get_str(dev),
+        __entry->render ? "render" : "capture", __entry->hw_pos, __entry->residue,
+        __entry->avail, __entry->count)
+);
+
+TRACE_EVENT(t507_audio_dma_pointer,
+    TP_PROTO(const char *dev, bool render, uint32_t pointer, uint32_t residue),
+    TP_ARGS(dev, render, pointer, residue),
+    TP_STRUCT__entry(
+        __string(dev, dev)
+        __field(bool, render)
+        __field(uint32_t, pointer)
+        __field(uint32_t, residue)
+    ),
+    TP_fast_assign(
+        __assign_str(dev, dev);
+        __entry->render = render;
+        __entry->pointer = pointer;
+        __entry->residue = residue;
+    ),
+    TP_printk("dev=%s stream=%s pointer=%u residue=%u", __get_str(dev),
+        __entry->render ? "render" : "capture", __entry->pointer, __entry->residue)
+);
+
+#endif /* T507_AUDIO_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE t507_audio_trace
+#include <trace/define_trace.h>
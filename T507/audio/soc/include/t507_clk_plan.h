@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef T507_CLK_PLAN_H
+#define T507_CLK_PLAN_H
+
+#include "audio_core.h"
+
+struct clk;
+
+#ifdef __cplusplus
+#if __cplusplus
+extern "C" {
+#endif
+#endif /* __cplusplus */
+
+/* the two audio pll families, every supported rate divides one of them */
+#define T507_CLK_FREQ_48K_FAMILY    24576000
+#define T507_CLK_FREQ_44K1_FAMILY   22579200
+
+/* blocks clocked from the shared audio pll */
+enum T507ClkUser {
+    T507_CLK_CODEC_RENDER = 0,
+    T507_CLK_AHUB_RENDER,
+    T507_CLK_AHUB_CAPTURE,
+    T507_CLK_CODEC_CAPTURE,
+    T507_CLK_USER_CNT,
+};
+
+struct T507ClkPlan {
+    uint32_t rate;          /* lrck */
+    uint32_t freqPoint;     /* pll family */
+    uint32_t pllx4Freq;     /* audio pll x4, ahub module clock */
+    uint32_t mclkFreq;      /* ahub mclk, ac107 needs 12.288/11.2896 MHz */
+    uint32_t bclkFreq;      /* 0 when there is no i2s frame */
+    uint32_t bclkRatio;     /* pllx4Freq / bclkFreq */
+    bool pllRetune;         /* the pll is not on this family yet */
+};
+
+int32_t T507ClkPlanLookup(uint32_t rate, uint32_t slots, uint32_t slotWidth, struct T507ClkPlan *plan);
+uint32_t T507ClkPlanRateAt(enum T507ClkUser user, uint32_t idx);
+int32_t T507ClkPlanPrepare(enum T507ClkUser user, uint32_t rate, uint32_t slots, uint32_t slotWidth,
+    struct T507ClkPlan *plan);
+int32_t T507ClkPlanCommit(enum T507ClkUser user, const struct T507ClkPlan *plan, struct clk *pllx4);
+int32_t T507ClkPlanSetRunning(enum T507ClkUser user, bool running);
+
+#ifdef __cplusplus
+#if __cplusplus
+}
+#endif
+#endif /* __cplusplus */
+
+#endif /* T507_CLK_PLAN_H */
@@ -18,6 +18,7 @@
 
 #include <linux/dmaengine.h>
 #include "audio_core.h"
+#include "t507_dma_uapi.h"
 
 #ifdef __cplusplus
 #if __cplusplus
@@ -25,33 +26,75 @@ extern "C" {
 #endif
 #endif /* __cplusplus */
 
+/* per-stream ring reserved at init, covers the ADM cirBufMax */
+#define T507_DMA_POOL_BUF_SIZE      (128 * 1024)
+
+struct vm_area_struct;
+struct T507DmaCdev;
+
+/* dma period used by low latency streams */
+#define T507_DMA_LL_PERIOD_US       1000
+
 #define SUNXI_CODEC_ADDR_BASE       0x05096000
 #define SUNXI_DAC_TXDATA            0X20
+#define SUNXI_ADC_RXDATA            0x40
 
 #define SUNXI_AHUB_ADDR_BASE        0x05097000
 #define SUNXI_AHUB_APBIF_RXFIFO(n)  (0x120 + ((n) * 0x30))
 
+/* FIFO trigger levels in samples: DAC_FIFO_CTL reset value, ADC set at hw params, AHUB APBIF init */
+#define T507_CODEC_TXFIFO_LEVEL     0x40
+#define T507_CODEC_RXFIFO_LEVEL     0x20
+#define T507_AHUB_TXFIFO_LEVEL      0x20
+#define T507_AHUB_RXFIFO_LEVEL      0x40
+
 #define AHUB_APBIF_0    0
 #define AHUB_APBIF_1    1
 #define AHUB_APBIF_2    2
+#define AHUB_APBIF_NUM  3
 #define AHUB_I2S_0      0
 #define AHUB_I2S_1      1
 #define AHUB_I2S_2      2
 #define AHUB_I2S_3      3
-#define AHUB_APBIF_USE  AHUB_APBIF_0
 #define AHUB_I2S_USE    AHUB_I2S_0
 
 int32_t T507AudioDmaDeviceInit(const struct AudioCard *card, const struct PlatformDevice *platform);
+int32_t T507AudioDmaAhubDeviceInit(const struct AudioCard *card, const struct PlatformDevice *platform);
+int32_t T507AudioDmaCodecDeviceInit(const struct AudioCard *card, const struct PlatformDevice *platform);
+bool T507AudioDmaRenderToAhub(const struct PlatformData *data);
+bool T507AudioDmaCaptureFromCodec(const struct PlatformData *data);
+void T507AudioDmaDeviceRelease(struct PlatformData *data);
+struct T507DmaCdev *T507AudioDmaCdevCreate(struct PlatformData *data);
+void T507AudioDmaCdevDestroy(struct T507DmaCdev *cdev);
 int32_t T507AudioDmaBufAlloc(struct PlatformData *data, const enum AudioStreamType streamType);
 int32_t T507AudioDmaBufFree(struct PlatformData *data, const enum AudioStreamType streamType);
 int32_t T507AudioDmaRequestChannel(const struct PlatformData *data, const enum AudioStreamType streamType);
 int32_t T507AudioDmaConfigChannel(const struct PlatformData *data, const enum AudioStreamType streamType);
+int32_t T507AudioDmaSetBurst(const struct PlatformData *data, const enum AudioStreamType streamType,
+    uint32_t maxburst);
 int32_t T507AudioDmaPrep(const struct PlatformData *data, const enum AudioStreamType streamType);
 int32_t T507AudioDmaSubmit(const struct PlatformData *data, const enum AudioStreamType streamType);
 int32_t T507AudioDmaPending(struct PlatformData *data, const enum AudioStreamType streamType);
 int32_t T507AudioDmaPause(struct PlatformData *data, const enum AudioStreamType streamType);
 int32_t T507AudioDmaResume(const struct PlatformData *data, const enum AudioStreamType streamType);
 int32_t T507AudioDmaPointer(struct PlatformData *data, const enum AudioStreamType streamType, uint32_t *pointer);
+int32_t T507AudioDmaGetTimestamp(struct PlatformData *data, const enum AudioStreamType streamType,
+    uint32_t *frames, uint64_t *tstampNs);
+int32_t T507AudioDmaMmap(struct PlatformData *data, const enum AudioStreamType streamType,
+    struct vm_area_struct *vma);
+int32_t T507AudioDmaMmapAppPtr(const struct PlatformData *data, const enum AudioStreamType streamType,
+    uint32_t *appPtr);
+int32_t T507AudioDmaGetXrunCount(const struct PlatformData *data, const enum AudioStreamType streamType,
+    uint32_t *count);
+int32_t T507AudioDmaSetLowLatency(const struct PlatformData *data, const enum AudioStreamType streamType,
+    bool enable);
+int32_t T507AudioDmaSetCached(const struct PlatformData *data, const enum AudioStreamType streamType, bool enable);
+int32_t T507AudioDmaTapStart(struct PlatformData *data, uint32_t apbNum, uint32_t *bufBytes);
+int32_t T507AudioDmaTapStop(struct PlatformData *data, uint32_t apbNum);
+int32_t T507AudioDmaTapPointer(const struct PlatformData *data, uint32_t apbNum, uint32_t *pointer);
+int32_t T507AudioDmaTapMmap(struct PlatformData *data, uint32_t apbNum, struct vm_area_struct *vma);
+int32_t T507AudioDmaTapAppPtr(const struct PlatformData *data, uint32_t apbNum, uint32_t *appPtr);
+int32_t T507AudioDmaWaitPeriod(struct PlatformData *data, const enum AudioStreamType streamType, uint32_t timeoutMs);
 
 #ifdef __cplusplus
 #if __cplusplus
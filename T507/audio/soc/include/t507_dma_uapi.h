@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef T507_DMA_UAPI_H
+#define T507_DMA_UAPI_H
+
+/*
+ * Userspace side of the per-card dma device, /dev/t507_<platform serviceName>.
+ * The ADM still opens, configures, starts and stops the streams. A file is
+ * bound to one stream of the card with T507_DMA_IOC_BIND, after which it can
+ * mmap the ring (pgoff 0) and the status page (T507_DMA_MMAP_STATUS_PGOFF).
+ * Shared with the HAL and tools/, so only fixed size types.
+ */
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* mmap offset of the per-stream status/control page, the ring itself is at 0 */
+#define T507_DMA_MMAP_STATUS_PGOFF  0x10000
+
+/*
+ * Status/control page shared with the audio HAL in mmap mode.
+ * hwPtr/tstampNs are written by the driver every period, seq is odd while an
+ * update is in progress. appPtr is written by the HAL. Pointers are ring
+ * offsets in frames, 0 .. bufferFrames - 1.
+ */
+struct T507DmaMmapStatus {
+    __u32 seq;
+    __u32 hwPtr;           /* frames */
+    __u64 tstampNs;        /* CLOCK_MONOTONIC of hwPtr */
+    __u32 appPtr;          /* frames */
+    __u32 bufferFrames;
+    __u32 periodFrames;
+    __u32 xrunCount;
+};
+
+/* T507_DMA_IOC_BIND argument */
+#define T507_DMA_TARGET_RENDER      0
+#define T507_DMA_TARGET_CAPTURE     1
+/* extra copy of the ahub capture on apbif n (0..2), not the one the capture uses */
+#define T507_DMA_TARGET_TAP(n)      (2 + (n))
+
+/*
+ * T507_DMA_IOC_SYNC: pointers of the bound stream. avail is what the HAL can
+ * write (render) or read (capture) between appPtr and hwPtr; appPtr equal to
+ * hwPtr counts as an empty render ring and an empty capture ring.
+ */
+struct T507DmaSync {
+    __u32 hwPtr;
+    __u32 appPtr;
+    __u32 avail;
+    __u32 bufferFrames;
+};
+
+/* T507_DMA_IOC_TSTAMP: hwPtr interpolated to tstampNs, CLOCK_MONOTONIC */
+struct T507DmaTstamp {
+    __u32 hwPtr;
+    __u32 reserved;
+    __u64 tstampNs;
+};
+
+/* longest T507_DMA_IOC_WAIT_PERIOD timeout, larger values are clamped */
+#define T507_DMA_WAIT_MAX_MS        2000
+
+/*
+ * T507_DMA_IOC_SET_LOW_LATENCY takes 0 or 1 and only applies while the ADM
+ * has the stream closed (-EBUSY otherwise); the HCS lowLatencyRender and
+ * lowLatencyCapture switches of the platform node set the default.
+ *
+ * T507_DMA_IOC_SET_CACHED (capture only, same rules) gives the capture a
+ * cacheable ring. The HCS cachedCapture switch reserves it at card init,
+ * otherwise the first enable does and may fail on fragmented memory.
+ *
+ * T507_DMA_IOC_SET_BURST fixes the dma maxburst (1, 4, 8 or 16) from the
+ * next ADM hw params on, 0 goes back to the burst picked from the format.
+ *
+ * T507_DMA_IOC_TAP_START starts a tap file's apbif and returns the ring size
+ * in bytes, the ring and status page can be mapped from then on; the tap runs
+ * with the capture format current at start. T507_DMA_IOC_TAP_STOP (-EBUSY
+ * while the ring is mapped) or closing the file stops it. Taps need rings
+ * reserved through the captureTaps count of the platform HCS node.
+ *
+ * T507_DMA_IOC_XRUN_COUNT returns the xruns of the stream since card init,
+ * also without mmap, where the status page is not kept. Diff two reads.
+ */
+#define T507_DMA_IOC_MAGIC              'T'
+#define T507_DMA_IOC_BIND               _IOW(T507_DMA_IOC_MAGIC, 0x00, __u32)
+#define T507_DMA_IOC_SYNC               _IOR(T507_DMA_IOC_MAGIC, 0x01, struct T507DmaSync)
+#define T507_DMA_IOC_TSTAMP             _IOR(T507_DMA_IOC_MAGIC, 0x02, struct T507DmaTstamp)
+#define T507_DMA_IOC_WAIT_PERIOD        _IOW(T507_DMA_IOC_MAGIC, 0x03, __u32)
+#define T507_DMA_IOC_XRUN_COUNT         _IOR(T507_DMA_IOC_MAGIC, 0x04, __u32)
+#define T507_DMA_IOC_SET_LOW_LATENCY    _IOW(T507_DMA_IOC_MAGIC, 0x05, __u32)
+#define T507_DMA_IOC_SET_CACHED         _IOW(T507_DMA_IOC_MAGIC, 0x06, __u32)
+#define T507_DMA_IOC_SET_BURST          _IOW(T507_DMA_IOC_MAGIC, 0x07, __u32)
+#define T507_DMA_IOC_TAP_START          _IOR(T507_DMA_IOC_MAGIC, 0x08, __u32)
+#define T507_DMA_IOC_TAP_STOP           _IO(T507_DMA_IOC_MAGIC, 0x09)
+
+#endif /* T507_DMA_UAPI_H */
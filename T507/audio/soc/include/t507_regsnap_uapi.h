@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef T507_REGSNAP_UAPI_H
+#define T507_REGSNAP_UAPI_H
+
+/*
+ * Binary register snapshot, the debugfs "regs.bin" of the ahub, codec and
+ * ac107 drivers: one header, then one entry per labelled register in label
+ * order, native byte order. tools/t507_regsnap.py decodes and diffs them, the
+ * register names come from the text "regs" file of the same block.
+ */
+#include <linux/types.h>
+
+#define T507_REGSNAP_MAGIC      0x53523554  /* "T5RS" */
+#define T507_REGSNAP_VERSION    1
+
+#define T507_REGSNAP_AHUB       1
+#define T507_REGSNAP_CODEC      2
+#define T507_REGSNAP_AC107      3
+
+struct T507RegSnapHeader {
+    __u32 magic;
+    __u16 version;
+    __u16 count;        /* entries that follow */
+    __u8 block;         /* T507_REGSNAP_AHUB ... */
+    __u8 valBytes;      /* register width, 4 for mmio, 1 for the ac107 */
+    __u16 id;           /* i2c address of the ac107, 0 for the soc blocks */
+    __u32 reserved;
+    __u64 tstampNs;     /* CLOCK_MONOTONIC after the last register was read */
+};
+
+/* the register could not be read, val is 0 */
+#define T507_REGSNAP_F_NOREAD   0x1
+
+struct T507RegSnapEntry {
+    __u16 addr;
+    __u16 flags;
+    __u32 val;
+};
+
+#endif /* T507_REGSNAP_UAPI_H */
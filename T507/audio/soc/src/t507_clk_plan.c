@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <linux/clk.h>
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+
+#include "audio_driver_log.h"
+#include "t507_clk_plan.h"
+
+#define HDF_LOG_TAG t507_clk_plan
+
+struct T507ClkRate {
+    uint32_t rate;
+    uint32_t freqPoint;
+    uint32_t users;     /* bit per enum T507ClkUser */
+};
+
+#define CLK_USERS_ALL       ((0x1 << T507_CLK_USER_CNT) - 1)
+#define CLK_USERS_AHUB      ((0x1 << T507_CLK_AHUB_RENDER) | (0x1 << T507_CLK_AHUB_CAPTURE))
+/* codec adc decimator stops at 48 kHz */
+#define CLK_USERS_NO_ADC    (CLK_USERS_ALL & ~(0x1 << T507_CLK_CODEC_CAPTURE))
+
+/* the codec fs dividers have no 64 kHz code, it is ahub only */
+static const struct T507ClkRate g_clk_rates[] = {
+    {8000,   T507_CLK_FREQ_48K_FAMILY,  CLK_USERS_ALL},
+    {11025,  T507_CLK_FREQ_44K1_FAMILY, CLK_USERS_ALL},
+    {12000,  T507_CLK_FREQ_48K_FAMILY,  CLK_USERS_ALL},
+    {16000,  T507_CLK_FREQ_48K_FAMILY,  CLK_USERS_ALL},
+    {22050,  T507_CLK_FREQ_44K1_FAMILY, CLK_USERS_ALL},
+    {24000,  T507_CLK_FREQ_48K_FAMILY,  CLK_USERS_ALL},
+    {32000,  T507_CLK_FREQ_48K_FAMILY,  CLK_USERS_ALL},
+    {44100,  T507_CLK_FREQ_44K1_FAMILY, CLK_USERS_ALL},
+    {48000,  T507_CLK_FREQ_48K_FAMILY,  CLK_USERS_ALL},
+    {64000,  T507_CLK_FREQ_48K_FAMILY,  CLK_USERS_AHUB},
+    {88200,  T507_CLK_FREQ_44K1_FAMILY, CLK_USERS_NO_ADC},
+    {96000,  T507_CLK_FREQ_48K_FAMILY,  CLK_USERS_NO_ADC},
+    {176400, T507_CLK_FREQ_44K1_FAMILY, CLK_USERS_NO_ADC},
+    {192000, T507_CLK_FREQ_48K_FAMILY,  CLK_USERS_NO_ADC},
+};
+
+/* the pll is shared, so is this: last family set and which users run on it */
+static DEFINE_MUTEX(g_clk_plan_lock);
+static uint32_t g_clk_pll_freq;
+static uint32_t g_clk_user_freq[T507_CLK_USER_CNT];
+static bool g_clk_user_running[T507_CLK_USER_CNT];
+
+static const char *g_clk_user_name[T507_CLK_USER_CNT] = {
+    "codec render",
+    "ahub render",
+    "ahub capture",
+    "codec capture",
+};
+
+/* pure table lookup, slots 0 skips the bclk part for blocks without an i2s frame */
+int32_t T507ClkPlanLookup(uint32_t rate, uint32_t slots, uint32_t slotWidth, struct T507ClkPlan *plan)
+{
+    uint32_t i;
+
+    if (plan == NULL) {
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(g_clk_rates); i++) {
+        if (g_clk_rates[i].rate == rate) {
+            break;
+        }
+    }
+    if (i == ARRAY_SIZE(g_clk_rates)) {
+        AUDIO_DRIVER_LOG_ERR("rate: %u is not define.", rate);
+        return HDF_ERR_NOT_SUPPORT;
+    }
+
+    plan->rate = rate;
+    plan->freqPoint = g_clk_rates[i].freqPoint;
+    plan->pllx4Freq = plan->freqPoint * 4;
+    plan->mclkFreq = plan->freqPoint / 2;
+    plan->bclkFreq = rate * slots * slotWidth;
+    plan->bclkRatio = (plan->bclkFreq != 0) ? (plan->pllx4Freq / plan->bclkFreq) : 0;
+    plan->pllRetune = false;
+    if (plan->bclkFreq != 0 && plan->bclkRatio * plan->bclkFreq != plan->pllx4Freq) {
+        AUDIO_DRIVER_LOG_ERR("bclk %u Hz does not divide pll %u Hz", plan->bclkFreq, plan->pllx4Freq);
+        return HDF_ERR_NOT_SUPPORT;
+    }
+
+    return HDF_SUCCESS;
+}
+
+/* idx-th rate user can run, 0 past the end; lets a block check its own table against this one */
+uint32_t T507ClkPlanRateAt(enum T507ClkUser user, uint32_t idx)
+{
+    uint32_t i;
+
+    if (user >= T507_CLK_USER_CNT) {
+        return 0;
+    }
+    for (i = 0; i < ARRAY_SIZE(g_clk_rates); i++) {
+        if ((g_clk_rates[i].users & (0x1 << user)) == 0) {
+            continue;
+        }
+        if (idx-- == 0) {
+            return g_clk_rates[i].rate;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Plan the clocks for one user and check them against everyone else running
+ * on the pll. A rate from the other family is refused while another user
+ * runs, it is never retuned under a live stream.
+ */
+int32_t T507ClkPlanPrepare(enum T507ClkUser user, uint32_t rate, uint32_t slots, uint32_t slotWidth,
+    struct T507ClkPlan *plan)
+{
+    int32_t ret;
+    uint32_t i;
+
+    if (user >= T507_CLK_USER_CNT) {
+        return HDF_ERR_INVALID_PARAM;
+    }
+    ret = T507ClkPlanLookup(rate, slots, slotWidth, plan);
+    if (ret != HDF_SUCCESS) {
+        return ret;
+    }
+    for (i = 0; i < ARRAY_SIZE(g_clk_rates); i++) {
+        if (g_clk_rates[i].rate == rate && (g_clk_rates[i].users & (0x1 << user)) == 0) {
+            AUDIO_DRIVER_LOG_ERR("%s can not run %u Hz", g_clk_user_name[user], rate);
+            return HDF_ERR_NOT_SUPPORT;
+        }
+    }
+
+    mutex_lock(&g_clk_plan_lock);
+    for (i = 0; i < T507_CLK_USER_CNT; i++) {
+        if (i == user || !g_clk_user_running[i] || g_clk_user_freq[i] == plan->freqPoint) {
+            continue;
+        }
+        mutex_unlock(&g_clk_plan_lock);
+        AUDIO_DRIVER_LOG_ERR("%s: %u Hz needs pll %u, %s runs on %u", g_clk_user_name[user], rate,
+            plan->freqPoint, g_clk_user_name[i], g_clk_user_freq[i]);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+    plan->pllRetune = (g_clk_pll_freq != plan->freqPoint);
+    mutex_unlock(&g_clk_plan_lock);
+
+    return HDF_SUCCESS;
+}
+
+/*
+ * Take the plan for user: re-check the running users and retune pllx4 under the
+ * lock, so another user's hw_params can not switch the family between the check
+ * and the clk_set_rate. The user sets its own module clock afterwards.
+ */
+int32_t T507ClkPlanCommit(enum T507ClkUser user, const struct T507ClkPlan *plan, struct clk *pllx4)
+{
+    uint32_t i;
+
+    if (user >= T507_CLK_USER_CNT || plan == NULL || pllx4 == NULL) {
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    mutex_lock(&g_clk_plan_lock);
+    for (i = 0; i < T507_CLK_USER_CNT; i++) {
+        if (i == user || !g_clk_user_running[i] || g_clk_user_freq[i] == plan->freqPoint) {
+            continue;
+        }
+        mutex_unlock(&g_clk_plan_lock);
+        AUDIO_DRIVER_LOG_ERR("%s: %s started on %u meanwhile", g_clk_user_name[user], g_clk_user_name[i],
+            g_clk_user_freq[i]);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+    if (g_clk_pll_freq != plan->freqPoint) {
+        if (clk_set_rate(pllx4, plan->pllx4Freq)) {
+            mutex_unlock(&g_clk_plan_lock);
+            AUDIO_DRIVER_LOG_ERR("clk pllaudio set rate %u failed", plan->pllx4Freq);
+            return HDF_FAILURE;
+        }
+        g_clk_pll_freq = plan->freqPoint;
+    }
+    g_clk_user_freq[user] = plan->freqPoint;
+    mutex_unlock(&g_clk_plan_lock);
+
+    return HDF_SUCCESS;
+}
+
+/*
+ * Called from trigger. A start is refused when the pll was retuned to the other
+ * family after this user's hw_params, e.g. codec 48k hw_params, ahub 44.1k
+ * hw_params, codec start: the codec would run at the wrong rate.
+ */
+int32_t T507ClkPlanSetRunning(enum T507ClkUser user, bool running)
+{
+    if (user >= T507_CLK_USER_CNT) {
+        return HDF_ERR_INVALID_PARAM;
+    }
+
+    mutex_lock(&g_clk_plan_lock);
+    if (running && (g_clk_user_freq[user] == 0 || g_clk_user_freq[user] != g_clk_pll_freq)) {
+        mutex_unlock(&g_clk_plan_lock);
+        AUDIO_DRIVER_LOG_ERR("%s: set up for pll %u, pll is on %u", g_clk_user_name[user],
+            g_clk_user_freq[user], g_clk_pll_freq);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+    g_clk_user_running[user] = running;
+    mutex_unlock(&g_clk_plan_lock);
+
+    return HDF_SUCCESS;
+}
@@ -37,6 +37,18 @@ struct PlatformData g_platformData = {
     .ops                = &g_dmaDeviceOps,
 };
 
+/* same dma ops, render goes to the ahub i2s (external dac, hdmi) */
+struct PlatformData g_ahubPlatformData = {
+    .PlatformInit       = T507AudioDmaAhubDeviceInit,
+    .ops                = &g_dmaDeviceOps,
+};
+
+/* same dma ops, render and capture on the internal codec (no ac107 fitted) */
+struct PlatformData g_codecPlatformData = {
+    .PlatformInit       = T507AudioDmaCodecDeviceInit,
+    .ops                = &g_dmaDeviceOps,
+};
+
 /* HdfDriverEntry implementations */
 static int32_t DmaDriverBind(struct HdfDeviceObject *device)
 {
@@ -62,7 +74,7 @@ static int32_t DmaDriverBind(struct HdfDeviceObject *device)
     return HDF_SUCCESS;
 }
 
-static int32_t DmaGetServiceName(const struct HdfDeviceObject *device)
+static int32_t DmaGetServiceName(const struct HdfDeviceObject *device, struct PlatformData *platformData)
 {
     const struct DeviceResourceNode *node = NULL;
     struct DeviceResourceIface *drsOps = NULL;
@@ -85,7 +97,7 @@ static int32_t DmaGetServiceName(const struct HdfDeviceObject *device)
         return HDF_FAILURE;
     }
 
-    ret = drsOps->GetString(node, "serviceName", &g_platformData.drvPlatformName, 0);
+    ret = drsOps->GetString(node, "serviceName", &platformData->drvPlatformName, 0);
     if (ret != HDF_SUCCESS) {
         AUDIO_DRIVER_LOG_ERR("read serviceName fail!");
         return ret;
@@ -95,7 +107,7 @@ static int32_t DmaGetServiceName(const struct HdfDeviceObject *device)
     return HDF_SUCCESS;
 }
 
-static int32_t DmaDriverInit(struct HdfDeviceObject *device)
+static int32_t DmaPlatformInit(struct HdfDeviceObject *device, struct PlatformData *platformData)
 {
     int32_t ret;
 
@@ -106,15 +118,15 @@ static int32_t DmaDriverInit(struct HdfDeviceObject *device)
         return HDF_ERR_INVALID_OBJECT;
     }
 
-    ret = DmaGetServiceName(device);
+    ret = DmaGetServiceName(device, platformData);
     if (ret !=  HDF_SUCCESS) {
         AUDIO_DRIVER_LOG_ERR("get service name fail.");
         return ret;
     }
-    OsalMutexInit(&g_platformData.renderBufInfo.buffMutex);
-    OsalMutexInit(&g_platformData.captureBufInfo.buffMutex);
-    g_platformData.platformInitFlag = false;
-    ret = AudioSocRegisterPlatform(device, &g_platformData);
+    OsalMutexInit(&platformData->renderBufInfo.buffMutex);
+    OsalMutexInit(&platformData->captureBufInfo.buffMutex);
+    platformData->platformInitFlag = false;
+    ret = AudioSocRegisterPlatform(device, platformData);
     if (ret !=  HDF_SUCCESS) {
         AUDIO_DRIVER_LOG_ERR("register dai fail.");
         return ret;
@@ -124,7 +136,22 @@ static int32_t DmaDriverInit(struct HdfDeviceObject *device)
     return HDF_SUCCESS;
 }
 
-static void DmaDriverRelease(struct HdfDeviceObject *device)
+static int32_t DmaDriverInit(struct HdfDeviceObject *device)
+{
+    return DmaPlatformInit(device, &g_platformData);
+}
+
+static int32_t DmaAhubDriverInit(struct HdfDeviceObject *device)
+{
+    return DmaPlatformInit(device, &g_ahubPlatformData);
+}
+
+static int32_t DmaCodecDriverInit(struct HdfDeviceObject *device)
+{
+    return DmaPlatformInit(device, &g_codecPlatformData);
+}
+
+static void DmaPlatformRelease(struct HdfDeviceObject *device, struct PlatformData *platformData)
 {
     struct PlatformHost *platformHost = NULL;
 
@@ -140,13 +167,29 @@ static void DmaDriverRelease(struct HdfDeviceObject *device)
         AUDIO_DRIVER_LOG_ERR("platformHost is NULL");
         return;
     }
-    OsalMutexDestroy(&g_platformData.renderBufInfo.buffMutex);
-    OsalMutexDestroy(&g_platformData.captureBufInfo.buffMutex);
+    T507AudioDmaDeviceRelease(platformData);
+    OsalMutexDestroy(&platformData->renderBufInfo.buffMutex);
+    OsalMutexDestroy(&platformData->captureBufInfo.buffMutex);
     OsalMemFree(platformHost);
 
     AUDIO_DRIVER_LOG_DEBUG("success!");
 }
 
+static void DmaDriverRelease(struct HdfDeviceObject *device)
+{
+    DmaPlatformRelease(device, &g_platformData);
+}
+
+static void DmaAhubDriverRelease(struct HdfDeviceObject *device)
+{
+    DmaPlatformRelease(device, &g_ahubPlatformData);
+}
+
+static void DmaCodecDriverRelease(struct HdfDeviceObject *device)
+{
+    DmaPlatformRelease(device, &g_codecPlatformData);
+}
+
 /* HdfDriverEntry definitions */
 struct HdfDriverEntry g_platformDriverEntry = {
     .moduleVersion  = 1,
@@ -156,3 +199,21 @@ struct HdfDriverEntry g_platformDriverEntry = {
     .Release        = DmaDriverRelease,
 };
 HDF_INIT(g_platformDriverEntry);
+
+struct HdfDriverEntry g_ahubPlatformDriverEntry = {
+    .moduleVersion  = 1,
+    .moduleName     = "DMA_T507_AHUB",
+    .Bind           = DmaDriverBind,
+    .Init           = DmaAhubDriverInit,
+    .Release        = DmaAhubDriverRelease,
+};
+HDF_INIT(g_ahubPlatformDriverEntry);
+
+struct HdfDriverEntry g_codecPlatformDriverEntry = {
+    .moduleVersion  = 1,
+    .moduleName     = "DMA_T507_CODEC",
+    .Bind           = DmaDriverBind,
+    .Init           = DmaCodecDriverInit,
+    .Release        = DmaCodecDriverRelease,
+};
+HDF_INIT(g_codecPlatformDriverEntry);
@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/rwsem.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+#include "audio_driver_log.h"
+#include "t507_dma_ops.h"
+
+#define HDF_LOG_TAG dma_cdev
+
+#define T507_DMA_CDEV_NAME_LEN  32
+
+/*
+ * One misc device per card for what the ADM ops have no room for: mmap of
+ * the ring and status page and the per-stream controls. The ADM keeps owning
+ * the stream lifecycle; ioctls land on the same PlatformData it uses.
+ */
+struct T507DmaCdev {
+    struct miscdevice misc;
+    struct PlatformData *data;      /* NULL once the card is released */
+    struct rw_semaphore lock;       /* ioctl/mmap read, release writes */
+    struct kref ref;                /* the card plus one per open file */
+    char name[T507_DMA_CDEV_NAME_LEN];
+};
+
+#define T507_DMA_TARGET_NONE    (-1)
+
+struct T507DmaFile {
+    struct T507DmaCdev *cdev;
+    int32_t target;
+    bool tapStarted;        /* stopped again when the file goes */
+    uint32_t tapFrames;
+};
+
+#define T507_DMA_TARGET_IS_TAP(target)  ((target) >= T507_DMA_TARGET_TAP(0))
+#define T507_DMA_TARGET_APBIF(target)   ((uint32_t)((target) - T507_DMA_TARGET_TAP(0)))
+
+static int audio_dma_cdev_errno(int32_t ret)
+{
+    switch (ret) {
+        case HDF_SUCCESS:
+            return 0;
+        case HDF_ERR_INVALID_PARAM:
+            return -EINVAL;
+        case HDF_ERR_DEVICE_BUSY:
+            return -EBUSY;
+        case HDF_ERR_NOT_SUPPORT:
+            return -EOPNOTSUPP;
+        case HDF_ERR_TIMEOUT:
+            return -ETIMEDOUT;
+        default:
+            /* HDF codes overlap the errno range, anything else is an io error */
+            return -EIO;
+    }
+}
+
+static void audio_dma_cdev_free(struct kref *ref)
+{
+    kfree(container_of(ref, struct T507DmaCdev, ref));
+}
+
+static enum AudioStreamType audio_dma_cdev_stream(const struct T507DmaFile *file)
+{
+    return (file->target == T507_DMA_TARGET_RENDER) ? AUDIO_RENDER_STREAM : AUDIO_CAPTURE_STREAM;
+}
+
+static int audio_dma_cdev_open(struct inode *inode, struct file *filp)
+{
+    struct T507DmaCdev *cdev = container_of(filp->private_data, struct T507DmaCdev, misc);
+    struct T507DmaFile *file;
+
+    (void)inode;
+    file = kzalloc(sizeof(*file), GFP_KERNEL);
+    if (file == NULL) {
+        return -ENOMEM;
+    }
+    /* misc_open runs under the misc lock, so the device is still registered */
+    kref_get(&cdev->ref);
+    file->cdev = cdev;
+    file->target = T507_DMA_TARGET_NONE;
+    filp->private_data = file;
+
+    return 0;
+}
+
+static int audio_dma_cdev_release(struct inode *inode, struct file *filp)
+{
+    struct T507DmaFile *file = filp->private_data;
+    struct T507DmaCdev *cdev = file->cdev;
+
+    (void)inode;
+    /* every vma holds the file, so the tap ring is no longer mapped here */
+    if (file->tapStarted) {
+        down_read(&cdev->lock);
+        if (cdev->data != NULL) {
+            (void)T507AudioDmaTapStop(cdev->data, T507_DMA_TARGET_APBIF(file->target));
+        }
+        up_read(&cdev->lock);
+    }
+    kref_put(&file->cdev->ref, audio_dma_cdev_free);
+    kfree(file);
+
+    return 0;
+}
+
+/* how much the HAL may move appPtr by */
+static int32_t audio_dma_cdev_avail(bool isRender, uint32_t frames, struct T507DmaSync *sync)
+{
+    if (frames == 0 || sync->appPtr >= frames) {
+        return HDF_ERR_INVALID_PARAM;
+    }
+    sync->bufferFrames = frames;
+    if (isRender) {
+        sync->avail = frames - (sync->appPtr + frames - sync->hwPtr) % frames;
+    } else {
+        sync->avail = (sync->hwPtr + frames - sync->appPtr) % frames;
+    }
+
+    return HDF_SUCCESS;
+}
+
+/* pointers of the bound stream */
+static int32_t audio_dma_cdev_sync(struct PlatformData *data, enum AudioStreamType streamType,
+    struct T507DmaSync *sync)
+{
+    const struct CircleBufInfo *bufInfo;
+    const struct PcmInfo *pcmInfo;
+    uint32_t frames;
+    int32_t ret;
+
+    bufInfo = (streamType == AUDIO_RENDER_STREAM) ? &data->renderBufInfo : &data->captureBufInfo;
+    pcmInfo = (streamType == AUDIO_RENDER_STREAM) ? &data->renderPcmInfo : &data->capturePcmInfo;
+    if (pcmInfo->frameSize == 0) {
+        return HDF_FAILURE;
+    }
+    frames = bufInfo->cirBufSize / pcmInfo->frameSize;
+
+    ret = T507AudioDmaPointer(data, streamType, &sync->hwPtr);
+    if (ret != HDF_SUCCESS) {
+        return ret;
+    }
+    ret = T507AudioDmaMmapAppPtr(data, streamType, &sync->appPtr);
+    if (ret != HDF_SUCCESS) {
+        return ret;
+    }
+
+    return audio_dma_cdev_avail(streamType == AUDIO_RENDER_STREAM, frames, sync);
+}
+
+/* taps are capture only, the geometry is the one latched at T507_DMA_IOC_TAP_START */
+static long audio_dma_cdev_tap_ioctl(struct T507DmaFile *file, struct PlatformData *data, unsigned int cmd,
+    void __user *argp)
+{
+    uint32_t apbNum = T507_DMA_TARGET_APBIF(file->target);
+    struct T507DmaSync sync;
+    uint32_t bufBytes;
+    int32_t ret;
+
+    switch (cmd) {
+        case T507_DMA_IOC_TAP_START:
+            if (data->capturePcmInfo.frameSize == 0) {
+                return -EINVAL;
+            }
+            ret = T507AudioDmaTapStart(data, apbNum, &bufBytes);
+            if (ret != HDF_SUCCESS) {
+                return audio_dma_cdev_errno(ret);
+            }
+            file->tapStarted = true;
+            file->tapFrames = bufBytes / data->capturePcmInfo.frameSize;
+            return put_user(bufBytes, (uint32_t __user *)argp) ? -EFAULT : 0;
+        case T507_DMA_IOC_TAP_STOP:
+            ret = T507AudioDmaTapStop(data, apbNum);
+            if (ret == HDF_SUCCESS) {
+                file->tapStarted = false;
+            }
+            return audio_dma_cdev_errno(ret);
+        case T507_DMA_IOC_SYNC:
+            (void)memset_s(&sync, sizeof(sync), 0, sizeof(sync));
+            ret = T507AudioDmaTapPointer(data, apbNum, &sync.hwPtr);
+            if (ret == HDF_SUCCESS) {
+                ret = T507AudioDmaTapAppPtr(data, apbNum, &sync.appPtr);
+            }
+            if (ret == HDF_SUCCESS) {
+                ret = audio_dma_cdev_avail(false, file->tapFrames, &sync);
+            }
+            if (ret != HDF_SUCCESS) {
+                return audio_dma_cdev_errno(ret);
+            }
+            return copy_to_user(argp, &sync, sizeof(sync)) ? -EFAULT : 0;
+        default:
+            return -EINVAL;
+    }
+}
+
+static long audio_dma_cdev_ioctl_locked(struct T507DmaFile *file, struct PlatformData *data, unsigned int cmd,
+    void __user *argp)
+{
+    struct T507DmaSync sync;
+    struct T507DmaTstamp tstamp;
+    uint32_t target;
+    uint32_t timeoutMs;
+    uint32_t count;
+    uint32_t enable;
+    int32_t ret;
+
+    if (cmd == T507_DMA_IOC_BIND) {
+        if (get_user(target, (uint32_t __user *)argp)) {
+            return -EFAULT;
+        }
+        if (target >= T507_DMA_TARGET_TAP(AHUB_APBIF_NUM)) {
+            return -EINVAL;
+        }
+        if (file->target != T507_DMA_TARGET_NONE) {
+            return -EBUSY;
+        }
+        file->target = (int32_t)target;
+        return 0;
+    }
+
+    if (file->target == T507_DMA_TARGET_NONE) {
+        return -ENXIO;
+    }
+    if (T507_DMA_TARGET_IS_TAP(file->target)) {
+        return audio_dma_cdev_tap_ioctl(file, data, cmd, argp);
+    }
+    switch (cmd) {
+        case T507_DMA_IOC_SYNC:
+            (void)memset_s(&sync, sizeof(sync), 0, sizeof(sync));
+            ret = audio_dma_cdev_sync(data, audio_dma_cdev_stream(file), &sync);
+            if (ret != HDF_SUCCESS) {
+                return audio_dma_cdev_errno(ret);
+            }
+            return copy_to_user(argp, &sync, sizeof(sync)) ? -EFAULT : 0;
+        case T507_DMA_IOC_TSTAMP:
+            (void)memset_s(&tstamp, sizeof(tstamp), 0, sizeof(tstamp));
+            ret = T507AudioDmaGetTimestamp(data, audio_dma_cdev_stream(file), &tstamp.hwPtr, &tstamp.tstampNs);
+            if (ret != HDF_SUCCESS) {
+                return audio_dma_cdev_errno(ret);
+            }
+            return copy_to_user(argp, &tstamp, sizeof(tstamp)) ? -EFAULT : 0;
+        case T507_DMA_IOC_WAIT_PERIOD:
+            if (get_user(timeoutMs, (uint32_t __user *)argp)) {
+                return -EFAULT;
+            }
+            /* the read lock is held across the wait, the cap bounds how long release waits for it */
+            ret = T507AudioDmaWaitPeriod(data, audio_dma_cdev_stream(file), min_t(uint32_t, timeoutMs,
+                T507_DMA_WAIT_MAX_MS));
+            if (ret != HDF_SUCCESS && signal_pending(current)) {
+                return -EINTR;
+            }
+            return audio_dma_cdev_errno(ret);
+        case T507_DMA_IOC_XRUN_COUNT:
+            ret = T507AudioDmaGetXrunCount(data, audio_dma_cdev_stream(file), &count);
+            if (ret != HDF_SUCCESS) {
+                return audio_dma_cdev_errno(ret);
+            }
+            return put_user(count, (uint32_t __user *)argp) ? -EFAULT : 0;
+        case T507_DMA_IOC_SET_LOW_LATENCY:
+            if (get_user(enable, (uint32_t __user *)argp)) {
+                return -EFAULT;
+            }
+            return audio_dma_cdev_errno(T507AudioDmaSetLowLatency(data, audio_dma_cdev_stream(file), enable != 0));
+        case T507_DMA_IOC_SET_CACHED:
+            if (get_user(enable, (uint32_t __user *)argp)) {
+                return -EFAULT;
+            }
+            return audio_dma_cdev_errno(T507AudioDmaSetCached(data, audio_dma_cdev_stream(file), enable != 0));
+        case T507_DMA_IOC_SET_BURST:
+            if (get_user(count, (uint32_t __user *)argp)) {
+                return -EFAULT;
+            }
+            return audio_dma_cdev_errno(T507AudioDmaSetBurst(data, audio_dma_cdev_stream(file), count));
+        case T507_DMA_IOC_TAP_START:
+        case T507_DMA_IOC_TAP_STOP:
+            return -EINVAL;
+        default:
+            return -ENOTTY;
+    }
+}
+
+static long audio_dma_cdev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+    struct T507DmaFile *file = filp->private_data;
+    struct T507DmaCdev *cdev = file->cdev;
+    long ret;
+
+    down_read(&cdev->lock);
+    if (cdev->data == NULL) {
+        up_read(&cdev->lock);
+        return -ENODEV;
+    }
+    ret = audio_dma_cdev_ioctl_locked(file, cdev->data, cmd, (void __user *)arg);
+    up_read(&cdev->lock);
+
+    return ret;
+}
+
+static int audio_dma_cdev_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+    struct T507DmaFile *file = filp->private_data;
+    struct T507DmaCdev *cdev = file->cdev;
+    int32_t ret;
+
+    if (file->target == T507_DMA_TARGET_NONE) {
+        return -ENXIO;
+    }
+    down_read(&cdev->lock);
+    if (cdev->data == NULL) {
+        up_read(&cdev->lock);
+        return -ENODEV;
+    }
+    if (T507_DMA_TARGET_IS_TAP(file->target)) {
+        ret = T507AudioDmaTapMmap(cdev->data, T507_DMA_TARGET_APBIF(file->target), vma);
+    } else {
+        ret = T507AudioDmaMmap(cdev->data, audio_dma_cdev_stream(file), vma);
+    }
+    up_read(&cdev->lock);
+
+    return audio_dma_cdev_errno(ret);
+}
+
+static const struct file_operations g_dma_cdev_fops = {
+    .owner = THIS_MODULE,
+    .open = audio_dma_cdev_open,
+    .release = audio_dma_cdev_release,
+    .unlocked_ioctl = audio_dma_cdev_ioctl,
+    .compat_ioctl = audio_dma_cdev_ioctl,
+    .mmap = audio_dma_cdev_mmap,
+};
+
+/* called at platform init, a card without the device still plays through the ADM */
+struct T507DmaCdev *T507AudioDmaCdevCreate(struct PlatformData *data)
+{
+    struct T507DmaCdev *cdev;
+    int ret;
+
+    if (data == NULL || data->drvPlatformName == NULL) {
+        return NULL;
+    }
+    cdev = kzalloc(sizeof(*cdev), GFP_KERNEL);
+    if (cdev == NULL) {
+        return NULL;
+    }
+    snprintf(cdev->name, sizeof(cdev->name), "t507_%s", data->drvPlatformName);
+    cdev->data = data;
+    init_rwsem(&cdev->lock);
+    kref_init(&cdev->ref);
+    cdev->misc.minor = MISC_DYNAMIC_MINOR;
+    cdev->misc.name = cdev->name;
+    cdev->misc.fops = &g_dma_cdev_fops;
+    cdev->misc.mode = 0660;
+
+    ret = misc_register(&cdev->misc);
+    if (ret != 0) {
+        AUDIO_DRIVER_LOG_ERR("register /dev/%s failed %d", cdev->name, ret);
+        kfree(cdev);
+        return NULL;
+    }
+    AUDIO_DRIVER_LOG_DEBUG("/dev/%s", cdev->name);
+
+    return cdev;
+}
+
+/* open files stay valid and get -ENODEV; mapped vmas keep their memory, see audio_dma_put */
+void T507AudioDmaCdevDestroy(struct T507DmaCdev *cdev)
+{
+    if (cdev == NULL) {
+        return;
+    }
+    misc_deregister(&cdev->misc);
+    down_write(&cdev->lock);
+    cdev->data = NULL;
+    up_write(&cdev->lock);
+    kref_put(&cdev->ref, audio_dma_cdev_free);
+}
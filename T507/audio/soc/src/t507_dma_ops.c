@@ -19,39 +19,157 @@
 #include <linux/platform_device.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma/sunxi-dma.h>
+#include <linux/debugfs.h>
+#include <linux/genalloc.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/seqlock.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 
 #include "audio_platform_if.h"
 #include "audio_sapm.h"
 #include "audio_stream_dispatch.h"
 #include "audio_driver_log.h"
+#include "t507_codec_impl_linux.h"
+#include "t507_dai_ahub_impl_linux.h"
 
 #include "t507_dma_ops.h"
 
+#define CREATE_TRACE_POINTS
+#include "t507_audio_trace.h"
+
 #define HDF_LOG_TAG dma_ops
 
+#define T507_DMA_DEBUGFS_NAME_LEN   32
+
 enum {
     DMA_STREAM_TX = 0,
     DMA_STREAM_RX,
     DMA_STREAM_CNT,
 };
 
-struct DmaRuntimeData {
-    struct device *dma_dev[DMA_STREAM_CNT];
-    struct dma_chan *dma_chan[DMA_STREAM_CNT];
-    dma_cookie_t cookie[DMA_STREAM_CNT];
+enum DmaStreamState {
+    DMA_STATE_IDLE = 0,
+    DMA_STATE_READY,
+    DMA_STATE_RUNNING,
+    DMA_STATE_PAUSED,
+};
+
+/* where the ring currently handed to the ADM came from */
+enum DmaBufSource {
+    DMA_BUF_NONE = 0,
+    DMA_BUF_POOL,
+    DMA_BUF_DRAM,
+    DMA_BUF_SRAM,
+    DMA_BUF_CACHED,
+};
+
+/* where the render stream of a card goes */
+enum DmaRenderSink {
+    DMA_SINK_CODEC = 0,
+    DMA_SINK_AHUB,
+};
 
-    uint32_t streamType;
+/* where the capture stream of a card comes from */
+enum DmaCaptureSource {
+    DMA_SRC_AHUB = 0,
+    DMA_SRC_CODEC,
 };
 
-static struct DmaRuntimeData g_prtd;
+/* ring buffer reserved at device init, handed out on open instead of dma_alloc_wc */
+struct DmaBufPool {
+    void *virtAddr;
+    dma_addr_t phyAddr;
+    uint32_t size;
+    bool inUse;
+    uint32_t hits;
+    uint32_t misses;
+};
+
+struct DmaRuntimeData;
+
+/* one runtime per stream, each stream owns its own channel, cookie and state */
+struct DmaStreamRuntime {
+    struct DmaRuntimeData *owner;
+    struct device *dma_dev;
+    struct dma_chan *dma_chan;
+    dma_cookie_t cookie;
+
+    enum AudioStreamType streamType;
+    enum DmaStreamState state;
+    bool canPause;    /* controller supports dmaengine_pause/resume */
+    uint32_t burstOverride;  /* 0 selects the burst from the stream format */
+    uint32_t maxburst;
+    bool lowLatency;         /* 1 ms dma periods, ring in sram when available */
+    struct gen_pool *sram;
+    enum DmaBufSource bufSource;
+    bool isTap;              /* extra capture apbif, not driven by the ADM */
+    bool onAhub;             /* peripheral fifo is an ahub apbif, else the internal codec */
+    bool cached;             /* capture only: cacheable ring, invalidated per period */
+    struct DmaBufPool *tapRing;  /* taps: one of DmaRuntimeData.tapPool while started */
+    bool needSubmit;  /* channel was terminated, resume must rebuild descriptors */
+    uint64_t pauseNs;
+
+    /* ring geometry, latched at submit */
+    dma_addr_t phyAddr;
+    enum dma_transfer_direction direction;
+    uint32_t bufBytes;
+    uint32_t periodBytes;
+    uint32_t frameSize;
+    uint32_t bytesPerSec;
+
+    /*
+     * written from the period tasklet and from process context (submit,
+     * xrun work, resume), so the writers serialise on the seqlock with irqs
+     * off; readers stay lock-free
+     */
+    seqlock_t seq;
+    uint32_t hwPos;
+    uint64_t tstampNs;
+    atomic_t periodsElapsed;
+    wait_queue_head_t periodWait;
+
+    /* fifo over/underruns seen in the period path, recovered in xrunWork */
+    atomic_t xrunCount;
+    struct work_struct xrunWork;
+
+    struct DmaBufPool pool;
+    struct DmaBufPool cachedPool;  /* capture only: cacheable ring, mapped once at init */
+
+    /* shared with the HAL when the ring is mmapped, see T507AudioDmaMmap */
+    struct T507DmaMmapStatus *status;
+    bool mmapMode;
+    atomic_t ringMaps;       /* user vmas on the ring, BufFree refuses while non-zero */
+};
+
+/* one runtime per card (PlatformData), hang on data->dmaPrv */
+struct DmaRuntimeData {
+    enum DmaRenderSink renderSink;
+    enum DmaCaptureSource captureSource;
+    struct DmaStreamRuntime stream[DMA_STREAM_CNT];
+    struct DmaStreamRuntime tap[AHUB_APBIF_NUM];    /* indexed by apbif, see T507AudioDmaTapStart */
+    struct DmaBufPool tapPool[AHUB_APBIF_NUM - 1];  /* HCS captureTaps rings, reserved at init */
+    uint32_t tapPools;
+    struct mutex tapLock;    /* tap start/stop come from any number of dma device files */
+    /* one for the card plus one per user vma, the rings and status pages go with the last */
+    atomic_t refs;
+    struct T507DmaCdev *cdev;    /* mmap and stream controls for the HAL */
+    struct dentry *debugfs_dir;
+};
 
 /* note:
- * render -> internal codec
- * capture -> ahub & ac107
+ * render -> internal codec, or ahub i2s on the DMA_T507_AHUB platform
+ * capture -> ahub & ac107, or the internal codec adc on the DMA_T507_CODEC platform
  */
 static const char *g_codec_dtstreepath = "/soc@03000000/codec@0x05096000";
 static const char *g_ahub_dtstreepath = "/soc@03000000/ahub@0x05097000";
 
+/* drq lines of the ahub apbifs, indexed by apb-num */
+static const uint32_t g_ahub_drq_tx[AHUB_APBIF_NUM] = { DRQDST_AHUB0_TX, DRQDST_AHUB1_TX, DRQDST_AHUB2_TX };
+static const uint32_t g_ahub_drq_rx[AHUB_APBIF_NUM] = { DRQSRC_AHUB0_RX, DRQSRC_AHUB1_RX, DRQSRC_AHUB2_RX };
+
 static struct device *get_dma_device(const char *dtstreepath)
 {
     struct device_node *dma_of_node;
@@ -83,386 +201,1720 @@ struct dma_chan *snd_dmaengine_pcm_request_channel(dma_filter_fn filter_fn, void
     return dma_request_channel(mask, filter_fn, filter_data);
 }
 
-static int audio_dma_request(void)
+static struct DmaStreamRuntime *get_dma_stream(const struct PlatformData *data, const enum AudioStreamType streamType)
 {
-    /* note: for internal codec */
-    g_prtd.dma_dev[DMA_STREAM_TX] = get_dma_device(g_codec_dtstreepath);
-    if (!(g_prtd.dma_dev[DMA_STREAM_TX])) {
-        AUDIO_DRIVER_LOG_ERR("get_dma_device failed.");
-        return HDF_FAILURE;
-    }
+    struct DmaRuntimeData *prtd;
 
-    g_prtd.dma_chan[DMA_STREAM_TX] = snd_dmaengine_pcm_request_channel(NULL, NULL);
+    if (data == NULL || data->dmaPrv == NULL) {
+        AUDIO_DRIVER_LOG_ERR("dma runtime is null");
+        return NULL;
+    }
+    prtd = (struct DmaRuntimeData *)data->dmaPrv;
 
-    /* note: for ahub (i2s with hub function) */
-    g_prtd.dma_dev[DMA_STREAM_RX] = get_dma_device(g_ahub_dtstreepath);
-    if (!(g_prtd.dma_dev[DMA_STREAM_RX])) {
-        AUDIO_DRIVER_LOG_ERR("get_dma_device failed.");
-        return HDF_FAILURE;
+    if (streamType == AUDIO_RENDER_STREAM) {
+        return &prtd->stream[DMA_STREAM_TX];
+    } else if (streamType == AUDIO_CAPTURE_STREAM) {
+        return &prtd->stream[DMA_STREAM_RX];
     }
 
-    g_prtd.dma_chan[DMA_STREAM_RX] = snd_dmaengine_pcm_request_channel(NULL, NULL);
+    AUDIO_DRIVER_LOG_ERR("stream Type is invalude.");
+    return NULL;
+}
+
+static void audio_dma_xrun_work(struct work_struct *work);
 
-    return HDF_SUCCESS;
+static void audio_dma_stream_init(struct DmaStreamRuntime *stream, enum AudioStreamType streamType)
+{
+    stream->streamType = streamType;
+    stream->state = DMA_STATE_IDLE;
+    seqlock_init(&stream->seq);
+    init_waitqueue_head(&stream->periodWait);
+    INIT_WORK(&stream->xrunWork, audio_dma_xrun_work);
 }
 
-int32_t T507AudioDmaDeviceInit(const struct AudioCard *card, const struct PlatformDevice *platformDevice)
+static int audio_dma_stream_request(struct DmaStreamRuntime *stream, const char *dtstreepath,
+    enum AudioStreamType streamType)
 {
-    int ret;
+    struct dma_slave_caps caps;
 
-    AUDIO_DRIVER_LOG_DEBUG("entry");
+    /* first: audio_dma_release cancels xrunWork on any stream that got a channel */
+    audio_dma_stream_init(stream, streamType);
 
-    if (card == NULL || platformDevice == NULL || platformDevice->devData == NULL) {
-        AUDIO_DRIVER_LOG_ERR("platformDevice is NULL.");
+    stream->dma_dev = get_dma_device(dtstreepath);
+    if (stream->dma_dev == NULL) {
+        AUDIO_DRIVER_LOG_ERR("get_dma_device failed.");
         return HDF_FAILURE;
     }
-    if (platformDevice->devData->platformInitFlag == true) {
-        AUDIO_DRIVER_LOG_ERR("platform init complete!");
-        return HDF_SUCCESS;
+    stream->dma_dev->coherent_dma_mask = DMA_BIT_MASK(32);
+
+    stream->dma_chan = snd_dmaengine_pcm_request_channel(NULL, NULL);
+    if (stream->dma_chan == NULL) {
+        AUDIO_DRIVER_LOG_ERR("request dma channel failed.");
+        return HDF_FAILURE;
     }
 
-    /* note: include internal codec and ahub */
-    ret = audio_dma_request();
-    if (ret < 0) {
-        AUDIO_DRIVER_LOG_ERR("audio_dma_request failed");
+    stream->status = (struct T507DmaMmapStatus *)get_zeroed_page(GFP_KERNEL);
+    if (stream->status == NULL) {
+        AUDIO_DRIVER_LOG_ERR("alloc mmap status page failed.");
         return HDF_FAILURE;
     }
 
-    platformDevice->devData->platformInitFlag = true;
-    AUDIO_DRIVER_LOG_DEBUG("success.");
+    /* optional "sram" phandle on the codec/ahub node, used by low latency streams */
+    stream->sram = of_gen_pool_get(stream->dma_dev->of_node, "sram", 0);
+
+    stream->canPause = (dma_get_slave_caps(stream->dma_chan, &caps) == 0) && caps.cmd_pause;
+
     return HDF_SUCCESS;
 }
 
-int32_t T507AudioDmaBufAlloc(struct PlatformData *data, const enum AudioStreamType streamType)
+/* mirror hwPos/tstampNs into the mmapped status page, odd seq means update in progress; under stream->seq */
+static void audio_dma_status_publish(struct DmaStreamRuntime *stream)
 {
-    struct device *dma_dev;
+    struct T507DmaMmapStatus *status = stream->status;
 
-    AUDIO_DRIVER_LOG_DEBUG("");
+    if (status == NULL || !stream->mmapMode || stream->frameSize == 0) {
+        return;
+    }
 
-    if (data == NULL) {
-        AUDIO_DRIVER_LOG_ERR("data is null");
-        return HDF_FAILURE;
+    WRITE_ONCE(status->seq, status->seq + 1);
+    smp_wmb();
+    WRITE_ONCE(status->hwPtr, stream->hwPos / stream->frameSize);
+    WRITE_ONCE(status->tstampNs, stream->tstampNs);
+    WRITE_ONCE(status->xrunCount, atomic_read(&stream->xrunCount));
+    smp_wmb();
+    WRITE_ONCE(status->seq, status->seq + 1);
+}
+
+static void audio_dma_stream_set_pos(struct DmaStreamRuntime *stream, uint32_t hwPos, uint64_t tstampNs)
+{
+    unsigned long flags;
+
+    write_seqlock_irqsave(&stream->seq, flags);
+    stream->hwPos = hwPos;
+    stream->tstampNs = tstampNs;
+    audio_dma_status_publish(stream);
+    write_sequnlock_irqrestore(&stream->seq, flags);
+}
+
+static bool audio_dma_xrun_check(const struct DmaStreamRuntime *stream)
+{
+    if (stream->isTap) {
+        return false;
     }
+    if (stream->onAhub) {
+        return T507AhubImplXrunCheck(stream->streamType);
+    }
+    return T507CodecImplXrunCheck(stream->streamType);
+}
 
-    if (streamType == AUDIO_RENDER_STREAM) {
-        if (data->renderBufInfo.virtAddr == NULL) {
-            dma_dev = g_prtd.dma_dev[DMA_STREAM_TX];
-            dma_dev->coherent_dma_mask = 0xffffffffUL;
-            data->renderBufInfo.virtAddr = dma_alloc_wc(dma_dev, data->renderBufInfo.cirBufMax,
-                                                        (dma_addr_t *)&data->renderBufInfo.phyAddr,
-                                                        GFP_DMA | GFP_KERNEL);
-            if (data->renderBufInfo.virtAddr == NULL) {
-                AUDIO_DRIVER_LOG_ERR("dma_alloc_wc faild");
-                return HDF_FAILURE;
-            }
-        }
-    } else if (streamType == AUDIO_CAPTURE_STREAM) {
-        if (data->captureBufInfo.virtAddr == NULL) {
-            dma_dev = g_prtd.dma_dev[DMA_STREAM_RX];
-            dma_dev->coherent_dma_mask = 0xffffffffUL;
-            data->captureBufInfo.virtAddr = dma_alloc_wc(dma_dev, data->captureBufInfo.cirBufMax,
-                                                         (dma_addr_t *)&data->captureBufInfo.phyAddr,
-                                                         GFP_DMA | GFP_KERNEL);
-            if (data->captureBufInfo.virtAddr == NULL) {
-                AUDIO_DRIVER_LOG_ERR("dma_alloc_wc faild");
-                return HDF_FAILURE;
-            }
-        }
-    } else {
-        AUDIO_DRIVER_LOG_ERR("stream Type is invalude.");
-        return HDF_FAILURE;
+static const char *audio_dma_trace_dev(const struct DmaStreamRuntime *stream)
+{
+    if (stream->isTap) {
+        return "ahub-tap";
     }
+    return stream->onAhub ? "ahub" : "codec";
+}
 
-    data->dmaPrv = &g_prtd;
-    g_prtd.streamType = streamType;
+/* bytes left in the cyclic descriptor, 0 if the controller does not report it */
+static uint32_t audio_dma_residue(const struct DmaStreamRuntime *stream)
+{
+    struct dma_tx_state state = {0};
 
-    AUDIO_DRIVER_LOG_DEBUG("success.");
+    if (stream->dma_chan == NULL) {
+        return 0;
+    }
+    dmaengine_tx_status(stream->dma_chan, stream->cookie, &state);
 
-    return HDF_SUCCESS;
+    return state.residue;
 }
 
-int32_t T507AudioDmaBufFree(struct PlatformData *data, const enum AudioStreamType streamType)
+/* only touches the fifo registers while the event is enabled */
+static void audio_dma_trace_period(const struct DmaStreamRuntime *stream, uint32_t hwPos)
 {
-    struct device *dma_dev;
-
-    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+    uint32_t avail = 0;
+    uint32_t count = 0;
 
-    if (data == NULL) {
-        AUDIO_DRIVER_LOG_ERR("data is null");
-        return HDF_FAILURE;
+    if (!trace_t507_audio_dma_period_enabled()) {
+        return;
     }
+    if (!stream->isTap) {
+        avail = stream->onAhub ? T507AhubImplFifoAvail(stream->streamType, &count) :
+                                 T507CodecImplFifoAvail(stream->streamType, &count);
+    }
+    trace_t507_audio_dma_period(audio_dma_trace_dev(stream), stream->streamType == AUDIO_RENDER_STREAM,
+                                hwPos, audio_dma_residue(stream), avail, count);
+}
 
-    if (streamType == AUDIO_RENDER_STREAM) {
-        if (data->renderBufInfo.virtAddr != NULL) {
-            dma_dev = g_prtd.dma_dev[DMA_STREAM_TX];
-            dma_free_wc(dma_dev, data->renderBufInfo.cirBufMax, data->renderBufInfo.virtAddr, data->renderBufInfo.phyAddr);
-        }
-    } else if (streamType == AUDIO_CAPTURE_STREAM) {
-        if (data->captureBufInfo.virtAddr != NULL) {
-            dma_dev = g_prtd.dma_dev[DMA_STREAM_RX];
-            dma_free_wc(dma_dev, data->captureBufInfo.cirBufMax, data->captureBufInfo.virtAddr, data->captureBufInfo.phyAddr);
-        }
-    } else {
-        AUDIO_DRIVER_LOG_ERR("stream Type is invalude.");
-        return HDF_FAILURE;
+/*
+ * Period boundary the cyclic descriptor has reached, from the residue.
+ * virt-dma runs the callback once for however many periods completed since
+ * the tasklet last ran, so counting callbacks drifts behind the hardware.
+ * Controllers that report no residue fall back to one period per callback.
+ */
+static uint32_t audio_dma_cyclic_pos(const struct DmaStreamRuntime *stream)
+{
+    uint32_t residue = audio_dma_residue(stream);
+    uint32_t hwPos;
+
+    if (residue == 0 || residue > stream->bufBytes) {
+        hwPos = stream->hwPos + stream->periodBytes;
+        return (hwPos >= stream->bufBytes) ? 0 : hwPos;
     }
-    return HDF_SUCCESS;
+
+    hwPos = stream->bufBytes - residue;
+    hwPos -= hwPos % stream->periodBytes;
+
+    return (hwPos >= stream->bufBytes) ? 0 : hwPos;
 }
 
-int32_t T507AudioDmaRequestChannel(const struct PlatformData *data, const enum AudioStreamType streamType)
+/* invalidate what the dma filled between two period boundaries, the ring may have wrapped */
+static void audio_dma_cached_sync(struct DmaStreamRuntime *stream, uint32_t from, uint32_t to)
 {
-    (void)data;
-    AUDIO_DRIVER_LOG_DEBUG("entry");
-    return HDF_SUCCESS;
+    if (to > from) {
+        dma_sync_single_for_cpu(stream->dma_dev, stream->phyAddr + from, to - from, DMA_FROM_DEVICE);
+        return;
+    }
+    dma_sync_single_for_cpu(stream->dma_dev, stream->phyAddr + from, stream->bufBytes - from, DMA_FROM_DEVICE);
+    if (to > 0) {
+        dma_sync_single_for_cpu(stream->dma_dev, stream->phyAddr, to, DMA_FROM_DEVICE);
+    }
 }
 
-int32_t T507AudioDmaConfigChannel(const struct PlatformData *data, const enum AudioStreamType streamType)
+static void audio_dma_period_update(struct DmaStreamRuntime *stream, uint32_t hwPos)
 {
-    int32_t ret = 0;
-    struct dma_chan *dmaChan;
-    struct dma_slave_config slaveConfig;
+    uint32_t oldPos = stream->hwPos;
+    uint32_t periods;
 
-    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+    if (stream->bufSource == DMA_BUF_CACHED) {
+        /* drop any lines the cpu pulled in while the dma was filling these periods */
+        audio_dma_cached_sync(stream, oldPos, hwPos);
+    }
+    periods = ((hwPos + stream->bufBytes - oldPos) % stream->bufBytes) / stream->periodBytes;
 
-    if (data == NULL) {
-        AUDIO_DRIVER_LOG_ERR("data is null");
-        return HDF_FAILURE;
+    audio_dma_stream_set_pos(stream, hwPos, ktime_get_ns());
+    audio_dma_trace_period(stream, hwPos);
+
+    if (audio_dma_xrun_check(stream)) {
+        atomic_inc(&stream->xrunCount);
+        schedule_work(&stream->xrunWork);
     }
 
-    (void)memset_s(&slaveConfig, sizeof(slaveConfig), 0, sizeof(slaveConfig));
+    /* at least one, waiters only look for a change */
+    atomic_add(max_t(uint32_t, periods, 1), &stream->periodsElapsed);
+    wake_up_interruptible(&stream->periodWait);
+}
 
-    if (streamType == AUDIO_RENDER_STREAM) {
-        dmaChan = g_prtd.dma_chan[DMA_STREAM_TX];
-        slaveConfig.direction = DMA_MEM_TO_DEV;
-        switch (data->renderPcmInfo.bitWidth) {
-            case 8:
-                slaveConfig.dst_addr_width = DMA_SLAVE_BUSWIDTH_1_BYTE;
-                break;
-            case 16:
-                slaveConfig.dst_addr_width = DMA_SLAVE_BUSWIDTH_2_BYTES;
-                break;
-            case 32:
-                slaveConfig.dst_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES;
-                break;
-            default:
-                AUDIO_DRIVER_LOG_ERR("unsupport bitWidth -> %u", data->renderPcmInfo.bitWidth);
-                return HDF_FAILURE;
-        }
-        slaveConfig.src_addr_width = slaveConfig.dst_addr_width;
-        slaveConfig.dst_maxburst = 4;
-        slaveConfig.dst_addr = SUNXI_CODEC_ADDR_BASE + SUNXI_DAC_TXDATA;
-        slaveConfig.slave_id = sunxi_slave_id(DRQDST_AUDIO_CODEC, DRQSRC_SDRAM);
-    } else if (streamType == AUDIO_CAPTURE_STREAM) {
-        dmaChan = g_prtd.dma_chan[DMA_STREAM_RX];
-        slaveConfig.direction = DMA_DEV_TO_MEM;
-        switch (data->capturePcmInfo.bitWidth) {
-            case 8:
-                slaveConfig.src_addr_width = DMA_SLAVE_BUSWIDTH_1_BYTE;
-                break;
-            case 16:
-                slaveConfig.src_addr_width = DMA_SLAVE_BUSWIDTH_2_BYTES;
-                break;
-            case 32:
-                slaveConfig.src_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES;
-                break;
-            default:
-                AUDIO_DRIVER_LOG_ERR("unsupport bitWidth -> %u", data->capturePcmInfo.bitWidth);
-                return HDF_FAILURE;
+/* called from the dma tasklet for the cyclic descriptor, possibly once for several periods */
+static void audio_dma_period_elapsed(void *arg)
+{
+    struct DmaStreamRuntime *stream = (struct DmaStreamRuntime *)arg;
+
+    audio_dma_period_update(stream, audio_dma_cyclic_pos(stream));
+}
+
+/* one single descriptor of the resume tail completed, each has its own callback */
+static void audio_dma_tail_elapsed(void *arg)
+{
+    struct DmaStreamRuntime *stream = (struct DmaStreamRuntime *)arg;
+    uint32_t hwPos = stream->hwPos + stream->periodBytes;
+
+    audio_dma_period_update(stream, (hwPos >= stream->bufBytes) ? 0 : hwPos);
+}
+
+static void audio_dma_stream_reset_pos(struct DmaStreamRuntime *stream)
+{
+    audio_dma_stream_set_pos(stream, 0, ktime_get_ns());
+}
+
+/* hardware pointer in bytes: last period boundary (resynced from the residue) plus the time elapsed since it */
+static uint32_t audio_dma_stream_pos(struct DmaStreamRuntime *stream, uint64_t *tstampNs)
+{
+    unsigned int seq;
+    uint32_t hwPos;
+    uint64_t lastNs;
+    uint64_t nowNs;
+    uint64_t delta;
+
+    do {
+        seq = read_seqbegin(&stream->seq);
+        hwPos = stream->hwPos;
+        lastNs = stream->tstampNs;
+    } while (read_seqretry(&stream->seq, seq));
+
+    nowNs = ktime_get_ns();
+    if (stream->bufSource == DMA_BUF_CACHED) {
+        /* a cached ring is only invalidated up to hwPos, frames past it may still be stale lines */
+        nowNs = lastNs;
+    } else if (stream->state == DMA_STATE_PAUSED && !stream->needSubmit) {
+        /* paused in place: the ring stopped at pauseNs, hold the pointer there */
+        nowNs = stream->pauseNs;
+    } else if (stream->state != DMA_STATE_RUNNING) {
+        nowNs = lastNs;
+    }
+    if (nowNs <= lastNs || stream->bytesPerSec == 0 || stream->frameSize == 0) {
+        if (tstampNs != NULL) {
+            *tstampNs = lastNs;
         }
-        slaveConfig.dst_addr_width = slaveConfig.src_addr_width;
-        slaveConfig.src_maxburst = 4;
-        slaveConfig.src_addr = SUNXI_AHUB_ADDR_BASE + SUNXI_AHUB_APBIF_RXFIFO(AHUB_APBIF_USE);
-        slaveConfig.slave_id = sunxi_slave_id(DRQDST_SDRAM, DRQSRC_AHUB0_RX);
-    } else {
-        AUDIO_DRIVER_LOG_ERR("stream Type is invalude.");
-        return HDF_FAILURE;
+        return hwPos;
+    }
+    if (tstampNs != NULL) {
+        *tstampNs = nowNs;
     }
-    slaveConfig.device_fc = false;
 
-    ret = dmaengine_slave_config(dmaChan, &slaveConfig);
-    if (ret != 0) {
-        AUDIO_DRIVER_LOG_ERR("dmaengine_slave_config failed");
-        return HDF_FAILURE;
+    /* never interpolate past the next period boundary, the irq owns that */
+    delta = div_u64((nowNs - lastNs) * stream->bytesPerSec, NSEC_PER_SEC);
+    if (delta >= stream->periodBytes) {
+        delta = stream->periodBytes - stream->frameSize;
     }
-    AUDIO_DRIVER_LOG_DEBUG("success!");
+    delta -= delta % stream->frameSize;
 
-    return HDF_SUCCESS;
-}
+    hwPos += (uint32_t)delta;
+    if (hwPos >= stream->bufBytes) {
+        hwPos -= stream->bufBytes;
+    }
 
-int32_t T507AudioDmaPrep(const struct PlatformData *data, const enum AudioStreamType streamType)
-{
-    (void)data;
-    AUDIO_DRIVER_LOG_DEBUG("entry");
-    return HDF_SUCCESS;
+    return hwPos;
 }
 
-int32_t T507AudioDmaSubmit(const struct PlatformData *data, const enum AudioStreamType streamType)
+/*
+ * Queue the ring starting at byte offset @offset. A non-zero offset is only
+ * used when resuming on a channel that cannot pause: the tail up to the ring
+ * end goes out as one single descriptor per period, then the cyclic one takes
+ * over from the ring start, so the period callbacks keep the same positions.
+ */
+static int audio_dma_stream_prep(struct DmaStreamRuntime *stream, uint32_t offset)
 {
     struct dma_async_tx_descriptor *desc;
-    enum dma_transfer_direction direction;
     unsigned long flags = DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
+    uint32_t pos;
+    uint32_t len;
 
-    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
-
-    if (streamType == AUDIO_RENDER_STREAM) {
-        direction = DMA_MEM_TO_DEV;
-        desc = dmaengine_prep_dma_cyclic(g_prtd.dma_chan[DMA_STREAM_TX],
-                                         data->renderBufInfo.phyAddr,
-                                         data->renderBufInfo.cirBufSize,
-                                         data->renderBufInfo.periodSize,
-                                         direction, flags);
-        if (!desc) {
-            AUDIO_DRIVER_LOG_ERR("DMA_STREAM_TX desc create failed");
-            return -ENOMEM;
-        }
-        g_prtd.cookie[DMA_STREAM_TX] = dmaengine_submit(desc);
-    } else if (streamType == AUDIO_CAPTURE_STREAM) {
-        direction = DMA_DEV_TO_MEM;
-        desc = dmaengine_prep_dma_cyclic(g_prtd.dma_chan[DMA_STREAM_RX],
-                                         data->captureBufInfo.phyAddr,
-                                         data->captureBufInfo.cirBufSize,
-                                         data->captureBufInfo.periodSize,
-                                         direction, flags);
+    for (pos = offset; pos > 0 && pos < stream->bufBytes; pos += len) {
+        len = min(stream->periodBytes, stream->bufBytes - pos);
+        desc = dmaengine_prep_slave_single(stream->dma_chan, stream->phyAddr + pos, len,
+                                           stream->direction, flags);
         if (!desc) {
-            AUDIO_DRIVER_LOG_ERR("DMA_RX_CHANNEL desc create failed");
+            AUDIO_DRIVER_LOG_ERR("streamType %d tail desc create failed", stream->streamType);
             return -ENOMEM;
         }
-        g_prtd.cookie[DMA_STREAM_RX] = dmaengine_submit(desc);
-    } else {
-        AUDIO_DRIVER_LOG_ERR("stream Type is invalude.");
-        return HDF_FAILURE;
+        desc->callback = audio_dma_tail_elapsed;
+        desc->callback_param = stream;
+        dmaengine_submit(desc);
     }
 
-    AUDIO_DRIVER_LOG_DEBUG("success!");
-    return HDF_SUCCESS;
+    desc = dmaengine_prep_dma_cyclic(stream->dma_chan, stream->phyAddr, stream->bufBytes,
+                                     stream->periodBytes, stream->direction, flags);
+    if (!desc) {
+        AUDIO_DRIVER_LOG_ERR("streamType %d desc create failed", stream->streamType);
+        return -ENOMEM;
+    }
+    desc->callback = audio_dma_period_elapsed;
+    desc->callback_param = stream;
+    stream->cookie = dmaengine_submit(desc);
+    stream->needSubmit = false;
+
+    return 0;
 }
 
-int32_t T507AudioDmaPending(struct PlatformData *data, const enum AudioStreamType streamType)
+/*
+ * Xrun recovery without closing the stream: stop the channel, flush the
+ * peripheral fifo and restart the ring at the last period boundary.
+ */
+static void audio_dma_xrun_work(struct work_struct *work)
 {
-    struct dma_chan *dmaChan;
-
-    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+    struct DmaStreamRuntime *stream = container_of(work, struct DmaStreamRuntime, xrunWork);
+    int32_t ret;
 
-    if (data == NULL) {
-        AUDIO_DRIVER_LOG_ERR("data is null");
-        return HDF_FAILURE;
+    if (stream->state != DMA_STATE_RUNNING) {
+        return;
     }
+    AUDIO_DRIVER_LOG_ERR("streamType %d xrun %d at %u", stream->streamType,
+        atomic_read(&stream->xrunCount), stream->hwPos);
 
-    if (streamType == AUDIO_RENDER_STREAM) {
-        dmaChan = g_prtd.dma_chan[DMA_STREAM_TX];
-    } else if (streamType == AUDIO_CAPTURE_STREAM) {
-        dmaChan = g_prtd.dma_chan[DMA_STREAM_RX];
+    dmaengine_terminate_sync(stream->dma_chan);
+    if (stream->onAhub) {
+        ret = T507AhubImplXrunRecover(stream->streamType);
     } else {
-        AUDIO_DRIVER_LOG_ERR("stream Type is invalude.");
-        return HDF_FAILURE;
+        ret = T507CodecImplXrunRecover(stream->streamType);
+    }
+    if (ret != HDF_SUCCESS) {
+        AUDIO_DRIVER_LOG_ERR("streamType %d fifo recover failed", stream->streamType);
     }
-    dma_async_issue_pending(dmaChan);
-    AUDIO_DRIVER_LOG_DEBUG("dmaChan chan_id = %d.", dmaChan->chan_id);
 
-    return HDF_SUCCESS;
+    audio_dma_stream_set_pos(stream, stream->hwPos, ktime_get_ns());
+    if (audio_dma_stream_prep(stream, stream->hwPos) != 0) {
+        AUDIO_DRIVER_LOG_ERR("streamType %d restart failed", stream->streamType);
+        stream->state = DMA_STATE_READY;
+        wake_up_interruptible(&stream->periodWait);
+        return;
+    }
+    dma_async_issue_pending(stream->dma_chan);
 }
 
-int32_t T507AudioDmaPause(struct PlatformData *data, const enum AudioStreamType streamType)
+static void audio_dma_pool_reserve(struct device *dev, struct DmaBufPool *pool, uint32_t size)
 {
-    struct dma_chan *dmaChan;
-
-    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
-
-    if (data == NULL) {
-        AUDIO_DRIVER_LOG_ERR("data is null");
-        return HDF_FAILURE;
+    pool->virtAddr = dma_alloc_wc(dev, size, &pool->phyAddr, GFP_DMA | GFP_KERNEL);
+    if (pool->virtAddr == NULL) {
+        AUDIO_DRIVER_LOG_ERR("reserve %u bytes failed", size);
+        return;
     }
+    pool->size = size;
+    pool->inUse = false;
+}
 
-    if (streamType == AUDIO_RENDER_STREAM) {
-        dmaChan = g_prtd.dma_chan[DMA_STREAM_TX];
-    } else if (streamType == AUDIO_CAPTURE_STREAM) {
-        dmaChan = g_prtd.dma_chan[DMA_STREAM_RX];
-    } else {
-        AUDIO_DRIVER_LOG_ERR("stream Type is invalude.");
-        return HDF_FAILURE;
+static void audio_dma_pool_release(struct device *dev, struct DmaBufPool *pool)
+{
+    if (pool->virtAddr != NULL) {
+        dma_free_wc(dev, pool->size, pool->virtAddr, pool->phyAddr);
+        pool->virtAddr = NULL;
+        pool->size = 0;
     }
-    dmaengine_terminate_async(dmaChan);
+}
 
-    return HDF_SUCCESS;
+/* not fatal when it fails, BufAlloc falls back to allocating on open */
+static void audio_dma_pool_alloc(struct DmaStreamRuntime *stream, uint32_t size)
+{
+    audio_dma_pool_reserve(stream->dma_dev, &stream->pool, size);
 }
 
-int32_t T507AudioDmaResume(const struct PlatformData *data, const enum AudioStreamType streamType)
+static void audio_dma_pool_free(struct DmaStreamRuntime *stream)
 {
-    int ret;
-    struct dma_chan *dmaChan;
+    struct DmaBufPool *pool = &stream->pool;
 
-    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+    audio_dma_pool_release(stream->dma_dev, pool);
+    AUDIO_DRIVER_LOG_DEBUG("streamType %d pool hits %u misses %u", stream->streamType, pool->hits, pool->misses);
+}
 
-    if (data == NULL) {
-        AUDIO_DRIVER_LOG_ERR("data is null");
-        return HDF_FAILURE;
-    }
+/* cacheable capture ring, streaming mapped for the life of the card and synced per period */
+static void audio_dma_cached_reserve(struct DmaStreamRuntime *stream, uint32_t size)
+{
+    struct DmaBufPool *pool = &stream->cachedPool;
+    void *virtAddr;
 
-    if (streamType == AUDIO_RENDER_STREAM) {
-        dmaChan = g_prtd.dma_chan[DMA_STREAM_TX];
-    } else if (streamType == AUDIO_CAPTURE_STREAM) {
-        dmaChan = g_prtd.dma_chan[DMA_STREAM_RX];
-    } else {
-        AUDIO_DRIVER_LOG_ERR("stream Type is invalude.");
-        return HDF_FAILURE;
+    virtAddr = (void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO, get_order(size));
+    if (virtAddr == NULL) {
+        AUDIO_DRIVER_LOG_ERR("streamType %d reserve %u cached bytes failed", stream->streamType, size);
+        return;
     }
-
-    ret = T507AudioDmaSubmit(data, streamType);
-    if (ret != HDF_SUCCESS) {
-        AUDIO_DRIVER_LOG_ERR("call DmaSubmit failed");
-        return HDF_FAILURE;
+    pool->phyAddr = dma_map_single(stream->dma_dev, virtAddr, size, DMA_FROM_DEVICE);
+    if (dma_mapping_error(stream->dma_dev, pool->phyAddr)) {
+        AUDIO_DRIVER_LOG_ERR("streamType %d map cached ring failed", stream->streamType);
+        free_pages((unsigned long)virtAddr, get_order(size));
+        return;
     }
-    dma_async_issue_pending(dmaChan);
+    pool->size = size;
+    pool->inUse = false;
+    /* last, BufAlloc takes the ring once virtAddr is set */
+    smp_wmb();
+    WRITE_ONCE(pool->virtAddr, virtAddr);
+}
 
-    return HDF_SUCCESS;
+static void audio_dma_cached_release(struct DmaStreamRuntime *stream)
+{
+    struct DmaBufPool *pool = &stream->cachedPool;
+
+    if (pool->virtAddr != NULL) {
+        dma_unmap_single(stream->dma_dev, pool->phyAddr, pool->size, DMA_FROM_DEVICE);
+        free_pages((unsigned long)pool->virtAddr, get_order(pool->size));
+        pool->virtAddr = NULL;
+        pool->size = 0;
+    }
 }
 
-static inline signed long BytesToFrames(uint32_t frameSize, uint32_t size)
+static void audio_dma_tap_stop(struct DmaStreamRuntime *tap, uint32_t apbNum)
 {
-    if (frameSize == 0 || size == 0) {
-        return 0;
+    if (tap->dma_chan == NULL) {
+        return;
     }
 
-    return size / frameSize;
+    (void)T507AhubImplCaptureTap(apbNum, false);
+    cancel_work_sync(&tap->xrunWork);
+    dmaengine_terminate_sync(tap->dma_chan);
+    dma_release_channel(tap->dma_chan);
+    tap->dma_chan = NULL;
+    if (tap->tapRing != NULL) {
+        tap->tapRing->inUse = false;
+        tap->tapRing = NULL;
+    }
+    tap->state = DMA_STATE_IDLE;
 }
 
-int32_t T507AudioDmaPointer(struct PlatformData *data, const enum AudioStreamType streamType, uint32_t *pointer)
+static void audio_dma_release_channels(struct DmaRuntimeData *prtd)
 {
-    struct dma_chan *dmaChan;
-    struct dma_tx_state state;
-    enum dma_status status;
-    uint32_t buf_size;
-    uint32_t pos = 0;
+    int i;
 
-    if (data == NULL || pointer == NULL) {
-        AUDIO_DRIVER_LOG_ERR("data is null");
-        return HDF_FAILURE;
+    for (i = 0; i < AHUB_APBIF_NUM; i++) {
+        audio_dma_tap_stop(&prtd->tap[i], i);
     }
 
-    if (streamType == AUDIO_RENDER_STREAM) {
-        dmaChan = g_prtd.dma_chan[DMA_STREAM_TX];
-        buf_size = data->renderBufInfo.cirBufSize;
-        status = dmaengine_tx_status(dmaChan, g_prtd.cookie[DMA_STREAM_TX], &state);
-        if (status == DMA_IN_PROGRESS || status == DMA_PAUSED) {
-            if (state.residue > 0 && state.residue <= buf_size) {
-                pos = buf_size - state.residue;
-            }
+    for (i = 0; i < DMA_STREAM_CNT; i++) {
+        if (prtd->stream[i].dma_chan != NULL) {
+            cancel_work_sync(&prtd->stream[i].xrunWork);
+            dmaengine_terminate_sync(prtd->stream[i].dma_chan);
+            dma_release_channel(prtd->stream[i].dma_chan);
+            prtd->stream[i].dma_chan = NULL;
         }
-        *pointer = BytesToFrames(data->renderPcmInfo.frameSize, pos);
-    } else if (streamType == AUDIO_CAPTURE_STREAM) {
-        dmaChan = g_prtd.dma_chan[DMA_STREAM_RX];
-        buf_size = data->captureBufInfo.cirBufSize;
-        status = dmaengine_tx_status(dmaChan, g_prtd.cookie[DMA_STREAM_RX], &state);
-        if (status == DMA_IN_PROGRESS || status == DMA_PAUSED) {
-            if (state.residue > 0 && state.residue <= buf_size) {
-                pos = buf_size - state.residue;
-            }
+    }
+}
+
+/* memory a user vma may still map: the reserved rings and the status pages */
+static void audio_dma_release_mem(struct DmaRuntimeData *prtd)
+{
+    int i;
+
+    for (i = 0; i < DMA_STREAM_CNT; i++) {
+        audio_dma_pool_free(&prtd->stream[i]);
+        audio_dma_cached_release(&prtd->stream[i]);
+        if (prtd->stream[i].status != NULL) {
+            free_page((unsigned long)prtd->stream[i].status);
+            prtd->stream[i].status = NULL;
         }
-        *pointer = BytesToFrames(data->capturePcmInfo.frameSize, pos);
-    } else {
-        AUDIO_DRIVER_LOG_ERR("stream Type is fail.");
-        return HDF_FAILURE;
     }
+    for (i = 0; i < (int)prtd->tapPools; i++) {
+        audio_dma_pool_release(prtd->stream[DMA_STREAM_RX].dma_dev, &prtd->tapPool[i]);
+    }
+    prtd->tapPools = 0;
+    for (i = 0; i < AHUB_APBIF_NUM; i++) {
+        if (prtd->tap[i].status != NULL) {
+            free_page((unsigned long)prtd->tap[i].status);
+            prtd->tap[i].status = NULL;
+        }
+    }
+}
 
-    return HDF_SUCCESS;
+static void audio_dma_release(struct DmaRuntimeData *prtd)
+{
+    audio_dma_release_channels(prtd);
+    audio_dma_release_mem(prtd);
+}
+
+static void audio_dma_put(struct DmaRuntimeData *prtd)
+{
+    if (atomic_dec_and_test(&prtd->refs)) {
+        audio_dma_release_mem(prtd);
+        kfree(prtd);
+    }
+}
+
+static int audio_dma_request(struct DmaRuntimeData *prtd)
+{
+    bool txOnAhub = (prtd->renderSink == DMA_SINK_AHUB);
+    bool rxOnAhub = (prtd->captureSource == DMA_SRC_AHUB);
+
+    /* note: for internal codec, or the ahub tx apbif */
+    if (audio_dma_stream_request(&prtd->stream[DMA_STREAM_TX], txOnAhub ? g_ahub_dtstreepath : g_codec_dtstreepath,
+        AUDIO_RENDER_STREAM) != HDF_SUCCESS) {
+        goto err_request;
+    }
+    prtd->stream[DMA_STREAM_TX].onAhub = txOnAhub;
+
+    /* note: for ahub (i2s with hub function), or the internal codec adc */
+    if (audio_dma_stream_request(&prtd->stream[DMA_STREAM_RX], rxOnAhub ? g_ahub_dtstreepath : g_codec_dtstreepath,
+        AUDIO_CAPTURE_STREAM) != HDF_SUCCESS) {
+        goto err_request;
+    }
+    prtd->stream[DMA_STREAM_RX].onAhub = rxOnAhub;
+
+    return HDF_SUCCESS;
+
+err_request:
+    audio_dma_release(prtd);
+    return HDF_FAILURE;
+}
+
+/* optional switches on the platform HCS node, all off when absent */
+static void audio_dma_get_config(const struct PlatformDevice *platformDevice, struct DmaRuntimeData *prtd)
+{
+    struct DeviceResourceIface *drsOps;
+    const struct DeviceResourceNode *node;
+    uint32_t taps = 0;
+
+    if (platformDevice->device == NULL || platformDevice->device->property == NULL) {
+        return;
+    }
+    node = platformDevice->device->property;
+    drsOps = DeviceResourceGetIfaceInstance(HDF_CONFIG_SOURCE);
+    if (drsOps == NULL || drsOps->GetBool == NULL || drsOps->GetUint32 == NULL) {
+        AUDIO_DRIVER_LOG_ERR("get drsops object instance fail!");
+        return;
+    }
+
+    prtd->stream[DMA_STREAM_TX].lowLatency = drsOps->GetBool(node, "lowLatencyRender");
+    prtd->stream[DMA_STREAM_RX].lowLatency = drsOps->GetBool(node, "lowLatencyCapture");
+    prtd->stream[DMA_STREAM_RX].cached = drsOps->GetBool(node, "cachedCapture");
+    /* rings for T507AudioDmaTapStart, taps copy the ahub capture so a codec card has none */
+    (void)drsOps->GetUint32(node, "captureTaps", &taps, 0);
+    if (prtd->captureSource == DMA_SRC_AHUB) {
+        prtd->tapPools = min_t(uint32_t, taps, ARRAY_SIZE(prtd->tapPool));
+    }
+}
+
+/* optional, a card without it works the same */
+static void audio_dma_debugfs_init(struct DmaRuntimeData *prtd, const char *name)
+{
+    char dirName[T507_DMA_DEBUGFS_NAME_LEN];
+    struct DmaBufPool *pool;
+
+    if (name == NULL) {
+        return;
+    }
+    snprintf(dirName, sizeof(dirName), "t507_dma_%s", name);
+    prtd->debugfs_dir = debugfs_create_dir(dirName, NULL);
+    if (IS_ERR_OR_NULL(prtd->debugfs_dir)) {
+        prtd->debugfs_dir = NULL;
+        return;
+    }
+    /* BufAlloc served from the init reservation vs. allocated on open */
+    pool = &prtd->stream[DMA_STREAM_TX].pool;
+    debugfs_create_u32("render_pool_hits", 0444, prtd->debugfs_dir, &pool->hits);
+    debugfs_create_u32("render_pool_misses", 0444, prtd->debugfs_dir, &pool->misses);
+    pool = &prtd->stream[DMA_STREAM_RX].pool;
+    debugfs_create_u32("capture_pool_hits", 0444, prtd->debugfs_dir, &pool->hits);
+    debugfs_create_u32("capture_pool_misses", 0444, prtd->debugfs_dir, &pool->misses);
+}
+
+static int32_t audio_dma_device_init(const struct AudioCard *card, const struct PlatformDevice *platformDevice,
+    enum DmaRenderSink renderSink, enum DmaCaptureSource captureSource)
+{
+    int ret;
+    uint32_t i;
+    struct DmaRuntimeData *prtd;
+
+    AUDIO_DRIVER_LOG_DEBUG("entry");
+
+    if (card == NULL || platformDevice == NULL || platformDevice->devData == NULL) {
+        AUDIO_DRIVER_LOG_ERR("platformDevice is NULL.");
+        return HDF_FAILURE;
+    }
+    if (platformDevice->devData->platformInitFlag == true) {
+        AUDIO_DRIVER_LOG_ERR("platform init complete!");
+        return HDF_SUCCESS;
+    }
+
+    prtd = kzalloc(sizeof(*prtd), GFP_KERNEL);
+    if (prtd == NULL) {
+        AUDIO_DRIVER_LOG_ERR("alloc dma runtime failed");
+        return HDF_FAILURE;
+    }
+    prtd->renderSink = renderSink;
+    prtd->captureSource = captureSource;
+    prtd->stream[DMA_STREAM_TX].owner = prtd;
+    prtd->stream[DMA_STREAM_RX].owner = prtd;
+    for (i = 0; i < AHUB_APBIF_NUM; i++) {
+        prtd->tap[i].owner = prtd;
+    }
+    mutex_init(&prtd->tapLock);
+    atomic_set(&prtd->refs, 1);
+
+    /* note: include internal codec and ahub */
+    ret = audio_dma_request(prtd);
+    if (ret < 0) {
+        AUDIO_DRIVER_LOG_ERR("audio_dma_request failed");
+        kfree(prtd);
+        return HDF_FAILURE;
+    }
+    audio_dma_get_config(platformDevice, prtd);
+
+    /* reserve the rings now, while CMA is still unfragmented */
+    audio_dma_pool_alloc(&prtd->stream[DMA_STREAM_TX],
+        max_t(uint32_t, platformDevice->devData->renderBufInfo.cirBufMax, T507_DMA_POOL_BUF_SIZE));
+    audio_dma_pool_alloc(&prtd->stream[DMA_STREAM_RX],
+        max_t(uint32_t, platformDevice->devData->captureBufInfo.cirBufMax, T507_DMA_POOL_BUF_SIZE));
+    /* high-order pages, only for cards configured for it; SetCached reserves late otherwise */
+    if (prtd->stream[DMA_STREAM_RX].cached) {
+        audio_dma_cached_reserve(&prtd->stream[DMA_STREAM_RX],
+            max_t(uint32_t, platformDevice->devData->captureBufInfo.cirBufMax, T507_DMA_POOL_BUF_SIZE));
+    }
+    for (i = 0; i < prtd->tapPools; i++) {
+        audio_dma_pool_reserve(prtd->stream[DMA_STREAM_RX].dma_dev, &prtd->tapPool[i],
+            max_t(uint32_t, platformDevice->devData->captureBufInfo.cirBufMax, T507_DMA_POOL_BUF_SIZE));
+    }
+
+    platformDevice->devData->dmaPrv = prtd;
+    platformDevice->devData->platformInitFlag = true;
+    prtd->cdev = T507AudioDmaCdevCreate(platformDevice->devData);
+    audio_dma_debugfs_init(prtd, platformDevice->devData->drvPlatformName);
+    AUDIO_DRIVER_LOG_DEBUG("success.");
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaDeviceInit(const struct AudioCard *card, const struct PlatformDevice *platformDevice)
+{
+    return audio_dma_device_init(card, platformDevice, DMA_SINK_CODEC, DMA_SRC_AHUB);
+}
+
+/* platform of a second card whose render stream feeds the ahub i2s instead of the codec */
+int32_t T507AudioDmaAhubDeviceInit(const struct AudioCard *card, const struct PlatformDevice *platformDevice)
+{
+    return audio_dma_device_init(card, platformDevice, DMA_SINK_AHUB, DMA_SRC_AHUB);
+}
+
+/* platform of a card that plays and records on the internal codec only, boards without ac107 */
+int32_t T507AudioDmaCodecDeviceInit(const struct AudioCard *card, const struct PlatformDevice *platformDevice)
+{
+    return audio_dma_device_init(card, platformDevice, DMA_SINK_CODEC, DMA_SRC_CODEC);
+}
+
+bool T507AudioDmaRenderToAhub(const struct PlatformData *data)
+{
+    if (data == NULL || data->dmaPrv == NULL) {
+        return false;
+    }
+
+    return ((struct DmaRuntimeData *)data->dmaPrv)->renderSink == DMA_SINK_AHUB;
+}
+
+bool T507AudioDmaCaptureFromCodec(const struct PlatformData *data)
+{
+    if (data == NULL || data->dmaPrv == NULL) {
+        return false;
+    }
+
+    return ((struct DmaRuntimeData *)data->dmaPrv)->captureSource == DMA_SRC_CODEC;
+}
+
+void T507AudioDmaDeviceRelease(struct PlatformData *data)
+{
+    struct DmaRuntimeData *prtd;
+
+    if (data == NULL || data->dmaPrv == NULL) {
+        return;
+    }
+    prtd = (struct DmaRuntimeData *)data->dmaPrv;
+
+    /* no new ioctl or mmap reaches the streams after this */
+    T507AudioDmaCdevDestroy(prtd->cdev);
+    prtd->cdev = NULL;
+    debugfs_remove_recursive(prtd->debugfs_dir);
+    prtd->debugfs_dir = NULL;
+    /* a HAL still holding an mmap keeps the memory until its munmap */
+    audio_dma_release_channels(prtd);
+    data->dmaPrv = NULL;
+    audio_dma_put(prtd);
+    data->platformInitFlag = false;
+}
+
+int32_t T507AudioDmaBufAlloc(struct PlatformData *data, const enum AudioStreamType streamType)
+{
+    struct DmaStreamRuntime *stream;
+    struct CircleBufInfo *bufInfo;
+
+    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+
+    if (data == NULL) {
+        AUDIO_DRIVER_LOG_ERR("data is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+    bufInfo = (streamType == AUDIO_RENDER_STREAM) ? &data->renderBufInfo : &data->captureBufInfo;
+
+    if (bufInfo->virtAddr == NULL && stream->cached && streamType == AUDIO_CAPTURE_STREAM) {
+        if (stream->cachedPool.virtAddr != NULL && !stream->cachedPool.inUse &&
+            bufInfo->cirBufMax <= stream->cachedPool.size) {
+            stream->cachedPool.inUse = true;
+            bufInfo->virtAddr = stream->cachedPool.virtAddr;
+            bufInfo->phyAddr = stream->cachedPool.phyAddr;
+            stream->bufSource = DMA_BUF_CACHED;
+        } else {
+            AUDIO_DRIVER_LOG_ERR("no cached ring reserved for %u bytes, use write-combined", bufInfo->cirBufMax);
+        }
+    }
+    if (bufInfo->virtAddr == NULL && stream->lowLatency && stream->sram != NULL) {
+        bufInfo->virtAddr = gen_pool_dma_alloc(stream->sram, bufInfo->cirBufMax, (dma_addr_t *)&bufInfo->phyAddr);
+        if (bufInfo->virtAddr != NULL) {
+            stream->bufSource = DMA_BUF_SRAM;
+        } else {
+            AUDIO_DRIVER_LOG_DEBUG("sram too small for %u bytes, use dram", bufInfo->cirBufMax);
+        }
+    }
+    if (bufInfo->virtAddr == NULL) {
+        if (stream->pool.virtAddr != NULL && !stream->pool.inUse && bufInfo->cirBufMax <= stream->pool.size) {
+            stream->pool.inUse = true;
+            stream->pool.hits++;
+            bufInfo->virtAddr = stream->pool.virtAddr;
+            bufInfo->phyAddr = stream->pool.phyAddr;
+            stream->bufSource = DMA_BUF_POOL;
+        } else {
+            stream->pool.misses++;
+            bufInfo->virtAddr = dma_alloc_wc(stream->dma_dev, bufInfo->cirBufMax,
+                                             (dma_addr_t *)&bufInfo->phyAddr, GFP_DMA | GFP_KERNEL);
+            if (bufInfo->virtAddr == NULL) {
+                AUDIO_DRIVER_LOG_ERR("dma_alloc_wc faild");
+                return HDF_FAILURE;
+            }
+            stream->bufSource = DMA_BUF_DRAM;
+        }
+    }
+    stream->state = DMA_STATE_READY;
+
+    AUDIO_DRIVER_LOG_DEBUG("success.");
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaBufFree(struct PlatformData *data, const enum AudioStreamType streamType)
+{
+    struct DmaStreamRuntime *stream;
+    struct CircleBufInfo *bufInfo;
+
+    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+
+    if (data == NULL) {
+        AUDIO_DRIVER_LOG_ERR("data is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+    bufInfo = (streamType == AUDIO_RENDER_STREAM) ? &data->renderBufInfo : &data->captureBufInfo;
+
+    if (atomic_read(&stream->ringMaps) != 0) {
+        AUDIO_DRIVER_LOG_ERR("streamType %d ring still mapped by userspace", streamType);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+
+    cancel_work_sync(&stream->xrunWork);
+    if (stream->state == DMA_STATE_RUNNING || stream->state == DMA_STATE_PAUSED) {
+        dmaengine_terminate_sync(stream->dma_chan);
+    }
+
+    switch (stream->bufSource) {
+        case DMA_BUF_POOL:
+            stream->pool.inUse = false;
+            break;
+        case DMA_BUF_DRAM:
+            dma_free_wc(stream->dma_dev, bufInfo->cirBufMax, bufInfo->virtAddr, bufInfo->phyAddr);
+            break;
+        case DMA_BUF_SRAM:
+            gen_pool_free(stream->sram, (unsigned long)bufInfo->virtAddr, bufInfo->cirBufMax);
+            break;
+        case DMA_BUF_CACHED:
+            stream->cachedPool.inUse = false;
+            break;
+        default:
+            break;
+    }
+    stream->bufSource = DMA_BUF_NONE;
+    bufInfo->virtAddr = NULL;
+    bufInfo->phyAddr = 0;
+    stream->state = DMA_STATE_IDLE;
+    stream->mmapMode = false;
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaRequestChannel(const struct PlatformData *data, const enum AudioStreamType streamType)
+{
+    (void)data;
+    AUDIO_DRIVER_LOG_DEBUG("entry");
+    return HDF_SUCCESS;
+}
+
+static enum dma_slave_buswidth audio_dma_bus_width(uint32_t bitWidth)
+{
+    switch (bitWidth) {
+        case 8:
+            return DMA_SLAVE_BUSWIDTH_1_BYTE;
+        case 16:
+            return DMA_SLAVE_BUSWIDTH_2_BYTES;
+        case 24:
+        case 32:
+            /* 24 bit samples sit in a 32 bit container in both FIFOs */
+            return DMA_SLAVE_BUSWIDTH_4_BYTES;
+        default:
+            return DMA_SLAVE_BUSWIDTH_UNDEFINED;
+    }
+}
+
+/*
+ * Low latency streams interrupt every T507_DMA_LL_PERIOD_US regardless of the
+ * ADM period; the ADM only sees a finer grained pointer. Falls back to the ADM
+ * period when the ring is not a whole number of short periods.
+ */
+static uint32_t audio_dma_low_latency_period(uint32_t frameSize, uint32_t rate, uint32_t bufBytes,
+    uint32_t admPeriod)
+{
+    uint32_t bytes;
+
+    if (frameSize == 0) {
+        return admPeriod;
+    }
+    bytes = DIV_ROUND_UP(rate * T507_DMA_LL_PERIOD_US, USEC_PER_SEC) * frameSize;
+    if (bytes == 0 || bytes >= admPeriod || (bufBytes % bytes) != 0) {
+        return admPeriod;
+    }
+
+    return bytes;
+}
+
+/*
+ * Largest burst the controller supports that keeps a quarter of the FIFO
+ * trigger level as headroom, spans no more than one frame (but never less
+ * than the old fixed burst of 4) and divides the period the stream will
+ * actually run with. A 16 channel 32 bit TDM frame moves in one burst of 16,
+ * 8 channels use 8 and stereo stays at 4.
+ */
+static uint32_t audio_dma_select_burst(const struct DmaStreamRuntime *stream, uint32_t fifoLevel,
+    uint32_t width, uint32_t channels, uint32_t periodBytes)
+{
+    static const uint32_t bursts[] = { 16, 8, 4, 1 };
+    uint32_t i;
+
+    if (stream->burstOverride != 0) {
+        return stream->burstOverride;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(bursts); i++) {
+        if (bursts[i] > fifoLevel / 4 || bursts[i] > max_t(uint32_t, channels, 4)) {
+            continue;
+        }
+        if (periodBytes != 0 && (periodBytes % (bursts[i] * width)) != 0) {
+            continue;
+        }
+        return bursts[i];
+    }
+
+    return 1;
+}
+
+/* render streams write to fifoAddr, capture streams read from it */
+static int32_t audio_dma_slave_config(struct DmaStreamRuntime *stream, const struct PcmInfo *pcmInfo,
+    const struct CircleBufInfo *bufInfo, uint32_t fifoLevel, dma_addr_t fifoAddr, uint32_t slaveId)
+{
+    struct dma_slave_config slaveConfig;
+    enum dma_slave_buswidth width;
+    uint32_t bytesPerSec;
+    uint32_t periodBytes;
+    int ret;
+
+    width = audio_dma_bus_width(pcmInfo->bitWidth);
+    if (width == DMA_SLAVE_BUSWIDTH_UNDEFINED) {
+        AUDIO_DRIVER_LOG_ERR("unsupport bitWidth -> %u", pcmInfo->bitWidth);
+        return HDF_FAILURE;
+    }
+    periodBytes = bufInfo->periodSize;
+    if (stream->lowLatency) {
+        periodBytes = audio_dma_low_latency_period(pcmInfo->frameSize, pcmInfo->rate, bufInfo->cirBufSize,
+            periodBytes);
+    }
+    stream->maxburst = audio_dma_select_burst(stream, fifoLevel, width, pcmInfo->channels, periodBytes);
+
+    (void)memset_s(&slaveConfig, sizeof(slaveConfig), 0, sizeof(slaveConfig));
+    slaveConfig.src_addr_width = width;
+    slaveConfig.dst_addr_width = width;
+    if (stream->streamType == AUDIO_RENDER_STREAM) {
+        slaveConfig.direction = DMA_MEM_TO_DEV;
+        slaveConfig.dst_maxburst = stream->maxburst;
+        slaveConfig.dst_addr = fifoAddr;
+    } else {
+        slaveConfig.direction = DMA_DEV_TO_MEM;
+        slaveConfig.src_maxburst = stream->maxburst;
+        slaveConfig.src_addr = fifoAddr;
+    }
+    slaveConfig.slave_id = slaveId;
+    slaveConfig.device_fc = false;
+
+    ret = dmaengine_slave_config(stream->dma_chan, &slaveConfig);
+    if (ret != 0) {
+        AUDIO_DRIVER_LOG_ERR("dmaengine_slave_config failed");
+        return HDF_FAILURE;
+    }
+
+    /* fifo side bursts per second follow from the format, each one is a drq handshake */
+    bytesPerSec = pcmInfo->channels * width * pcmInfo->rate;
+    AUDIO_DRIVER_LOG_DEBUG("streamType %d width %d ch %u period %u burst %u: %u bursts/s (burst 4: %u)",
+        stream->streamType, width, pcmInfo->channels, periodBytes, stream->maxburst,
+        bytesPerSec / (stream->maxburst * width), bytesPerSec / (4 * width));
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaConfigChannel(const struct PlatformData *data, const enum AudioStreamType streamType)
+{
+    struct DmaStreamRuntime *stream;
+    const struct PcmInfo *pcmInfo;
+    const struct CircleBufInfo *bufInfo;
+    uint32_t fifoLevel;
+    uint32_t apbNum = 0;
+
+    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+
+    if (data == NULL) {
+        AUDIO_DRIVER_LOG_ERR("data is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+
+    if (streamType == AUDIO_RENDER_STREAM) {
+        pcmInfo = &data->renderPcmInfo;
+        bufInfo = &data->renderBufInfo;
+        fifoLevel = stream->onAhub ? T507_AHUB_TXFIFO_LEVEL : T507_CODEC_TXFIFO_LEVEL;
+    } else {
+        pcmInfo = &data->capturePcmInfo;
+        bufInfo = &data->captureBufInfo;
+        fifoLevel = stream->onAhub ? T507_AHUB_RXFIFO_LEVEL : T507_CODEC_RXFIFO_LEVEL;
+    }
+    /* the apbif the ahub dai programs, from its dts apb-num */
+    if (stream->onAhub && (T507AhubImplApbNum(&apbNum) != HDF_SUCCESS || apbNum >= AHUB_APBIF_NUM)) {
+        AUDIO_DRIVER_LOG_ERR("ahub apbif unknown");
+        return HDF_FAILURE;
+    }
+
+    if (streamType == AUDIO_RENDER_STREAM && stream->onAhub) {
+        return audio_dma_slave_config(stream, pcmInfo, bufInfo, fifoLevel,
+            SUNXI_AHUB_ADDR_BASE + SUNXI_AHUB_APBIF_TXFIFO(apbNum), sunxi_slave_id(g_ahub_drq_tx[apbNum], DRQSRC_SDRAM));
+    }
+    if (streamType == AUDIO_RENDER_STREAM) {
+        return audio_dma_slave_config(stream, pcmInfo, bufInfo, fifoLevel,
+            SUNXI_CODEC_ADDR_BASE + SUNXI_DAC_TXDATA, sunxi_slave_id(DRQDST_AUDIO_CODEC, DRQSRC_SDRAM));
+    }
+    if (!stream->onAhub) {
+        return audio_dma_slave_config(stream, pcmInfo, bufInfo, fifoLevel,
+            SUNXI_CODEC_ADDR_BASE + SUNXI_ADC_RXDATA, sunxi_slave_id(DRQDST_SDRAM, DRQSRC_AUDIO_CODEC));
+    }
+    return audio_dma_slave_config(stream, pcmInfo, bufInfo, fifoLevel,
+        SUNXI_AHUB_ADDR_BASE + SUNXI_AHUB_APBIF_RXFIFO(apbNum), sunxi_slave_id(DRQDST_SDRAM, g_ahub_drq_rx[apbNum]));
+}
+
+int32_t T507AudioDmaSetBurst(const struct PlatformData *data, const enum AudioStreamType streamType,
+    uint32_t maxburst)
+{
+    struct DmaStreamRuntime *stream;
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+    if (maxburst != 0 && maxburst != 1 && maxburst != 4 && maxburst != 8 && maxburst != 16) {
+        AUDIO_DRIVER_LOG_ERR("unsupport maxburst -> %u", maxburst);
+        return HDF_ERR_INVALID_PARAM;
+    }
+    /* takes effect at the next DmaConfigChannel */
+    stream->burstOverride = maxburst;
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaPrep(const struct PlatformData *data, const enum AudioStreamType streamType)
+{
+    (void)data;
+    AUDIO_DRIVER_LOG_DEBUG("entry");
+    return HDF_SUCCESS;
+}
+
+/* latch the ring geometry and rewind the position, descriptors are queued by the caller */
+static int32_t audio_dma_stream_setup(struct DmaStreamRuntime *stream, enum dma_transfer_direction direction,
+    dma_addr_t phyAddr, uint32_t bufBytes, uint32_t periodBytes, const struct PcmInfo *pcmInfo)
+{
+    if (periodBytes == 0 || bufBytes < periodBytes) {
+        AUDIO_DRIVER_LOG_ERR("invalid ring: cirBufSize %u periodSize %u", bufBytes, periodBytes);
+        return HDF_FAILURE;
+    }
+    stream->phyAddr = phyAddr;
+    stream->direction = direction;
+    stream->bufBytes = bufBytes;
+    stream->periodBytes = periodBytes;
+    stream->frameSize = pcmInfo->frameSize;
+    stream->bytesPerSec = pcmInfo->frameSize * pcmInfo->rate;
+    if (stream->lowLatency) {
+        stream->periodBytes = audio_dma_low_latency_period(pcmInfo->frameSize, pcmInfo->rate, bufBytes,
+            periodBytes);
+    }
+
+    if (stream->bufSource == DMA_BUF_CACHED) {
+        dma_sync_single_for_device(stream->dma_dev, stream->phyAddr, stream->bufBytes, DMA_FROM_DEVICE);
+    }
+
+    audio_dma_stream_reset_pos(stream);
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaSubmit(const struct PlatformData *data, const enum AudioStreamType streamType)
+{
+    struct DmaStreamRuntime *stream;
+    const struct CircleBufInfo *bufInfo;
+    const struct PcmInfo *pcmInfo;
+    enum dma_transfer_direction direction;
+
+    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+
+    if (streamType == AUDIO_RENDER_STREAM) {
+        direction = DMA_MEM_TO_DEV;
+        bufInfo = &data->renderBufInfo;
+        pcmInfo = &data->renderPcmInfo;
+    } else {
+        direction = DMA_DEV_TO_MEM;
+        bufInfo = &data->captureBufInfo;
+        pcmInfo = &data->capturePcmInfo;
+    }
+
+    if (audio_dma_stream_setup(stream, direction, bufInfo->phyAddr, bufInfo->cirBufSize,
+        bufInfo->periodSize, pcmInfo) != HDF_SUCCESS) {
+        return HDF_FAILURE;
+    }
+    if (audio_dma_stream_prep(stream, 0) != 0) {
+        return -ENOMEM;
+    }
+
+    AUDIO_DRIVER_LOG_DEBUG("success!");
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaPending(struct PlatformData *data, const enum AudioStreamType streamType)
+{
+    struct DmaStreamRuntime *stream;
+
+    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+
+    if (data == NULL) {
+        AUDIO_DRIVER_LOG_ERR("data is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+
+    audio_dma_stream_reset_pos(stream);
+    dma_async_issue_pending(stream->dma_chan);
+    stream->state = DMA_STATE_RUNNING;
+    AUDIO_DRIVER_LOG_DEBUG("dmaChan chan_id = %d.", stream->dma_chan->chan_id);
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaPause(struct PlatformData *data, const enum AudioStreamType streamType)
+{
+    struct DmaStreamRuntime *stream;
+
+    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+
+    if (data == NULL) {
+        AUDIO_DRIVER_LOG_ERR("data is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+
+    if (stream->state != DMA_STATE_RUNNING) {
+        return HDF_SUCCESS;
+    }
+    cancel_work_sync(&stream->xrunWork);
+
+    stream->pauseNs = ktime_get_ns();
+    if (!stream->canPause || dmaengine_pause(stream->dma_chan) != 0) {
+        /* resume restarts from the last period boundary, see audio_dma_stream_prep */
+        dmaengine_terminate_async(stream->dma_chan);
+        stream->needSubmit = true;
+    }
+    stream->state = DMA_STATE_PAUSED;
+    wake_up_interruptible(&stream->periodWait);
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaResume(const struct PlatformData *data, const enum AudioStreamType streamType)
+{
+    struct DmaStreamRuntime *stream;
+    uint64_t pausedNs;
+    unsigned long flags;
+
+    AUDIO_DRIVER_LOG_DEBUG("streamType = %d", streamType);
+
+    if (data == NULL) {
+        AUDIO_DRIVER_LOG_ERR("data is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+    if (stream->state != DMA_STATE_PAUSED) {
+        return HDF_SUCCESS;
+    }
+
+    if (!stream->needSubmit && dmaengine_resume(stream->dma_chan) == 0) {
+        /* the ring did not move while paused, keep interpolation continuous */
+        pausedNs = ktime_get_ns() - stream->pauseNs;
+        write_seqlock_irqsave(&stream->seq, flags);
+        stream->tstampNs += pausedNs;
+        write_sequnlock_irqrestore(&stream->seq, flags);
+    } else {
+        if (!stream->needSubmit) {
+            dmaengine_terminate_async(stream->dma_chan);
+        }
+        dmaengine_synchronize(stream->dma_chan);
+        /* hwPos is a period boundary, restart there so the pointer stays continuous */
+        audio_dma_stream_set_pos(stream, stream->hwPos, ktime_get_ns());
+        if (audio_dma_stream_prep(stream, stream->hwPos) != 0) {
+            AUDIO_DRIVER_LOG_ERR("resubmit at offset %u failed", stream->hwPos);
+            return HDF_FAILURE;
+        }
+        dma_async_issue_pending(stream->dma_chan);
+    }
+    stream->state = DMA_STATE_RUNNING;
+    wake_up_interruptible(&stream->periodWait);
+
+    return HDF_SUCCESS;
+}
+
+static inline signed long BytesToFrames(uint32_t frameSize, uint32_t size)
+{
+    if (frameSize == 0 || size == 0) {
+        return 0;
+    }
+
+    return size / frameSize;
+}
+
+int32_t T507AudioDmaPointer(struct PlatformData *data, const enum AudioStreamType streamType, uint32_t *pointer)
+{
+    struct DmaStreamRuntime *stream;
+
+    if (data == NULL || pointer == NULL) {
+        AUDIO_DRIVER_LOG_ERR("data is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+
+    *pointer = BytesToFrames(stream->frameSize, audio_dma_stream_pos(stream, NULL));
+    if (trace_t507_audio_dma_pointer_enabled()) {
+        trace_t507_audio_dma_pointer(audio_dma_trace_dev(stream), streamType == AUDIO_RENDER_STREAM,
+                                     *pointer, audio_dma_residue(stream));
+    }
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaGetTimestamp(struct PlatformData *data, const enum AudioStreamType streamType,
+    uint32_t *frames, uint64_t *tstampNs)
+{
+    struct DmaStreamRuntime *stream;
+
+    if (data == NULL || frames == NULL || tstampNs == NULL) {
+        AUDIO_DRIVER_LOG_ERR("input param is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+
+    *frames = BytesToFrames(stream->frameSize, audio_dma_stream_pos(stream, tstampNs));
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaWaitPeriod(struct PlatformData *data, const enum AudioStreamType streamType, uint32_t timeoutMs)
+{
+    struct DmaStreamRuntime *stream;
+    int periods;
+    long ret;
+
+    if (data == NULL) {
+        AUDIO_DRIVER_LOG_ERR("data is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+    if (stream->state != DMA_STATE_RUNNING) {
+        return HDF_FAILURE;
+    }
+
+    periods = atomic_read(&stream->periodsElapsed);
+    ret = wait_event_interruptible_timeout(stream->periodWait,
+        atomic_read(&stream->periodsElapsed) != periods || stream->state != DMA_STATE_RUNNING,
+        msecs_to_jiffies(timeoutMs));
+    if (ret == 0) {
+        return HDF_ERR_TIMEOUT;
+    } else if (ret < 0) {
+        return HDF_FAILURE;
+    }
+
+    return HDF_SUCCESS;
+}
+
+/* every user vma holds the card runtime, ring vmas also pin the ring against BufFree */
+static void audio_dma_status_vm_open(struct vm_area_struct *vma)
+{
+    struct DmaStreamRuntime *stream = vma->vm_private_data;
+
+    atomic_inc(&stream->owner->refs);
+}
+
+static void audio_dma_status_vm_close(struct vm_area_struct *vma)
+{
+    struct DmaStreamRuntime *stream = vma->vm_private_data;
+
+    audio_dma_put(stream->owner);
+}
+
+static void audio_dma_ring_vm_open(struct vm_area_struct *vma)
+{
+    struct DmaStreamRuntime *stream = vma->vm_private_data;
+
+    atomic_inc(&stream->ringMaps);
+    atomic_inc(&stream->owner->refs);
+}
+
+static void audio_dma_ring_vm_close(struct vm_area_struct *vma)
+{
+    struct DmaStreamRuntime *stream = vma->vm_private_data;
+
+    atomic_dec(&stream->ringMaps);
+    audio_dma_put(stream->owner);
+}
+
+static const struct vm_operations_struct g_dma_status_vm_ops = {
+    .open = audio_dma_status_vm_open,
+    .close = audio_dma_status_vm_close,
+};
+
+static const struct vm_operations_struct g_dma_ring_vm_ops = {
+    .open = audio_dma_ring_vm_open,
+    .close = audio_dma_ring_vm_close,
+};
+
+/* what a ring mapping covers: the memory, its reserved size and the running geometry */
+struct DmaMmapRing {
+    void *virtAddr;
+    dma_addr_t phyAddr;
+    uint32_t mapMax;
+    uint32_t bufBytes;
+    uint32_t periodBytes;
+    uint32_t frameSize;
+};
+
+static int32_t audio_dma_stream_mmap(struct DmaStreamRuntime *stream, const struct DmaMmapRing *ring,
+    struct vm_area_struct *vma)
+{
+    unsigned long size;
+    bool isStatus;
+    int ret;
+
+    /* remap_pfn_range may rewrite vm_pgoff, decide on the original */
+    isStatus = (vma->vm_pgoff == T507_DMA_MMAP_STATUS_PGOFF);
+    size = vma->vm_end - vma->vm_start;
+
+    if (isStatus) {
+        if (size != PAGE_SIZE || stream->status == NULL) {
+            AUDIO_DRIVER_LOG_ERR("status page map size %lu invalid", size);
+            return HDF_ERR_INVALID_PARAM;
+        }
+        ret = remap_pfn_range(vma, vma->vm_start, virt_to_phys(stream->status) >> PAGE_SHIFT,
+                              PAGE_SIZE, vma->vm_page_prot);
+    } else if (vma->vm_pgoff == 0) {
+        if (ring->virtAddr == NULL || size > PAGE_ALIGN(ring->mapMax)) {
+            AUDIO_DRIVER_LOG_ERR("ring map size %lu invalid", size);
+            return HDF_ERR_INVALID_PARAM;
+        }
+        if (stream->bufSource == DMA_BUF_SRAM) {
+            ret = remap_pfn_range(vma, vma->vm_start, ring->phyAddr >> PAGE_SHIFT, size,
+                                  pgprot_writecombine(vma->vm_page_prot));
+        } else if (stream->bufSource == DMA_BUF_CACHED) {
+            ret = remap_pfn_range(vma, vma->vm_start, virt_to_phys(ring->virtAddr) >> PAGE_SHIFT, size,
+                                  vma->vm_page_prot);
+        } else {
+            ret = dma_mmap_wc(stream->dma_dev, vma, ring->virtAddr, ring->phyAddr, size);
+        }
+    } else {
+        AUDIO_DRIVER_LOG_ERR("pgoff %lu invalid", vma->vm_pgoff);
+        return HDF_ERR_INVALID_PARAM;
+    }
+    if (ret != 0) {
+        AUDIO_DRIVER_LOG_ERR("mmap pgoff %lu failed %d", vma->vm_pgoff, ret);
+        return HDF_FAILURE;
+    }
+
+    /* the core does not call open for the first vma */
+    vma->vm_private_data = stream;
+    if (isStatus) {
+        vma->vm_ops = &g_dma_status_vm_ops;
+        audio_dma_status_vm_open(vma);
+        return HDF_SUCCESS;
+    }
+    vma->vm_ops = &g_dma_ring_vm_ops;
+    audio_dma_ring_vm_open(vma);
+
+    stream->frameSize = ring->frameSize;
+    stream->status->bufferFrames = BytesToFrames(stream->frameSize, ring->bufBytes);
+    stream->status->periodFrames = BytesToFrames(stream->frameSize, ring->periodBytes);
+    stream->mmapMode = true;
+    audio_dma_status_publish(stream);
+
+    return HDF_SUCCESS;
+}
+
+static int32_t audio_dma_stream_app_ptr(const struct DmaStreamRuntime *stream, uint32_t *appPtr)
+{
+    if (!stream->mmapMode) {
+        return HDF_FAILURE;
+    }
+    *appPtr = READ_ONCE(stream->status->appPtr);
+
+    return HDF_SUCCESS;
+}
+
+/*
+ * Map the DMA ring (pgoff 0) or the status/control page (T507_DMA_MMAP_STATUS_PGOFF)
+ * of a stream into userspace. Once the ring is mapped the HAL reads and writes
+ * samples in place and follows hwPtr through the status page.
+ */
+int32_t T507AudioDmaMmap(struct PlatformData *data, const enum AudioStreamType streamType,
+    struct vm_area_struct *vma)
+{
+    struct DmaStreamRuntime *stream;
+    const struct CircleBufInfo *bufInfo;
+    struct DmaMmapRing ring;
+
+    if (data == NULL || vma == NULL) {
+        AUDIO_DRIVER_LOG_ERR("input param is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+    bufInfo = (streamType == AUDIO_RENDER_STREAM) ? &data->renderBufInfo : &data->captureBufInfo;
+    ring.virtAddr = bufInfo->virtAddr;
+    ring.phyAddr = bufInfo->phyAddr;
+    ring.mapMax = bufInfo->cirBufMax;
+    ring.bufBytes = bufInfo->cirBufSize;
+    ring.periodBytes = bufInfo->periodSize;
+    ring.frameSize = (streamType == AUDIO_RENDER_STREAM) ?
+        data->renderPcmInfo.frameSize : data->capturePcmInfo.frameSize;
+
+    return audio_dma_stream_mmap(stream, &ring, vma);
+}
+
+int32_t T507AudioDmaMmapAppPtr(const struct PlatformData *data, const enum AudioStreamType streamType,
+    uint32_t *appPtr)
+{
+    struct DmaStreamRuntime *stream;
+
+    if (data == NULL || appPtr == NULL) {
+        AUDIO_DRIVER_LOG_ERR("input param is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+
+    return audio_dma_stream_app_ptr(stream, appPtr);
+}
+
+int32_t T507AudioDmaGetXrunCount(const struct PlatformData *data, const enum AudioStreamType streamType,
+    uint32_t *count)
+{
+    struct DmaStreamRuntime *stream;
+
+    if (data == NULL || count == NULL) {
+        AUDIO_DRIVER_LOG_ERR("input param is null");
+        return HDF_FAILURE;
+    }
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+
+    *count = atomic_read(&stream->xrunCount);
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaSetLowLatency(const struct PlatformData *data, const enum AudioStreamType streamType,
+    bool enable)
+{
+    struct DmaStreamRuntime *stream;
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+    if (stream->state != DMA_STATE_IDLE) {
+        /* the ring placement is decided at BufAlloc */
+        AUDIO_DRIVER_LOG_ERR("streamType %d is open, close it first", streamType);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+    stream->lowLatency = enable;
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaSetCached(const struct PlatformData *data, const enum AudioStreamType streamType, bool enable)
+{
+    struct DmaStreamRuntime *stream;
+
+    stream = get_dma_stream(data, streamType);
+    if (stream == NULL) {
+        return HDF_FAILURE;
+    }
+    if (streamType != AUDIO_CAPTURE_STREAM) {
+        AUDIO_DRIVER_LOG_ERR("cached ring is capture only");
+        return HDF_ERR_NOT_SUPPORT;
+    }
+    if (stream->state != DMA_STATE_IDLE) {
+        AUDIO_DRIVER_LOG_ERR("streamType %d is open, close it first", streamType);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+    /* once reserved the ring stays until card release, BufAlloc may be looking at it */
+    if (enable && stream->cachedPool.virtAddr == NULL) {
+        audio_dma_cached_reserve(stream, max_t(uint32_t, data->captureBufInfo.cirBufMax, T507_DMA_POOL_BUF_SIZE));
+        if (stream->cachedPool.virtAddr == NULL) {
+            return HDF_FAILURE;
+        }
+    }
+    stream->cached = enable;
+
+    return HDF_SUCCESS;
+}
+
+static struct DmaStreamRuntime *get_dma_tap(const struct PlatformData *data, uint32_t apbNum)
+{
+    struct DmaRuntimeData *prtd;
+    uint32_t mainApb;
+
+    if (data == NULL || data->dmaPrv == NULL) {
+        AUDIO_DRIVER_LOG_ERR("dma runtime is null");
+        return NULL;
+    }
+    prtd = (struct DmaRuntimeData *)data->dmaPrv;
+    /* taps copy the ahub tdm input, a card recording from the codec has none */
+    if (prtd->captureSource != DMA_SRC_AHUB) {
+        AUDIO_DRIVER_LOG_ERR("card does not capture from the ahub, no taps");
+        return NULL;
+    }
+    if (T507AhubImplApbNum(&mainApb) != HDF_SUCCESS) {
+        AUDIO_DRIVER_LOG_ERR("ahub apbif unknown");
+        return NULL;
+    }
+    if (apbNum >= AHUB_APBIF_NUM || apbNum == mainApb) {
+        AUDIO_DRIVER_LOG_ERR("apbif %u can not be a tap", apbNum);
+        return NULL;
+    }
+
+    return &prtd->tap[apbNum];
+}
+
+/* a free ring reserved at init for the HCS captureTaps, under tapLock */
+static struct DmaBufPool *audio_dma_tap_ring(struct DmaRuntimeData *prtd, uint32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < prtd->tapPools; i++) {
+        if (prtd->tapPool[i].virtAddr != NULL && !prtd->tapPool[i].inUse && size <= prtd->tapPool[i].size) {
+            prtd->tapPool[i].inUse = true;
+            return &prtd->tapPool[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Start a capture tap: the tdm input of the main capture is also routed to
+ * apbif apbNum, which gets its own channel and ring with the capture geometry.
+ * Each tap starts and stops independently of the main capture and of other taps.
+ * The ring comes from the captureTaps reservation and is reached through
+ * T507AudioDmaTapMmap.
+ */
+int32_t T507AudioDmaTapStart(struct PlatformData *data, uint32_t apbNum, uint32_t *bufBytes)
+{
+    struct DmaRuntimeData *prtd;
+    struct DmaStreamRuntime *tap;
+    const struct CircleBufInfo *bufInfo;
+
+    tap = get_dma_tap(data, apbNum);
+    if (tap == NULL || bufBytes == NULL) {
+        return HDF_FAILURE;
+    }
+    prtd = (struct DmaRuntimeData *)data->dmaPrv;
+    bufInfo = &data->captureBufInfo;
+    if (prtd->tapPools == 0) {
+        AUDIO_DRIVER_LOG_ERR("no captureTaps rings on this platform");
+        return HDF_ERR_NOT_SUPPORT;
+    }
+
+    mutex_lock(&prtd->tapLock);
+    if (tap->dma_chan != NULL) {
+        mutex_unlock(&prtd->tapLock);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+    if (tap->status == NULL) {
+        tap->status = (struct T507DmaMmapStatus *)get_zeroed_page(GFP_KERNEL);
+        if (tap->status == NULL) {
+            mutex_unlock(&prtd->tapLock);
+            return HDF_FAILURE;
+        }
+    }
+    tap->tapRing = audio_dma_tap_ring(prtd, bufInfo->cirBufSize);
+    if (tap->tapRing == NULL) {
+        AUDIO_DRIVER_LOG_ERR("no free tap ring for %u bytes", bufInfo->cirBufSize);
+        mutex_unlock(&prtd->tapLock);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+
+    audio_dma_stream_init(tap, AUDIO_CAPTURE_STREAM);
+    tap->isTap = true;
+    tap->onAhub = true;
+    tap->bufSource = DMA_BUF_POOL;
+    tap->dma_dev = prtd->stream[DMA_STREAM_RX].dma_dev;
+    tap->dma_chan = snd_dmaengine_pcm_request_channel(NULL, NULL);
+    if (tap->dma_chan == NULL) {
+        AUDIO_DRIVER_LOG_ERR("request dma channel failed.");
+        tap->tapRing->inUse = false;
+        tap->tapRing = NULL;
+        mutex_unlock(&prtd->tapLock);
+        return HDF_FAILURE;
+    }
+
+    if (audio_dma_slave_config(tap, &data->capturePcmInfo, bufInfo, T507_AHUB_RXFIFO_LEVEL,
+        SUNXI_AHUB_ADDR_BASE + SUNXI_AHUB_APBIF_RXFIFO(apbNum), sunxi_slave_id(DRQDST_SDRAM, g_ahub_drq_rx[apbNum])) !=
+        HDF_SUCCESS) {
+        goto err_tap;
+    }
+    WRITE_ONCE(tap->status->appPtr, 0);
+    if (audio_dma_stream_setup(tap, DMA_DEV_TO_MEM, tap->tapRing->phyAddr, bufInfo->cirBufSize,
+        bufInfo->periodSize, &data->capturePcmInfo) != HDF_SUCCESS || audio_dma_stream_prep(tap, 0) != 0) {
+        goto err_tap;
+    }
+
+    /* dma first so the apbif drq never fires into an idle channel */
+    dma_async_issue_pending(tap->dma_chan);
+    if (T507AhubImplCaptureTap(apbNum, true) != HDF_SUCCESS) {
+        goto err_tap;
+    }
+    tap->state = DMA_STATE_RUNNING;
+    *bufBytes = tap->bufBytes;
+    mutex_unlock(&prtd->tapLock);
+
+    return HDF_SUCCESS;
+
+err_tap:
+    audio_dma_tap_stop(tap, apbNum);
+    mutex_unlock(&prtd->tapLock);
+    return HDF_FAILURE;
+}
+
+int32_t T507AudioDmaTapStop(struct PlatformData *data, uint32_t apbNum)
+{
+    struct DmaRuntimeData *prtd;
+    struct DmaStreamRuntime *tap;
+
+    tap = get_dma_tap(data, apbNum);
+    if (tap == NULL) {
+        return HDF_FAILURE;
+    }
+    prtd = (struct DmaRuntimeData *)data->dmaPrv;
+
+    mutex_lock(&prtd->tapLock);
+    /* the ring goes back to the pool, another tap must not land under a live mapping */
+    if (atomic_read(&tap->ringMaps) != 0) {
+        mutex_unlock(&prtd->tapLock);
+        AUDIO_DRIVER_LOG_ERR("apbif %u ring still mapped", apbNum);
+        return HDF_ERR_DEVICE_BUSY;
+    }
+    audio_dma_tap_stop(tap, apbNum);
+    mutex_unlock(&prtd->tapLock);
+
+    return HDF_SUCCESS;
+}
+
+int32_t T507AudioDmaTapPointer(const struct PlatformData *data, uint32_t apbNum, uint32_t *pointer)
+{
+    struct DmaRuntimeData *prtd;
+    struct DmaStreamRuntime *tap;
+    int32_t ret = HDF_FAILURE;
+
+    tap = get_dma_tap(data, apbNum);
+    if (tap == NULL || pointer == NULL) {
+        return HDF_FAILURE;
+    }
+    prtd = (struct DmaRuntimeData *)data->dmaPrv;
+
+    mutex_lock(&prtd->tapLock);
+    if (tap->dma_chan != NULL) {
+        *pointer = BytesToFrames(tap->frameSize, audio_dma_stream_pos(tap, NULL));
+        ret = HDF_SUCCESS;
+    }
+    mutex_unlock(&prtd->tapLock);
+
+    return ret;
+}
+
+/* same layout as T507AudioDmaMmap, the ring can only be mapped while the tap runs */
+int32_t T507AudioDmaTapMmap(struct PlatformData *data, uint32_t apbNum, struct vm_area_struct *vma)
+{
+    struct DmaRuntimeData *prtd;
+    struct DmaStreamRuntime *tap;
+    struct DmaMmapRing ring;
+    int32_t ret;
+
+    tap = get_dma_tap(data, apbNum);
+    if (tap == NULL || vma == NULL) {
+        return HDF_FAILURE;
+    }
+    prtd = (struct DmaRuntimeData *)data->dmaPrv;
+
+    mutex_lock(&prtd->tapLock);
+    if (tap->tapRing == NULL) {
+        mutex_unlock(&prtd->tapLock);
+        AUDIO_DRIVER_LOG_ERR("apbif %u tap is not started", apbNum);
+        return HDF_FAILURE;
+    }
+    ring.virtAddr = tap->tapRing->virtAddr;
+    ring.phyAddr = tap->tapRing->phyAddr;
+    ring.mapMax = tap->tapRing->size;
+    ring.bufBytes = tap->bufBytes;
+    ring.periodBytes = tap->periodBytes;
+    ring.frameSize = tap->frameSize;
+    ret = audio_dma_stream_mmap(tap, &ring, vma);
+    mutex_unlock(&prtd->tapLock);
+
+    return ret;
+}
+
+int32_t T507AudioDmaTapAppPtr(const struct PlatformData *data, uint32_t apbNum, uint32_t *appPtr)
+{
+    struct DmaStreamRuntime *tap;
+
+    tap = get_dma_tap(data, apbNum);
+    if (tap == NULL || appPtr == NULL) {
+        return HDF_FAILURE;
+    }
+
+    return audio_dma_stream_app_ptr(tap, appPtr);
 }
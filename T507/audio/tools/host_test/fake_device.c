@@ -0,0 +1,1147 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include "host_device.h"
+
+#define HOST_DEVRES_NUM     64
+#define HOST_OF_PROPS       64
+#define HOST_OF_VALUES      16
+#define HOST_CLKS           16
+#define HOST_REGULATORS     8
+#define HOST_SYSFS_GROUPS   8
+
+uint64_t host_mmio_ns;
+void (*host_mmio_write_hook)(unsigned int reg, u32 old, u32 *hw);
+
+int scnprintf(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list args;
+    int ret;
+
+    if (size == 0) {
+        return 0;
+    }
+    va_start(args, fmt);
+    ret = vsnprintf(buf, size, fmt, args);
+    va_end(args);
+
+    return (ret < 0) ? 0 : min(ret, (int)size - 1);
+}
+
+void msleep(unsigned int ms)
+{
+    host_advance((uint64_t)ms * NSEC_PER_MSEC);
+}
+
+void usleep_range(unsigned long min, unsigned long max)
+{
+    (void)max;
+    host_advance((uint64_t)min * NSEC_PER_USEC);
+}
+
+void udelay(unsigned long us)
+{
+    host_busy((uint64_t)us * NSEC_PER_USEC);
+}
+
+/* devm */
+struct HostDevres {
+    struct device *dev;
+    void *ptr;
+    void (*release)(void *ptr);
+};
+
+static struct HostDevres g_devres[HOST_DEVRES_NUM];
+static size_t g_devres_num;
+
+static void host_devres_add(struct device *dev, void *ptr, void (*release)(void *ptr))
+{
+    if (g_devres_num == ARRAY_SIZE(g_devres)) {
+        fprintf(stderr, "host: devres table full\n");
+        abort();
+    }
+    g_devres[g_devres_num].dev = dev;
+    g_devres[g_devres_num].ptr = ptr;
+    g_devres[g_devres_num].release = release;
+    g_devres_num++;
+}
+
+static bool host_devres_drop(struct device *dev, const void *ptr)
+{
+    size_t i;
+
+    for (i = 0; i < g_devres_num; i++) {
+        if (g_devres[i].dev == dev && g_devres[i].ptr == ptr) {
+            g_devres[i].release(g_devres[i].ptr);
+            memmove(&g_devres[i], &g_devres[i + 1], (g_devres_num - i - 1) * sizeof(g_devres[0]));
+            g_devres_num--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void host_devres_release_all(struct device *dev)
+{
+    size_t i = g_devres_num;
+
+    while (i-- > 0) {
+        if (g_devres[i].dev == dev) {
+            host_devres_drop(dev, g_devres[i].ptr);
+        }
+    }
+}
+
+int host_devres_live(void)
+{
+    return (int)g_devres_num;
+}
+
+static void host_devres_kfree(void *ptr)
+{
+    kfree(ptr);
+}
+
+void *devm_kzalloc(struct device *dev, size_t size, gfp_t flags)
+{
+    void *p = kzalloc(size, flags);
+
+    if (p != NULL) {
+        host_devres_add(dev, p, host_devres_kfree);
+    }
+
+    return p;
+}
+
+void *devm_kcalloc(struct device *dev, size_t n, size_t size, gfp_t flags)
+{
+    return devm_kzalloc(dev, n * size, flags);
+}
+
+void devm_kfree(struct device *dev, const void *p)
+{
+    host_devres_drop(dev, p);
+}
+
+struct resource *devm_request_mem_region(struct device *dev, phys_addr_t start, unsigned long n, const char *name)
+{
+    struct resource *res = kzalloc(sizeof(*res), GFP_KERNEL);
+
+    if (res == NULL) {
+        return NULL;
+    }
+    res->start = start;
+    res->end = start + n - 1;
+    res->name = name;
+    host_devres_add(dev, res, host_devres_kfree);
+
+    return res;
+}
+
+void devm_release_mem_region(struct device *dev, phys_addr_t start, unsigned long n)
+{
+    size_t i;
+
+    (void)n;
+    for (i = 0; i < g_devres_num; i++) {
+        if (g_devres[i].dev == dev && g_devres[i].release == host_devres_kfree &&
+            ((struct resource *)g_devres[i].ptr)->start == start) {
+            host_devres_drop(dev, g_devres[i].ptr);
+            return;
+        }
+    }
+}
+
+/* the mapping is the register file itself, reset to zero */
+void __iomem *devm_ioremap(struct device *dev, phys_addr_t start, unsigned long size)
+{
+    void *regs = kzalloc(size, GFP_KERNEL);
+
+    (void)start;
+    if (regs != NULL) {
+        host_devres_add(dev, regs, host_devres_kfree);
+    }
+
+    return regs;
+}
+
+void devm_iounmap(struct device *dev, void __iomem *addr)
+{
+    host_devres_drop(dev, addr);
+}
+
+/* device tree */
+struct HostOfProp {
+    const struct device_node *np;
+    const char *name;
+    u32 values[HOST_OF_VALUES];
+    size_t num;
+    const char *str;
+};
+
+static struct HostOfProp g_props[HOST_OF_PROPS];
+
+static struct HostOfProp *host_of_find(const struct device_node *np, const char *name, bool create)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_props); i++) {
+        if (g_props[i].np == np && g_props[i].name != NULL && strcmp(g_props[i].name, name) == 0) {
+            return &g_props[i];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    for (i = 0; i < ARRAY_SIZE(g_props); i++) {
+        if (g_props[i].name == NULL) {
+            g_props[i].np = np;
+            g_props[i].name = name;
+            return &g_props[i];
+        }
+    }
+    fprintf(stderr, "host: of property table full\n");
+    abort();
+}
+
+void host_of_set_u32_array(const struct device_node *np, const char *name, const u32 *values, size_t n)
+{
+    struct HostOfProp *prop = host_of_find(np, name, true);
+
+    prop->num = min(n, ARRAY_SIZE(prop->values));
+    memcpy(prop->values, values, prop->num * sizeof(u32));
+    prop->str = NULL;
+}
+
+void host_of_set_u32(const struct device_node *np, const char *name, u32 value)
+{
+    host_of_set_u32_array(np, name, &value, 1);
+}
+
+void host_of_set_string(const struct device_node *np, const char *name, const char *value)
+{
+    struct HostOfProp *prop = host_of_find(np, name, true);
+
+    prop->num = 0;
+    prop->str = value;
+}
+
+void host_of_set_bool(const struct device_node *np, const char *name)
+{
+    struct HostOfProp *prop = host_of_find(np, name, true);
+
+    prop->num = 0;
+    prop->str = NULL;
+}
+
+int of_property_read_u32_array(const struct device_node *np, const char *name, u32 *values, size_t n)
+{
+    const struct HostOfProp *prop = host_of_find(np, name, false);
+
+    if (prop == NULL) {
+        return -EINVAL;
+    }
+    if (prop->num < n) {
+        return -EOVERFLOW;
+    }
+    memcpy(values, prop->values, n * sizeof(u32));
+
+    return 0;
+}
+
+int of_property_read_u32(const struct device_node *np, const char *name, u32 *value)
+{
+    return of_property_read_u32_array(np, name, value, 1);
+}
+
+int of_property_read_string(const struct device_node *np, const char *name, const char **value)
+{
+    const struct HostOfProp *prop = host_of_find(np, name, false);
+
+    if (prop == NULL || prop->str == NULL) {
+        return -EINVAL;
+    }
+    *value = prop->str;
+
+    return 0;
+}
+
+bool of_property_read_bool(const struct device_node *np, const char *name)
+{
+    return host_of_find(np, name, false) != NULL;
+}
+
+int of_address_to_resource(struct device_node *np, int index, struct resource *res)
+{
+    u32 reg[2];
+
+    if (index != 0 || of_property_read_u32_array(np, "reg", reg, ARRAY_SIZE(reg)) != 0) {
+        return -EINVAL;
+    }
+    res->start = reg[0];
+    res->end = (phys_addr_t)reg[0] + reg[1] - 1;
+    res->name = np->full_name;
+
+    return 0;
+}
+
+void of_node_put(struct device_node *np)
+{
+    (void)np;
+}
+
+int of_get_named_gpio_flags(struct device_node *np, const char *name, int index, enum of_gpio_flags *flags)
+{
+    u32 gpio;
+
+    if (index != 0 || of_property_read_u32(np, name, &gpio) != 0) {
+        return -ENOENT;
+    }
+    if (flags != NULL) {
+        *flags = 0;
+    }
+
+    return (int)gpio;
+}
+
+/* regmap: rbtree and flat caches both become a value plus present flag per register */
+struct regmap {
+    struct regmap_config config;
+    struct device *dev;
+    u32 *hw;
+    u32 *cache;
+    bool *present;
+    unsigned int num;
+    bool cacheOnly;
+    bool cacheBypass;
+    bool cacheDirty;
+    struct HostRegmapStats stats;
+};
+
+static void host_regmap_release(void *ptr)
+{
+    struct regmap *map = ptr;
+
+    kfree(map->cache);
+    kfree(map->present);
+    kfree(map);
+}
+
+struct regmap *devm_regmap_init_mmio(struct device *dev, void __iomem *regs, const struct regmap_config *config)
+{
+    struct regmap *map;
+    unsigned int i;
+
+    if (regs == NULL || config->reg_stride <= 0) {
+        return ERR_PTR(-EINVAL);
+    }
+    map = kzalloc(sizeof(*map), GFP_KERNEL);
+    if (map == NULL) {
+        return ERR_PTR(-ENOMEM);
+    }
+    map->config = *config;
+    map->dev = dev;
+    map->hw = regs;
+    map->num = config->max_register / config->reg_stride + 1;
+    if (config->cache_type != REGCACHE_NONE) {
+        map->cache = kcalloc(map->num, sizeof(u32), GFP_KERNEL);
+        map->present = kcalloc(map->num, sizeof(bool), GFP_KERNEL);
+        if (map->cache == NULL || map->present == NULL) {
+            host_regmap_release(map);
+            return ERR_PTR(-ENOMEM);
+        }
+        for (i = 0; i < config->num_reg_defaults; i++) {
+            map->cache[config->reg_defaults[i].reg / config->reg_stride] = config->reg_defaults[i].def;
+            map->present[config->reg_defaults[i].reg / config->reg_stride] = true;
+        }
+        if (config->cache_type == REGCACHE_FLAT) {
+            memset(map->present, true, map->num * sizeof(bool));
+        }
+    }
+    host_devres_add(dev, map, host_regmap_release);
+
+    return map;
+}
+
+struct HostRegmapStats *host_regmap_stats(struct regmap *map)
+{
+    return &map->stats;
+}
+
+u32 *host_regmap_hw(struct regmap *map)
+{
+    return map->hw;
+}
+
+static bool host_regmap_cached(const struct regmap *map, unsigned int reg)
+{
+    if (map->cache == NULL || map->cacheBypass) {
+        return false;
+    }
+
+    return map->config.volatile_reg == NULL || !map->config.volatile_reg(map->dev, reg);
+}
+
+static int host_regmap_check(const struct regmap *map, unsigned int reg)
+{
+    if (reg > map->config.max_register || (reg % map->config.reg_stride) != 0) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static u32 host_bus_read(struct regmap *map, unsigned int reg)
+{
+    map->stats.busReads++;
+    host_busy(host_mmio_ns);
+
+    return map->hw[reg / 4];
+}
+
+static void host_bus_write(struct regmap *map, unsigned int reg, u32 val)
+{
+    u32 old = map->hw[reg / 4];
+
+    map->stats.busWrites++;
+    host_busy(host_mmio_ns);
+    map->hw[reg / 4] = val;
+    if (host_mmio_write_hook != NULL) {
+        host_mmio_write_hook(reg, old, &map->hw[reg / 4]);
+    }
+}
+
+int regmap_read(struct regmap *map, unsigned int reg, unsigned int *val)
+{
+    unsigned int idx = reg / map->config.reg_stride;
+    bool cached = host_regmap_cached(map, reg);
+
+    if (host_regmap_check(map, reg) != 0) {
+        return -EINVAL;
+    }
+    if (cached && map->present[idx]) {
+        *val = map->cache[idx];
+        return 0;
+    }
+    if (map->cacheOnly) {
+        return -EBUSY;
+    }
+    *val = host_bus_read(map, reg);
+    if (cached) {
+        map->stats.fillReads++;
+        map->cache[idx] = *val;
+        map->present[idx] = true;
+    }
+
+    return 0;
+}
+
+int regmap_write(struct regmap *map, unsigned int reg, unsigned int val)
+{
+    unsigned int idx = reg / map->config.reg_stride;
+
+    if (host_regmap_check(map, reg) != 0) {
+        return -EINVAL;
+    }
+    if (host_regmap_cached(map, reg)) {
+        map->cache[idx] = val;
+        map->present[idx] = true;
+    }
+    if (map->cacheOnly) {
+        map->cacheDirty = true;
+        return 0;
+    }
+    host_bus_write(map, reg, val);
+
+    return 0;
+}
+
+int regmap_update_bits(struct regmap *map, unsigned int reg, unsigned int mask, unsigned int val)
+{
+    unsigned int orig;
+    unsigned int tmp;
+    int ret;
+
+    ret = regmap_read(map, reg, &orig);
+    if (ret != 0) {
+        return ret;
+    }
+    tmp = (orig & ~mask) | (val & mask);
+    if (tmp == orig) {
+        return 0;
+    }
+
+    return regmap_write(map, reg, tmp);
+}
+
+int regmap_multi_reg_write(struct regmap *map, const struct reg_sequence *regs, int num_regs)
+{
+    int i;
+    int ret;
+
+    for (i = 0; i < num_regs; i++) {
+        ret = regmap_write(map, regs[i].reg, regs[i].def);
+        if (ret != 0) {
+            return ret;
+        }
+        if (regs[i].delay_us != 0) {
+            udelay(regs[i].delay_us);
+        }
+    }
+
+    return 0;
+}
+
+void regcache_cache_only(struct regmap *map, bool enable)
+{
+    map->cacheOnly = enable;
+}
+
+void regcache_cache_bypass(struct regmap *map, bool enable)
+{
+    map->cacheBypass = enable;
+}
+
+void regcache_mark_dirty(struct regmap *map)
+{
+    map->cacheDirty = true;
+}
+
+/* without reg_defaults every cached register is written back, as regcache_rbtree_sync does */
+int regcache_sync(struct regmap *map)
+{
+    unsigned int idx;
+    unsigned int i;
+    bool needed;
+
+    if (map->cache == NULL || !map->cacheDirty) {
+        return 0;
+    }
+    for (idx = 0; idx < map->num; idx++) {
+        if (!map->present[idx]) {
+            continue;
+        }
+        needed = true;
+        for (i = 0; i < map->config.num_reg_defaults; i++) {
+            if (map->config.reg_defaults[i].reg / map->config.reg_stride == idx) {
+                needed = (map->config.reg_defaults[i].def != map->cache[idx]);
+                break;
+            }
+        }
+        if (needed) {
+            host_bus_write(map, idx * map->config.reg_stride, map->cache[idx]);
+            map->stats.syncWrites++;
+        }
+    }
+    map->cacheDirty = false;
+
+    return 0;
+}
+
+/* clocks and regulators live as long as the test, like the clock tree */
+struct HostClkSlot {
+    const struct device_node *np;
+    int index;
+    struct clk clk;
+};
+
+static struct HostClkSlot g_clks[HOST_CLKS];
+static struct regulator g_regulators[HOST_REGULATORS];
+
+struct clk *host_clk(const struct device_node *np, int index)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_clks); i++) {
+        if (g_clks[i].np == np && g_clks[i].index == index && g_clks[i].clk.name[0] != '\0') {
+            return &g_clks[i].clk;
+        }
+    }
+    for (i = 0; i < ARRAY_SIZE(g_clks); i++) {
+        if (g_clks[i].clk.name[0] == '\0') {
+            g_clks[i].np = np;
+            g_clks[i].index = index;
+            snprintf(g_clks[i].clk.name, sizeof(g_clks[i].clk.name), "%s#%d", np->full_name, index);
+            return &g_clks[i].clk;
+        }
+    }
+
+    return ERR_PTR(-ENOMEM);
+}
+
+struct clk *of_clk_get(struct device_node *np, int index)
+{
+    return host_clk(np, index);
+}
+
+void clk_put(struct clk *clk)
+{
+    (void)clk;
+}
+
+int clk_set_parent(struct clk *clk, struct clk *parent)
+{
+    clk->parent = parent;
+
+    return 0;
+}
+
+int clk_prepare_enable(struct clk *clk)
+{
+    if (clk->enableCount++ == 0) {
+        host_busy(clk->lockNs);
+    }
+
+    return 0;
+}
+
+void clk_disable_unprepare(struct clk *clk)
+{
+    if (clk->enableCount > 0) {
+        clk->enableCount--;
+    }
+}
+
+int clk_set_rate(struct clk *clk, unsigned long rate)
+{
+    clk->setRates++;
+    if (clk->rate != rate && clk->enableCount > 0) {
+        host_busy(clk->lockNs);
+    }
+    clk->rate = rate;
+
+    return 0;
+}
+
+unsigned long clk_get_rate(struct clk *clk)
+{
+    return clk->rate;
+}
+
+struct regulator *host_regulator(const char *id)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_regulators); i++) {
+        if (strcmp(g_regulators[i].name, id) == 0) {
+            return &g_regulators[i];
+        }
+    }
+    for (i = 0; i < ARRAY_SIZE(g_regulators); i++) {
+        if (g_regulators[i].name[0] == '\0') {
+            snprintf(g_regulators[i].name, sizeof(g_regulators[i].name), "%s", id);
+            return &g_regulators[i];
+        }
+    }
+
+    return ERR_PTR(-ENOMEM);
+}
+
+struct regulator *regulator_get(struct device *dev, const char *id)
+{
+    (void)dev;
+    return host_regulator(id);
+}
+
+void regulator_put(struct regulator *regulator)
+{
+    (void)regulator;
+}
+
+int regulator_set_voltage(struct regulator *regulator, int minUv, int maxUv)
+{
+    (void)maxUv;
+    regulator->uV = minUv;
+
+    return 0;
+}
+
+int regulator_enable(struct regulator *regulator)
+{
+    if (regulator->enableCount++ == 0) {
+        host_busy(regulator->rampNs);
+    }
+
+    return 0;
+}
+
+int regulator_disable(struct regulator *regulator)
+{
+    if (regulator->enableCount > 0) {
+        regulator->enableCount--;
+    }
+
+    return 0;
+}
+
+int regulator_is_enabled(struct regulator *regulator)
+{
+    return regulator->enableCount > 0;
+}
+
+/* pinctrl */
+struct pinctrl {
+    int selects;
+};
+
+struct pinctrl_state {
+    const char *name;
+};
+
+static struct pinctrl g_pinctrl;
+static struct pinctrl_state g_pin_states[] = {
+    { PINCTRL_STATE_DEFAULT },
+    { PINCTRL_STATE_SLEEP },
+};
+
+struct pinctrl *devm_pinctrl_get(struct device *dev)
+{
+    (void)dev;
+    return &g_pinctrl;
+}
+
+void devm_pinctrl_put(struct pinctrl *p)
+{
+    (void)p;
+}
+
+struct pinctrl_state *pinctrl_lookup_state(struct pinctrl *p, const char *name)
+{
+    size_t i;
+
+    (void)p;
+    for (i = 0; i < ARRAY_SIZE(g_pin_states); i++) {
+        if (strcmp(g_pin_states[i].name, name) == 0) {
+            return &g_pin_states[i];
+        }
+    }
+
+    return ERR_PTR(-ENODEV);
+}
+
+int pinctrl_select_state(struct pinctrl *p, struct pinctrl_state *state)
+{
+    (void)state;
+    p->selects++;
+
+    return 0;
+}
+
+/* sysfs */
+struct HostSysfsGroup {
+    struct kobject *kobj;
+    const struct attribute_group *grp;
+};
+
+static struct HostSysfsGroup g_groups[HOST_SYSFS_GROUPS];
+
+int sysfs_create_group(struct kobject *kobj, const struct attribute_group *grp)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_groups); i++) {
+        if (g_groups[i].kobj == NULL) {
+            g_groups[i].kobj = kobj;
+            g_groups[i].grp = grp;
+            return 0;
+        }
+    }
+
+    return -ENOMEM;
+}
+
+void sysfs_remove_group(struct kobject *kobj, const struct attribute_group *grp)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_groups); i++) {
+        if (g_groups[i].kobj == kobj && g_groups[i].grp == grp) {
+            g_groups[i].kobj = NULL;
+            g_groups[i].grp = NULL;
+        }
+    }
+}
+
+static struct device_attribute *host_sysfs_find(struct device *dev, const char *name)
+{
+    struct attribute **attr;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_groups); i++) {
+        if (g_groups[i].kobj != &dev->kobj) {
+            continue;
+        }
+        for (attr = g_groups[i].grp->attrs; *attr != NULL; attr++) {
+            if (strcmp((*attr)->name, name) == 0) {
+                return container_of(*attr, struct device_attribute, attr);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+ssize_t host_sysfs_show(struct device *dev, const char *name, char *buf)
+{
+    struct device_attribute *attr = host_sysfs_find(dev, name);
+
+    return (attr != NULL && attr->show != NULL) ? attr->show(dev, attr, buf) : -ENOENT;
+}
+
+ssize_t host_sysfs_store(struct device *dev, const char *name, const char *buf)
+{
+    struct device_attribute *attr = host_sysfs_find(dev, name);
+
+    return (attr != NULL && attr->store != NULL) ? attr->store(dev, attr, buf, strlen(buf)) : -ENOENT;
+}
+
+/* seq_file: show runs once into a buffer that doubles until it fits, reads drain it */
+void seq_printf(struct seq_file *m, const char *fmt, ...)
+{
+    va_list args;
+    int len;
+
+    if (m->count >= m->size) {
+        return;
+    }
+    va_start(args, fmt);
+    len = vsnprintf(m->buf + m->count, m->size - m->count, fmt, args);
+    va_end(args);
+    m->count = (len < 0 || (size_t)len >= m->size - m->count) ? m->size : m->count + (size_t)len;
+}
+
+void seq_write(struct seq_file *m, const void *data, size_t len)
+{
+    if (m->count + len > m->size) {
+        m->count = m->size;
+        return;
+    }
+    memcpy(m->buf + m->count, data, len);
+    m->count += len;
+}
+
+int single_open(struct file *file, int (*show)(struct seq_file *m, void *v), void *data)
+{
+    struct seq_file *m = kzalloc(sizeof(*m), GFP_KERNEL);
+
+    if (m == NULL) {
+        return -ENOMEM;
+    }
+    m->show = show;
+    m->private = data;
+    file->private_data = m;
+
+    return 0;
+}
+
+int single_release(struct inode *inode, struct file *file)
+{
+    struct seq_file *m = file->private_data;
+
+    (void)inode;
+    kfree(m->buf);
+    kfree(m);
+    file->private_data = NULL;
+
+    return 0;
+}
+
+ssize_t seq_read(struct file *file, char __user *buf, size_t size, long long *ppos)
+{
+    struct seq_file *m = file->private_data;
+    size_t n;
+    int ret;
+
+    if (m->buf == NULL) {
+        for (m->size = PAGE_SIZE;; m->size *= 2) {
+            m->buf = kzalloc(m->size, GFP_KERNEL);
+            if (m->buf == NULL) {
+                return -ENOMEM;
+            }
+            m->count = 0;
+            ret = m->show(m, NULL);
+            if (ret < 0) {
+                return ret;
+            }
+            if (m->count < m->size) {
+                break;
+            }
+            kfree(m->buf);
+        }
+    }
+    n = min(size, m->count - m->from);
+    memcpy(buf, m->buf + m->from, n);
+    m->from += n;
+    *ppos += (long long)n;
+
+    return (ssize_t)n;
+}
+
+long long seq_lseek(struct file *file, long long offset, int whence)
+{
+    struct seq_file *m = file->private_data;
+
+    if (whence != 0 || offset < 0) {
+        return -EINVAL;
+    }
+    m->from = (size_t)offset;
+    file->f_pos = offset;
+
+    return offset;
+}
+
+/* runtime pm, the subset of rpm_resume/rpm_suspend/rpm_idle the drivers lean on */
+static const struct dev_pm_ops *host_pm_ops(struct device *dev)
+{
+    return (dev->driver != NULL) ? dev->driver->pm : NULL;
+}
+
+static int host_rpm_resume(struct device *dev)
+{
+    const struct dev_pm_ops *ops = host_pm_ops(dev);
+    int ret;
+
+    if (dev->power.active) {
+        return 1;
+    }
+    if (dev->power.disable_depth > 0) {
+        return -EACCES;
+    }
+    host_timer_cancel(&dev->power.suspend_timer);
+    if (ops != NULL && ops->runtime_resume != NULL) {
+        ret = ops->runtime_resume(dev);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    dev->power.active = true;
+    dev->power.resumes++;
+
+    return 0;
+}
+
+static int host_rpm_suspend(struct device *dev)
+{
+    const struct dev_pm_ops *ops = host_pm_ops(dev);
+    int ret;
+
+    if (!dev->power.active || dev->power.usage_count > 0 || dev->power.disable_depth > 0) {
+        return -EAGAIN;
+    }
+    if (ops != NULL && ops->runtime_suspend != NULL) {
+        ret = ops->runtime_suspend(dev);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    dev->power.active = false;
+    dev->power.suspends++;
+
+    return 0;
+}
+
+static uint64_t host_rpm_expires(const struct device *dev)
+{
+    return dev->power.last_busy + (uint64_t)dev->power.autosuspend_delay * NSEC_PER_MSEC;
+}
+
+static void host_rpm_timer(struct HostTimer *timer)
+{
+    struct device *dev = container_of(timer, struct device, power.suspend_timer);
+
+    if (dev->power.use_autosuspend && ktime_get_ns() < host_rpm_expires(dev)) {
+        host_timer_arm(timer, host_rpm_expires(dev));
+        return;
+    }
+    host_rpm_suspend(dev);
+}
+
+/* the last reference went away: suspend after the autosuspend delay, or right away */
+static void host_rpm_idle(struct device *dev)
+{
+    if (!dev->power.active || dev->power.usage_count > 0 || dev->power.disable_depth > 0) {
+        return;
+    }
+    dev->power.suspend_timer.fn = host_rpm_timer;
+    host_timer_arm(&dev->power.suspend_timer, dev->power.use_autosuspend ? host_rpm_expires(dev) : ktime_get_ns());
+}
+
+void pm_runtime_enable(struct device *dev)
+{
+    if (dev->power.disable_depth > 0) {
+        dev->power.disable_depth--;
+    }
+}
+
+void pm_runtime_disable(struct device *dev)
+{
+    dev->power.disable_depth++;
+    host_timer_cancel(&dev->power.suspend_timer);
+}
+
+int pm_runtime_set_active(struct device *dev)
+{
+    dev->power.active = true;
+
+    return 0;
+}
+
+void pm_runtime_set_autosuspend_delay(struct device *dev, int delay)
+{
+    dev->power.autosuspend_delay = delay;
+}
+
+void pm_runtime_use_autosuspend(struct device *dev)
+{
+    dev->power.use_autosuspend = true;
+}
+
+void pm_runtime_dont_use_autosuspend(struct device *dev)
+{
+    dev->power.use_autosuspend = false;
+}
+
+void pm_runtime_mark_last_busy(struct device *dev)
+{
+    dev->power.last_busy = ktime_get_ns();
+}
+
+int pm_runtime_get_sync(struct device *dev)
+{
+    dev->power.usage_count++;
+
+    return host_rpm_resume(dev);
+}
+
+int pm_runtime_put_autosuspend(struct device *dev)
+{
+    if (dev->power.usage_count > 0) {
+        dev->power.usage_count--;
+    }
+    host_rpm_idle(dev);
+
+    return 0;
+}
+
+void pm_runtime_put_noidle(struct device *dev)
+{
+    if (dev->power.usage_count > 0) {
+        dev->power.usage_count--;
+    }
+}
+
+int pm_request_autosuspend(struct device *dev)
+{
+    host_rpm_idle(dev);
+
+    return 0;
+}
+
+bool pm_runtime_suspended(struct device *dev)
+{
+    return !dev->power.active && dev->power.disable_depth == 0;
+}
+
+int pm_runtime_force_suspend(struct device *dev)
+{
+    const struct dev_pm_ops *ops = host_pm_ops(dev);
+    int ret;
+
+    pm_runtime_disable(dev);
+    if (!dev->power.active) {
+        return 0;
+    }
+    if (ops != NULL && ops->runtime_suspend != NULL) {
+        ret = ops->runtime_suspend(dev);
+        if (ret < 0) {
+            pm_runtime_enable(dev);
+            return ret;
+        }
+    }
+    dev->power.active = false;
+    dev->power.suspends++;
+
+    return 0;
+}
+
+/* only a device somebody still holds comes back, the rest resumes on its next get */
+int pm_runtime_force_resume(struct device *dev)
+{
+    int ret = 0;
+
+    pm_runtime_enable(dev);
+    if (dev->power.usage_count > 0) {
+        ret = host_rpm_resume(dev);
+    }
+
+    return (ret < 0) ? ret : 0;
+}
+
+int host_platform_probe(struct platform_driver *drv, struct platform_device *pdev)
+{
+    int ret;
+
+    memset(&pdev->dev.power, 0, sizeof(pdev->dev.power));
+    pdev->dev.power.disable_depth = 1;
+    pdev->dev.driver = &drv->driver;
+    ret = drv->probe(pdev);
+    if (ret != 0) {
+        host_devres_release_all(&pdev->dev);
+        pdev->dev.driver = NULL;
+    }
+
+    return ret;
+}
+
+int host_platform_remove(struct platform_driver *drv, struct platform_device *pdev)
+{
+    int ret = drv->remove(pdev);
+
+    host_timer_cancel(&pdev->dev.power.suspend_timer);
+    host_devres_release_all(&pdev->dev);
+    pdev->dev.driver = NULL;
+    pdev->dev.driver_data = NULL;
+
+    return ret;
+}
+
+int host_pm_suspend(struct device *dev)
+{
+    const struct dev_pm_ops *ops = host_pm_ops(dev);
+
+    return (ops != NULL && ops->suspend != NULL) ? ops->suspend(dev) : 0;
+}
+
+int host_pm_resume(struct device *dev)
+{
+    const struct dev_pm_ops *ops = host_pm_ops(dev);
+
+    return (ops != NULL && ops->resume != NULL) ? ops->resume(dev) : 0;
+}
+
+void host_device_reset(void)
+{
+    memset(g_props, 0, sizeof(g_props));
+    memset(g_clks, 0, sizeof(g_clks));
+    memset(g_regulators, 0, sizeof(g_regulators));
+    memset(g_groups, 0, sizeof(g_groups));
+    memset(&g_pinctrl, 0, sizeof(g_pinctrl));
+    g_devres_num = 0;
+    host_mmio_ns = 0;
+    host_mmio_write_hook = NULL;
+}
@@ -0,0 +1,616 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * A virt-dma style controller on the virtual clock. Each channel moves bytes
+ * at the rate of the fifo it is configured for, in whole bursts. Issued
+ * descriptors run back to back; a single completes once, a cyclic one wraps
+ * forever and raises an irq per period. The irq only schedules the channel
+ * tasklet, which runs irqToTaskletNs (+ jitter) later and then calls the
+ * cyclic callback once however many periods passed, and the callback of each
+ * completed single. tx_status reports the residue of the active descriptor
+ * and the full length for queued ones. pause freezes the channel clock, so a
+ * burst cut short resumes where it was; terminate
+ * drops every descriptor and any callback not yet run.
+ */
+
+#include <stdlib.h>
+
+#include <linux/dmaengine.h>
+
+#define HOST_DMA_CHANS      16
+#define HOST_DMA_FIFOS      16
+
+struct HostDmaDesc {
+    struct dma_async_tx_descriptor tx;
+    bool cyclic;
+    dma_addr_t buf;
+    uint32_t len;
+    uint32_t period;
+    struct HostDmaDesc *next;
+};
+
+struct HostDmaChan {
+    struct dma_chan chan;
+    bool used;
+    bool canPause;
+    struct dma_slave_config config;
+
+    struct HostDmaDesc *submitted;  /* submitted, not issued yet */
+    struct HostDmaDesc *issued;     /* head is the active one */
+    struct HostDmaDesc *completed;  /* singles waiting for the tasklet */
+
+    /* progress: totals are bytes since the first issue, wraps included */
+    bool running;
+    bool paused;
+    uint64_t anchorNs;
+    uint64_t anchorTotal;
+    uint64_t pausedAtNs;
+    uint64_t descStart;             /* total when the active descriptor started */
+    uint64_t irqTotal;              /* total the armed irq fires at */
+    uint32_t pendingPeriods;
+
+    struct HostTimer irq;
+    struct HostTimer tasklet;
+    dma_cookie_t cookie;
+    uint32_t callbacks;
+};
+
+struct HostDmaFifo {
+    phys_addr_t addr;
+    uint64_t rate;                  /* bytes per 10^15 ns: bytesPerSec * (10^6 + ppm) */
+};
+
+static struct HostDmaChan g_chans[HOST_DMA_CHANS];
+static struct HostDmaFifo g_fifos[HOST_DMA_FIFOS];
+static struct HostDmaConfig g_config = {
+    .canPause = true,
+    .reportResidue = true,
+    .channels = 8,
+};
+static uint32_t g_jitter_seed = 1;
+static int g_descs_live;
+
+struct HostDmaCalls host_dma_calls;
+
+#define HOST_DMA_RATE_SCALE     1000000000000000ULL
+
+static struct HostDmaChan *host_chan(const struct dma_chan *chan)
+{
+    return container_of(chan, struct HostDmaChan, chan);
+}
+
+static phys_addr_t host_chan_fifo(const struct HostDmaChan *hc)
+{
+    return (hc->config.direction == DMA_MEM_TO_DEV) ? hc->config.dst_addr : hc->config.src_addr;
+}
+
+static uint64_t host_chan_rate(const struct HostDmaChan *hc)
+{
+    phys_addr_t addr = host_chan_fifo(hc);
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_fifos); i++) {
+        if (g_fifos[i].rate != 0 && g_fifos[i].addr == addr) {
+            return g_fifos[i].rate;
+        }
+    }
+
+    return 0;
+}
+
+static uint32_t host_chan_burst_bytes(const struct HostDmaChan *hc)
+{
+    uint32_t burst;
+    uint32_t width;
+
+    if (hc->config.direction == DMA_MEM_TO_DEV) {
+        burst = hc->config.dst_maxburst;
+        width = hc->config.dst_addr_width;
+    } else {
+        burst = hc->config.src_maxburst;
+        width = hc->config.src_addr_width;
+    }
+
+    return max_t(uint32_t, burst, 1) * max_t(uint32_t, width, 1);
+}
+
+/* whole bursts moved since the anchor */
+static uint64_t host_chan_total(const struct HostDmaChan *hc)
+{
+    uint64_t rate = host_chan_rate(hc);
+    uint64_t burst = host_chan_burst_bytes(hc);
+    uint64_t bytes;
+
+    if (!hc->running || rate == 0) {
+        return hc->anchorTotal;
+    }
+    bytes = (uint64_t)((unsigned __int128)((hc->paused ? hc->pausedAtNs : ktime_get_ns()) - hc->anchorNs) *
+        rate / HOST_DMA_RATE_SCALE);
+
+    return hc->anchorTotal + bytes - (bytes % burst);
+}
+
+/* next total at which the active descriptor raises its irq */
+static uint64_t host_chan_boundary(const struct HostDmaChan *hc, uint64_t total)
+{
+    const struct HostDmaDesc *desc = hc->issued;
+
+    if (!desc->cyclic) {
+        return hc->descStart + desc->len;
+    }
+
+    return hc->descStart + ((total - hc->descStart) / desc->period + 1) * desc->period;
+}
+
+/* arm the irq for the next boundary after the anchor */
+static void host_chan_arm_irq(struct HostDmaChan *hc)
+{
+    uint64_t rate = host_chan_rate(hc);
+    uint64_t ns;
+
+    host_timer_cancel(&hc->irq);
+    if (!hc->running || hc->paused || hc->issued == NULL || rate == 0) {
+        return;
+    }
+    hc->irqTotal = host_chan_boundary(hc, hc->anchorTotal);
+    ns = (uint64_t)(((unsigned __int128)(hc->irqTotal - hc->anchorTotal) * HOST_DMA_RATE_SCALE + rate - 1) / rate);
+    host_timer_arm(&hc->irq, hc->anchorNs + ns);
+}
+
+static uint64_t host_jitter(void)
+{
+    if (g_config.taskletJitterNs == 0) {
+        return 0;
+    }
+    g_jitter_seed = g_jitter_seed * 1103515245u + 12345u;
+
+    return ((g_jitter_seed >> 8) % 65536) * g_config.taskletJitterNs / 65536;
+}
+
+static void host_chan_schedule_tasklet(struct HostDmaChan *hc)
+{
+    if (!hc->tasklet.armed) {
+        host_timer_arm(&hc->tasklet, ktime_get_ns() + g_config.irqToTaskletNs + host_jitter());
+    }
+}
+
+static void host_desc_free(struct HostDmaDesc *desc)
+{
+    g_descs_live--;
+    free(desc);
+}
+
+static void host_desc_free_list(struct HostDmaDesc **list)
+{
+    struct HostDmaDesc *desc;
+
+    while (*list != NULL) {
+        desc = *list;
+        *list = desc->next;
+        host_desc_free(desc);
+    }
+}
+
+static void host_desc_append(struct HostDmaDesc **list, struct HostDmaDesc *desc)
+{
+    while (*list != NULL) {
+        list = &(*list)->next;
+    }
+    desc->next = NULL;
+    *list = desc;
+}
+
+/* the exact moment the active descriptor crosses a period or its end */
+static void host_chan_irq(struct HostTimer *timer)
+{
+    struct HostDmaChan *hc = container_of(timer, struct HostDmaChan, irq);
+    struct HostDmaDesc *desc = hc->issued;
+    uint64_t boundary = hc->irqTotal;
+
+    /* restart the clock on the exact boundary, no rounding carried over */
+    hc->anchorTotal = boundary;
+    hc->anchorNs = ktime_get_ns();
+    if (desc->cyclic) {
+        hc->pendingPeriods++;
+    } else {
+        hc->issued = desc->next;
+        host_desc_append(&hc->completed, desc);
+        hc->descStart = boundary;
+        if (hc->issued == NULL) {
+            hc->running = false;
+        }
+    }
+    host_chan_schedule_tasklet(hc);
+    host_chan_arm_irq(hc);
+}
+
+static void host_chan_tasklet(struct HostTimer *timer)
+{
+    struct HostDmaChan *hc = container_of(timer, struct HostDmaChan, tasklet);
+    struct HostDmaDesc *cyclic = (hc->issued != NULL && hc->issued->cyclic) ? hc->issued : NULL;
+    struct HostDmaDesc *done = hc->completed;
+    struct HostDmaDesc *desc;
+
+    hc->completed = NULL;
+    if (cyclic != NULL && hc->pendingPeriods != 0) {
+        hc->pendingPeriods = 0;
+        hc->callbacks++;
+        if (cyclic->tx.callback != NULL) {
+            cyclic->tx.callback(cyclic->tx.callback_param);
+        }
+    }
+    while (done != NULL) {
+        desc = done;
+        done = desc->next;
+        hc->callbacks++;
+        if (desc->tx.callback != NULL) {
+            desc->tx.callback(desc->tx.callback_param);
+        }
+        host_desc_free(desc);
+    }
+}
+
+struct dma_chan *__dma_request_channel(const dma_cap_mask_t *mask, dma_filter_fn fn, void *fn_param)
+{
+    uint32_t used = 0;
+    size_t i;
+
+    (void)mask;
+    (void)fn;
+    (void)fn_param;
+    if (host_fail_take(HOST_FAIL_DMA_CHAN)) {
+        return NULL;
+    }
+    for (i = 0; i < ARRAY_SIZE(g_chans); i++) {
+        used += g_chans[i].used ? 1 : 0;
+    }
+    if (used >= g_config.channels) {
+        return NULL;
+    }
+    for (i = 0; i < ARRAY_SIZE(g_chans); i++) {
+        if (!g_chans[i].used) {
+            memset(&g_chans[i], 0, sizeof(g_chans[i]));
+            g_chans[i].used = true;
+            g_chans[i].canPause = g_config.canPause;
+            g_chans[i].chan.chan_id = (int)i;
+            g_chans[i].irq.fn = host_chan_irq;
+            g_chans[i].tasklet.fn = host_chan_tasklet;
+            return &g_chans[i].chan;
+        }
+    }
+
+    return NULL;
+}
+
+int dmaengine_terminate_sync(struct dma_chan *chan);
+
+void dma_release_channel(struct dma_chan *chan)
+{
+    struct HostDmaChan *hc = host_chan(chan);
+
+    dmaengine_terminate_sync(chan);
+    hc->used = false;
+}
+
+int dma_get_slave_caps(struct dma_chan *chan, struct dma_slave_caps *caps)
+{
+    memset(caps, 0, sizeof(*caps));
+    caps->directions = BIT(DMA_MEM_TO_DEV) | BIT(DMA_DEV_TO_MEM);
+    caps->max_burst = 16;
+    caps->cmd_pause = host_chan(chan)->canPause;
+    caps->cmd_resume = caps->cmd_pause;
+    caps->cmd_terminate = true;
+    caps->residue_granularity = DMA_RESIDUE_GRANULARITY_BURST;
+
+    return 0;
+}
+
+int dmaengine_slave_config(struct dma_chan *chan, struct dma_slave_config *config)
+{
+    host_dma_calls.slaveConfig++;
+    host_chan(chan)->config = *config;
+
+    return 0;
+}
+
+static struct dma_async_tx_descriptor *host_prep(struct dma_chan *chan, dma_addr_t buf, size_t len, size_t period,
+    bool cyclic, unsigned long flags)
+{
+    struct HostDmaDesc *desc;
+
+    if (len == 0 || period == 0 || period > len) {
+        return NULL;
+    }
+    desc = calloc(1, sizeof(*desc));
+    if (desc == NULL) {
+        return NULL;
+    }
+    g_descs_live++;
+    desc->tx.chan = chan;
+    desc->tx.flags = (enum dma_ctrl_flags)flags;
+    desc->cyclic = cyclic;
+    desc->buf = buf;
+    desc->len = (uint32_t)len;
+    desc->period = (uint32_t)period;
+
+    return &desc->tx;
+}
+
+struct dma_async_tx_descriptor *dmaengine_prep_slave_single(struct dma_chan *chan, dma_addr_t buf, size_t len,
+    enum dma_transfer_direction dir, unsigned long flags)
+{
+    (void)dir;
+    host_dma_calls.prepSingle++;
+    return host_prep(chan, buf, len, len, false, flags);
+}
+
+struct dma_async_tx_descriptor *dmaengine_prep_dma_cyclic(struct dma_chan *chan, dma_addr_t buf_addr,
+    size_t buf_len, size_t period_len, enum dma_transfer_direction dir, unsigned long flags)
+{
+    (void)dir;
+    host_dma_calls.prepCyclic++;
+    return host_prep(chan, buf_addr, buf_len, period_len, true, flags);
+}
+
+dma_cookie_t dmaengine_submit(struct dma_async_tx_descriptor *tx)
+{
+    struct HostDmaDesc *desc = container_of(tx, struct HostDmaDesc, tx);
+    struct HostDmaChan *hc = host_chan(tx->chan);
+
+    host_dma_calls.submit++;
+    tx->cookie = ++hc->cookie;
+    host_desc_append(&hc->submitted, desc);
+
+    return tx->cookie;
+}
+
+void dma_async_issue_pending(struct dma_chan *chan)
+{
+    struct HostDmaChan *hc = host_chan(chan);
+    struct HostDmaDesc *desc;
+
+    host_dma_calls.issuePending++;
+    while (hc->submitted != NULL) {
+        desc = hc->submitted;
+        hc->submitted = desc->next;
+        host_desc_append(&hc->issued, desc);
+    }
+    if (hc->running || hc->issued == NULL) {
+        return;
+    }
+    hc->running = true;
+    hc->anchorNs = ktime_get_ns();
+    hc->descStart = hc->anchorTotal;
+    if (!hc->paused) {
+        host_chan_arm_irq(hc);
+    }
+}
+
+int dmaengine_pause(struct dma_chan *chan)
+{
+    struct HostDmaChan *hc = host_chan(chan);
+
+    host_dma_calls.pause++;
+    if (!hc->canPause) {
+        return -ENOSYS;
+    }
+    if (hc->paused) {
+        return 0;
+    }
+    hc->pausedAtNs = ktime_get_ns();
+    hc->paused = true;
+    host_timer_cancel(&hc->irq);
+
+    return 0;
+}
+
+int dmaengine_resume(struct dma_chan *chan)
+{
+    struct HostDmaChan *hc = host_chan(chan);
+
+    host_dma_calls.resume++;
+    if (!hc->canPause) {
+        return -ENOSYS;
+    }
+    if (!hc->paused) {
+        return 0;
+    }
+    hc->paused = false;
+    hc->anchorNs += ktime_get_ns() - hc->pausedAtNs;
+    host_chan_arm_irq(hc);
+
+    return 0;
+}
+
+int dmaengine_terminate_async(struct dma_chan *chan)
+{
+    struct HostDmaChan *hc = host_chan(chan);
+
+    host_dma_calls.terminate++;
+    hc->anchorTotal = host_chan_total(hc);
+    hc->running = false;
+    hc->paused = false;
+    hc->pendingPeriods = 0;
+    host_timer_cancel(&hc->irq);
+    host_timer_cancel(&hc->tasklet);
+    host_desc_free_list(&hc->submitted);
+    host_desc_free_list(&hc->issued);
+    host_desc_free_list(&hc->completed);
+
+    return 0;
+}
+
+void dmaengine_synchronize(struct dma_chan *chan)
+{
+    (void)chan;
+    host_dma_calls.synchronize++;
+}
+
+int dmaengine_terminate_sync(struct dma_chan *chan)
+{
+    dmaengine_terminate_async(chan);
+    dmaengine_synchronize(chan);
+
+    return 0;
+}
+
+enum dma_status dmaengine_tx_status(struct dma_chan *chan, dma_cookie_t cookie, struct dma_tx_state *state)
+{
+    struct HostDmaChan *hc = host_chan(chan);
+    const struct HostDmaDesc *desc;
+    uint64_t offset;
+
+    host_dma_calls.txStatus++;
+    state->last = hc->cookie;
+    state->used = hc->cookie;
+    state->residue = 0;
+    for (desc = hc->issued; desc != NULL && desc->tx.cookie != cookie; desc = desc->next) {
+    }
+    if (desc == NULL) {
+        for (desc = hc->submitted; desc != NULL && desc->tx.cookie != cookie; desc = desc->next) {
+        }
+    }
+    if (desc == NULL) {
+        return DMA_COMPLETE;
+    }
+    if (g_config.reportResidue) {
+        if (desc == hc->issued) {
+            offset = host_chan_total(hc) - hc->descStart;
+            state->residue = desc->len - (uint32_t)(desc->cyclic ? offset % desc->len : offset);
+        } else {
+            state->residue = desc->len;
+        }
+    }
+
+    return hc->paused ? DMA_PAUSED : DMA_IN_PROGRESS;
+}
+
+void host_dma_set_fifo_rate(phys_addr_t addr, uint32_t bytesPerSec, int32_t ppm)
+{
+    size_t i;
+    size_t slot = ARRAY_SIZE(g_fifos);
+
+    for (i = 0; i < ARRAY_SIZE(g_fifos); i++) {
+        if (g_fifos[i].rate != 0 && g_fifos[i].addr == addr) {
+            slot = i;
+            break;
+        }
+        if (g_fifos[i].rate == 0 && slot == ARRAY_SIZE(g_fifos)) {
+            slot = i;
+        }
+    }
+    if (slot == ARRAY_SIZE(g_fifos)) {
+        return;
+    }
+    g_fifos[slot].addr = addr;
+    g_fifos[slot].rate = (uint64_t)bytesPerSec * (uint64_t)(1000000 + ppm);
+}
+
+void host_dma_configure(const struct HostDmaConfig *config)
+{
+    g_config = *config;
+}
+
+void host_dma_reset(void)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_chans); i++) {
+        if (g_chans[i].used) {
+            dma_release_channel(&g_chans[i].chan);
+        }
+    }
+    memset(g_fifos, 0, sizeof(g_fifos));
+    memset(&host_dma_calls, 0, sizeof(host_dma_calls));
+    g_config.canPause = true;
+    g_config.reportResidue = true;
+    g_config.channels = 8;
+    g_config.irqToTaskletNs = 0;
+    g_config.taskletJitterNs = 0;
+    g_jitter_seed = 1;
+}
+
+struct dma_chan *host_dma_chan_by_fifo(phys_addr_t addr)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_chans); i++) {
+        if (g_chans[i].used && host_chan_fifo(&g_chans[i]) == addr) {
+            return &g_chans[i].chan;
+        }
+    }
+
+    return NULL;
+}
+
+const struct dma_slave_config *host_dma_chan_config(const struct dma_chan *chan)
+{
+    return &host_chan(chan)->config;
+}
+
+uint64_t host_dma_chan_bytes(const struct dma_chan *chan)
+{
+    return host_chan_total(host_chan(chan));
+}
+
+dma_addr_t host_dma_chan_addr(const struct dma_chan *chan)
+{
+    const struct HostDmaChan *hc = host_chan(chan);
+    const struct HostDmaDesc *desc = hc->issued;
+    uint64_t offset;
+
+    if (desc == NULL) {
+        return 0;
+    }
+    offset = host_chan_total(hc) - hc->descStart;
+
+    return desc->buf + (desc->cyclic ? offset % desc->len : offset);
+}
+
+dma_addr_t host_dma_chan_ring(const struct dma_chan *chan)
+{
+    const struct HostDmaDesc *desc;
+
+    for (desc = host_chan(chan)->issued; desc != NULL; desc = desc->next) {
+        if (desc->cyclic) {
+            return desc->buf;
+        }
+    }
+
+    return 0;
+}
+
+uint32_t host_dma_chan_callbacks(const struct dma_chan *chan)
+{
+    return host_chan(chan)->callbacks;
+}
+
+int host_dma_chans_live(void)
+{
+    int live = 0;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_chans); i++) {
+        live += g_chans[i].used ? 1 : 0;
+    }
+
+    return live;
+}
+
+int host_dma_descs_live(void)
+{
+    return g_descs_live;
+}
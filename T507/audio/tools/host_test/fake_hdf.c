@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+
+#include "host_hdf.h"
+
+#define HOST_HCS_ATTRS      16
+
+struct HostHcsAttr {
+    const char *name;
+    bool isBool;
+    uint32_t value;
+};
+
+static struct HostHcsAttr g_attrs[HOST_HCS_ATTRS];
+
+unsigned long host_log_count[HOST_LOG_CNT];
+bool host_trace_enabled;
+unsigned long host_trace_hits;
+
+void host_log(enum HostLogLevel level, const char *func, int line, const char *fmt, ...)
+{
+    static const char *tags[HOST_LOG_CNT] = { "D", "I", "W", "E" };
+    static int verbose = -1;
+    va_list args;
+
+    host_log_count[level]++;
+    if (verbose < 0) {
+        verbose = (getenv("HOST_TEST_VERBOSE") != NULL);
+    }
+    if (!verbose) {
+        return;
+    }
+    fprintf(stderr, "%s [%s][line:%d]: ", tags[level], func, line);
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+errno_t memset_s(void *dest, size_t destMax, int c, size_t count)
+{
+    if (dest == NULL || count > destMax) {
+        return EINVAL;
+    }
+    memset(dest, c, count);
+
+    return EOK;
+}
+
+errno_t memcpy_s(void *dest, size_t destMax, const void *src, size_t count)
+{
+    if (dest == NULL || src == NULL || count > destMax) {
+        return EINVAL;
+    }
+    memcpy(dest, src, count);
+
+    return EOK;
+}
+
+void *OsalMemCalloc(size_t size)
+{
+    return kzalloc(size, GFP_KERNEL);
+}
+
+void OsalMemFree(void *mem)
+{
+    kfree(mem);
+}
+
+static struct HostHcsAttr *host_hcs_find(const char *attrName, bool create)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_attrs); i++) {
+        if (g_attrs[i].name != NULL && strcmp(g_attrs[i].name, attrName) == 0) {
+            return &g_attrs[i];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    for (i = 0; i < ARRAY_SIZE(g_attrs); i++) {
+        if (g_attrs[i].name == NULL) {
+            g_attrs[i].name = attrName;
+            return &g_attrs[i];
+        }
+    }
+
+    return NULL;
+}
+
+void host_hcs_reset(void)
+{
+    memset(g_attrs, 0, sizeof(g_attrs));
+}
+
+void host_hcs_set_bool(const char *attrName, bool value)
+{
+    struct HostHcsAttr *attr = host_hcs_find(attrName, true);
+
+    if (attr != NULL) {
+        attr->isBool = true;
+        attr->value = value;
+    }
+}
+
+void host_hcs_set_u32(const char *attrName, uint32_t value)
+{
+    struct HostHcsAttr *attr = host_hcs_find(attrName, true);
+
+    if (attr != NULL) {
+        attr->isBool = false;
+        attr->value = value;
+    }
+}
+
+/* a bool attribute is true when present, like an empty HCS property */
+static bool host_hcs_get_bool(const struct DeviceResourceNode *node, const char *attrName)
+{
+    const struct HostHcsAttr *attr = host_hcs_find(attrName, false);
+
+    (void)node;
+    return attr != NULL && attr->isBool && attr->value != 0;
+}
+
+static int32_t host_hcs_get_u32(const struct DeviceResourceNode *node, const char *attrName, uint32_t *value,
+    uint32_t def)
+{
+    const struct HostHcsAttr *attr = host_hcs_find(attrName, false);
+
+    (void)node;
+    if (attr == NULL || attr->isBool) {
+        *value = def;
+        return HDF_FAILURE;
+    }
+    *value = attr->value;
+
+    return HDF_SUCCESS;
+}
+
+static int32_t host_hcs_get_string(const struct DeviceResourceNode *node, const char *attrName, const char **value,
+    const char *def)
+{
+    (void)node;
+    (void)attrName;
+    *value = def;
+
+    return HDF_FAILURE;
+}
+
+static struct DeviceResourceIface g_hcs_iface = {
+    .GetBool = host_hcs_get_bool,
+    .GetUint32 = host_hcs_get_u32,
+    .GetString = host_hcs_get_string,
+};
+
+struct DeviceResourceIface *DeviceResourceGetIfaceInstance(int type)
+{
+    (void)type;
+    return &g_hcs_iface;
+}
+
+int32_t AudioGetCtrlOpsReg(struct AudioCtrlElemValue *elemValue, const struct AudioMixerControl *mixerCtrl,
+    uint32_t rcurValue)
+{
+    uint32_t curValue = (rcurValue >> mixerCtrl->shift) & mixerCtrl->mask;
+
+    if (curValue > (uint32_t)mixerCtrl->max) {
+        return HDF_FAILURE;
+    }
+    elemValue->value[0] = mixerCtrl->invert ? mixerCtrl->max - curValue : curValue;
+
+    return HDF_SUCCESS;
+}
+
+int32_t AudioGetCtrlOpsRReg(struct AudioCtrlElemValue *elemValue, const struct AudioMixerControl *mixerCtrl,
+    uint32_t rcurValue)
+{
+    uint32_t curValue;
+
+    if (mixerCtrl->reg == mixerCtrl->rreg && mixerCtrl->shift == mixerCtrl->rshift) {
+        return HDF_SUCCESS;
+    }
+    curValue = (rcurValue >> mixerCtrl->rshift) & mixerCtrl->mask;
+    if (curValue > (uint32_t)mixerCtrl->max) {
+        return HDF_FAILURE;
+    }
+    elemValue->value[1] = mixerCtrl->invert ? mixerCtrl->max - curValue : curValue;
+
+    return HDF_SUCCESS;
+}
+
+static int32_t host_ctrl_value(const struct AudioMixerControl *mixerCtrl, uint32_t val, uint32_t *value)
+{
+    if ((int32_t)val < mixerCtrl->min || (int32_t)val > mixerCtrl->max) {
+        return HDF_FAILURE;
+    }
+    *value = mixerCtrl->invert ? mixerCtrl->max - val : val;
+
+    return HDF_SUCCESS;
+}
+
+int32_t AudioSetCtrlOpsReg(const struct AudioKcontrol *kcontrol, const struct AudioCtrlElemValue *elemValue,
+    const struct AudioMixerControl *mixerCtrl, uint32_t *value)
+{
+    (void)kcontrol;
+
+    return host_ctrl_value(mixerCtrl, elemValue->value[0], value);
+}
+
+int32_t AudioSetCtrlOpsRReg(const struct AudioCtrlElemValue *elemValue, struct AudioMixerControl *mixerCtrl,
+    uint32_t *rvalue, bool *updateRReg)
+{
+    *updateRReg = false;
+    if (mixerCtrl->reg == mixerCtrl->rreg && mixerCtrl->shift == mixerCtrl->rshift) {
+        return HDF_SUCCESS;
+    }
+    *updateRReg = true;
+
+    return host_ctrl_value(mixerCtrl, elemValue->value[1], rvalue);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * What t507_dma_ops.c calls in the ahub and codec drivers and in the dma
+ * device, reduced to flags the test sets and counters it reads.
+ */
+
+#include "t507_codec_impl_linux.h"
+#include "t507_dai_ahub_impl_linux.h"
+#include "t507_dma_ops.h"
+#include "host_impl.h"
+
+struct HostImpl host_impl = {
+    .ahubApbNum = AHUB_APBIF_0,
+};
+
+/* index of a stream in the per-stream arrays */
+static int host_impl_dir(enum AudioStreamType streamType)
+{
+    return (streamType == AUDIO_RENDER_STREAM) ? 1 : 0;
+}
+
+bool T507AhubImplXrunCheck(enum AudioStreamType streamType)
+{
+    bool xrun = host_impl.ahubXrun[host_impl_dir(streamType)];
+
+    host_impl.ahubXrun[host_impl_dir(streamType)] = false;
+    return xrun;
+}
+
+int32_t T507AhubImplXrunRecover(enum AudioStreamType streamType)
+{
+    host_impl.ahubRecover[host_impl_dir(streamType)]++;
+    return HDF_SUCCESS;
+}
+
+uint32_t T507AhubImplFifoAvail(enum AudioStreamType streamType, uint32_t *count)
+{
+    (void)streamType;
+    *count = 0;
+    return 0;
+}
+
+int32_t T507AhubImplApbNum(uint32_t *apb_num)
+{
+    *apb_num = host_impl.ahubApbNum;
+    return HDF_SUCCESS;
+}
+
+int32_t T507AhubImplCaptureTap(uint32_t apb_num, bool enable)
+{
+    if (apb_num >= AHUB_APBIF_NUM) {
+        return HDF_FAILURE;
+    }
+    host_impl.tapEnabled[apb_num] = enable;
+    return HDF_SUCCESS;
+}
+
+bool T507CodecImplXrunCheck(enum AudioStreamType streamType)
+{
+    bool xrun = host_impl.codecXrun[host_impl_dir(streamType)];
+
+    host_impl.codecXrun[host_impl_dir(streamType)] = false;
+    return xrun;
+}
+
+int32_t T507CodecImplXrunRecover(enum AudioStreamType streamType)
+{
+    host_impl.codecRecover[host_impl_dir(streamType)]++;
+    return HDF_SUCCESS;
+}
+
+uint32_t T507CodecImplFifoAvail(enum AudioStreamType streamType, uint32_t *count)
+{
+    (void)streamType;
+    *count = 0;
+    return 0;
+}
+
+/* the dma device has its own misc device plumbing, only its lifetime matters here */
+struct T507DmaCdev {
+    struct PlatformData *data;
+};
+
+struct T507DmaCdev *T507AudioDmaCdevCreate(struct PlatformData *data)
+{
+    struct T507DmaCdev *cdev = kzalloc(sizeof(*cdev), GFP_KERNEL);
+
+    if (cdev != NULL) {
+        cdev->data = data;
+    }
+    return cdev;
+}
+
+void T507AudioDmaCdevDestroy(struct T507DmaCdev *cdev)
+{
+    kfree(cdev);
+}
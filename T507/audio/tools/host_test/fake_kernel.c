@@ -0,0 +1,612 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include "host_kernel.h"
+
+static uint64_t g_now_ns;
+static struct HostTimer *g_timers;
+static int g_mem_live;
+static int g_fail[HOST_FAIL_CNT];
+
+unsigned long host_wakeups;
+bool host_signal;
+uint64_t host_work_latency_ns;
+struct HostDmaSyncStats host_dma_sync;
+void (*host_dma_sync_cpu_hook)(dma_addr_t addr, size_t size);
+size_t host_sram_size;
+
+u64 ktime_get_ns(void)
+{
+    return g_now_ns;
+}
+
+void host_timer_arm(struct HostTimer *timer, uint64_t due)
+{
+    if (!timer->armed) {
+        timer->next = g_timers;
+        g_timers = timer;
+        timer->armed = true;
+    }
+    timer->due = (due < g_now_ns) ? g_now_ns : due;
+}
+
+void host_timer_cancel(struct HostTimer *timer)
+{
+    struct HostTimer **pp;
+
+    if (!timer->armed) {
+        return;
+    }
+    for (pp = &g_timers; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == timer) {
+            *pp = timer->next;
+            break;
+        }
+    }
+    timer->armed = false;
+    timer->next = NULL;
+}
+
+static struct HostTimer *host_timer_first(void)
+{
+    struct HostTimer *timer;
+    struct HostTimer *first = NULL;
+
+    for (timer = g_timers; timer != NULL; timer = timer->next) {
+        if (first == NULL || timer->due < first->due) {
+            first = timer;
+        }
+    }
+
+    return first;
+}
+
+bool host_step(uint64_t deadline)
+{
+    struct HostTimer *timer = host_timer_first();
+
+    if (timer == NULL || timer->due > deadline) {
+        g_now_ns = deadline;
+        return false;
+    }
+    g_now_ns = timer->due;
+    host_timer_cancel(timer);
+    timer->fn(timer);
+
+    return true;
+}
+
+void host_advance(uint64_t ns)
+{
+    uint64_t deadline = g_now_ns + ns;
+
+    while (host_step(deadline)) {
+    }
+}
+
+void host_busy(uint64_t ns)
+{
+    g_now_ns += ns;
+}
+
+void host_clock_reset(void)
+{
+    while (g_timers != NULL) {
+        host_timer_cancel(g_timers);
+    }
+    g_now_ns = 0;
+}
+
+int host_mem_live(void)
+{
+    return g_mem_live;
+}
+
+void host_fail_next(enum HostFailKind kind, int n)
+{
+    g_fail[kind] = n;
+}
+
+bool host_fail_take(enum HostFailKind kind)
+{
+    if (g_fail[kind] == 0) {
+        return false;
+    }
+    g_fail[kind]--;
+
+    return true;
+}
+
+unsigned long msecs_to_jiffies(unsigned int ms)
+{
+    return ms * HZ / MSEC_PER_SEC;
+}
+
+long host_wait_step(long left)
+{
+    uint64_t deadline = g_now_ns + (uint64_t)left * (NSEC_PER_SEC / HZ);
+
+    host_step(deadline);
+
+    return (long)DIV_ROUND_UP(deadline - g_now_ns, NSEC_PER_SEC / HZ);
+}
+
+static void host_work_fire(struct HostTimer *timer)
+{
+    struct work_struct *work = container_of(timer, struct work_struct, timer);
+
+    work->func(work);
+}
+
+void host_work_init(struct work_struct *work, work_func_t func)
+{
+    host_timer_cancel(&work->timer);
+    work->func = func;
+    work->timer.fn = host_work_fire;
+}
+
+bool schedule_work(struct work_struct *work)
+{
+    if (work->timer.armed) {
+        return false;
+    }
+    host_timer_arm(&work->timer, g_now_ns + host_work_latency_ns);
+
+    return true;
+}
+
+bool cancel_work_sync(struct work_struct *work)
+{
+    bool pending = work->timer.armed;
+
+    host_timer_cancel(&work->timer);
+
+    return pending;
+}
+
+struct workqueue_struct *system_wq;
+
+unsigned long nsecs_to_jiffies(u64 ns)
+{
+    return (unsigned long)(ns / (NSEC_PER_SEC / HZ));
+}
+
+bool schedule_delayed_work(struct delayed_work *dwork, unsigned long delay)
+{
+    if (dwork->work.timer.armed) {
+        return false;
+    }
+    host_timer_arm(&dwork->work.timer, g_now_ns + (uint64_t)delay * (NSEC_PER_SEC / HZ) + host_work_latency_ns);
+
+    return true;
+}
+
+bool mod_delayed_work(struct workqueue_struct *wq, struct delayed_work *dwork, unsigned long delay)
+{
+    bool pending = dwork->work.timer.armed;
+
+    (void)wq;
+    host_timer_cancel(&dwork->work.timer);
+    schedule_delayed_work(dwork, delay);
+
+    return pending;
+}
+
+bool cancel_delayed_work(struct delayed_work *dwork)
+{
+    return cancel_work_sync(&dwork->work);
+}
+
+bool cancel_delayed_work_sync(struct delayed_work *dwork)
+{
+    return cancel_work_sync(&dwork->work);
+}
+
+/* the two dts nodes the audio platforms look up */
+static struct device_node g_nodes[] = {
+    { "/soc@03000000/codec@0x05096000" },
+    { "/soc@03000000/ahub@0x05097000" },
+};
+
+static struct platform_device g_pdevs[ARRAY_SIZE(g_nodes)];
+
+struct device_node *of_find_node_by_path(const char *path)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_nodes); i++) {
+        if (strcmp(g_nodes[i].full_name, path) == 0) {
+            return &g_nodes[i];
+        }
+    }
+
+    return NULL;
+}
+
+struct platform_device *of_find_device_by_node(struct device_node *np)
+{
+    size_t i = (size_t)(np - g_nodes);
+
+    if (i >= ARRAY_SIZE(g_nodes)) {
+        return NULL;
+    }
+    g_pdevs[i].dev.of_node = np;
+    g_pdevs[i].dev.init_name = np->full_name;
+
+    return &g_pdevs[i];
+}
+
+const char *dev_name(const struct device *dev)
+{
+    return dev->init_name;
+}
+
+void *kzalloc(size_t size, gfp_t flags)
+{
+    void *p;
+
+    (void)flags;
+    if (host_fail_take(HOST_FAIL_KZALLOC)) {
+        return NULL;
+    }
+    p = calloc(1, size);
+    if (p != NULL) {
+        g_mem_live++;
+    }
+
+    return p;
+}
+
+void *kcalloc(size_t n, size_t size, gfp_t flags)
+{
+    return kzalloc(n * size, flags);
+}
+
+void kfree(const void *p)
+{
+    if (p != NULL) {
+        g_mem_live--;
+        free((void *)p);
+    }
+}
+
+unsigned long __get_free_pages(gfp_t flags, unsigned int order)
+{
+    size_t size = PAGE_SIZE << order;
+    void *p;
+
+    if (host_fail_take(HOST_FAIL_PAGES)) {
+        return 0;
+    }
+    p = aligned_alloc(PAGE_SIZE, size);
+    if (p == NULL) {
+        return 0;
+    }
+    if (flags & __GFP_ZERO) {
+        memset(p, 0, size);
+    }
+    g_mem_live++;
+
+    return (unsigned long)p;
+}
+
+unsigned long get_zeroed_page(gfp_t flags)
+{
+    return __get_free_pages(flags | __GFP_ZERO, 0);
+}
+
+void free_pages(unsigned long addr, unsigned int order)
+{
+    (void)order;
+    if (addr != 0) {
+        g_mem_live--;
+        free((void *)addr);
+    }
+}
+
+void free_page(unsigned long addr)
+{
+    free_pages(addr, 0);
+}
+
+int get_order(unsigned long size)
+{
+    int order = 0;
+
+    size = (size - 1) >> PAGE_SHIFT;
+    while (size != 0) {
+        order++;
+        size >>= 1;
+    }
+
+    return order;
+}
+
+phys_addr_t virt_to_phys(volatile void *addr)
+{
+    return (phys_addr_t)(uintptr_t)addr;
+}
+
+void *dma_alloc_wc(struct device *dev, size_t size, dma_addr_t *handle, gfp_t flags)
+{
+    void *p;
+
+    (void)dev;
+    (void)flags;
+    if (host_fail_take(HOST_FAIL_DMA_ALLOC)) {
+        return NULL;
+    }
+    p = aligned_alloc(PAGE_SIZE, PAGE_ALIGN(size));
+    if (p == NULL) {
+        return NULL;
+    }
+    memset(p, 0, PAGE_ALIGN(size));
+    *handle = (dma_addr_t)(uintptr_t)p;
+    g_mem_live++;
+
+    return p;
+}
+
+void dma_free_wc(struct device *dev, size_t size, void *cpu, dma_addr_t handle)
+{
+    (void)dev;
+    (void)size;
+    (void)handle;
+    if (cpu != NULL) {
+        g_mem_live--;
+        free(cpu);
+    }
+}
+
+dma_addr_t dma_map_single(struct device *dev, void *ptr, size_t size, enum dma_data_direction dir)
+{
+    (void)dev;
+    (void)size;
+    (void)dir;
+    return (dma_addr_t)(uintptr_t)ptr;
+}
+
+void dma_unmap_single(struct device *dev, dma_addr_t addr, size_t size, enum dma_data_direction dir)
+{
+    (void)dev;
+    (void)addr;
+    (void)size;
+    (void)dir;
+}
+
+int dma_mapping_error(struct device *dev, dma_addr_t addr)
+{
+    (void)dev;
+    return addr == 0;
+}
+
+void dma_sync_single_for_cpu(struct device *dev, dma_addr_t addr, size_t size, enum dma_data_direction dir)
+{
+    (void)dev;
+    (void)dir;
+    host_dma_sync.forCpu++;
+    host_dma_sync.cpuBytes += size;
+    if (host_dma_sync_cpu_hook != NULL) {
+        host_dma_sync_cpu_hook(addr, size);
+    }
+}
+
+void dma_sync_single_for_device(struct device *dev, dma_addr_t addr, size_t size, enum dma_data_direction dir)
+{
+    (void)dev;
+    (void)addr;
+    (void)size;
+    (void)dir;
+    host_dma_sync.forDevice++;
+}
+
+int remap_pfn_range(struct vm_area_struct *vma, unsigned long addr, unsigned long pfn, unsigned long size,
+    pgprot_t prot)
+{
+    (void)addr;
+    (void)size;
+    vma->host_pfn = pfn;
+    vma->vm_page_prot = prot;
+
+    return 0;
+}
+
+int dma_mmap_wc(struct device *dev, struct vm_area_struct *vma, void *cpu, dma_addr_t handle, size_t size)
+{
+    (void)dev;
+    (void)cpu;
+    return remap_pfn_range(vma, vma->vm_start, handle >> PAGE_SHIFT, size, pgprot_writecombine(vma->vm_page_prot));
+}
+
+/* first fit is enough for one or two rings */
+struct gen_pool {
+    size_t used;
+};
+
+static struct gen_pool g_sram;
+
+struct gen_pool *of_gen_pool_get(struct device_node *np, const char *propname, int index)
+{
+    (void)np;
+    (void)propname;
+    (void)index;
+    return (host_sram_size != 0) ? &g_sram : NULL;
+}
+
+void *gen_pool_dma_alloc(struct gen_pool *pool, size_t size, dma_addr_t *dma)
+{
+    void *p;
+
+    if (pool->used + size > host_sram_size) {
+        return NULL;
+    }
+    p = aligned_alloc(PAGE_SIZE, PAGE_ALIGN(size));
+    if (p == NULL) {
+        return NULL;
+    }
+    pool->used += size;
+    *dma = (dma_addr_t)(uintptr_t)p;
+    g_mem_live++;
+
+    return p;
+}
+
+void gen_pool_free(struct gen_pool *pool, unsigned long addr, size_t size)
+{
+    pool->used -= size;
+    g_mem_live--;
+    free((void *)addr);
+}
+
+#define HOST_DEBUGFS_FILES  32
+
+struct dentry {
+    char name[64];
+    bool used;
+};
+
+struct HostDebugfsFile {
+    struct dentry *dir;
+    char name[64];
+    u32 *value;
+    void *data;
+    const struct file_operations *fops;
+};
+
+static struct dentry g_dirs[8];
+static struct HostDebugfsFile g_files[HOST_DEBUGFS_FILES];
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent)
+{
+    size_t i;
+
+    (void)parent;
+    for (i = 0; i < ARRAY_SIZE(g_dirs); i++) {
+        if (!g_dirs[i].used) {
+            g_dirs[i].used = true;
+            snprintf(g_dirs[i].name, sizeof(g_dirs[i].name), "%s", name);
+            return &g_dirs[i];
+        }
+    }
+
+    return ERR_PTR(-ENOMEM);
+}
+
+static struct HostDebugfsFile *host_debugfs_add(const char *name, struct dentry *parent)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_files); i++) {
+        if (g_files[i].dir == NULL) {
+            memset(&g_files[i], 0, sizeof(g_files[i]));
+            g_files[i].dir = parent;
+            snprintf(g_files[i].name, sizeof(g_files[i].name), "%s", name);
+            return &g_files[i];
+        }
+    }
+
+    return NULL;
+}
+
+void debugfs_create_u32(const char *name, unsigned short mode, struct dentry *parent, u32 *value)
+{
+    struct HostDebugfsFile *file = host_debugfs_add(name, parent);
+
+    (void)mode;
+    if (file != NULL) {
+        file->value = value;
+    }
+}
+
+struct dentry *debugfs_create_file(const char *name, unsigned short mode, struct dentry *parent, void *data,
+    const struct file_operations *fops)
+{
+    struct HostDebugfsFile *file = host_debugfs_add(name, parent);
+
+    (void)mode;
+    if (file == NULL) {
+        return ERR_PTR(-ENOMEM);
+    }
+    file->data = data;
+    file->fops = fops;
+
+    return parent;
+}
+
+void debugfs_remove_recursive(struct dentry *dentry)
+{
+    size_t i;
+
+    if (IS_ERR_OR_NULL(dentry)) {
+        return;
+    }
+    for (i = 0; i < ARRAY_SIZE(g_files); i++) {
+        if (g_files[i].dir == dentry) {
+            g_files[i].dir = NULL;
+        }
+    }
+    dentry->used = false;
+}
+
+static struct HostDebugfsFile *host_debugfs_find(const char *dir, const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(g_files); i++) {
+        if (g_files[i].dir != NULL && strcmp(g_files[i].dir->name, dir) == 0 &&
+            strcmp(g_files[i].name, name) == 0) {
+            return &g_files[i];
+        }
+    }
+
+    return NULL;
+}
+
+u32 *host_debugfs_u32(const char *dir, const char *name)
+{
+    struct HostDebugfsFile *file = host_debugfs_find(dir, name);
+
+    return (file != NULL) ? file->value : NULL;
+}
+
+ssize_t host_debugfs_read(const char *dir, const char *name, char *buf, size_t size, size_t chunk)
+{
+    struct HostDebugfsFile *entry = host_debugfs_find(dir, name);
+    struct inode inode;
+    struct file file;
+    size_t total = 0;
+    ssize_t ret;
+
+    if (entry == NULL || entry->fops == NULL) {
+        return -ENOENT;
+    }
+    inode.i_private = entry->data;
+    memset(&file, 0, sizeof(file));
+    ret = entry->fops->open(&inode, &file);
+    if (ret < 0) {
+        return ret;
+    }
+    do {
+        ret = entry->fops->read(&file, buf + total, min(chunk, size - total), &file.f_pos);
+        if (ret > 0) {
+            total += (size_t)ret;
+        }
+    } while (ret > 0 && total < size);
+    entry->fops->release(&inode, &file);
+
+    return (ret < 0) ? ret : (ssize_t)total;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_test.h"
+
+static int g_case_failures;
+
+void host_check_failed(const char *file, int line, const char *expr, long long a, long long b)
+{
+    g_case_failures++;
+    if (a != b) {
+        printf("    %s:%d: %s (%lld vs %lld)\n", file, line, expr, a, b);
+    } else {
+        printf("    %s:%d: %s\n", file, line, expr);
+    }
+}
+
+void host_report(const char *fmt, ...)
+{
+    va_list args;
+
+    printf("    # ");
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    putchar('\n');
+}
+
+uint64_t host_wall_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* with arguments only the cases whose name contains one of them run */
+static int host_test_selected(const char *name, int argc, char **argv)
+{
+    int i;
+
+    if (argc < 2) {
+        return 1;
+    }
+    for (i = 1; i < argc; i++) {
+        if (strstr(name, argv[i]) != NULL) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int host_test_main(const struct HostTestCase *cases, size_t count, void (*reset)(void), int argc, char **argv)
+{
+    size_t failed = 0;
+    size_t ran = 0;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (!host_test_selected(cases[i].name, argc, argv)) {
+            continue;
+        }
+        g_case_failures = 0;
+        printf("  %s\n", cases[i].name);
+        fflush(stdout);
+        reset();
+        cases[i].run();
+        ran++;
+        if (g_case_failures != 0) {
+            printf("  FAIL %s\n", cases[i].name);
+            failed++;
+        }
+    }
+    printf("%zu/%zu passed\n", ran - failed, ran);
+
+    return failed != 0;
+}
@@ -0,0 +1 @@
+#include "host_hdf.h"
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The platform device side of the kernel api, for building the ahub and codec
+ * drivers unchanged: regmap-mmio over a register array with the bus accesses
+ * counted, clocks and regulators whose enable costs virtual time, runtime pm
+ * with the autosuspend timer on the virtual clock, dts properties the test
+ * sets, sysfs, seq_file and devm. Backed by fake_device.c.
+ */
+
+#ifndef HOST_DEVICE_H
+#define HOST_DEVICE_H
+
+#include <stdarg.h>
+
+#include "host_kernel.h"
+#include "host_hdf.h"
+
+#define MODULE_AUTHOR(x)
+#define MODULE_DEVICE_TABLE(type, name)
+
+#define pr_info(fmt, ...)   host_log(HOST_LOG_INFO, __func__, __LINE__, fmt, ##__VA_ARGS__)
+#define pr_err(fmt, ...)    host_log(HOST_LOG_ERR, __func__, __LINE__, fmt, ##__VA_ARGS__)
+
+int scnprintf(char *buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+void msleep(unsigned int ms);
+void usleep_range(unsigned long min, unsigned long max);
+void udelay(unsigned long us);
+
+/* resources and devm, released in reverse order when the driver is removed */
+struct resource {
+    phys_addr_t start;
+    phys_addr_t end;
+    const char *name;
+};
+
+static inline unsigned long resource_size(const struct resource *res)
+{
+    return (unsigned long)(res->end - res->start + 1);
+}
+
+void *devm_kzalloc(struct device *dev, size_t size, gfp_t flags);
+void *devm_kcalloc(struct device *dev, size_t n, size_t size, gfp_t flags);
+void devm_kfree(struct device *dev, const void *p);
+struct resource *devm_request_mem_region(struct device *dev, phys_addr_t start, unsigned long n, const char *name);
+void devm_release_mem_region(struct device *dev, phys_addr_t start, unsigned long n);
+void __iomem *devm_ioremap(struct device *dev, phys_addr_t start, unsigned long size);
+void devm_iounmap(struct device *dev, void __iomem *addr);
+
+/* device tree: properties of a node are what the test set, "reg" is <start size> */
+int of_property_read_u32(const struct device_node *np, const char *name, u32 *value);
+int of_property_read_u32_array(const struct device_node *np, const char *name, u32 *values, size_t n);
+int of_property_read_string(const struct device_node *np, const char *name, const char **value);
+bool of_property_read_bool(const struct device_node *np, const char *name);
+int of_address_to_resource(struct device_node *np, int index, struct resource *res);
+void of_node_put(struct device_node *np);
+
+enum of_gpio_flags {
+    OF_GPIO_ACTIVE_LOW = 0x1,
+};
+
+int of_get_named_gpio_flags(struct device_node *np, const char *name, int index, enum of_gpio_flags *flags);
+
+void host_of_set_u32(const struct device_node *np, const char *name, u32 value);
+void host_of_set_u32_array(const struct device_node *np, const char *name, const u32 *values, size_t n);
+void host_of_set_string(const struct device_node *np, const char *name, const char *value);
+void host_of_set_bool(const struct device_node *np, const char *name);
+
+/* regmap */
+enum regcache_type {
+    REGCACHE_NONE = 0,
+    REGCACHE_RBTREE,
+    REGCACHE_COMPRESSED,
+    REGCACHE_FLAT,
+};
+
+struct reg_default {
+    unsigned int reg;
+    unsigned int def;
+};
+
+struct reg_sequence {
+    unsigned int reg;
+    unsigned int def;
+    unsigned int delay_us;
+};
+
+struct regmap_config {
+    const char *name;
+    int reg_bits;
+    int reg_stride;
+    int val_bits;
+    unsigned int max_register;
+    bool (*volatile_reg)(struct device *dev, unsigned int reg);
+    const struct reg_default *reg_defaults;
+    unsigned int num_reg_defaults;
+    enum regcache_type cache_type;
+};
+
+/* what went over the bus, the cache hits never show up here */
+struct HostRegmapStats {
+    uint32_t busReads;
+    uint32_t busWrites;
+    uint32_t fillReads;     /* reads of cacheable registers the cache did not hold yet */
+    uint32_t syncWrites;
+};
+
+struct regmap;
+
+struct regmap *devm_regmap_init_mmio(struct device *dev, void __iomem *regs, const struct regmap_config *config);
+int regmap_read(struct regmap *map, unsigned int reg, unsigned int *val);
+int regmap_write(struct regmap *map, unsigned int reg, unsigned int val);
+int regmap_update_bits(struct regmap *map, unsigned int reg, unsigned int mask, unsigned int val);
+int regmap_multi_reg_write(struct regmap *map, const struct reg_sequence *regs, int num_regs);
+void regcache_cache_only(struct regmap *map, bool enable);
+void regcache_cache_bypass(struct regmap *map, bool enable);
+void regcache_mark_dirty(struct regmap *map);
+int regcache_sync(struct regmap *map);
+
+/* every bus access costs host_mmio_ns of virtual time, the apb round trip */
+extern uint64_t host_mmio_ns;
+/* runs after each bus write, for the self-clearing and write-1-to-clear bits of the block */
+extern void (*host_mmio_write_hook)(unsigned int reg, u32 old, u32 *hw);
+struct HostRegmapStats *host_regmap_stats(struct regmap *map);
+/* the register array behind the map, what the hardware holds */
+u32 *host_regmap_hw(struct regmap *map);
+
+/* clocks and regulators, enables cost their settle time on the virtual clock */
+struct clk {
+    char name[32];
+    unsigned long rate;
+    struct clk *parent;
+    int enableCount;
+    uint64_t lockNs;        /* pll lock after enable or a rate change while enabled */
+    uint32_t setRates;
+};
+
+struct clk *of_clk_get(struct device_node *np, int index);
+void clk_put(struct clk *clk);
+int clk_set_parent(struct clk *clk, struct clk *parent);
+int clk_prepare_enable(struct clk *clk);
+void clk_disable_unprepare(struct clk *clk);
+int clk_set_rate(struct clk *clk, unsigned long rate);
+unsigned long clk_get_rate(struct clk *clk);
+
+struct regulator {
+    char name[32];
+    int uV;
+    int enableCount;
+    uint64_t rampNs;
+};
+
+struct regulator *regulator_get(struct device *dev, const char *id);
+void regulator_put(struct regulator *regulator);
+int regulator_set_voltage(struct regulator *regulator, int minUv, int maxUv);
+int regulator_enable(struct regulator *regulator);
+int regulator_disable(struct regulator *regulator);
+int regulator_is_enabled(struct regulator *regulator);
+
+/* the clock at index of a node and the regulator of a name, created on first use like the driver would */
+struct clk *host_clk(const struct device_node *np, int index);
+struct regulator *host_regulator(const char *id);
+
+/* pinctrl */
+#define PINCTRL_STATE_DEFAULT   "default"
+#define PINCTRL_STATE_SLEEP     "sleep"
+
+struct pinctrl;
+struct pinctrl_state;
+
+struct pinctrl *devm_pinctrl_get(struct device *dev);
+void devm_pinctrl_put(struct pinctrl *p);
+struct pinctrl_state *pinctrl_lookup_state(struct pinctrl *p, const char *name);
+int pinctrl_select_state(struct pinctrl *p, struct pinctrl_state *state);
+
+/* sysfs: the test reads and writes attributes by name */
+struct attribute {
+    const char *name;
+    unsigned short mode;
+};
+
+struct device_attribute {
+    struct attribute attr;
+    ssize_t (*show)(struct device *dev, struct device_attribute *attr, char *buf);
+    ssize_t (*store)(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+};
+
+struct attribute_group {
+    const char *name;
+    struct attribute **attrs;
+};
+
+#define DEVICE_ATTR(_name, _mode, _show, _store)                                \
+    struct device_attribute dev_attr_##_name = {                                \
+        .attr = { .name = #_name, .mode = (_mode) }, .show = (_show), .store = (_store) }
+
+int sysfs_create_group(struct kobject *kobj, const struct attribute_group *grp);
+void sysfs_remove_group(struct kobject *kobj, const struct attribute_group *grp);
+ssize_t host_sysfs_show(struct device *dev, const char *name, char *buf);
+ssize_t host_sysfs_store(struct device *dev, const char *name, const char *buf);
+
+/* seq_file, single_open only */
+struct seq_file {
+    char *buf;
+    size_t size;
+    size_t count;
+    size_t from;
+    int (*show)(struct seq_file *m, void *v);
+    void *private;
+};
+
+void seq_printf(struct seq_file *m, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void seq_write(struct seq_file *m, const void *data, size_t len);
+int single_open(struct file *file, int (*show)(struct seq_file *m, void *v), void *data);
+int single_release(struct inode *inode, struct file *file);
+ssize_t seq_read(struct file *file, char __user *buf, size_t size, long long *ppos);
+long long seq_lseek(struct file *file, long long offset, int whence);
+
+/* runtime and system pm, callbacks come from the bound driver */
+struct dev_pm_ops {
+    int (*suspend)(struct device *dev);
+    int (*resume)(struct device *dev);
+    int (*runtime_suspend)(struct device *dev);
+    int (*runtime_resume)(struct device *dev);
+    int (*runtime_idle)(struct device *dev);
+};
+
+#define SET_RUNTIME_PM_OPS(suspend_fn, resume_fn, idle_fn)                      \
+    .runtime_suspend = (suspend_fn), .runtime_resume = (resume_fn), .runtime_idle = (idle_fn),
+#define SET_SYSTEM_SLEEP_PM_OPS(suspend_fn, resume_fn)                          \
+    .suspend = (suspend_fn), .resume = (resume_fn),
+
+void pm_runtime_enable(struct device *dev);
+void pm_runtime_disable(struct device *dev);
+int pm_runtime_set_active(struct device *dev);
+void pm_runtime_set_autosuspend_delay(struct device *dev, int delay);
+void pm_runtime_use_autosuspend(struct device *dev);
+void pm_runtime_dont_use_autosuspend(struct device *dev);
+void pm_runtime_mark_last_busy(struct device *dev);
+int pm_runtime_get_sync(struct device *dev);
+int pm_runtime_put_autosuspend(struct device *dev);
+void pm_runtime_put_noidle(struct device *dev);
+int pm_request_autosuspend(struct device *dev);
+bool pm_runtime_suspended(struct device *dev);
+int pm_runtime_force_suspend(struct device *dev);
+int pm_runtime_force_resume(struct device *dev);
+
+/* platform driver, the test binds it to a device of its own */
+struct of_device_id {
+    char compatible[128];
+    const void *data;
+};
+
+struct device_driver {
+    const char *name;
+    void *owner;
+    const struct of_device_id *of_match_table;
+    const struct dev_pm_ops *pm;
+};
+
+struct platform_driver {
+    struct device_driver driver;
+    int (*probe)(struct platform_device *pdev);
+    int (*remove)(struct platform_device *pdev);
+};
+
+#define module_platform_driver(drv)                                            \
+    static struct platform_driver *const host_module_##drv __maybe_unused = &(drv)
+
+int host_platform_probe(struct platform_driver *drv, struct platform_device *pdev);
+int host_platform_remove(struct platform_driver *drv, struct platform_device *pdev);
+/* system sleep through the driver's dev_pm_ops */
+int host_pm_suspend(struct device *dev);
+int host_pm_resume(struct device *dev);
+
+/* forget properties, clocks, regulators and sysfs groups, check host_devres_live first */
+void host_device_reset(void);
+/* devm resources still held */
+int host_devres_live(void);
+
+#endif /* HOST_DEVICE_H */
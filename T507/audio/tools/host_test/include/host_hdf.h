@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The HDF and ADM declarations the T507 audio drivers use, laid out like
+ * drivers/framework of OpenHarmony 3.1 for the members they touch. The HCS
+ * node is a table the test fills, see host_hcs_set_*.
+ */
+
+#ifndef HOST_HDF_H
+#define HOST_HDF_H
+
+#include "host_kernel.h"
+
+#define HDF_SUCCESS                 0
+#define HDF_FAILURE                 (-1)
+#define HDF_ERR_NOT_SUPPORT         (-2)
+#define HDF_ERR_INVALID_PARAM       (-3)
+#define HDF_ERR_INVALID_OBJECT      (-4)
+#define HDF_ERR_MALLOC_FAIL         (-6)
+#define HDF_ERR_TIMEOUT             (-7)
+#define HDF_ERR_DEVICE_BUSY         (-11)
+
+#define HDF_CONFIG_SOURCE           0
+#define HDF_ARRAY_SIZE(a)           (sizeof(a) / sizeof((a)[0]))
+
+/* logs are counted, and printed with HOST_TEST_VERBOSE set */
+enum HostLogLevel {
+    HOST_LOG_DEBUG = 0,
+    HOST_LOG_INFO,
+    HOST_LOG_WARNING,
+    HOST_LOG_ERR,
+    HOST_LOG_CNT,
+};
+
+extern unsigned long host_log_count[HOST_LOG_CNT];
+void host_log(enum HostLogLevel level, const char *func, int line, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#define AUDIO_DRIVER_LOG_DEBUG(fmt, ...)    host_log(HOST_LOG_DEBUG, __func__, __LINE__, fmt, ##__VA_ARGS__)
+#define AUDIO_DRIVER_LOG_INFO(fmt, ...)     host_log(HOST_LOG_INFO, __func__, __LINE__, fmt, ##__VA_ARGS__)
+#define AUDIO_DRIVER_LOG_WARNING(fmt, ...)  host_log(HOST_LOG_WARNING, __func__, __LINE__, fmt, ##__VA_ARGS__)
+#define AUDIO_DRIVER_LOG_ERR(fmt, ...)      host_log(HOST_LOG_ERR, __func__, __LINE__, fmt, ##__VA_ARGS__)
+#define HDF_LOGE(fmt, ...)                  host_log(HOST_LOG_ERR, __func__, __LINE__, fmt, ##__VA_ARGS__)
+
+/* securec */
+typedef int errno_t;
+#define EOK 0
+errno_t memset_s(void *dest, size_t destMax, int c, size_t count);
+errno_t memcpy_s(void *dest, size_t destMax, const void *src, size_t count);
+
+/* osal */
+struct OsalMutex {
+    void *realMutex;
+};
+
+void *OsalMemCalloc(size_t size);
+void OsalMemFree(void *mem);
+
+/* device resource: the HCS node of the driver */
+struct DeviceResourceNode {
+    const char *name;
+};
+
+struct DeviceResourceIface {
+    bool (*GetBool)(const struct DeviceResourceNode *node, const char *attrName);
+    int32_t (*GetUint32)(const struct DeviceResourceNode *node, const char *attrName, uint32_t *value, uint32_t def);
+    int32_t (*GetString)(const struct DeviceResourceNode *node, const char *attrName, const char **value,
+        const char *def);
+};
+
+struct DeviceResourceIface *DeviceResourceGetIfaceInstance(int type);
+void host_hcs_reset(void);
+void host_hcs_set_bool(const char *attrName, bool value);
+void host_hcs_set_u32(const char *attrName, uint32_t value);
+
+struct HdfDeviceObject {
+    void *service;
+    const struct DeviceResourceNode *property;
+    void *priv;
+};
+
+/* adm */
+enum AudioStreamType {
+    AUDIO_CAPTURE_STREAM = 0,
+    AUDIO_RENDER_STREAM,
+};
+
+enum AudioFormat {
+    AUDIO_FORMAT_PCM_8_BIT = 1,
+    AUDIO_FORMAT_PCM_16_BIT,
+    AUDIO_FORMAT_PCM_24_BIT,
+    AUDIO_FORMAT_PCM_32_BIT,
+};
+
+/* kcontrols as audio_control.h has them, the fields the codec drivers use */
+struct AudioMixerControl {
+    int32_t min;
+    int32_t max;
+    int32_t platformMax;
+    uint32_t mask;
+    uint32_t reg;
+    uint32_t rreg;
+    uint32_t shift;
+    uint32_t rshift;
+    uint32_t invert;
+    uint32_t value;
+};
+
+struct AudioCtrlElemValue {
+    uint32_t value[2];
+};
+
+struct AudioKcontrol {
+    const char *name;
+    unsigned long privateValue;
+};
+
+/* audio_parse.h register groups of codec_config.hcs */
+enum AudioRegCfgIndex {
+    AUDIO_RSET_GROUP = 0,
+    AUDIO_INIT_GROUP,
+    AUDIO_CTRL_PATAM_GROUP,
+    AUDIO_CTRL_SAPM_PATAM_GROUP,
+    AUDIO_DAI_STARTUP_PATAM_GROUP,
+    AUDIO_DAI_PATAM_GROUP,
+    AUDIO_DAI_TRIGGER_GROUP,
+    AUDIO_CTRL_CFG_GROUP,
+    AUDIO_SAPM_COMP_GROUP,
+    AUDIO_SAPM_CFG_GROUP,
+    AUDIO_GROUP_MAX,
+};
+
+struct AudioAddrConfig {
+    uint32_t addr;
+    uint32_t value;
+};
+
+struct AudioRegCfgGroupNode {
+    uint8_t itemNum;
+    enum AudioRegCfgIndex groupIndex;
+    struct AudioAddrConfig *addrCfgItem;
+    struct AudioMixerControl *regCfgItem;
+};
+
+/* the audio_core.c field helpers: range check and invert, the shift stays with the caller */
+int32_t AudioGetCtrlOpsReg(struct AudioCtrlElemValue *elemValue, const struct AudioMixerControl *mixerCtrl,
+    uint32_t rcurValue);
+int32_t AudioGetCtrlOpsRReg(struct AudioCtrlElemValue *elemValue, const struct AudioMixerControl *mixerCtrl,
+    uint32_t rcurValue);
+int32_t AudioSetCtrlOpsReg(const struct AudioKcontrol *kcontrol, const struct AudioCtrlElemValue *elemValue,
+    const struct AudioMixerControl *mixerCtrl, uint32_t *value);
+int32_t AudioSetCtrlOpsRReg(const struct AudioCtrlElemValue *elemValue, struct AudioMixerControl *mixerCtrl,
+    uint32_t *rvalue, bool *updateRReg);
+
+struct PcmInfo {
+    enum AudioStreamType streamType;
+    uint32_t channels;
+    uint32_t rate;
+    uint32_t bitWidth;
+    uint32_t frameSize;
+    bool isBigEndian;
+    bool isSignedData;
+    uint32_t startThreshold;
+    uint32_t stopThreshold;
+    uint32_t silenceThreshold;
+    uint32_t totalStreamSize;
+    uint32_t interleaved;
+};
+
+struct CircleBufInfo {
+    uint32_t cirBufSize;
+    uint32_t trafBufSize;
+    uint32_t period;
+    uint32_t periodSize;
+    uint32_t periodCount;
+    unsigned long phyAddr;
+    uint32_t *virtAddr;
+    uint32_t wbufOffSet;
+    uint32_t wptrOffSet;
+    uint32_t rbufOffSet;
+    uint32_t rptrOffSet;
+    uint32_t framesPosition;
+    uint32_t pointer;
+    uint32_t periodsMax;
+    uint32_t periodsMin;
+    uint32_t cirBufMax;
+    uint32_t curTrafSize;
+    uint32_t oneMs;
+    uint32_t chnId;
+    uint32_t enable;
+    struct OsalMutex buffMutex;
+    uint32_t trafCompCount;
+    uint32_t runStatus;
+};
+
+struct AudioMmapData {
+    void *memoryAddress;
+    int32_t memoryFd;
+    int32_t totalBufferFrames;
+    int32_t transferFrameSize;
+    int32_t isShareable;
+    uint32_t offset;
+};
+
+struct AudioCard;
+struct PlatformData;
+
+struct PlatformDevice {
+    const char *devPlatformName;
+    struct PlatformData *devData;
+    struct HdfDeviceObject *device;
+};
+
+struct PlatformData {
+    const char *drvPlatformName;
+    int32_t (*PlatformInit)(const struct AudioCard *card, const struct PlatformDevice *platform);
+    struct AudioDmaOps *ops;
+    struct CircleBufInfo renderBufInfo;
+    struct CircleBufInfo captureBufInfo;
+    struct PcmInfo renderPcmInfo;
+    struct PcmInfo capturePcmInfo;
+    bool platformInitFlag;
+    struct AudioMmapData mmapData;
+    uint32_t mmapLoopCount;
+    void *dmaPrv;
+};
+
+struct AudioCard {
+    struct AudioPcmRuntime *rtd;
+    const char *configData;
+};
+
+#endif /* HOST_HDF_H */
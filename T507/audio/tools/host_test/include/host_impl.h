@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_IMPL_H
+#define HOST_IMPL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* state of the fake ahub/codec drivers, arrays are indexed capture 0, render 1 */
+struct HostImpl {
+    uint32_t ahubApbNum;
+    bool ahubXrun[2];        /* next XrunCheck reports an xrun, then clears */
+    bool codecXrun[2];
+    uint32_t ahubRecover[2];
+    uint32_t codecRecover[2];
+    bool tapEnabled[3];
+};
+
+extern struct HostImpl host_impl;
+
+#endif /* HOST_IMPL_H */
@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The slice of the linux-4.19 kernel api the audio drivers use, for building
+ * them unchanged on the host. Everything runs on one thread against a virtual
+ * clock: ktime_get_ns() only moves in host_advance(), which fires the timers
+ * behind dma interrupts, tasklets and work items in time order. Locks are
+ * no-ops, the seqlock still counts so a reader can see a writer.
+ */
+
+#ifndef HOST_KERNEL_H
+#define HOST_KERNEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <linux/types.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef unsigned int gfp_t;
+typedef uint64_t dma_addr_t;
+typedef uint64_t phys_addr_t;
+typedef int32_t dma_cookie_t;
+typedef unsigned long pgprot_t;
+
+#define __iomem
+#define __user
+#define __init
+#define __exit
+#define __maybe_unused      __attribute__((unused))
+
+#define GFP_KERNEL          0x01u
+#define GFP_DMA             0x02u
+#define GFP_ATOMIC          0x04u
+#define __GFP_ZERO          0x100u
+
+#ifndef ENOTSUPP
+#define ENOTSUPP            524
+#endif
+#define ERESTARTSYS         512
+#define MAX_ERRNO           4095
+
+#define ARRAY_SIZE(a)       (sizeof(a) / sizeof((a)[0]))
+#define DMA_BIT_MASK(n)     (((n) == 64) ? ~0ULL : ((1ULL << (n)) - 1))
+#define BIT(n)              (1UL << (n))
+#define GENMASK(h, l)       (((~0U) << (l)) & (~0U >> (31 - (h))))
+#define container_of(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#define likely(x)           __builtin_expect(!!(x), 1)
+#define unlikely(x)         __builtin_expect(!!(x), 0)
+#define min(a, b)           ((a) < (b) ? (a) : (b))
+#define max(a, b)           ((a) > (b) ? (a) : (b))
+#define min_t(t, a, b)      ((t)(a) < (t)(b) ? (t)(a) : (t)(b))
+#define max_t(t, a, b)      ((t)(a) > (t)(b) ? (t)(a) : (t)(b))
+#define clamp_t(t, v, lo, hi) min_t(t, max_t(t, v, lo), hi)
+#define clamp(v, lo, hi)    min(max(v, lo), hi)
+#define DIV_ROUND_UP(n, d)  (((n) + (d) - 1) / (d))
+#define DIV_ROUND_CLOSEST(x, d) (((x) + ((d) / 2)) / (d))
+#define is_power_of_2(x)    ((x) != 0 && (((x) & ((x) - 1)) == 0))
+#define roundup_pow_of_two(x) ((x) <= 1 ? 1UL : 1UL << (64 - __builtin_clzll((unsigned long long)(x) - 1)))
+#define round_up(x, y)      ((((x) - 1) | ((y) - 1)) + 1)
+#define round_down(x, y)    ((x) & ~((y) - 1))
+#define ALIGN(x, a)         (((x) + (a) - 1) & ~((a) - 1))
+#define IS_ALIGNED(x, a)    (((x) & ((a) - 1)) == 0)
+#define ilog2(x)            (63 - __builtin_clzll((unsigned long long)(x)))
+#define fls(x)              ((x) ? 32 - __builtin_clz(x) : 0)
+#define ffs(x)              __builtin_ffs(x)
+#define hweight32(x)        __builtin_popcount(x)
+#define swap(a, b)          do { __typeof__(a) __t = (a); (a) = (b); (b) = __t; } while (0)
+#define U32_MAX             0xffffffffU
+#define BUILD_BUG_ON(x)     _Static_assert(!(x), #x)
+#define WARN_ON(x)          (!!(x))
+#define fallthrough         __attribute__((__fallthrough__))
+
+#define READ_ONCE(x)        (*(const volatile __typeof__(x) *)&(x))
+#define WRITE_ONCE(x, v)    (*(volatile __typeof__(x) *)&(x) = (v))
+#define barrier()           __asm__ __volatile__("" ::: "memory")
+#define smp_wmb()           barrier()
+#define smp_rmb()           barrier()
+#define smp_mb()            barrier()
+
+#define IS_ERR_VALUE(x)     ((unsigned long)(void *)(x) >= (unsigned long)-MAX_ERRNO)
+#define IS_ERR(p)           IS_ERR_VALUE(p)
+#define IS_ERR_OR_NULL(p)   ((p) == NULL || IS_ERR_VALUE(p))
+#define PTR_ERR(p)          ((long)(p))
+#define ERR_PTR(e)          ((void *)(long)(e))
+
+#define NSEC_PER_USEC       1000LL
+#define NSEC_PER_MSEC       1000000LL
+#define NSEC_PER_SEC        1000000000LL
+#define USEC_PER_MSEC       1000LL
+#define USEC_PER_SEC        1000000LL
+#define MSEC_PER_SEC        1000LL
+#define HZ                  1000
+
+#define PAGE_SHIFT          12
+#define PAGE_SIZE           (1UL << PAGE_SHIFT)
+#define PAGE_ALIGN(x)       (((x) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+
+#define div_u64(a, b)       ((u64)(a) / (u32)(b))
+#define div64_u64(a, b)     ((u64)(a) / (u64)(b))
+#define do_div(n, base)     ({ u32 __r = (u32)((n) % (base)); (n) /= (base); __r; })
+
+#define EXPORT_SYMBOL(x)
+#define EXPORT_SYMBOL_GPL(x)
+#define MODULE_LICENSE(x)
+#define MODULE_DESCRIPTION(x)
+#define THIS_MODULE         NULL
+
+/* virtual clock and timers, fake_kernel.c */
+struct HostTimer {
+    uint64_t due;
+    void (*fn)(struct HostTimer *timer);
+    bool armed;
+    struct HostTimer *next;
+};
+
+u64 ktime_get_ns(void);
+void host_timer_arm(struct HostTimer *timer, uint64_t due);
+void host_timer_cancel(struct HostTimer *timer);
+/* run every timer due up to now + ns in time order, the clock ends at now + ns */
+void host_advance(uint64_t ns);
+/* the cpu spins for ns: the clock moves, timers due meanwhile run at the next advance */
+void host_busy(uint64_t ns);
+/* run the next timer due no later than deadline, or move to deadline; false when nothing ran */
+bool host_step(uint64_t deadline);
+void host_clock_reset(void);
+
+/* allocations still live, for leak checks after a card release */
+int host_mem_live(void);
+/* fail the next n allocations of a kind */
+enum HostFailKind {
+    HOST_FAIL_KZALLOC = 0,
+    HOST_FAIL_DMA_ALLOC,
+    HOST_FAIL_PAGES,
+    HOST_FAIL_DMA_CHAN,
+    HOST_FAIL_CNT,
+};
+void host_fail_next(enum HostFailKind kind, int n);
+bool host_fail_take(enum HostFailKind kind);
+
+/* atomics, single threaded */
+typedef struct {
+    int counter;
+} atomic_t;
+
+#define ATOMIC_INIT(i)      { (i) }
+static inline int atomic_read(const atomic_t *a) { return READ_ONCE(a->counter); }
+static inline void atomic_set(atomic_t *a, int v) { WRITE_ONCE(a->counter, v); }
+static inline void atomic_inc(atomic_t *a) { a->counter++; }
+static inline void atomic_dec(atomic_t *a) { a->counter--; }
+static inline void atomic_add(int i, atomic_t *a) { a->counter += i; }
+static inline int atomic_inc_return(atomic_t *a) { return ++a->counter; }
+static inline int atomic_dec_return(atomic_t *a) { return --a->counter; }
+static inline int atomic_dec_and_test(atomic_t *a) { return --a->counter == 0; }
+static inline int atomic_xchg(atomic_t *a, int v) { int o = a->counter; a->counter = v; return o; }
+
+/* locks */
+struct mutex {
+    int locked;
+};
+
+#define DEFINE_MUTEX(m)     struct mutex m = { 0 }
+#define mutex_init(m)       ((m)->locked = 0)
+#define mutex_destroy(m)    ((void)(m))
+#define mutex_lock(m)       ((m)->locked++)
+#define mutex_unlock(m)     ((m)->locked--)
+
+typedef struct {
+    int locked;
+} spinlock_t;
+
+#define DEFINE_SPINLOCK(l)  spinlock_t l = { 0 }
+#define spin_lock_init(l)   ((l)->locked = 0)
+#define spin_lock(l)        ((l)->locked++)
+#define spin_unlock(l)      ((l)->locked--)
+#define spin_lock_bh(l)     ((l)->locked++)
+#define spin_unlock_bh(l)   ((l)->locked--)
+#define spin_lock_irqsave(l, f)      ((f) = 0, (l)->locked++)
+#define spin_unlock_irqrestore(l, f) ((void)(f), (l)->locked--)
+
+typedef struct {
+    unsigned sequence;
+} seqcount_t;
+
+typedef struct {
+    seqcount_t seqcount;
+} seqlock_t;
+
+static inline void seqlock_init(seqlock_t *s) { s->seqcount.sequence = 0; }
+static inline unsigned read_seqbegin(const seqlock_t *s) { return READ_ONCE(s->seqcount.sequence); }
+static inline int read_seqretry(const seqlock_t *s, unsigned start)
+{
+    return (start & 1) || READ_ONCE(s->seqcount.sequence) != start;
+}
+#define write_seqlock_irqsave(s, f)      ((f) = 0, (s)->seqcount.sequence++)
+#define write_sequnlock_irqrestore(s, f) ((void)(f), (s)->seqcount.sequence++)
+
+/* wait queues: a waiter runs the virtual clock until its condition holds */
+typedef struct {
+    int waiters;
+} wait_queue_head_t;
+
+extern unsigned long host_wakeups;
+extern bool host_signal;
+
+#define init_waitqueue_head(w)      ((w)->waiters = 0)
+#define wake_up(w)                  ((void)(w), host_wakeups++)
+#define wake_up_interruptible(w)    ((void)(w), host_wakeups++)
+unsigned long msecs_to_jiffies(unsigned int ms);
+/* move the clock to the next event, at most to the deadline @left jiffies away; jiffies left */
+long host_wait_step(long left);
+
+#define wait_event_interruptible_timeout(wq, condition, timeout) ({         \
+    long __left = (long)(timeout);                                          \
+    (wq).waiters++;                                                         \
+    while (!(condition) && __left > 0 && !host_signal) {                    \
+        __left = host_wait_step(__left);                                    \
+    }                                                                       \
+    (wq).waiters--;                                                         \
+    (condition) ? (__left > 0 ? __left : 1) : (host_signal ? -ERESTARTSYS : 0); })
+
+/* work items run from the virtual clock, host_work_latency_ns after schedule_work */
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+    work_func_t func;
+    struct HostTimer timer;
+};
+
+extern uint64_t host_work_latency_ns;
+void host_work_init(struct work_struct *work, work_func_t func);
+bool schedule_work(struct work_struct *work);
+bool cancel_work_sync(struct work_struct *work);
+#define INIT_WORK(w, f)     host_work_init((w), (f))
+
+/* a delayed work is a work armed that many jiffies out, every queue is the one clock */
+struct workqueue_struct;
+extern struct workqueue_struct *system_wq;
+
+struct delayed_work {
+    struct work_struct work;
+};
+
+unsigned long nsecs_to_jiffies(u64 ns);
+bool schedule_delayed_work(struct delayed_work *dwork, unsigned long delay);
+bool mod_delayed_work(struct workqueue_struct *wq, struct delayed_work *dwork, unsigned long delay);
+bool cancel_delayed_work(struct delayed_work *dwork);
+bool cancel_delayed_work_sync(struct delayed_work *dwork);
+#define INIT_DELAYED_WORK(w, f) host_work_init(&(w)->work, (f))
+#define to_delayed_work(w)      container_of((w), struct delayed_work, work)
+
+/* devices */
+struct device_node {
+    const char *full_name;
+};
+
+struct kobject {
+    const char *name;
+};
+
+/* runtime pm state, fake_device.c runs the callbacks and the autosuspend timer */
+struct dev_pm_info {
+    int usage_count;
+    int disable_depth;
+    bool active;
+    bool use_autosuspend;
+    int autosuspend_delay;
+    uint64_t last_busy;
+    struct HostTimer suspend_timer;
+    uint32_t resumes;
+    uint32_t suspends;
+};
+
+struct device_driver;
+
+struct device {
+    struct device_node *of_node;
+    u64 coherent_dma_mask;
+    const char *init_name;
+    struct kobject kobj;
+    void *driver_data;
+    const struct device_driver *driver;
+    struct dev_pm_info power;
+};
+
+struct platform_device {
+    struct device dev;
+    const char *name;
+};
+
+struct device_node *of_find_node_by_path(const char *path);
+struct platform_device *of_find_device_by_node(struct device_node *np);
+const char *dev_name(const struct device *dev);
+static inline void *dev_get_drvdata(const struct device *dev) { return dev->driver_data; }
+static inline void dev_set_drvdata(struct device *dev, void *data) { dev->driver_data = data; }
+
+/* slab and pages */
+void *kzalloc(size_t size, gfp_t flags);
+void *kcalloc(size_t n, size_t size, gfp_t flags);
+void kfree(const void *p);
+unsigned long __get_free_pages(gfp_t flags, unsigned int order);
+unsigned long get_zeroed_page(gfp_t flags);
+void free_pages(unsigned long addr, unsigned int order);
+void free_page(unsigned long addr);
+int get_order(unsigned long size);
+phys_addr_t virt_to_phys(volatile void *addr);
+
+/* dma mapping; bus addresses are the host addresses */
+enum dma_data_direction {
+    DMA_BIDIRECTIONAL = 0,
+    DMA_TO_DEVICE = 1,
+    DMA_FROM_DEVICE = 2,
+    DMA_NONE = 3,
+};
+
+struct HostDmaSyncStats {
+    uint32_t forCpu;
+    uint32_t forDevice;
+    uint64_t cpuBytes;
+};
+
+extern struct HostDmaSyncStats host_dma_sync;
+/* sees every range handed back to the cpu, for checking what a reader finds invalidated */
+extern void (*host_dma_sync_cpu_hook)(dma_addr_t addr, size_t size);
+
+void *dma_alloc_wc(struct device *dev, size_t size, dma_addr_t *handle, gfp_t flags);
+void dma_free_wc(struct device *dev, size_t size, void *cpu, dma_addr_t handle);
+dma_addr_t dma_map_single(struct device *dev, void *ptr, size_t size, enum dma_data_direction dir);
+void dma_unmap_single(struct device *dev, dma_addr_t addr, size_t size, enum dma_data_direction dir);
+int dma_mapping_error(struct device *dev, dma_addr_t addr);
+void dma_sync_single_for_cpu(struct device *dev, dma_addr_t addr, size_t size, enum dma_data_direction dir);
+void dma_sync_single_for_device(struct device *dev, dma_addr_t addr, size_t size, enum dma_data_direction dir);
+
+/* vmas: the test is the mm, it calls vm_ops->open/close for fork and munmap */
+struct vm_area_struct;
+
+struct vm_operations_struct {
+    void (*open)(struct vm_area_struct *vma);
+    void (*close)(struct vm_area_struct *vma);
+};
+
+struct vm_area_struct {
+    unsigned long vm_start;
+    unsigned long vm_end;
+    unsigned long vm_pgoff;
+    unsigned long vm_flags;
+    pgprot_t vm_page_prot;
+    const struct vm_operations_struct *vm_ops;
+    void *vm_private_data;
+    unsigned long host_pfn;    /* what remap_pfn_range/dma_mmap_wc mapped */
+};
+
+#define pgprot_writecombine(p)  ((p) | 0x1000UL)
+int remap_pfn_range(struct vm_area_struct *vma, unsigned long addr, unsigned long pfn, unsigned long size,
+    pgprot_t prot);
+int dma_mmap_wc(struct device *dev, struct vm_area_struct *vma, void *cpu, dma_addr_t handle, size_t size);
+
+/* sram pool behind the optional "sram" phandle, host_sram_size 0 means no phandle */
+struct gen_pool;
+extern size_t host_sram_size;
+struct gen_pool *of_gen_pool_get(struct device_node *np, const char *propname, int index);
+void *gen_pool_dma_alloc(struct gen_pool *pool, size_t size, dma_addr_t *dma);
+void gen_pool_free(struct gen_pool *pool, unsigned long addr, size_t size);
+
+/* debugfs: files are kept by name so a test can read what userspace would */
+struct dentry;
+struct inode {
+    void *i_private;
+};
+
+struct file {
+    void *private_data;
+    long long f_pos;
+};
+
+struct file_operations {
+    void *owner;
+    int (*open)(struct inode *inode, struct file *file);
+    ssize_t (*read)(struct file *file, char __user *buf, size_t count, long long *ppos);
+    long long (*llseek)(struct file *file, long long offset, int whence);
+    int (*release)(struct inode *inode, struct file *file);
+};
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent);
+void debugfs_create_u32(const char *name, unsigned short mode, struct dentry *parent, u32 *value);
+struct dentry *debugfs_create_file(const char *name, unsigned short mode, struct dentry *parent, void *data,
+    const struct file_operations *fops);
+void debugfs_remove_recursive(struct dentry *dentry);
+u32 *host_debugfs_u32(const char *dir, const char *name);
+/* open, read to the end in chunks of chunk bytes and release, like cat; bytes read or a negative errno */
+ssize_t host_debugfs_read(const char *dir, const char *name, char *buf, size_t size, size_t chunk);
+
+#endif /* HOST_KERNEL_H */
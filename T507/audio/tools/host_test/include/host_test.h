@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+struct HostTestCase {
+    const char *name;
+    void (*run)(void);
+};
+
+/* a failed check marks the case failed and carries on, the case decides when to stop */
+void host_check_failed(const char *file, int line, const char *expr, long long a, long long b);
+
+#define HOST_CHECK(cond) do {                                                   \
+    if (!(cond)) {                                                              \
+        host_check_failed(__FILE__, __LINE__, #cond, 0, 0);                     \
+    }                                                                           \
+} while (0)
+
+#define HOST_CHECK_EQ(a, b) do {                                                \
+    long long __a = (long long)(a);                                             \
+    long long __b = (long long)(b);                                             \
+    if (__a != __b) {                                                           \
+        host_check_failed(__FILE__, __LINE__, #a " == " #b, __a, __b);          \
+    }                                                                           \
+} while (0)
+
+/* measurement lines, kept apart from the pass/fail output */
+void host_report(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/* host wall clock for op costs, never the driver's virtual clock */
+uint64_t host_wall_ns(void);
+
+/* runs each case after reset(), a non-zero exit when any check failed */
+int host_test_main(const struct HostTestCase *cases, size_t count, void (*reset)(void), int argc, char **argv);
+
+#endif /* HOST_TEST_H */
@@ -0,0 +1,14 @@
+#include "../dmaengine.h"
+
+/* drq numbering is the fake's own, the driver only passes it through */
+#define sunxi_slave_id(d, s)    (((d) << 16) | (s))
+#define DRQSRC_SDRAM            1
+#define DRQDST_SDRAM            1
+#define DRQSRC_AHUB0_RX         3
+#define DRQSRC_AHUB1_RX         4
+#define DRQSRC_AHUB2_RX         5
+#define DRQDST_AHUB0_TX         3
+#define DRQDST_AHUB1_TX         4
+#define DRQDST_AHUB2_TX         5
+#define DRQSRC_AUDIO_CODEC      7
+#define DRQDST_AUDIO_CODEC      7
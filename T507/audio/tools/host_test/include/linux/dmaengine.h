@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * dmaengine client api backed by fake_dmaengine.c, a virt-dma controller
+ * (sun6i-dma) moving bytes at the rate its peripheral fifo drains or fills.
+ */
+
+#ifndef HOST_LINUX_DMAENGINE_H
+#define HOST_LINUX_DMAENGINE_H
+
+#include "../host_kernel.h"
+
+enum dma_transaction_type {
+    DMA_SLAVE = 0,
+    DMA_CYCLIC,
+};
+
+typedef struct {
+    unsigned long bits[1];
+} dma_cap_mask_t;
+
+#define dma_cap_zero(mask)      ((mask).bits[0] = 0)
+#define dma_cap_set(tx, mask)   ((mask).bits[0] |= 1UL << (tx))
+
+enum dma_transfer_direction {
+    DMA_MEM_TO_MEM = 0,
+    DMA_MEM_TO_DEV,
+    DMA_DEV_TO_MEM,
+    DMA_DEV_TO_DEV,
+    DMA_TRANS_NONE,
+};
+
+enum dma_slave_buswidth {
+    DMA_SLAVE_BUSWIDTH_UNDEFINED = 0,
+    DMA_SLAVE_BUSWIDTH_1_BYTE = 1,
+    DMA_SLAVE_BUSWIDTH_2_BYTES = 2,
+    DMA_SLAVE_BUSWIDTH_3_BYTES = 3,
+    DMA_SLAVE_BUSWIDTH_4_BYTES = 4,
+    DMA_SLAVE_BUSWIDTH_8_BYTES = 8,
+};
+
+enum dma_residue_granularity {
+    DMA_RESIDUE_GRANULARITY_DESCRIPTOR = 0,
+    DMA_RESIDUE_GRANULARITY_SEGMENT,
+    DMA_RESIDUE_GRANULARITY_BURST,
+};
+
+enum dma_ctrl_flags {
+    DMA_PREP_INTERRUPT = (1 << 0),
+    DMA_CTRL_ACK = (1 << 1),
+};
+
+enum dma_status {
+    DMA_COMPLETE = 0,
+    DMA_IN_PROGRESS,
+    DMA_PAUSED,
+    DMA_ERROR,
+};
+
+struct dma_slave_config {
+    enum dma_transfer_direction direction;
+    phys_addr_t src_addr;
+    phys_addr_t dst_addr;
+    enum dma_slave_buswidth src_addr_width;
+    enum dma_slave_buswidth dst_addr_width;
+    u32 src_maxburst;
+    u32 dst_maxburst;
+    bool device_fc;
+    unsigned int slave_id;
+};
+
+struct dma_slave_caps {
+    u32 src_addr_widths;
+    u32 dst_addr_widths;
+    u32 directions;
+    u32 max_burst;
+    bool cmd_pause;
+    bool cmd_resume;
+    bool cmd_terminate;
+    enum dma_residue_granularity residue_granularity;
+    bool descriptor_reuse;
+};
+
+struct dma_device;
+
+struct dma_chan {
+    struct dma_device *device;
+    int chan_id;
+};
+
+typedef bool (*dma_filter_fn)(struct dma_chan *chan, void *filter_param);
+typedef void (*dma_async_tx_callback)(void *dma_async_param);
+
+struct dma_async_tx_descriptor {
+    dma_cookie_t cookie;
+    enum dma_ctrl_flags flags;
+    struct dma_chan *chan;
+    dma_async_tx_callback callback;
+    void *callback_param;
+};
+
+struct dma_tx_state {
+    dma_cookie_t last;
+    dma_cookie_t used;
+    u32 residue;
+};
+
+#define dma_request_channel(mask, x, y) __dma_request_channel(&(mask), x, y)
+struct dma_chan *__dma_request_channel(const dma_cap_mask_t *mask, dma_filter_fn fn, void *fn_param);
+void dma_release_channel(struct dma_chan *chan);
+int dma_get_slave_caps(struct dma_chan *chan, struct dma_slave_caps *caps);
+int dmaengine_slave_config(struct dma_chan *chan, struct dma_slave_config *config);
+struct dma_async_tx_descriptor *dmaengine_prep_slave_single(struct dma_chan *chan, dma_addr_t buf, size_t len,
+    enum dma_transfer_direction dir, unsigned long flags);
+struct dma_async_tx_descriptor *dmaengine_prep_dma_cyclic(struct dma_chan *chan, dma_addr_t buf_addr,
+    size_t buf_len, size_t period_len, enum dma_transfer_direction dir, unsigned long flags);
+dma_cookie_t dmaengine_submit(struct dma_async_tx_descriptor *desc);
+void dma_async_issue_pending(struct dma_chan *chan);
+int dmaengine_pause(struct dma_chan *chan);
+int dmaengine_resume(struct dma_chan *chan);
+int dmaengine_terminate_async(struct dma_chan *chan);
+int dmaengine_terminate_sync(struct dma_chan *chan);
+void dmaengine_synchronize(struct dma_chan *chan);
+enum dma_status dmaengine_tx_status(struct dma_chan *chan, dma_cookie_t cookie, struct dma_tx_state *state);
+
+/* test side of the fake controller */
+struct HostDmaConfig {
+    bool canPause;            /* caps.cmd_pause of channels requested from now on */
+    bool reportResidue;       /* false: tx_status residue is always 0 */
+    uint32_t channels;        /* free physical channels */
+    uint64_t irqToTaskletNs;  /* period irq to callback, the tasklet delay */
+    uint64_t taskletJitterNs; /* extra 0 .. jitter on top, pseudo random */
+};
+
+/* one drq endpoint: the fifo at addr drains or fills at bytesPerSec, off by ppm */
+void host_dma_set_fifo_rate(phys_addr_t addr, uint32_t bytesPerSec, int32_t ppm);
+void host_dma_configure(const struct HostDmaConfig *config);
+void host_dma_reset(void);
+/* channel serving the fifo at addr, NULL when none is configured for it */
+struct dma_chan *host_dma_chan_by_fifo(phys_addr_t addr);
+const struct dma_slave_config *host_dma_chan_config(const struct dma_chan *chan);
+/* bytes the channel moved since its first issue_pending, wraps included */
+uint64_t host_dma_chan_bytes(const struct dma_chan *chan);
+/* bus address the channel transfers at now, 0 when idle */
+dma_addr_t host_dma_chan_addr(const struct dma_chan *chan);
+/* start of the issued cyclic ring, 0 when there is none */
+dma_addr_t host_dma_chan_ring(const struct dma_chan *chan);
+uint32_t host_dma_chan_callbacks(const struct dma_chan *chan);
+int host_dma_chans_live(void);
+int host_dma_descs_live(void);
+
+/* calls into the fake, per api entry; tests diff two snapshots */
+struct HostDmaCalls {
+    uint32_t prepCyclic;
+    uint32_t prepSingle;
+    uint32_t submit;
+    uint32_t issuePending;
+    uint32_t pause;
+    uint32_t resume;
+    uint32_t terminate;
+    uint32_t synchronize;
+    uint32_t txStatus;
+    uint32_t slaveConfig;
+};
+
+extern struct HostDmaCalls host_dma_calls;
+
+#endif /* HOST_LINUX_DMAENGINE_H */
@@ -0,0 +1,10 @@
+#include "../host_kernel.h"
+
+/* every event becomes a counter, all of them on or off with host_trace_enabled */
+extern bool host_trace_enabled;
+extern unsigned long host_trace_hits;
+
+#define TP_PROTO(...)   __VA_ARGS__
+#define TRACE_EVENT(name, proto, args, tstruct, assign, print)                 \
+    static inline bool trace_##name##_enabled(void) { return host_trace_enabled; } \
+    static inline void trace_##name(proto) { host_trace_hits++; }
@@ -0,0 +1 @@
+/* events are defined inline by linux/tracepoint.h, nothing to instantiate */
@@ -0,0 +1,662 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * t507_dai_ahub_impl_linux.c probed on a fake platform device. The driver and
+ * the clock plan are included rather than linked so the cases can reach the
+ * static helpers and the driver state; the register file behind the regmap is
+ * what the hardware would hold, the bus counters are what reached it.
+ */
+
+#include <stdlib.h>
+
+#include "../../soc/src/t507_clk_plan.c"
+#include "../../dai/src/t507_dai_ahub_impl_linux.c"
+#include "t507_dma_ops.h"
+#include "host_device.h"
+#include "host_test.h"
+
+#define TEST_AHUB_NODE      "/soc@03000000/ahub@0x05097000"
+#define TEST_AHUB_REGULATOR "vcc-audio-33"
+
+#define US(n)               ((uint64_t)(n) * NSEC_PER_USEC)
+#define MS(n)               ((uint64_t)(n) * NSEC_PER_MSEC)
+
+static struct platform_device g_pdev;
+
+/* fifo flush bits clear themselves, irq status is write-1-to-clear */
+static void ahub_hw_write(unsigned int reg, u32 old, u32 *hw)
+{
+    uint32_t n;
+
+    for (n = 0; n < SUNXI_AHUB_APBIF_NUM; n++) {
+        if (reg == SUNXI_AHUB_APBIF_TXFIFO_CTL(n)) {
+            *hw &= ~(0x1 << APBIF_TX_FTX);
+        } else if (reg == SUNXI_AHUB_APBIF_RXFIFO_CTL(n)) {
+            *hw &= ~(0x1 << APBIF_RX_FRX);
+        } else if (reg == SUNXI_AHUB_APBIF_TX_IRQ_STA(n) || reg == SUNXI_AHUB_APBIF_RX_IRQ_STA(n)) {
+            *hw = old & ~*hw;
+        }
+    }
+    for (n = 0; n < SUNXI_AHUB_I2S_NUM; n++) {
+        if (reg == SUNXI_AHUB_I2S_IRQ_STA(n)) {
+            *hw = old & ~*hw;
+        }
+    }
+}
+
+static void test_reset(void)
+{
+    host_clock_reset();
+    host_device_reset();
+    host_mmio_write_hook = ahub_hw_write;
+    host_hcs_reset();
+    host_trace_enabled = false;
+    g_regmap_config.cache_type = REGCACHE_RBTREE;
+    g_ahub_pdev = NULL;
+    g_clk_pll_freq = 0;
+    memset(g_clk_user_freq, 0, sizeof(g_clk_user_freq));
+    memset(g_clk_user_running, 0, sizeof(g_clk_user_running));
+}
+
+static struct device_node *ahub_node(void)
+{
+    return of_find_node_by_path(TEST_AHUB_NODE);
+}
+
+/* the dts node of the board: apbif 0 on i2s 0, data pins 0, a switched 3.3 V supply */
+static void ahub_dts(void)
+{
+    const u32 reg[2] = { SUNXI_AHUB_ADDR_BASE, SUNXI_AHUB_MAX_REG + 4 };
+    struct device_node *np = ahub_node();
+
+    host_of_set_u32_array(np, "reg", reg, ARRAY_SIZE(reg));
+    host_of_set_u32(np, "apb-num", 0);
+    host_of_set_u32(np, "tdm-num", 0);
+    host_of_set_u32(np, "tx-pin", 0);
+    host_of_set_u32(np, "rx-pin", 0);
+    host_of_set_string(np, "ahub_regulator", TEST_AHUB_REGULATOR);
+}
+
+static struct sunxi_ahub_info *ahub_probe(void)
+{
+    memset(&g_pdev, 0, sizeof(g_pdev));
+    g_pdev.name = DRV_NAME;
+    g_pdev.dev.of_node = ahub_node();
+    g_pdev.dev.init_name = TEST_AHUB_NODE;
+    HOST_CHECK_EQ(host_platform_probe(&sunxi_ahub_driver, &g_pdev), 0);
+
+    return dev_get_drvdata(&g_pdev.dev);
+}
+
+static void ahub_remove(void)
+{
+    HOST_CHECK_EQ(host_platform_remove(&sunxi_ahub_driver, &g_pdev), 0);
+    HOST_CHECK_EQ(host_devres_live(), 0);
+    HOST_CHECK_EQ(host_mem_live(), 0);
+}
+
+static struct HostRegmapStats ahub_bus(const struct sunxi_ahub_info *ahub)
+{
+    return *host_regmap_stats(ahub->mem_info.regmap);
+}
+
+static void test_probe_remove(void)
+{
+    struct sunxi_ahub_info *ahub;
+    struct regulator *supply;
+
+    ahub_dts();
+    ahub = ahub_probe();
+    HOST_CHECK(ahub != NULL);
+    HOST_CHECK(g_ahub_pdev == &g_pdev);
+    HOST_CHECK_EQ(ahub->dts_info.slot_width, 32);
+    HOST_CHECK_EQ(ahub->dts_info.autosuspend_ms, SUNXI_AHUB_AUTOSUSPEND_MS);
+    supply = host_regulator(TEST_AHUB_REGULATOR);
+    HOST_CHECK_EQ(supply->enableCount, 1);
+    HOST_CHECK_EQ(supply->uV, 3300000);
+    HOST_CHECK_EQ(ahub->clk_info.clk_module->enableCount, 1);
+    HOST_CHECK(ahub->clk_info.clk_module->parent == ahub->clk_info.clk_pllx4);
+
+    /* nothing holds the block after probe, it gates after the idle delay */
+    host_advance(MS(SUNXI_AHUB_AUTOSUSPEND_MS) + 1);
+    HOST_CHECK(pm_runtime_suspended(&g_pdev.dev));
+    HOST_CHECK_EQ(supply->enableCount, 0);
+    HOST_CHECK_EQ(ahub->clk_info.clk_module->enableCount, 0);
+
+    ahub_remove();
+    HOST_CHECK_EQ(supply->enableCount, 0);
+    HOST_CHECK_EQ(host_clk(ahub_node(), 2)->enableCount, 0);
+}
+
+struct BusCost {
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t fills;
+    double hostNs;
+};
+
+struct RegmapRun {
+    struct BusCost init;
+    struct BusCost first;
+    struct BusCost reopen;
+    struct BusCost rateSwitch;
+    uint32_t firstFills;    /* cache fills of the very first hw_params, the rest must hit */
+    u32 regs[(SUNXI_AHUB_MAX_REG + 4) / 4];
+};
+
+static struct BusCost bus_cost(const struct HostRegmapStats *before, const struct HostRegmapStats *after,
+    uint32_t loops, uint64_t wallNs)
+{
+    struct BusCost cost = {
+        .reads = (after->busReads - before->busReads) / loops,
+        .writes = (after->busWrites - before->busWrites) / loops,
+        .fills = after->fillReads - before->fillReads,
+        .hostNs = (double)wallNs / loops,
+    };
+
+    return cost;
+}
+
+/*
+ * DeviceInit, then hw_params as the ADM calls it: the first open after init
+ * or a system resume (nothing applied yet), the same stream opened again, and
+ * a 44.1k <-> 48k switch that retunes the pll every time.
+ */
+static void regmap_run(enum regcache_type cache, struct RegmapRun *run)
+{
+    const uint32_t loops = 2000;
+    struct sunxi_ahub_info *ahub;
+    struct HostRegmapStats before;
+    struct HostRegmapStats after;
+    uint64_t start;
+    uint32_t i;
+
+    test_reset();
+    g_regmap_config.cache_type = cache;
+    ahub_dts();
+    ahub = ahub_probe();
+
+    before = ahub_bus(ahub);
+    T507AhubImplDeviceInit();
+    after = ahub_bus(ahub);
+    run->init = bus_cost(&before, &after, 1, 0);
+
+    before = ahub_bus(ahub);
+    start = host_wall_ns();
+    for (i = 0; i < loops; i++) {
+        ahub->applied.valid = false;
+        HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_RENDER_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 48000), HDF_SUCCESS);
+        if (i == 0) {
+            run->firstFills = ahub_bus(ahub).fillReads - before.fillReads;
+        }
+    }
+    after = ahub_bus(ahub);
+    run->first = bus_cost(&before, &after, loops, host_wall_ns() - start);
+
+    before = ahub_bus(ahub);
+    start = host_wall_ns();
+    for (i = 0; i < loops; i++) {
+        HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_RENDER_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 48000), HDF_SUCCESS);
+    }
+    after = ahub_bus(ahub);
+    run->reopen = bus_cost(&before, &after, loops, host_wall_ns() - start);
+
+    before = ahub_bus(ahub);
+    start = host_wall_ns();
+    for (i = 0; i < loops; i++) {
+        HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_RENDER_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2,
+            (i % 2 == 0) ? 44100 : 48000), HDF_SUCCESS);
+    }
+    after = ahub_bus(ahub);
+    run->rateSwitch = bus_cost(&before, &after, loops, host_wall_ns() - start);
+
+    memcpy(run->regs, host_regmap_hw(ahub->mem_info.regmap), sizeof(run->regs));
+    ahub_remove();
+}
+
+static void regmap_report(const char *what, const struct BusCost *none, const struct BusCost *cached)
+{
+    host_report("%-22s %3u rd %3u wr %7.0f ns | %3u rd %3u wr %7.0f ns", what, none->reads, none->writes,
+        none->hostNs, cached->reads, cached->writes, cached->hostNs);
+}
+
+static void test_regmap_cost(void)
+{
+    static struct RegmapRun none;
+    static struct RegmapRun cached;
+
+    regmap_run(REGCACHE_NONE, &none);
+    regmap_run(REGCACHE_RBTREE, &cached);
+
+    host_report("bus accesses per call and host time, REGCACHE_NONE | REGCACHE_RBTREE");
+    regmap_report("DeviceInit", &none.init, &cached.init);
+    regmap_report("hw_params first open", &none.first, &cached.first);
+    regmap_report("hw_params reopen", &none.reopen, &cached.reopen);
+    regmap_report("hw_params 44.1k<->48k", &none.rateSwitch, &cached.rateSwitch);
+
+    /* the cache changes what is read back, never what ends up in the registers */
+    HOST_CHECK(memcmp(none.regs, cached.regs, sizeof(none.regs)) == 0);
+    host_report("cache fills: first hw_params %u, later %u", cached.firstFills,
+        cached.first.fills - cached.firstFills + cached.reopen.fills + cached.rateSwitch.fills);
+
+    /* a cacheable register is read from the bus once, after that only the volatile ones are */
+    HOST_CHECK_EQ(cached.first.fills, cached.firstFills);
+    HOST_CHECK_EQ(cached.reopen.fills, 0);
+    HOST_CHECK_EQ(cached.rateSwitch.fills, 0);
+    HOST_CHECK(cached.first.reads < none.first.reads);
+    HOST_CHECK(cached.rateSwitch.reads < none.rateSwitch.reads);
+    HOST_CHECK(cached.reopen.reads <= none.reopen.reads);
+    HOST_CHECK_EQ(cached.first.writes, none.first.writes);
+    HOST_CHECK_EQ(cached.rateSwitch.writes, none.rateSwitch.writes);
+}
+
+static void test_tdm_slots(void)
+{
+    struct sunxi_ahub_dts_info dts = { 0 };
+
+    /* derived from the channel count: at least a stereo frame, powers of two up to one full pin */
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, 0), 0);
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, 1), 2);
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, 2), 2);
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, 3), 4);
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, 6), 8);
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, 9), 16);
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, SUNXI_AHUB_TDM_MAX_CH), SUNXI_AHUB_TDM_MAX_CH);
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, SUNXI_AHUB_TDM_MAX_CH + 1), 0);
+
+    /* a board frame from the dts is kept whatever fits in it */
+    dts.slots = 8;
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, 2), 8);
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, 8), 8);
+    HOST_CHECK_EQ(sunxi_ahub_tdm_slots(&dts, 9), 0);
+}
+
+static void test_tdm_dts(void)
+{
+    struct sunxi_ahub_info *ahub;
+    uint32_t i;
+
+    /* no tdm properties: derived slots, 32 bit, identity maps */
+    ahub_dts();
+    ahub = ahub_probe();
+    HOST_CHECK_EQ(ahub->dts_info.slots, 0);
+    HOST_CHECK_EQ(ahub->dts_info.slot_width, 32);
+    for (i = 0; i < SUNXI_AHUB_TDM_MAX_CH; i++) {
+        HOST_CHECK_EQ(ahub->dts_info.rx_slot_map[i], i);
+        HOST_CHECK_EQ(ahub->dts_info.tx_slot_map[i], i);
+    }
+    ahub_remove();
+
+    /* values the block can not do fall back to the defaults */
+    host_of_set_u32(ahub_node(), "tdm-slots", 6);
+    host_of_set_u32(ahub_node(), "tdm-slot-width", 26);
+    ahub = ahub_probe();
+    HOST_CHECK_EQ(ahub->dts_info.slots, 0);
+    HOST_CHECK_EQ(ahub->dts_info.slot_width, 32);
+    ahub_remove();
+
+    host_of_set_u32(ahub_node(), "tdm-slots", 8);
+    host_of_set_u32(ahub_node(), "tdm-slot-width", 24);
+    ahub = ahub_probe();
+    HOST_CHECK_EQ(ahub->dts_info.slots, 8);
+    HOST_CHECK_EQ(ahub->dts_info.slot_width, 24);
+    /* 8 x 24 bit does not divide either pll, the clock plan refuses rather than run a drifting bclk */
+    T507AhubImplDeviceInit();
+    HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_24_BIT, 8, 48000), HDF_ERR_NOT_SUPPORT);
+    ahub_remove();
+
+    host_of_set_u32(ahub_node(), "tdm-slot-width", 16);
+    ahub = ahub_probe();
+    T507AhubImplDeviceInit();
+    /* 8 slots can not carry 16 channels */
+    HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_16_BIT, 16, 48000), HDF_FAILURE);
+    HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 48000), HDF_SUCCESS);
+    HOST_CHECK_EQ(ahub->bclk_freq, 48000u * 8 * 16);
+    HOST_CHECK_EQ(ahub->applied.slots, 8);
+    ahub_remove();
+}
+
+/*
+ * The rx side of the i2s block as the registers describe it: the frame
+ * geometry from FMT0, the channel count from IN_SLOT and for each channel
+ * the pin and slot it takes from IN_CHMAP. Decodes frames of a source that
+ * drives every slot of every data pin.
+ */
+struct TdmRx {
+    uint32_t slotWidth;
+    uint32_t slots;
+    uint32_t channels;
+    uint8_t pin[SUNXI_AHUB_TDM_MAX_CH];
+    uint8_t slot[SUNXI_AHUB_TDM_MAX_CH];
+};
+
+#define TDM_PINS    4
+
+static void tdm_rx_from_regs(const u32 *hw, uint32_t tdmNum, struct TdmRx *rx)
+{
+    static const uint32_t widths[8] = { 0, 8, 12, 16, 20, 24, 28, 32 };
+    u32 fmt0 = hw[SUNXI_AHUB_I2S_FMT0(tdmNum) / 4];
+    uint32_t lrckPeriod = ((fmt0 >> I2S_FMT0_LRCK_PERIOD) & 0x3ff) + 1;
+    uint32_t c;
+
+    rx->slotWidth = widths[(fmt0 >> I2S_FMT0_SW) & 0x7];
+    /* i2s: the lrck period is half the frame */
+    rx->slots = (rx->slotWidth != 0) ? (lrckPeriod * 2 / rx->slotWidth) : 0;
+    rx->channels = ((hw[SUNXI_AHUB_I2S_IN_SLOT(tdmNum) / 4] >> I2S_IN_SLOT_NUM) & 0xf) + 1;
+    for (c = 0; c < SUNXI_AHUB_TDM_MAX_CH; c++) {
+        u32 chmap = hw[(SUNXI_AHUB_I2S_IN_CHMAP0(tdmNum) + (c / 4) * 4) / 4];
+        uint32_t byte = (chmap >> ((c % 4) * 8)) & 0xff;
+
+        rx->pin[c] = byte >> 4;
+        rx->slot[c] = byte & 0xf;
+    }
+}
+
+/* sample of a slot in a frame: pin, slot and frame number, cut to the slot width */
+static uint32_t tdm_source(uint32_t frame, uint32_t pin, uint32_t slot, uint32_t width)
+{
+    uint32_t word = (frame << 8) | (pin << 4) | slot;
+
+    return (width < 32) ? (word & ((1u << width) - 1)) : word;
+}
+
+static void test_tdm_16ch_capture(void)
+{
+    /* a board that wired its mics out of order, on data pin 2 */
+    const u32 rxMap[SUNXI_AHUB_TDM_MAX_CH] = { 3, 2, 1, 0, 7, 6, 5, 4, 8, 9, 10, 11, 15, 14, 13, 12 };
+    const uint32_t rxPin = 2;
+    const uint32_t frames = 64;
+    struct sunxi_ahub_info *ahub;
+    struct TdmRx rx;
+    const u32 *hw;
+    uint32_t f;
+    uint32_t c;
+    uint32_t bad = 0;
+
+    ahub_dts();
+    host_of_set_u32(ahub_node(), "rx-pin", rxPin);
+    host_of_set_u32_array(ahub_node(), "rx-slot-map", rxMap, ARRAY_SIZE(rxMap));
+    ahub = ahub_probe();
+    T507AhubImplDeviceInit();
+    HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_32_BIT, 16, 48000), HDF_SUCCESS);
+    HOST_CHECK_EQ(ahub->applied.slots, 16);
+    HOST_CHECK_EQ(ahub->bclk_freq, 48000u * 16 * 32);
+
+    hw = host_regmap_hw(ahub->mem_info.regmap);
+    tdm_rx_from_regs(hw, 0, &rx);
+    HOST_CHECK_EQ(rx.slotWidth, 32);
+    HOST_CHECK_EQ(rx.slots, 16);
+    HOST_CHECK_EQ(rx.channels, 16);
+    HOST_CHECK_EQ((hw[SUNXI_AHUB_I2S_CHCFG(0) / 4] >> I2S_CHCFG_RX_CHANNUM) & 0xf, 15);
+    HOST_CHECK_EQ((hw[SUNXI_AHUB_APBIF_RX_CTL(0) / 4] >> APBIF_RX_CHAN_NUM) & 0xf, 15);
+
+    /* every channel of every frame carries the slot the dts put it on, from the configured pin */
+    for (f = 0; f < frames; f++) {
+        for (c = 0; c < rx.channels; c++) {
+            uint32_t got;
+
+            HOST_CHECK(rx.slot[c] < rx.slots && rx.pin[c] < TDM_PINS);
+            got = tdm_source(f, rx.pin[c], rx.slot[c], rx.slotWidth);
+            bad += (got != tdm_source(f, rxPin, rxMap[c], 32)) ? 1 : 0;
+        }
+    }
+    HOST_CHECK_EQ(bad, 0);
+    host_report("16 ch capture: %u slots x %u bit on pin %u, bclk %u Hz, %u frames decoded", rx.slots,
+        rx.slotWidth, rxPin, ahub->bclk_freq, frames);
+
+    /* a stereo stream after it shrinks the frame again, the map stays */
+    HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 48000), HDF_SUCCESS);
+    tdm_rx_from_regs(hw, 0, &rx);
+    HOST_CHECK_EQ(rx.slots, 2);
+    HOST_CHECK_EQ(rx.channels, 2);
+    HOST_CHECK_EQ(rx.slot[0], 3);
+    HOST_CHECK_EQ(rx.slot[1], 2);
+    HOST_CHECK_EQ(ahub->bclk_freq, 48000u * 2 * 32);
+
+    /* more channels than one pin carries */
+    HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_32_BIT, 17, 48000), HDF_FAILURE);
+    ahub_remove();
+}
+
+static void snap_save(const char *dir, const char *name, const void *data, size_t len)
+{
+    char path[256];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    fp = fopen(path, "wb");
+    HOST_CHECK(fp != NULL);
+    if (fp != NULL) {
+        HOST_CHECK_EQ(fwrite(data, 1, len, fp), len);
+        fclose(fp);
+    }
+}
+
+static unsigned long snap_logs(void)
+{
+    return host_log_count[HOST_LOG_INFO] + host_log_count[HOST_LOG_WARNING] + host_log_count[HOST_LOG_ERR];
+}
+
+/* regs.bin of the block as one read of the debugfs file, in chunks the size of a small user buffer */
+static ssize_t snap_read_bin(char *buf, size_t size)
+{
+    return host_debugfs_read(DRV_NAME, "regs.bin", buf, size, 100);
+}
+
+static void snap_check(const char *buf, ssize_t len, const u32 *hw)
+{
+    const size_t labels = ARRAY_SIZE(g_reg_labels) - 1;
+    struct T507RegSnapHeader hdr;
+    struct T507RegSnapEntry entry;
+    size_t i;
+
+    HOST_CHECK_EQ(len, (ssize_t)(sizeof(hdr) + labels * sizeof(entry)));
+    if (len < (ssize_t)sizeof(hdr)) {
+        return;
+    }
+    memcpy(&hdr, buf, sizeof(hdr));
+    HOST_CHECK_EQ(hdr.magic, T507_REGSNAP_MAGIC);
+    HOST_CHECK_EQ(hdr.version, T507_REGSNAP_VERSION);
+    HOST_CHECK_EQ(hdr.block, T507_REGSNAP_AHUB);
+    HOST_CHECK_EQ(hdr.valBytes, 4);
+    HOST_CHECK_EQ(hdr.count, labels);
+    HOST_CHECK_EQ(hdr.tstampNs, ktime_get_ns());
+    for (i = 0; i < hdr.count && sizeof(hdr) + (i + 1) * sizeof(entry) <= (size_t)len; i++) {
+        memcpy(&entry, buf + sizeof(hdr) + i * sizeof(entry), sizeof(entry));
+        HOST_CHECK_EQ(entry.addr, g_reg_labels[i].address);
+        HOST_CHECK_EQ(entry.flags, 0);
+        HOST_CHECK_EQ(entry.val, hw[entry.addr / 4]);
+    }
+}
+
+static void test_regs_snapshot(void)
+{
+    static char open[4096];
+    static char run[4096];
+    static char text[8192];
+    struct sunxi_ahub_info *ahub;
+    struct HostRegmapStats before;
+    struct HostRegmapStats after;
+    const char *dir = getenv("HOST_SNAP_DIR");
+    unsigned long logs;
+    ssize_t openLen;
+    ssize_t runLen;
+    ssize_t textLen;
+
+    ahub_dts();
+    ahub = ahub_probe();
+    T507AhubImplDeviceInit();
+
+    logs = snap_logs();
+    before = ahub_bus(ahub);
+    openLen = snap_read_bin(open, sizeof(open));
+    after = ahub_bus(ahub);
+    snap_check(open, openLen, host_regmap_hw(ahub->mem_info.regmap));
+
+    host_advance(MS(1));
+    HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_RENDER_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 48000), HDF_SUCCESS);
+    runLen = snap_read_bin(run, sizeof(run));
+    snap_check(run, runLen, host_regmap_hw(ahub->mem_info.regmap));
+    textLen = host_debugfs_read(DRV_NAME, "regs", text, sizeof(text), 100);
+    HOST_CHECK(textLen > 0);
+    /* a snapshot reads, it never logs */
+    HOST_CHECK_EQ(snap_logs(), logs);
+    HOST_CHECK(runLen > 0 && memcmp(open, run, (size_t)runLen) != 0);
+
+    host_report("regs.bin %zd bytes, text regs %zd bytes, %u labelled registers, %u bus reads per snapshot",
+        runLen, textLen, (unsigned)(ARRAY_SIZE(g_reg_labels) - 1), after.busReads - before.busReads);
+
+    /* the Makefile hands these to tools/t507_regsnap.py */
+    if (dir != NULL) {
+        snap_save(dir, "ahub_open.bin", open, (size_t)openLen);
+        snap_save(dir, "ahub_run.bin", run, (size_t)runLen);
+        snap_save(dir, "ahub_regs.txt", text, (size_t)textLen);
+    }
+    ahub_remove();
+}
+
+/*
+ * Settle times charged on the virtual clock, assumed rather than measured: a
+ * pmic ldo that declares 1 ms of enable time, 100 us pll lock (the pllx4
+ * enable is charged a second lock, which overstates it) and 100 ns per apb
+ * access. The budget is checked against the sum, the board has to be no
+ * slower than this.
+ */
+#define TEST_SUPPLY_RAMP_US     1000
+#define TEST_PLL_LOCK_US        100
+#define TEST_MMIO_NS            100
+
+static void resume_costs(uint32_t rampUs)
+{
+    host_regulator(TEST_AHUB_REGULATOR)->rampNs = US(rampUs);
+    host_clk(ahub_node(), 0)->lockNs = US(TEST_PLL_LOCK_US);
+    host_clk(ahub_node(), 1)->lockNs = US(TEST_PLL_LOCK_US);
+    host_mmio_ns = TEST_MMIO_NS;
+}
+
+/* what the ADM does to start a render: startup, hw_params, trigger; virtual ns from the first call */
+static uint64_t stream_start(struct sunxi_ahub_info *ahub, uint32_t rate, uint64_t gapNs)
+{
+    uint64_t start = ktime_get_ns();
+    uint64_t idle;
+
+    HOST_CHECK_EQ(T507AhubImplStartup(AUDIO_RENDER_STREAM), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507AhubImplHwParams(AUDIO_RENDER_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, rate), HDF_SUCCESS);
+    /* the time an application takes between prepare and the first write does not count */
+    idle = ktime_get_ns();
+    host_advance(gapNs);
+    idle = ktime_get_ns() - idle;
+    HOST_CHECK_EQ(T507AhubImplTrigger(AUDIO_RENDER_STREAM, true), HDF_SUCCESS);
+    HOST_CHECK(ahub->tx_on);
+
+    return ktime_get_ns() - start - idle;
+}
+
+static void stream_stop_idle(struct sunxi_ahub_info *ahub)
+{
+    HOST_CHECK_EQ(T507AhubImplTrigger(AUDIO_RENDER_STREAM, false), HDF_SUCCESS);
+    host_advance(MS(ahub->dts_info.autosuspend_ms) + 1);
+    HOST_CHECK(pm_runtime_suspended(ahub->dev));
+}
+
+static void test_resume_latency(void)
+{
+    struct sunxi_ahub_info *ahub;
+    uint32_t resumes;
+    uint64_t warm;
+    uint64_t cold;
+    uint64_t family;
+    uint64_t late;
+
+    ahub_dts();
+    resume_costs(TEST_SUPPLY_RAMP_US);
+    ahub = ahub_probe();
+    T507AhubImplDeviceInit();
+    /* the first stream after boot programs everything, the ones after only resume and flush */
+    stream_start(ahub, 48000, 0);
+    HOST_CHECK_EQ(T507AhubImplTrigger(AUDIO_RENDER_STREAM, false), HDF_SUCCESS);
+    warm = stream_start(ahub, 48000, 0);
+    stream_stop_idle(ahub);
+
+    /* after autosuspend: one resume in hw_params, the trigger finds the block still up */
+    resumes = ahub->dev->power.resumes;
+    cold = stream_start(ahub, 48000, MS(500));
+    HOST_CHECK_EQ(ahub->dev->power.resumes, resumes + 1);
+    HOST_CHECK(cold < US(SUNXI_AHUB_RESUME_BUDGET_US));
+    HOST_CHECK(ahub->resume_last_us < SUNXI_AHUB_RESUME_BUDGET_US);
+    HOST_CHECK(ahub->resume_last_us * NSEC_PER_USEC <= cold);
+    stream_stop_idle(ahub);
+
+    /* after autosuspend at the other rate family, the pll is retuned on top */
+    resumes = ahub->dev->power.resumes;
+    family = stream_start(ahub, 44100, 0);
+    HOST_CHECK_EQ(ahub->dev->power.resumes, resumes + 1);
+    HOST_CHECK(family < US(SUNXI_AHUB_RESUME_BUDGET_US));
+    stream_stop_idle(ahub);
+
+    /* prepared, then started after the idle delay: the trigger pays the resume instead */
+    resumes = ahub->dev->power.resumes;
+    late = stream_start(ahub, 44100, MS(ahub->dts_info.autosuspend_ms) + 1);
+    HOST_CHECK_EQ(ahub->dev->power.resumes, resumes + 2);
+    HOST_CHECK(late < US(SUNXI_AHUB_RESUME_BUDGET_US));
+    HOST_CHECK_EQ(ahub->resume_over_budget, 0);
+
+    host_report("stream start, virtual clock, budget %u us:", SUNXI_AHUB_RESUME_BUDGET_US);
+    host_report("  block awake            %8.1f us", warm / 1e3);
+    host_report("  after autosuspend      %8.1f us, of it resume %u us", cold / 1e3, ahub->resume_max_us);
+    host_report("  after, 44.1k family    %8.1f us", family / 1e3);
+    host_report("  trigger after idle     %8.1f us, two resumes", late / 1e3);
+    HOST_CHECK_EQ(T507AhubImplTrigger(AUDIO_RENDER_STREAM, false), HDF_SUCCESS);
+    ahub_remove();
+}
+
+/* a supply slower than the budget is counted and logged once per resume */
+static void test_resume_over_budget(void)
+{
+    struct sunxi_ahub_info *ahub;
+    unsigned long errors;
+
+    ahub_dts();
+    resume_costs(SUNXI_AHUB_RESUME_BUDGET_US + 1000);
+    ahub = ahub_probe();
+    T507AhubImplDeviceInit();
+    host_advance(MS(ahub->dts_info.autosuspend_ms) + 1);
+    HOST_CHECK(pm_runtime_suspended(ahub->dev));
+
+    errors = host_log_count[HOST_LOG_ERR];
+    HOST_CHECK(stream_start(ahub, 48000, 0) > US(SUNXI_AHUB_RESUME_BUDGET_US));
+    HOST_CHECK_EQ(ahub->resume_over_budget, 1);
+    HOST_CHECK(ahub->resume_last_us > SUNXI_AHUB_RESUME_BUDGET_US);
+    HOST_CHECK_EQ(host_log_count[HOST_LOG_ERR], errors + 1);
+    HOST_CHECK_EQ(T507AhubImplTrigger(AUDIO_RENDER_STREAM, false), HDF_SUCCESS);
+    ahub_remove();
+}
+
+static const struct HostTestCase g_cases[] = {
+    { "probe_remove", test_probe_remove },
+    { "regmap_cost", test_regmap_cost },
+    { "tdm_slots", test_tdm_slots },
+    { "tdm_dts", test_tdm_dts },
+    { "tdm_16ch_capture", test_tdm_16ch_capture },
+    { "regs_snapshot", test_regs_snapshot },
+    { "resume_latency", test_resume_latency },
+    { "resume_over_budget", test_resume_over_budget },
+};
+
+int main(int argc, char **argv)
+{
+    return host_test_main(g_cases, ARRAY_SIZE(g_cases), test_reset, argc, argv);
+}
@@ -0,0 +1,814 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * t507_codec_impl_linux.c probed on a fake platform device, included like the
+ * ahub driver in test_ahub.c. The expected register values are spelled out
+ * from the datasheet field layout here, not taken from the driver tables.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "../../soc/src/t507_clk_plan.c"
+#include "../../codec/t507/src/t507_codec_impl_linux.c"
+#include "t507_dma_ops.h"
+#include "host_device.h"
+#include "host_test.h"
+
+#define TEST_CODEC_NODE     "/soc@03000000/codec@0x05096000"
+#define TEST_CODEC_SUPPLY   "avcc"
+
+#define MS(n)               ((uint64_t)(n) * NSEC_PER_MSEC)
+
+#define FIELD(v, shift, mask)   (((v) >> (shift)) & (mask))
+
+static struct platform_device g_pdev;
+
+/* fifo flush bits clear themselves, fifo status is write-1-to-clear */
+static void codec_hw_write(unsigned int reg, u32 old, u32 *hw)
+{
+    switch (reg) {
+        case SUNXI_DAC_FIFO_CTL:
+            *hw &= ~(0x1 << DAC_FIFO_FLUSH);
+            break;
+        case SUNXI_ADC_FIFO_CTL:
+            *hw &= ~(0x1 << ADC_FIFO_FLUSH);
+            break;
+        case SUNXI_DAC_FIFO_STA:
+        case SUNXI_ADC_FIFO_STA:
+            *hw = old & ~*hw;
+            break;
+        default:
+            break;
+    }
+}
+
+static void test_reset(void)
+{
+    host_clock_reset();
+    host_device_reset();
+    host_mmio_write_hook = codec_hw_write;
+    host_hcs_reset();
+    host_trace_enabled = false;
+    g_codec_pdev = NULL;
+    g_clk_pll_freq = 0;
+    memset(g_clk_user_freq, 0, sizeof(g_clk_user_freq));
+    memset(g_clk_user_running, 0, sizeof(g_clk_user_running));
+}
+
+static struct device_node *codec_node(void)
+{
+    return of_find_node_by_path(TEST_CODEC_NODE);
+}
+
+static void codec_dts(void)
+{
+    const u32 reg[2] = { SUNXI_CODEC_ADDR_BASE, SUNXI_AUDIO_MAX_REG + 4 };
+
+    host_of_set_u32_array(codec_node(), "reg", reg, ARRAY_SIZE(reg));
+}
+
+static struct sunxi_codec_info *codec_probe(void)
+{
+    codec_dts();
+    memset(&g_pdev, 0, sizeof(g_pdev));
+    g_pdev.name = DRV_NAME;
+    g_pdev.dev.of_node = codec_node();
+    g_pdev.dev.init_name = TEST_CODEC_NODE;
+    HOST_CHECK_EQ(host_platform_probe(&sunxi_internal_codec_driver, &g_pdev), 0);
+
+    return dev_get_drvdata(&g_pdev.dev);
+}
+
+static void codec_remove(void)
+{
+    HOST_CHECK_EQ(host_platform_remove(&sunxi_internal_codec_driver, &g_pdev), 0);
+    HOST_CHECK_EQ(host_devres_live(), 0);
+    HOST_CHECK_EQ(host_mem_live(), 0);
+}
+
+static u32 codec_reg(const struct sunxi_codec_info *codec, unsigned int reg)
+{
+    return host_regmap_hw(codec->mem_info.regmap)[reg / 4];
+}
+
+/* past the autosuspend delay, nothing should still hold the codec */
+static void codec_idle(const struct sunxi_codec_info *codec)
+{
+    host_advance(MS(codec->dts_info.autosuspend_ms) + 1);
+}
+
+static void test_probe_remove(void)
+{
+    struct sunxi_codec_info *codec = codec_probe();
+    struct regulator *avcc = host_regulator(TEST_CODEC_SUPPLY);
+
+    HOST_CHECK(codec != NULL);
+    HOST_CHECK(g_codec_pdev == &g_pdev);
+    HOST_CHECK_EQ(avcc->enableCount, 1);
+    HOST_CHECK_EQ(avcc->uV, 1800000);
+    HOST_CHECK(codec->clk_info.clk_audio->parent == codec->clk_info.clk_pll_audiox4);
+
+    codec_idle(codec);
+    HOST_CHECK(pm_runtime_suspended(&g_pdev.dev));
+    HOST_CHECK_EQ(avcc->enableCount, 0);
+    HOST_CHECK_EQ(codec->clk_info.clk_audio->enableCount, 0);
+
+    codec_remove();
+    HOST_CHECK_EQ(host_clk(codec_node(), 2)->enableCount, 0);
+}
+
+/* adc fifo as the datasheet lays it out: fs 31:29, mode 24, width 16, channel mask 15:12, drq level 11:4 */
+static void test_capture_hw_params(void)
+{
+    struct sunxi_codec_info *codec = codec_probe();
+    u32 ctl;
+
+    HOST_CHECK_EQ(T507CodecImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 48000), HDF_SUCCESS);
+    ctl = codec_reg(codec, SUNXI_ADC_FIFO_CTL);
+    HOST_CHECK_EQ(FIELD(ctl, 29, 0x7), 0);
+    HOST_CHECK_EQ(FIELD(ctl, 24, 0x1), 1);
+    HOST_CHECK_EQ(FIELD(ctl, 16, 0x1), 0);
+    HOST_CHECK_EQ(FIELD(ctl, 12, 0xf), 0x3);
+    HOST_CHECK_EQ(FIELD(ctl, 4, 0xff), T507_CODEC_RXFIFO_LEVEL);
+    HOST_CHECK_EQ(FIELD(ctl, 0, 0x1), 0);
+    HOST_CHECK_EQ(FIELD(ctl, 28, 0x1), 0);
+    HOST_CHECK_EQ(FIELD(ctl, 3, 0x1), 0);
+    HOST_CHECK_EQ(codec->clk_info.clk_audio->rate, 2 * T507_CLK_FREQ_48K_FAMILY);
+
+    HOST_CHECK_EQ(T507CodecImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_24_BIT, 1, 16000), HDF_SUCCESS);
+    ctl = codec_reg(codec, SUNXI_ADC_FIFO_CTL);
+    HOST_CHECK_EQ(FIELD(ctl, 29, 0x7), 0x3);
+    HOST_CHECK_EQ(FIELD(ctl, 24, 0x1), 0);
+    HOST_CHECK_EQ(FIELD(ctl, 16, 0x1), 1);
+    HOST_CHECK_EQ(FIELD(ctl, 12, 0xf), 0x1);
+
+    /* the adc decimator stops at 48 kHz */
+    HOST_CHECK_EQ(T507CodecImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 96000),
+        HDF_ERR_NOT_SUPPORT);
+    HOST_CHECK_EQ(codec_reg(codec, SUNXI_ADC_FIFO_CTL), ctl);
+    HOST_CHECK_EQ(codec_reg(codec, SUNXI_DAC_FIFO_CTL), 0);
+    codec_remove();
+}
+
+/* the adc holds a runtime pm reference from start to stop, then the codec gates */
+static void test_capture_trigger(void)
+{
+    struct sunxi_codec_info *codec = codec_probe();
+    struct regulator *avcc = host_regulator(TEST_CODEC_SUPPLY);
+    uint32_t resumes;
+
+    codec_idle(codec);
+    HOST_CHECK(pm_runtime_suspended(&g_pdev.dev));
+    resumes = g_pdev.dev.power.resumes;
+
+    HOST_CHECK_EQ(T507CodecImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 48000), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_CAPTURE_STREAM, true), HDF_SUCCESS);
+    HOST_CHECK(codec->capture_on);
+    HOST_CHECK(g_clk_user_running[T507_CLK_CODEC_CAPTURE]);
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_ADC_FIFO_CTL), 28, 0x1), 1);
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_ADC_FIFO_CTL), 3, 0x1), 1);
+    /* a second start is a no-op, it must not take another reference */
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_CAPTURE_STREAM, true), HDF_SUCCESS);
+
+    codec_idle(codec);
+    HOST_CHECK(!pm_runtime_suspended(&g_pdev.dev));
+    HOST_CHECK_EQ(avcc->enableCount, 1);
+    /* hw_params and start ran inside the same autosuspend window */
+    HOST_CHECK_EQ(g_pdev.dev.power.resumes, resumes + 1);
+
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_CAPTURE_STREAM, false), HDF_SUCCESS);
+    HOST_CHECK(!codec->capture_on);
+    HOST_CHECK(!g_clk_user_running[T507_CLK_CODEC_CAPTURE]);
+    codec_idle(codec);
+    HOST_CHECK(pm_runtime_suspended(&g_pdev.dev));
+    HOST_CHECK_EQ(avcc->enableCount, 0);
+    /* en_ad and drq were cleared in the cache before the gate */
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_ADC_FIFO_CTL), 28, 0x1), 0);
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_ADC_FIFO_CTL), 3, 0x1), 0);
+    codec_remove();
+}
+
+/*
+ * dac and adc share the module clock: capture joins a running render on the
+ * same family, is refused on the other one, and each direction keeps the
+ * codec awake on its own while the other stops.
+ */
+static void test_full_duplex(void)
+{
+    struct sunxi_codec_info *codec = codec_probe();
+    struct regulator *avcc = host_regulator(TEST_CODEC_SUPPLY);
+    uint32_t resumes;
+    u32 adc;
+
+    codec_idle(codec);
+    resumes = g_pdev.dev.power.resumes;
+
+    HOST_CHECK_EQ(T507CodecImplHwParams(AUDIO_RENDER_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 48000), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_RENDER_STREAM, true), HDF_SUCCESS);
+
+    /* 44.1k would retune the pll under the running dac */
+    HOST_CHECK_EQ(T507CodecImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 44100),
+        HDF_ERR_DEVICE_BUSY);
+    HOST_CHECK_EQ(codec->clk_info.clk_audio->rate, 2 * T507_CLK_FREQ_48K_FAMILY);
+    HOST_CHECK_EQ(codec_reg(codec, SUNXI_ADC_FIFO_CTL), 0);
+
+    /* 16k is on the 48k family, it runs next to 48k playback */
+    HOST_CHECK_EQ(T507CodecImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_16_BIT, 1, 16000), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_CAPTURE_STREAM, true), HDF_SUCCESS);
+    adc = codec_reg(codec, SUNXI_ADC_FIFO_CTL);
+    HOST_CHECK_EQ(FIELD(adc, 29, 0x7), 0x3);
+    HOST_CHECK_EQ(FIELD(adc, 28, 0x1), 1);
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_DAC_FIFO_CTL), 29, 0x7), 0);
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_DAC_FIFO_CTL), 4, 0x1), 1);
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_DAC_DPC), EN_DA, 0x1), 1);
+
+    /* render stops, the adc keeps running and keeps the codec up */
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_RENDER_STREAM, false), HDF_SUCCESS);
+    codec_idle(codec);
+    HOST_CHECK(!pm_runtime_suspended(&g_pdev.dev));
+    HOST_CHECK_EQ(avcc->enableCount, 1);
+    HOST_CHECK_EQ(codec_reg(codec, SUNXI_ADC_FIFO_CTL), adc);
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_DAC_FIFO_CTL), 4, 0x1), 0);
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_DAC_DPC), EN_DA, 0x1), 0);
+
+    /* a dac restart on the adc's family joins it without a resume */
+    HOST_CHECK_EQ(T507CodecImplHwParams(AUDIO_RENDER_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 96000), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_RENDER_STREAM, true), HDF_SUCCESS);
+    HOST_CHECK_EQ(g_pdev.dev.power.resumes, resumes + 1);
+
+    /* capture stops first this time, render alone holds the codec */
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_CAPTURE_STREAM, false), HDF_SUCCESS);
+    codec_idle(codec);
+    HOST_CHECK(!pm_runtime_suspended(&g_pdev.dev));
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_ADC_FIFO_CTL), 28, 0x1), 0);
+    HOST_CHECK_EQ(FIELD(codec_reg(codec, SUNXI_DAC_FIFO_CTL), 4, 0x1), 1);
+
+    /* with the dac alone on 48k, capture may take the other family only once it stops */
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_RENDER_STREAM, false), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507CodecImplHwParams(AUDIO_CAPTURE_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 44100), HDF_SUCCESS);
+    HOST_CHECK_EQ(codec->clk_info.clk_audio->rate, 2 * T507_CLK_FREQ_44K1_FAMILY);
+    /* and the dac set up for 96k may no longer start on it */
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_RENDER_STREAM, true), HDF_ERR_DEVICE_BUSY);
+    HOST_CHECK(!codec->render_on);
+
+    codec_idle(codec);
+    HOST_CHECK(pm_runtime_suspended(&g_pdev.dev));
+    HOST_CHECK_EQ(avcc->enableCount, 0);
+    /* one resume for the whole session, one suspend at its end */
+    HOST_CHECK_EQ(g_pdev.dev.power.resumes, resumes + 1);
+    host_report("full duplex session: %u resume, %u suspends since probe", g_pdev.dev.power.resumes - resumes,
+        g_pdev.dev.power.suspends);
+    codec_remove();
+}
+
+/*
+ * DAC_FS/ADC_FS codes from the datasheet: 000 48k, 001 32k, 010 24k, 011 16k,
+ * 100 12k, 101 8k, 110 192k, 111 96k. A 44.1k family rate takes the code of
+ * its 48k sibling and the module clock moves to 2 x 22.5792 MHz. fs 0 ends
+ * the table, the rates after it have no code at all.
+ */
+struct RateSpec {
+    uint32_t rate;
+    uint32_t fs;
+    uint32_t family;
+    bool adc;
+};
+
+static const struct RateSpec g_rate_specs[] = {
+    {8000,   0x5, T507_CLK_FREQ_48K_FAMILY,  true},
+    {11025,  0x4, T507_CLK_FREQ_44K1_FAMILY, true},
+    {12000,  0x4, T507_CLK_FREQ_48K_FAMILY,  true},
+    {16000,  0x3, T507_CLK_FREQ_48K_FAMILY,  true},
+    {22050,  0x2, T507_CLK_FREQ_44K1_FAMILY, true},
+    {24000,  0x2, T507_CLK_FREQ_48K_FAMILY,  true},
+    {32000,  0x1, T507_CLK_FREQ_48K_FAMILY,  true},
+    {44100,  0x0, T507_CLK_FREQ_44K1_FAMILY, true},
+    {48000,  0x0, T507_CLK_FREQ_48K_FAMILY,  true},
+    {88200,  0x7, T507_CLK_FREQ_44K1_FAMILY, false},
+    {96000,  0x7, T507_CLK_FREQ_48K_FAMILY,  false},
+    {176400, 0x6, T507_CLK_FREQ_44K1_FAMILY, false},
+    {192000, 0x6, T507_CLK_FREQ_48K_FAMILY,  false},
+    {0,      0,   0,                         false},
+    {7999,   0,   0,                         false},
+    {64000,  0,   0,                         false},
+    {384000, 0,   0,                         false},
+};
+
+static const enum AudioFormat g_formats[] = {
+    AUDIO_FORMAT_PCM_8_BIT, AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_24_BIT, AUDIO_FORMAT_PCM_32_BIT,
+};
+
+/* fields hw_params owns in each fifo ctl, everything else must come through untouched */
+#define DAC_PARAM_MASK      ((0x7U << 29) | (0x3U << 24) | (0x1U << 6) | (0x1U << 5))
+#define ADC_PARAM_MASK      ((0x7U << 29) | (0x1U << 24) | (0x1U << 16) | (0xfU << 12) | (0xffU << 4))
+
+static u32 dac_expect(const struct RateSpec *spec, enum AudioFormat format, uint32_t channels)
+{
+    bool s16 = (format == AUDIO_FORMAT_PCM_16_BIT);
+
+    return (spec->fs << 29) | ((s16 ? 0x3U : 0x0U) << 24) | ((channels == 1 ? 1U : 0U) << 6) | ((s16 ? 0U : 1U) << 5);
+}
+
+static u32 adc_expect(const struct RateSpec *spec, enum AudioFormat format, uint32_t channels)
+{
+    bool s16 = (format == AUDIO_FORMAT_PCM_16_BIT);
+
+    return (spec->fs << 29) | ((s16 ? 1U : 0U) << 24) | ((s16 ? 0U : 1U) << 16) |
+        ((channels == 1 ? 0x1U : 0x3U) << 12) | (T507_CODEC_RXFIFO_LEVEL << 4);
+}
+
+static int32_t params_expect(enum AudioStreamType stream, const struct RateSpec *spec, enum AudioFormat format,
+    uint32_t channels)
+{
+    if (spec->fs == 0 && spec->rate != 44100 && spec->rate != 48000) {
+        return HDF_ERR_NOT_SUPPORT;
+    }
+    if (stream == AUDIO_CAPTURE_STREAM && !spec->adc) {
+        return HDF_ERR_NOT_SUPPORT;
+    }
+    if ((format != AUDIO_FORMAT_PCM_16_BIT && format != AUDIO_FORMAT_PCM_24_BIT) || channels < 1 || channels > 2) {
+        return HDF_FAILURE;
+    }
+
+    return HDF_SUCCESS;
+}
+
+/*
+ * Every rate, format and channel count on both fifos, each from a baseline
+ * of 8 kHz 24 bit mono so a partial write shows. An accepted set programs
+ * exactly its fields and the module clock, a refused one touches neither
+ * the registers, the clocks nor the drc rate.
+ */
+static void test_params_matrix(void)
+{
+    struct sunxi_codec_info *codec = codec_probe();
+    struct clk *pllx4 = codec->clk_info.clk_pll_audiox4;
+    struct clk *module = codec->clk_info.clk_audio;
+    uint32_t accepted = 0;
+    uint32_t refused = 0;
+    uint32_t stream, r, f, channels;
+    uint64_t start, wall = 0;
+
+    for (stream = AUDIO_CAPTURE_STREAM; stream <= AUDIO_RENDER_STREAM; stream++) {
+        unsigned int reg = (stream == AUDIO_RENDER_STREAM) ? SUNXI_DAC_FIFO_CTL : SUNXI_ADC_FIFO_CTL;
+        u32 mask = (stream == AUDIO_RENDER_STREAM) ? DAC_PARAM_MASK : ADC_PARAM_MASK;
+
+        for (r = 0; r < ARRAY_SIZE(g_rate_specs); r++) {
+            const struct RateSpec *spec = &g_rate_specs[r];
+
+            for (f = 0; f < ARRAY_SIZE(g_formats); f++) {
+                for (channels = 0; channels <= 3; channels++) {
+                    int32_t want = params_expect(stream, spec, g_formats[f], channels);
+                    unsigned long pllRate, moduleRate;
+                    uint32_t drcRate;
+                    u32 before, after, other;
+                    int32_t ret;
+
+                    HOST_CHECK_EQ(T507CodecImplHwParams(stream, AUDIO_FORMAT_PCM_24_BIT, 1, 8000), HDF_SUCCESS);
+                    before = codec_reg(codec, reg);
+                    other = codec_reg(codec, reg == SUNXI_DAC_FIFO_CTL ? SUNXI_ADC_FIFO_CTL : SUNXI_DAC_FIFO_CTL);
+                    pllRate = pllx4->rate;
+                    moduleRate = module->rate;
+                    drcRate = codec->drc_rate;
+
+                    start = host_wall_ns();
+                    ret = T507CodecImplHwParams(stream, g_formats[f], channels, spec->rate);
+                    wall += host_wall_ns() - start;
+                    after = codec_reg(codec, reg);
+                    HOST_CHECK_EQ(ret, want);
+                    if (ret != want) {
+                        host_report("%s %u Hz format %d %u ch", stream == AUDIO_RENDER_STREAM ? "render" : "capture",
+                            spec->rate, g_formats[f], channels);
+                    }
+                    HOST_CHECK_EQ(codec_reg(codec, reg == SUNXI_DAC_FIFO_CTL ? SUNXI_ADC_FIFO_CTL :
+                        SUNXI_DAC_FIFO_CTL), other);
+                    if (want != HDF_SUCCESS) {
+                        HOST_CHECK_EQ(after, before);
+                        HOST_CHECK_EQ(pllx4->rate, pllRate);
+                        HOST_CHECK_EQ(module->rate, moduleRate);
+                        HOST_CHECK_EQ(codec->drc_rate, drcRate);
+                        refused++;
+                        continue;
+                    }
+                    HOST_CHECK_EQ(after & ~mask, before & ~mask);
+                    HOST_CHECK_EQ(after & mask, stream == AUDIO_RENDER_STREAM ?
+                        dac_expect(spec, g_formats[f], channels) : adc_expect(spec, g_formats[f], channels));
+                    HOST_CHECK_EQ(module->rate, 2 * spec->family);
+                    HOST_CHECK_EQ(codec->drc_rate, stream == AUDIO_RENDER_STREAM ? spec->rate : drcRate);
+                    accepted++;
+                }
+            }
+        }
+    }
+
+    HOST_CHECK_EQ(accepted, (13 + 9) * 2 * 2);
+    host_report("%u combinations, %u accepted, %u refused, %.0f ns host per hw_params", accepted + refused,
+        accepted, refused, (double)wall / (accepted + refused));
+    codec_remove();
+}
+
+/* the drc reference in double precision: Q24 of 1 - exp(-2.2 / (fs * t)) and of dB / 20log10(2) */
+static double drc_time_ref(uint32_t rate, uint32_t us)
+{
+    return (1.0 - exp(-2.2 / ((double)rate * us * 1e-6))) * SUNXI_DRC_ONE;
+}
+
+static double drc_level_ref(uint32_t mdb)
+{
+    return mdb / 1000.0 / (20.0 * log10(2.0)) * SUNXI_DRC_ONE;
+}
+
+static double lsb_err(uint32_t got, double want)
+{
+    return fabs((double)(int32_t)got - want);
+}
+
+/*
+ * The time constant over every codec rate and every attack and release the
+ * kcontrols can ask for, plus a sweep from 100 us to 2 s; the driver claims
+ * 1 lsb against libm.
+ */
+static void test_drc_time(void)
+{
+    double worst = 0.0;
+    double err;
+    uint32_t worstRate = 0, worstUs = 0;
+    uint32_t n = 0;
+    uint32_t r, us, step;
+    double t;
+
+    for (r = 0; r < ARRAY_SIZE(g_rate_specs); r++) {
+        uint32_t rate = g_rate_specs[r].rate;
+
+        if (g_rate_specs[r].family == 0) {
+            continue;
+        }
+        for (step = 1; step <= 3000; step++) {
+            /* attack 0.1 ms units up to 100 ms, then release 1 ms units up to 2 s */
+            us = (step <= 1000) ? step * 100 : (step - 1000) * 1000;
+            err = lsb_err(sunxi_drc_time(rate, us), drc_time_ref(rate, us));
+            if (err > worst) {
+                worst = err;
+                worstRate = rate;
+                worstUs = us;
+            }
+            n++;
+        }
+        for (t = 100.0; t <= 2000000.0; t *= 1.01) {
+            us = (uint32_t)t;
+            err = lsb_err(sunxi_drc_time(rate, us), drc_time_ref(rate, us));
+            if (err > worst) {
+                worst = err;
+                worstRate = rate;
+                worstUs = us;
+            }
+            n++;
+        }
+    }
+
+    HOST_CHECK(worst < 1.0);
+    /* 1 ms attack and 100 ms release at 48 kHz, the second one is past 2^32 us x Hz */
+    HOST_CHECK_EQ(sunxi_drc_time(48000, 1000), 0x000B77F0);
+    HOST_CHECK_EQ(SUNXI_DRC_ONE - sunxi_drc_time(48000, 100000), 0x00FFE1F8);
+    host_report("drc time constant: %u points, worst %.2f Q24 lsb (%u Hz, %u us)", n, worst, worstRate, worstUs);
+}
+
+static bool batch_find(const struct sunxi_codec_batch *batch, uint32_t reg, uint32_t *val, uint32_t *mask)
+{
+    int j;
+
+    for (j = 0; j < batch->num; j++) {
+        if (batch->seq[j].reg == reg) {
+            *val = batch->seq[j].def;
+            *mask = batch->mask[j];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* a 32 bit coefficient from its two 16 bit halves in the batch */
+static uint32_t batch_coef(const struct sunxi_codec_batch *batch, uint32_t hreg, uint32_t lreg)
+{
+    uint32_t hi = 0, lo = 0, hmask = 0, lmask = 0;
+
+    HOST_CHECK(batch_find(batch, hreg, &hi, &hmask));
+    HOST_CHECK(batch_find(batch, lreg, &lo, &lmask));
+    HOST_CHECK_EQ(hmask, 0xffff);
+    HOST_CHECK_EQ(lmask, 0xffff);
+
+    return (hi << 16) | lo;
+}
+
+/* DRC_TOL_LSB also covers the 6.0206 dB per unit of the levels, 2.5 lsb at 60 dB */
+#define DRC_TOL_LSB         4.0
+
+/* the coefficients a drc parameter set must compile to at rate */
+static void drc_check_batch(const struct sunxi_codec_batch *batch, const struct sunxi_codec_drc_preset *p,
+    uint32_t rate, double *worst)
+{
+    uint32_t ct = p->comp_thr * 1000;
+    uint32_t ratio = p->comp_ratio ? p->comp_ratio : 1;
+    uint32_t lt = (p->limit_thr * 1000 < ct) ? p->limit_thr * 1000 : ct;
+    uint32_t attack = p->attack * 100;
+    uint32_t release = p->release * 1000;
+    double opl = drc_level_ref(ct) - (drc_level_ref(ct) - drc_level_ref(lt)) / ratio;
+    double errs[] = {
+        lsb_err(batch_coef(batch, AC_DAC_DRC_LPFHAT, AC_DAC_DRC_LPFLAT), drc_time_ref(rate, attack)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_RPFHAT, AC_DAC_DRC_RPFLAT), drc_time_ref(rate, attack)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_SFHAT, AC_DAC_DRC_SFLAT), drc_time_ref(rate, attack)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_LPFHRT, AC_DAC_DRC_LPFLRT), SUNXI_DRC_ONE - drc_time_ref(rate, release)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_RPFHRT, AC_DAC_DRC_RPFLRT), SUNXI_DRC_ONE - drc_time_ref(rate, release)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_SFHRT, AC_DAC_DRC_SFLRT), drc_time_ref(rate, release)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_LRMSHAT, AC_DAC_DRC_LRMSLAT), drc_time_ref(rate, SUNXI_DRC_RMS_US)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_RRMSHAT, AC_DAC_DRC_RRMSLAT), drc_time_ref(rate, SUNXI_DRC_RMS_US)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_HCT, AC_DAC_DRC_LCT), drc_level_ref(ct)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_HOPC, AC_DAC_DRC_LOPC), -drc_level_ref(ct)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_HLT, AC_DAC_DRC_LLT), drc_level_ref(lt)),
+        lsb_err(batch_coef(batch, AC_DAC_DRC_HOPL, AC_DAC_DRC_LOPL), -opl),
+    };
+    uint32_t val = 0, mask = 0;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(errs); i++) {
+        HOST_CHECK(errs[i] < DRC_TOL_LSB);
+        *worst = errs[i] > *worst ? errs[i] : *worst;
+    }
+    HOST_CHECK_EQ(batch_coef(batch, AC_DAC_DRC_HKC, AC_DAC_DRC_LKC), SUNXI_DRC_ONE / ratio);
+    HOST_CHECK_EQ(batch_coef(batch, AC_DAC_DRC_HKI, AC_DAC_DRC_LKI), SUNXI_DRC_KI);
+    HOST_CHECK(batch_find(batch, AC_DAC_DRC_CTRL, &val, &mask));
+    HOST_CHECK_EQ(mask, (1 << DRC_LT_EN) | (1 << DRC_ET_EN));
+    HOST_CHECK_EQ(val, 1 << DRC_LT_EN);
+}
+
+static void drc_load(struct sunxi_codec_info *codec, const struct sunxi_codec_drc_preset *p)
+{
+    codec->kctrl[KCTRL_DRC_ENABLE].value = p->enable;
+    codec->kctrl[KCTRL_DRC_COMP_THR].value = p->comp_thr;
+    codec->kctrl[KCTRL_DRC_COMP_RATIO].value = p->comp_ratio;
+    codec->kctrl[KCTRL_DRC_LIMIT_THR].value = p->limit_thr;
+    codec->kctrl[KCTRL_DRC_ATTACK].value = p->attack;
+    codec->kctrl[KCTRL_DRC_RELEASE].value = p->release;
+}
+
+/* every preset at every render rate compiles to one batch of 29 registers matching the reference */
+static void test_drc_compile(void)
+{
+    struct sunxi_codec_info *codec = codec_probe();
+    struct sunxi_codec_batch batch;
+    double worst = 0.0;
+    uint32_t p, r;
+
+    for (p = 0; p < ARRAY_SIZE(g_drc_presets); p++) {
+        drc_load(codec, &g_drc_presets[p]);
+        for (r = 0; r < ARRAY_SIZE(g_rate_specs); r++) {
+            if (g_rate_specs[r].family == 0) {
+                continue;
+            }
+            codec->drc_rate = g_rate_specs[r].rate;
+            batch.num = 0;
+            sunxi_codec_drc_compile(codec, &batch);
+            HOST_CHECK_EQ(batch.num, SUNXI_DRC_REG_NUM);
+            drc_check_batch(&batch, &g_drc_presets[p], g_rate_specs[r].rate, &worst);
+        }
+    }
+    host_report("drc compile: %zu presets x 13 rates, worst coefficient %.2f Q24 lsb", ARRAY_SIZE(g_drc_presets),
+        worst);
+    codec_remove();
+}
+
+/* the drc coefficients as the hardware holds them, read back into a batch */
+static void drc_from_regs(const struct sunxi_codec_info *codec, struct sunxi_codec_batch *batch)
+{
+    static const uint32_t regs[] = {
+        AC_DAC_DRC_CTRL, AC_DAC_DRC_LPFHAT, AC_DAC_DRC_LPFLAT, AC_DAC_DRC_RPFHAT, AC_DAC_DRC_RPFLAT,
+        AC_DAC_DRC_LPFHRT, AC_DAC_DRC_LPFLRT, AC_DAC_DRC_RPFHRT, AC_DAC_DRC_RPFLRT, AC_DAC_DRC_LRMSHAT,
+        AC_DAC_DRC_LRMSLAT, AC_DAC_DRC_RRMSHAT, AC_DAC_DRC_RRMSLAT, AC_DAC_DRC_HCT, AC_DAC_DRC_LCT,
+        AC_DAC_DRC_HKC, AC_DAC_DRC_LKC, AC_DAC_DRC_HOPC, AC_DAC_DRC_LOPC, AC_DAC_DRC_HLT, AC_DAC_DRC_LLT,
+        AC_DAC_DRC_HKI, AC_DAC_DRC_LKI, AC_DAC_DRC_HOPL, AC_DAC_DRC_LOPL, AC_DAC_DRC_SFHAT, AC_DAC_DRC_SFLAT,
+        AC_DAC_DRC_SFHRT, AC_DAC_DRC_SFLRT,
+    };
+    size_t i;
+
+    batch->num = 0;
+    for (i = 0; i < ARRAY_SIZE(regs); i++) {
+        u32 val = codec_reg(codec, regs[i]);
+
+        sunxi_codec_batch_add(batch, regs[i], regs[i] == AC_DAC_DRC_CTRL ? 0x3 : 0xffff, val);
+    }
+}
+
+static bool dap_drc_on(const struct sunxi_codec_info *codec)
+{
+    u32 dap = codec_reg(codec, SUNXI_DAC_DAP_CTL);
+
+    return FIELD(dap, DDAP_EN, 0x1) && FIELD(dap, DDAP_DRC_EN, 0x1);
+}
+
+/*
+ * Presets through the kcontrol ops as the adm calls them: collected while
+ * stopped, programmed at render start for the render rate, live while
+ * running, "off" drops the dap enable.
+ */
+static void test_drc_presets(void)
+{
+    struct AudioAddrConfig item = { SUNXI_DAC_DPC, 0 };
+    struct AudioRegCfgGroupNode init = { 1, AUDIO_INIT_GROUP, &item, NULL };
+    struct AudioRegCfgGroupNode *groups[AUDIO_GROUP_MAX] = { [AUDIO_INIT_GROUP] = &init };
+    struct AudioMixerControl preset = { .max = 255, .mask = 0xffff, .reg = KCONTROL_DRC_PRESET,
+        .rreg = KCONTROL_DRC_PRESET };
+    struct AudioMixerControl attack = { .max = 1000, .mask = 0xffff, .reg = KCONTROL_DRC_ATTACK,
+        .rreg = KCONTROL_DRC_ATTACK };
+    struct AudioKcontrol presetCtrl = { "drc preset", (unsigned long)(uintptr_t)&preset };
+    struct AudioKcontrol attackCtrl = { "drc attack", (unsigned long)(uintptr_t)&attack };
+    struct AudioCtrlElemValue elem = { { 0, 0 } };
+    struct sunxi_codec_info *codec = codec_probe();
+    struct sunxi_codec_batch batch;
+    struct HostRegmapStats before;
+    double worst = 0.0;
+    uint64_t start, liveNs;
+    uint32_t liveWrites;
+
+    /* the boot batch programs the default parameters for 48 kHz, the dap stays off */
+    HOST_CHECK_EQ(T507CodecImplRegDefaultInit(groups), HDF_SUCCESS);
+    HOST_CHECK(!dap_drc_on(codec));
+    drc_from_regs(codec, &batch);
+    drc_check_batch(&batch, &(struct sunxi_codec_drc_preset){ "default", 0, 24, 3, 3, 10, 100 }, 48000, &worst);
+
+    /* stopped: the preset is only collected */
+    before = *host_regmap_stats(codec->mem_info.regmap);
+    elem.value[0] = 3;
+    HOST_CHECK_EQ(T507CodecImplSetCtrlOps(&presetCtrl, &elem), HDF_SUCCESS);
+    HOST_CHECK_EQ(host_regmap_stats(codec->mem_info.regmap)->busWrites, before.busWrites);
+    HOST_CHECK_EQ(T507CodecImplGetCtrlOps(&attackCtrl, &elem), HDF_SUCCESS);
+    HOST_CHECK_EQ(elem.value[0], g_drc_presets[3].attack);
+
+    /* render start compiles it for the render rate */
+    HOST_CHECK_EQ(T507CodecImplHwParams(AUDIO_RENDER_STREAM, AUDIO_FORMAT_PCM_16_BIT, 2, 44100), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_RENDER_STREAM, true), HDF_SUCCESS);
+    HOST_CHECK(dap_drc_on(codec));
+    drc_from_regs(codec, &batch);
+    drc_check_batch(&batch, &g_drc_presets[3], 44100, &worst);
+
+    /* running: a preset goes out at once, in one batch */
+    before = *host_regmap_stats(codec->mem_info.regmap);
+    elem.value[0] = 2;
+    start = host_wall_ns();
+    HOST_CHECK_EQ(T507CodecImplSetCtrlOps(&presetCtrl, &elem), HDF_SUCCESS);
+    liveNs = host_wall_ns() - start;
+    liveWrites = host_regmap_stats(codec->mem_info.regmap)->busWrites - before.busWrites;
+    drc_from_regs(codec, &batch);
+    drc_check_batch(&batch, &g_drc_presets[2], 44100, &worst);
+    HOST_CHECK(liveWrites <= SUNXI_DRC_REG_NUM + 1);
+
+    /* tuned on top of the preset */
+    elem.value[0] = 20;
+    HOST_CHECK_EQ(T507CodecImplSetCtrlOps(&attackCtrl, &elem), HDF_SUCCESS);
+    HOST_CHECK_EQ(codec->kctrl[KCTRL_DRC_RELEASE].value, g_drc_presets[2].release);
+    drc_from_regs(codec, &batch);
+    HOST_CHECK(lsb_err(batch_coef(&batch, AC_DAC_DRC_LPFHAT, AC_DAC_DRC_LPFLAT), drc_time_ref(44100, 2000)) < DRC_TOL_LSB);
+
+    elem.value[0] = 0;
+    HOST_CHECK_EQ(T507CodecImplSetCtrlOps(&presetCtrl, &elem), HDF_SUCCESS);
+    HOST_CHECK(!dap_drc_on(codec));
+    elem.value[0] = ARRAY_SIZE(g_drc_presets);
+    HOST_CHECK_EQ(T507CodecImplSetCtrlOps(&presetCtrl, &elem), HDF_ERR_INVALID_PARAM);
+    HOST_CHECK_EQ(codec->kctrl[KCTRL_DRC_PRESET].value, 0);
+
+    HOST_CHECK_EQ(T507CodecImplTrigger(AUDIO_RENDER_STREAM, false), HDF_SUCCESS);
+    host_report("preset change while rendering: %u bus writes, %.0f ns host", liveWrites, (double)liveNs);
+    codec_remove();
+}
+
+/*
+ * The limiter the speaker path runs on the a53 without the hardware drc:
+ * peak detector and gain smoothing with the same one-pole time constants,
+ * gain in dB per frame, 48 kHz stereo float.
+ */
+struct SoftLimiter {
+    float attack;
+    float release;
+    float thrDb;
+    float env;
+    float gain;
+};
+
+static void soft_limiter_init(struct SoftLimiter *lim, uint32_t rate, const struct sunxi_codec_drc_preset *p)
+{
+    lim->attack = (float)(drc_time_ref(rate, p->attack * 100) / SUNXI_DRC_ONE);
+    lim->release = (float)(drc_time_ref(rate, p->release * 1000) / SUNXI_DRC_ONE);
+    lim->thrDb = -(float)p->limit_thr;
+    lim->env = 0.0f;
+    lim->gain = 1.0f;
+}
+
+static void soft_limiter_run(struct SoftLimiter *lim, float *buf, size_t frames)
+{
+    size_t i;
+
+    for (i = 0; i < frames; i++) {
+        float peak = fmaxf(fabsf(buf[2 * i]), fabsf(buf[2 * i + 1]));
+        float levelDb, target;
+
+        lim->env += (peak > lim->env ? lim->attack : lim->release) * (peak - lim->env);
+        levelDb = 20.0f * log10f(lim->env + 1e-9f);
+        target = levelDb > lim->thrDb ? powf(10.0f, (lim->thrDb - levelDb) / 20.0f) : 1.0f;
+        lim->gain += (target < lim->gain ? lim->attack : lim->release) * (target - lim->gain);
+        buf[2 * i] *= lim->gain;
+        buf[2 * i + 1] *= lim->gain;
+    }
+}
+
+#define DRC_CPU_RATE        48000
+#define DRC_CPU_SECONDS     10
+
+/*
+ * Host cpu of the software limiter against what the driver spends for the
+ * hardware drc: a compile per parameter or rate change, nothing per sample.
+ */
+static void test_drc_cpu(void)
+{
+    const struct sunxi_codec_drc_preset *p = &g_drc_presets[3];
+    size_t frames = DRC_CPU_RATE * DRC_CPU_SECONDS;
+    float *buf = malloc(frames * 2 * sizeof(*buf));
+    struct sunxi_codec_info *codec = codec_probe();
+    struct sunxi_codec_batch batch;
+    struct SoftLimiter lim;
+    float tail = 0.0f;
+    uint64_t start, limNs, compileNs;
+    double nsFrame;
+    size_t i;
+    int loops;
+
+    HOST_CHECK(buf != NULL);
+    if (buf == NULL) {
+        codec_remove();
+        return;
+    }
+    /* full scale 440 Hz left, 1 kHz right: the limiter works on every frame */
+    for (i = 0; i < frames; i++) {
+        buf[2 * i] = (float)sin(2.0 * M_PI * 440.0 * i / DRC_CPU_RATE);
+        buf[2 * i + 1] = (float)sin(2.0 * M_PI * 1000.0 * i / DRC_CPU_RATE);
+    }
+
+    soft_limiter_init(&lim, DRC_CPU_RATE, p);
+    start = host_wall_ns();
+    soft_limiter_run(&lim, buf, frames);
+    limNs = host_wall_ns() - start;
+    for (i = frames - DRC_CPU_RATE; i < frames; i++) {
+        tail = fmaxf(tail, fmaxf(fabsf(buf[2 * i]), fabsf(buf[2 * i + 1])));
+    }
+    /* it does limit: the last second stays within 0.2 dB of the threshold */
+    HOST_CHECK(20.0f * log10f(tail) < lim.thrDb + 0.2f);
+
+    drc_load(codec, p);
+    codec->drc_rate = DRC_CPU_RATE;
+    loops = 10000;
+    start = host_wall_ns();
+    for (i = 0; i < (size_t)loops; i++) {
+        batch.num = 0;
+        sunxi_codec_drc_compile(codec, &batch);
+    }
+    compileNs = (host_wall_ns() - start) / loops;
+    HOST_CHECK_EQ(batch.num, SUNXI_DRC_REG_NUM);
+
+    nsFrame = (double)limNs / frames;
+    host_report("software limiter 48k stereo: %.1f ns/frame host, %.3f%% of one host core, peak %.2f dBFS",
+        nsFrame, nsFrame * DRC_CPU_RATE / 1e7, 20.0f * log10f(tail));
+    host_report("hardware drc: %llu ns host per coefficient compile, once per parameter or rate change, "
+        "0 per frame", (unsigned long long)compileNs);
+    free(buf);
+    codec_remove();
+}
+
+static const struct HostTestCase g_cases[] = {
+    { "probe_remove", test_probe_remove },
+    { "capture_hw_params", test_capture_hw_params },
+    { "capture_trigger", test_capture_trigger },
+    { "full_duplex", test_full_duplex },
+    { "params_matrix", test_params_matrix },
+    { "drc_time", test_drc_time },
+    { "drc_compile", test_drc_compile },
+    { "drc_presets", test_drc_presets },
+    { "drc_cpu", test_drc_cpu },
+};
+
+int main(int argc, char **argv)
+{
+    return host_test_main(g_cases, ARRAY_SIZE(g_cases), test_reset, argc, argv);
+}
@@ -0,0 +1,1064 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * t507_dma_ops.c on the fake dmaengine. The ADM calls are made in the order
+ * the ADM makes them; the pointer the driver reports is compared with the
+ * position the fake channel has really reached, sampled off the period grid.
+ * ahead means the driver claims more than the dma moved, the dangerous side
+ * for both directions; behind is the latency the HAL sees.
+ */
+
+#include <stdlib.h>
+
+#include <linux/dmaengine.h>
+#include <linux/tracepoint.h>
+#include "t507_dma_ops.h"
+#include "t507_dai_ahub_impl_linux.h"
+#include "host_hdf.h"
+#include "host_impl.h"
+#include "host_test.h"
+
+#define TEST_CIRBUF_MAX     (64 * 1024)
+#define TEST_PLATFORM_NAME  "dma_service_0"
+#define TEST_DEBUGFS_DIR    "t507_dma_" TEST_PLATFORM_NAME
+
+#define FIFO_CODEC_TX       (SUNXI_CODEC_ADDR_BASE + SUNXI_DAC_TXDATA)
+#define FIFO_CODEC_RX       (SUNXI_CODEC_ADDR_BASE + SUNXI_ADC_RXDATA)
+#define FIFO_AHUB_TX(n)     (SUNXI_AHUB_ADDR_BASE + SUNXI_AHUB_APBIF_TXFIFO(n))
+#define FIFO_AHUB_RX(n)     (SUNXI_AHUB_ADDR_BASE + SUNXI_AHUB_APBIF_RXFIFO(n))
+
+#define US(n)               ((uint64_t)(n) * NSEC_PER_USEC)
+#define MS(n)               ((uint64_t)(n) * NSEC_PER_MSEC)
+
+typedef int32_t (*CardInitFn)(const struct AudioCard *card, const struct PlatformDevice *platform);
+
+struct TestCard {
+    struct PlatformData data;
+    struct PlatformDevice platform;
+    struct HdfDeviceObject device;
+    struct DeviceResourceNode node;
+    struct AudioCard card;
+};
+
+struct TestFormat {
+    uint32_t rate;
+    uint32_t channels;
+    uint32_t bitWidth;
+    uint32_t periodFrames;
+    uint32_t periods;
+    int32_t ppm;        /* fifo clock error against the nominal rate */
+};
+
+struct PtrStats {
+    uint32_t samples;
+    int32_t maxAhead;
+    int32_t maxBehind;
+    uint64_t sumAbs;
+    uint32_t backwards;
+    uint32_t last;
+    bool haveLast;
+};
+
+static struct TestCard g_card;
+
+static const struct TestFormat g_stereo48k = { 48000, 2, 16, 1024, 4, 0 };
+static const struct TestFormat g_tdm8 = { 48000, 8, 32, 256, 8, 0 };
+
+static void test_reset(void)
+{
+    host_clock_reset();
+    host_dma_reset();
+    host_hcs_reset();
+    memset(&host_impl, 0, sizeof(host_impl));
+    memset(&host_dma_sync, 0, sizeof(host_dma_sync));
+    host_work_latency_ns = US(100);
+    host_sram_size = 0;
+    host_trace_enabled = false;
+    host_dma_sync_cpu_hook = NULL;
+}
+
+static void card_init(CardInitFn init)
+{
+    memset(&g_card, 0, sizeof(g_card));
+    g_card.data.drvPlatformName = TEST_PLATFORM_NAME;
+    g_card.data.renderBufInfo.cirBufMax = TEST_CIRBUF_MAX;
+    g_card.data.captureBufInfo.cirBufMax = TEST_CIRBUF_MAX;
+    g_card.node.name = "dma_controller";
+    g_card.device.property = &g_card.node;
+    g_card.platform.devPlatformName = TEST_PLATFORM_NAME;
+    g_card.platform.devData = &g_card.data;
+    g_card.platform.device = &g_card.device;
+
+    HOST_CHECK_EQ(init(&g_card.card, &g_card.platform), HDF_SUCCESS);
+}
+
+static void card_release(void)
+{
+    T507AudioDmaDeviceRelease(&g_card.data);
+}
+
+static struct PcmInfo *card_pcm(enum AudioStreamType type)
+{
+    return (type == AUDIO_RENDER_STREAM) ? &g_card.data.renderPcmInfo : &g_card.data.capturePcmInfo;
+}
+
+static struct CircleBufInfo *card_buf(enum AudioStreamType type)
+{
+    return (type == AUDIO_RENDER_STREAM) ? &g_card.data.renderBufInfo : &g_card.data.captureBufInfo;
+}
+
+static phys_addr_t stream_fifo(enum AudioStreamType type)
+{
+    if (type == AUDIO_RENDER_STREAM) {
+        return T507AudioDmaRenderToAhub(&g_card.data) ? FIFO_AHUB_TX(host_impl.ahubApbNum) : FIFO_CODEC_TX;
+    }
+    return T507AudioDmaCaptureFromCodec(&g_card.data) ? FIFO_CODEC_RX : FIFO_AHUB_RX(host_impl.ahubApbNum);
+}
+
+static struct dma_chan *stream_chan(enum AudioStreamType type)
+{
+    return host_dma_chan_by_fifo(stream_fifo(type));
+}
+
+static uint32_t stream_frame_size(const struct TestFormat *fmt)
+{
+    return fmt->channels * (fmt->bitWidth == 24 ? 4 : fmt->bitWidth / 8);
+}
+
+/* hw params and prepare: ring, channel config, and the fifo clock behind it */
+static int32_t stream_open(enum AudioStreamType type, const struct TestFormat *fmt)
+{
+    struct PcmInfo *pcm = card_pcm(type);
+    struct CircleBufInfo *buf = card_buf(type);
+    int32_t ret;
+
+    pcm->streamType = type;
+    pcm->rate = fmt->rate;
+    pcm->channels = fmt->channels;
+    pcm->bitWidth = fmt->bitWidth;
+    pcm->frameSize = stream_frame_size(fmt);
+    buf->periodSize = fmt->periodFrames * pcm->frameSize;
+    buf->periodCount = fmt->periods;
+    buf->cirBufSize = buf->periodSize * fmt->periods;
+
+    ret = T507AudioDmaBufAlloc(&g_card.data, type);
+    if (ret != HDF_SUCCESS) {
+        return ret;
+    }
+    ret = T507AudioDmaConfigChannel(&g_card.data, type);
+    if (ret != HDF_SUCCESS) {
+        return ret;
+    }
+    host_dma_set_fifo_rate(stream_fifo(type), fmt->rate * pcm->frameSize, fmt->ppm);
+
+    return HDF_SUCCESS;
+}
+
+static void stream_start(enum AudioStreamType type)
+{
+    HOST_CHECK_EQ(T507AudioDmaSubmit(&g_card.data, type), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507AudioDmaPending(&g_card.data, type), HDF_SUCCESS);
+}
+
+static void stream_close(enum AudioStreamType type)
+{
+    HOST_CHECK_EQ(T507AudioDmaBufFree(&g_card.data, type), HDF_SUCCESS);
+}
+
+/* frame the fake channel is really at, relative to the ring start */
+static uint32_t stream_truth(enum AudioStreamType type)
+{
+    dma_addr_t addr = host_dma_chan_addr(stream_chan(type));
+
+    if (addr == 0) {
+        return 0;
+    }
+    return (uint32_t)(addr - card_buf(type)->phyAddr) / card_pcm(type)->frameSize;
+}
+
+static int32_t frames_diff(uint32_t a, uint32_t b, uint32_t bufFrames)
+{
+    int32_t diff = (int32_t)((a + bufFrames - b) % bufFrames);
+
+    return (diff >= (int32_t)bufFrames / 2) ? diff - (int32_t)bufFrames : diff;
+}
+
+static void ptr_sample(enum AudioStreamType type, struct PtrStats *stats)
+{
+    uint32_t bufFrames = card_buf(type)->cirBufSize / card_pcm(type)->frameSize;
+    uint32_t ptr = 0;
+    int32_t err;
+
+    HOST_CHECK_EQ(T507AudioDmaPointer(&g_card.data, type, &ptr), HDF_SUCCESS);
+    err = frames_diff(ptr, stream_truth(type), bufFrames);
+    stats->samples++;
+    stats->sumAbs += (uint64_t)(err < 0 ? -err : err);
+    stats->maxAhead = max(stats->maxAhead, err);
+    stats->maxBehind = max(stats->maxBehind, -err);
+    if (stats->haveLast && frames_diff(ptr, stats->last, bufFrames) < 0) {
+        stats->backwards++;
+    }
+    stats->last = ptr;
+    stats->haveLast = true;
+}
+
+/* sample off the period grid: 97 us steps with a 0..12 us stagger */
+static void ptr_run(const enum AudioStreamType *types, struct PtrStats *stats, size_t count, uint64_t durationNs)
+{
+    uint64_t end = ktime_get_ns() + durationNs;
+    uint32_t i = 0;
+    size_t s;
+
+    while (ktime_get_ns() < end) {
+        host_advance(US(97) + US(i % 13));
+        for (s = 0; s < count; s++) {
+            ptr_sample(types[s], &stats[s]);
+        }
+        i++;
+    }
+}
+
+static double ptr_mean(const struct PtrStats *stats)
+{
+    return stats->samples ? (double)stats->sumAbs / stats->samples : 0.0;
+}
+
+static void ptr_report(const char *what, const struct PtrStats *stats)
+{
+    host_report("%-44s ahead %3d  behind %4d  mean|err| %7.2f frames  backwards %u  (%u samples)", what,
+        stats->maxAhead, stats->maxBehind, ptr_mean(stats), stats->backwards, stats->samples);
+}
+
+/*
+ * Limits from the model, not from the results: interpolation at the nominal
+ * rate overshoots a slow fifo by ppm of a period, and a late tasklet leaves
+ * the pointer behind by what moved meanwhile plus one burst of residue
+ * granularity.
+ */
+static void ptr_check(const struct PtrStats *stats, const struct TestFormat *fmt, uint64_t lateNs,
+    uint32_t burstFrames)
+{
+    uint32_t ppmFrames = (uint32_t)DIV_ROUND_UP((uint64_t)(fmt->ppm < 0 ? -fmt->ppm : fmt->ppm) *
+        fmt->periodFrames, 1000000);
+    uint32_t lateFrames = (uint32_t)DIV_ROUND_UP(lateNs * fmt->rate, NSEC_PER_SEC);
+
+    HOST_CHECK(stats->samples > 0);
+    HOST_CHECK(stats->maxAhead <= (int32_t)(1 + ppmFrames));
+    HOST_CHECK(stats->maxBehind <= (int32_t)(lateFrames + burstFrames + ppmFrames + 1));
+    HOST_CHECK_EQ(stats->backwards, 0);
+}
+
+struct PtrScenario {
+    const char *name;
+    struct TestFormat fmt;
+    uint64_t taskletNs;
+    uint64_t jitterNs;
+    bool residue;
+    bool lowLatency;
+};
+
+static void test_pointer_accuracy(void)
+{
+    static const struct PtrScenario scenarios[] = {
+        { "48k/2ch/16 1024x4, tasklet 20us", { 48000, 2, 16, 1024, 4, 0 }, US(20), 0, true, false },
+        { "  + 0..500us tasklet jitter, fifo -300ppm", { 48000, 2, 16, 1024, 4, -300 }, US(20), US(500), true, false },
+        { "  + fifo +300ppm", { 48000, 2, 16, 1024, 4, 300 }, US(20), 0, true, false },
+        { "  tasklet 25ms, longer than a period", { 48000, 2, 16, 1024, 4, 0 }, MS(25), 0, true, false },
+        { "  controller without residue", { 48000, 2, 16, 1024, 4, 0 }, US(20), 0, false, false },
+        { "48k/2ch/16 240x4 low latency (48 fr dma)", { 48000, 2, 16, 240, 4, 0 }, US(20), 0, true, true },
+        { "44.1k/2ch/16 441x4, tasklet 20us", { 44100, 2, 16, 441, 4, 0 }, US(20), 0, true, false },
+    };
+    struct HostDmaConfig config = { .canPause = true, .channels = 8 };
+    struct PtrStats stats;
+    uint32_t burstFrames;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(scenarios); i++) {
+        test_reset();
+        config.irqToTaskletNs = scenarios[i].taskletNs;
+        config.taskletJitterNs = scenarios[i].jitterNs;
+        config.reportResidue = scenarios[i].residue;
+        host_dma_configure(&config);
+        host_hcs_set_bool("lowLatencyRender", scenarios[i].lowLatency);
+        card_init(T507AudioDmaDeviceInit);
+
+        HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &scenarios[i].fmt), HDF_SUCCESS);
+        stream_start(AUDIO_RENDER_STREAM);
+        host_advance(MS(50));
+        memset(&stats, 0, sizeof(stats));
+        ptr_run((const enum AudioStreamType[]){ AUDIO_RENDER_STREAM }, &stats, 1, NSEC_PER_SEC * 2);
+        ptr_report(scenarios[i].name, &stats);
+
+        burstFrames = host_dma_chan_config(stream_chan(AUDIO_RENDER_STREAM))->dst_maxburst *
+            (scenarios[i].fmt.bitWidth / 8) / stream_frame_size(&scenarios[i].fmt) + 1;
+        ptr_check(&stats, &scenarios[i].fmt, scenarios[i].taskletNs + scenarios[i].jitterNs, burstFrames);
+
+        stream_close(AUDIO_RENDER_STREAM);
+        card_release();
+        HOST_CHECK_EQ(host_mem_live(), 0);
+    }
+}
+
+/* render to the codec and capture from the ahub on one card, run together for 5 s */
+static void test_full_duplex(void)
+{
+    static const enum AudioStreamType types[] = { AUDIO_RENDER_STREAM, AUDIO_CAPTURE_STREAM };
+    struct HostDmaConfig config = {
+        .canPause = true, .reportResidue = true, .channels = 8,
+        .irqToTaskletNs = US(50), .taskletJitterNs = US(200),
+    };
+    struct PtrStats stats[2];
+    uint32_t xruns[2];
+    uint32_t callbacks[2];
+
+    host_dma_configure(&config);
+    card_init(T507AudioDmaDeviceInit);
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &g_stereo48k), HDF_SUCCESS);
+    HOST_CHECK_EQ(stream_open(AUDIO_CAPTURE_STREAM, &g_tdm8), HDF_SUCCESS);
+    HOST_CHECK(stream_chan(AUDIO_RENDER_STREAM) != stream_chan(AUDIO_CAPTURE_STREAM));
+    stream_start(AUDIO_RENDER_STREAM);
+    host_advance(US(3100));
+    stream_start(AUDIO_CAPTURE_STREAM);
+
+    memset(stats, 0, sizeof(stats));
+    ptr_run(types, stats, 2, MS(2500));
+    /* one capture fifo overrun in the next period */
+    host_impl.ahubXrun[AUDIO_CAPTURE_STREAM] = true;
+    host_advance(MS(10));
+    ptr_run(types, stats, 2, MS(2500));
+
+    ptr_report("duplex render 48k/2ch/16 1024x4", &stats[0]);
+    ptr_report("duplex capture 48k/8ch/32 256x8 (1 xrun)", &stats[1]);
+    ptr_check(&stats[0], &g_stereo48k, config.irqToTaskletNs + config.taskletJitterNs, 2);
+    ptr_check(&stats[1], &g_tdm8, config.irqToTaskletNs + config.taskletJitterNs + host_work_latency_ns, 2);
+
+    callbacks[0] = host_dma_chan_callbacks(stream_chan(AUDIO_RENDER_STREAM));
+    callbacks[1] = host_dma_chan_callbacks(stream_chan(AUDIO_CAPTURE_STREAM));
+    host_report("period callbacks in 5.0131 s: render %u (expect %u), capture %u (expect %u)", callbacks[0],
+        (uint32_t)(5013100ULL * 48 / 1024 / 1000), callbacks[1], (uint32_t)(5010000ULL * 48 / 256 / 1000));
+    HOST_CHECK_EQ(callbacks[0], 5013100ULL * 48 / 1024 / 1000);
+    HOST_CHECK(callbacks[1] + 1 >= 5010000ULL * 48 / 256 / 1000);
+
+    HOST_CHECK_EQ(T507AudioDmaGetXrunCount(&g_card.data, AUDIO_RENDER_STREAM, &xruns[0]), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507AudioDmaGetXrunCount(&g_card.data, AUDIO_CAPTURE_STREAM, &xruns[1]), HDF_SUCCESS);
+    HOST_CHECK_EQ(xruns[0], 0);
+    HOST_CHECK_EQ(xruns[1], 1);
+    HOST_CHECK_EQ(host_impl.ahubRecover[AUDIO_CAPTURE_STREAM], 1);
+    HOST_CHECK_EQ(host_impl.codecRecover[AUDIO_RENDER_STREAM], 0);
+
+    stream_close(AUDIO_CAPTURE_STREAM);
+    stream_close(AUDIO_RENDER_STREAM);
+    card_release();
+    HOST_CHECK_EQ(host_mem_live(), 0);
+    HOST_CHECK_EQ(host_dma_chans_live(), 0);
+    HOST_CHECK_EQ(host_dma_descs_live(), 0);
+}
+
+/*
+ * Render and capture opened, paused, resumed and closed in a random order on
+ * one card. Between any two ops both pointers are sampled against their own
+ * channel, and a stream's ring and channel must not move while the other one
+ * comes and goes.
+ */
+static void test_duplex_stress(void)
+{
+    static const struct TestFormat fmts[2] = {
+        { 48000, 8, 32, 256, 8, 0 },
+        { 48000, 2, 16, 1024, 4, 0 },
+    };
+    struct HostDmaConfig config = {
+        .canPause = true, .reportResidue = true, .channels = 8,
+        .irqToTaskletNs = US(50), .taskletJitterNs = US(200),
+    };
+    struct PtrStats stats[2];
+    struct dma_chan *chan[2] = { NULL, NULL };
+    dma_addr_t ring[2] = { 0, 0 };
+    bool open[2] = { false, false };
+    uint32_t ops[2] = { 0, 0 };
+    uint32_t seed = 0x5eed;
+    enum AudioStreamType type;
+    uint32_t n;
+    int s;
+
+    host_dma_configure(&config);
+    card_init(T507AudioDmaDeviceInit);
+    memset(stats, 0, sizeof(stats));
+
+    for (n = 0; n < 2000; n++) {
+        seed = seed * 1103515245 + 12345;
+        s = (seed >> 16) & 1;
+        type = (s == 0) ? AUDIO_CAPTURE_STREAM : AUDIO_RENDER_STREAM;
+        if (!open[s]) {
+            HOST_CHECK_EQ(stream_open(type, &fmts[s]), HDF_SUCCESS);
+            stream_start(type);
+            chan[s] = stream_chan(type);
+            ring[s] = card_buf(type)->phyAddr;
+            stats[s].haveLast = false;
+            open[s] = true;
+        } else {
+            switch ((seed >> 20) % 4) {
+                case 0:
+                    stream_close(type);
+                    open[s] = false;
+                    break;
+                case 1:
+                    HOST_CHECK_EQ(T507AudioDmaPause(&g_card.data, type), HDF_SUCCESS);
+                    break;
+                default:
+                    HOST_CHECK_EQ(T507AudioDmaResume(&g_card.data, type), HDF_SUCCESS);
+                    break;
+            }
+        }
+        ops[s]++;
+
+        /* 0.3 .. 7 ms to the next op, the other stream must not have noticed */
+        host_advance(US(300) + US((seed >> 8) % 6700));
+        for (s = 0; s < 2; s++) {
+            if (!open[s]) {
+                continue;
+            }
+            type = (s == 0) ? AUDIO_CAPTURE_STREAM : AUDIO_RENDER_STREAM;
+            HOST_CHECK(stream_chan(type) == chan[s]);
+            HOST_CHECK_EQ(card_buf(type)->phyAddr, ring[s]);
+            ptr_sample(type, &stats[s]);
+        }
+    }
+
+    host_report("%u capture and %u render ops interleaved over %.1f s (virtual)", ops[0], ops[1],
+        (double)ktime_get_ns() / NSEC_PER_SEC);
+    ptr_report("stress capture 48k/8ch/32 256x8", &stats[0]);
+    ptr_report("stress render 48k/2ch/16 1024x4", &stats[1]);
+    ptr_check(&stats[0], &fmts[0], config.irqToTaskletNs + config.taskletJitterNs, 2);
+    ptr_check(&stats[1], &fmts[1], config.irqToTaskletNs + config.taskletJitterNs, 2);
+
+    for (s = 0; s < 2; s++) {
+        if (open[s]) {
+            stream_close((s == 0) ? AUDIO_CAPTURE_STREAM : AUDIO_RENDER_STREAM);
+        }
+    }
+    card_release();
+    HOST_CHECK_EQ(host_mem_live(), 0);
+    HOST_CHECK_EQ(host_dma_chans_live(), 0);
+    HOST_CHECK_EQ(host_dma_descs_live(), 0);
+}
+
+static void test_wait_period(void)
+{
+    uint64_t start;
+    uint64_t waited;
+    uint32_t i;
+
+    card_init(T507AudioDmaDeviceInit);
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &g_stereo48k), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507AudioDmaWaitPeriod(&g_card.data, AUDIO_RENDER_STREAM, 100), HDF_FAILURE);
+    stream_start(AUDIO_RENDER_STREAM);
+
+    /* each wait ends on the next period callback, 1024 frames = 21.33 ms apart */
+    for (i = 0; i < 10; i++) {
+        start = ktime_get_ns();
+        HOST_CHECK_EQ(T507AudioDmaWaitPeriod(&g_card.data, AUDIO_RENDER_STREAM, 100), HDF_SUCCESS);
+        waited = ktime_get_ns() - start;
+        HOST_CHECK(waited <= 1024ULL * NSEC_PER_SEC / 48000 + 1);
+    }
+    HOST_CHECK_EQ(T507AudioDmaWaitPeriod(&g_card.data, AUDIO_RENDER_STREAM, 5), HDF_ERR_TIMEOUT);
+
+    stream_close(AUDIO_RENDER_STREAM);
+    card_release();
+}
+
+/* dmaengine_pause in place: the pointer holds and carries on where it stopped */
+static void test_pause_in_place(void)
+{
+    struct HostDmaCalls calls;
+    struct PtrStats stats;
+    uint32_t before = 0;
+    uint32_t during = 0;
+    uint32_t truth;
+
+    card_init(T507AudioDmaDeviceInit);
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &g_stereo48k), HDF_SUCCESS);
+    stream_start(AUDIO_RENDER_STREAM);
+    host_advance(MS(30));
+
+    calls = host_dma_calls;
+    HOST_CHECK_EQ(T507AudioDmaPointer(&g_card.data, AUDIO_RENDER_STREAM, &before), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507AudioDmaPause(&g_card.data, AUDIO_RENDER_STREAM), HDF_SUCCESS);
+    truth = stream_truth(AUDIO_RENDER_STREAM);
+    host_advance(MS(200));
+    HOST_CHECK_EQ(stream_truth(AUDIO_RENDER_STREAM), truth);
+    HOST_CHECK_EQ(T507AudioDmaPointer(&g_card.data, AUDIO_RENDER_STREAM, &during), HDF_SUCCESS);
+    host_report("paused at dma frame %u: pointer %u before pause, %u while paused", truth, before, during);
+    HOST_CHECK_EQ(during, before);
+    HOST_CHECK(frames_diff(during, truth, 4096) <= 1);
+
+    HOST_CHECK_EQ(T507AudioDmaResume(&g_card.data, AUDIO_RENDER_STREAM), HDF_SUCCESS);
+    HOST_CHECK_EQ(host_dma_calls.pause - calls.pause, 1);
+    HOST_CHECK_EQ(host_dma_calls.resume - calls.resume, 1);
+    HOST_CHECK_EQ(host_dma_calls.prepCyclic - calls.prepCyclic, 0);
+    HOST_CHECK_EQ(host_dma_calls.terminate - calls.terminate, 0);
+
+    memset(&stats, 0, sizeof(stats));
+    ptr_run((const enum AudioStreamType[]){ AUDIO_RENDER_STREAM }, &stats, 1, NSEC_PER_SEC);
+    ptr_report("after in-place resume", &stats);
+    ptr_check(&stats, &g_stereo48k, 0, 2);
+
+    stream_close(AUDIO_RENDER_STREAM);
+    card_release();
+}
+
+/*
+ * A controller that cannot pause: resume queues the ring tail from the last
+ * period boundary as singles, then the cyclic descriptor from the ring start.
+ */
+static void test_pause_resubmit(void)
+{
+    static const uint64_t tasklets[] = { US(20), MS(25) };
+    struct HostDmaConfig config = { .canPause = false, .reportResidue = true, .channels = 8 };
+    struct HostDmaCalls calls;
+    struct PtrStats stats;
+    uint32_t during = 0;
+    uint32_t truth;
+    uint64_t start;
+    char what[64];
+    uint32_t n;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(tasklets); i++) {
+        test_reset();
+        config.irqToTaskletNs = tasklets[i];
+        host_dma_configure(&config);
+        card_init(T507AudioDmaDeviceInit);
+        HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &g_stereo48k), HDF_SUCCESS);
+        stream_start(AUDIO_RENDER_STREAM);
+        /* 1.5 periods in: the last boundary the driver saw is period 1 */
+        host_advance(MS(32) + tasklets[i]);
+
+        truth = stream_truth(AUDIO_RENDER_STREAM);
+        HOST_CHECK_EQ(T507AudioDmaPause(&g_card.data, AUDIO_RENDER_STREAM), HDF_SUCCESS);
+        host_advance(MS(100));
+        HOST_CHECK_EQ(T507AudioDmaPointer(&g_card.data, AUDIO_RENDER_STREAM, &during), HDF_SUCCESS);
+        calls = host_dma_calls;
+        HOST_CHECK_EQ(T507AudioDmaResume(&g_card.data, AUDIO_RENDER_STREAM), HDF_SUCCESS);
+        HOST_CHECK_EQ(host_dma_calls.prepSingle - calls.prepSingle, tasklets[i] > MS(20) ? 2 : 3);
+        HOST_CHECK_EQ(host_dma_calls.prepCyclic - calls.prepCyclic, 1);
+        HOST_CHECK_EQ(stream_truth(AUDIO_RENDER_STREAM), tasklets[i] > MS(20) ? 2048 : 1024);
+        HOST_CHECK_EQ(during, stream_truth(AUDIO_RENDER_STREAM));
+        host_report("tasklet %llu us: paused at dma frame %u, restarts at %u, %u frames played again",
+            (unsigned long long)tasklets[i] / 1000, truth, during, truth - during);
+
+        memset(&stats, 0, sizeof(stats));
+        ptr_run((const enum AudioStreamType[]){ AUDIO_RENDER_STREAM }, &stats, 1, NSEC_PER_SEC * 2);
+        snprintf(what, sizeof(what), "after resubmit, tasklet %llu us", (unsigned long long)tasklets[i] / 1000);
+        ptr_report(what, &stats);
+        ptr_check(&stats, &g_stereo48k, tasklets[i], 2);
+
+        stream_close(AUDIO_RENDER_STREAM);
+        card_release();
+        HOST_CHECK_EQ(host_dma_descs_live(), 0);
+    }
+
+    /* what a resume costs on the host when it has to rebuild the descriptors */
+    test_reset();
+    config.irqToTaskletNs = US(20);
+    host_dma_configure(&config);
+    card_init(T507AudioDmaDeviceInit);
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &g_stereo48k), HDF_SUCCESS);
+    stream_start(AUDIO_RENDER_STREAM);
+    host_advance(MS(32));
+    calls = host_dma_calls;
+    start = host_wall_ns();
+    for (n = 0; n < 10000; n++) {
+        (void)T507AudioDmaPause(&g_card.data, AUDIO_RENDER_STREAM);
+        (void)T507AudioDmaResume(&g_card.data, AUDIO_RENDER_STREAM);
+    }
+    host_report("Pause+Resume by resubmit %6.1f ns/pair (host), %u dmaengine calls per pair",
+        (double)(host_wall_ns() - start) / 10000, (host_dma_calls.terminate - calls.terminate +
+        host_dma_calls.synchronize - calls.synchronize + host_dma_calls.prepSingle - calls.prepSingle +
+        host_dma_calls.prepCyclic - calls.prepCyclic + host_dma_calls.submit - calls.submit +
+        host_dma_calls.issuePending - calls.issuePending + host_dma_calls.pause - calls.pause) / 10000);
+    stream_close(AUDIO_RENDER_STREAM);
+    card_release();
+}
+
+static void test_burst_select(void)
+{
+    static const struct {
+        CardInitFn init;
+        enum AudioStreamType type;
+        struct TestFormat fmt;
+        uint32_t override;
+        uint32_t burst;
+    } cases[] = {
+        { T507AudioDmaDeviceInit, AUDIO_RENDER_STREAM, { 48000, 2, 16, 1024, 4, 0 }, 0, 4 },
+        { T507AudioDmaDeviceInit, AUDIO_CAPTURE_STREAM, { 48000, 2, 16, 1024, 4, 0 }, 0, 4 },
+        { T507AudioDmaDeviceInit, AUDIO_CAPTURE_STREAM, { 48000, 8, 32, 256, 8, 0 }, 0, 8 },
+        { T507AudioDmaDeviceInit, AUDIO_CAPTURE_STREAM, { 48000, 16, 32, 256, 4, 0 }, 0, 16 },
+        { T507AudioDmaAhubDeviceInit, AUDIO_RENDER_STREAM, { 48000, 16, 32, 256, 4, 0 }, 0, 8 },
+        { T507AudioDmaCodecDeviceInit, AUDIO_CAPTURE_STREAM, { 48000, 2, 16, 1024, 4, 0 }, 0, 4 },
+        /* 1001 frames of 4 bytes is no multiple of a 4 x 2 byte burst */
+        { T507AudioDmaDeviceInit, AUDIO_RENDER_STREAM, { 48000, 2, 16, 1001, 4, 0 }, 0, 1 },
+        { T507AudioDmaDeviceInit, AUDIO_CAPTURE_STREAM, { 48000, 8, 32, 256, 8, 0 }, 16, 16 },
+    };
+    const struct dma_slave_config *cfg;
+    uint32_t burst;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(cases); i++) {
+        test_reset();
+        card_init(cases[i].init);
+        if (cases[i].override != 0) {
+            HOST_CHECK_EQ(T507AudioDmaSetBurst(&g_card.data, cases[i].type, cases[i].override), HDF_SUCCESS);
+        }
+        HOST_CHECK_EQ(stream_open(cases[i].type, &cases[i].fmt), HDF_SUCCESS);
+        cfg = host_dma_chan_config(stream_chan(cases[i].type));
+        burst = (cases[i].type == AUDIO_RENDER_STREAM) ? cfg->dst_maxburst : cfg->src_maxburst;
+        HOST_CHECK_EQ(burst, cases[i].burst);
+        stream_close(cases[i].type);
+        card_release();
+    }
+
+    test_reset();
+    card_init(T507AudioDmaDeviceInit);
+    HOST_CHECK_EQ(T507AudioDmaSetBurst(&g_card.data, AUDIO_RENDER_STREAM, 3), HDF_ERR_INVALID_PARAM);
+    card_release();
+}
+
+/* 1 ms dma periods under a 5 ms ADM period, and the fallback when the ring does not divide */
+static void test_low_latency_period(void)
+{
+    static const struct TestFormat fmt = { 48000, 2, 16, 240, 4, 0 };
+    static const struct TestFormat odd = { 48000, 2, 16, 250, 4, 0 };
+    uint32_t callbacks;
+
+    host_hcs_set_bool("lowLatencyRender", true);
+    card_init(T507AudioDmaDeviceInit);
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &fmt), HDF_SUCCESS);
+    stream_start(AUDIO_RENDER_STREAM);
+    host_advance(NSEC_PER_SEC);
+    callbacks = host_dma_chan_callbacks(stream_chan(AUDIO_RENDER_STREAM));
+    host_report("low latency, ADM period 240 frames: %u dma periods in 1 s", callbacks);
+    HOST_CHECK_EQ(callbacks, 1000);
+    stream_close(AUDIO_RENDER_STREAM);
+
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &odd), HDF_SUCCESS);
+    stream_start(AUDIO_RENDER_STREAM);
+    callbacks = host_dma_chan_callbacks(stream_chan(AUDIO_RENDER_STREAM));
+    /* the 192nd boundary lands on 1 s exactly */
+    host_advance(NSEC_PER_SEC + US(100));
+    callbacks = host_dma_chan_callbacks(stream_chan(AUDIO_RENDER_STREAM)) - callbacks;
+    host_report("low latency, ADM period 250 frames: %u dma periods in 1 s", callbacks);
+    HOST_CHECK_EQ(callbacks, 192);
+    stream_close(AUDIO_RENDER_STREAM);
+
+    HOST_CHECK_EQ(T507AudioDmaSetLowLatency(&g_card.data, AUDIO_RENDER_STREAM, false), HDF_SUCCESS);
+    card_release();
+}
+
+struct RoundTrip {
+    uint32_t wakeups;
+    uint32_t underruns;
+    uint64_t sumUs;
+    uint64_t maxUs;
+    uint64_t minUs;
+};
+
+/*
+ * A monitor loop on one card: wake on each capture period, take the newest
+ * captured frame and write it one dma period ahead of the render pointer.
+ * Round trip is the age of that frame at wakeup plus the time until the
+ * render channel reaches where it was written, FIFOs and converters excluded.
+ */
+static void round_trip_run(const struct TestFormat *fmt, bool lowLatency, struct RoundTrip *rt)
+{
+    struct HostDmaConfig config = {
+        .canPause = true, .reportResidue = true, .channels = 8,
+        .irqToTaskletNs = US(20), .taskletJitterNs = US(100),
+    };
+    uint32_t bufFrames = fmt->periodFrames * fmt->periods;
+    u32 *hits;
+    uint32_t guard;
+    uint32_t capPtr = 0;
+    uint32_t renPtr = 0;
+    int32_t age;
+    int32_t ahead;
+    uint64_t us;
+    uint32_t i;
+
+    test_reset();
+    host_dma_configure(&config);
+    host_hcs_set_bool("lowLatencyRender", lowLatency);
+    host_hcs_set_bool("lowLatencyCapture", lowLatency);
+    /* room for both rings in sram, low latency streams must take it over the dram pool */
+    host_sram_size = lowLatency ? 2 * TEST_CIRBUF_MAX : 0;
+    card_init(T507AudioDmaDeviceInit);
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, fmt), HDF_SUCCESS);
+    HOST_CHECK_EQ(stream_open(AUDIO_CAPTURE_STREAM, fmt), HDF_SUCCESS);
+    hits = host_debugfs_u32(TEST_DEBUGFS_DIR, "render_pool_hits");
+    HOST_CHECK(hits != NULL && *hits == (lowLatency ? 0 : 1));
+    stream_start(AUDIO_CAPTURE_STREAM);
+    stream_start(AUDIO_RENDER_STREAM);
+    host_advance(MS(20));
+    guard = lowLatency ? fmt->rate * T507_DMA_LL_PERIOD_US / USEC_PER_SEC : fmt->periodFrames;
+
+    memset(rt, 0, sizeof(*rt));
+    rt->minUs = U32_MAX;
+    for (i = 0; i < 500; i++) {
+        HOST_CHECK_EQ(T507AudioDmaWaitPeriod(&g_card.data, AUDIO_CAPTURE_STREAM, 100), HDF_SUCCESS);
+        HOST_CHECK_EQ(T507AudioDmaPointer(&g_card.data, AUDIO_CAPTURE_STREAM, &capPtr), HDF_SUCCESS);
+        HOST_CHECK_EQ(T507AudioDmaPointer(&g_card.data, AUDIO_RENDER_STREAM, &renPtr), HDF_SUCCESS);
+        /* newest frame the app can read is capPtr - 1 */
+        age = frames_diff(stream_truth(AUDIO_CAPTURE_STREAM), capPtr, bufFrames) + 1;
+        ahead = frames_diff((renPtr + guard) % bufFrames, stream_truth(AUDIO_RENDER_STREAM), bufFrames);
+        if (ahead <= 0) {
+            rt->underruns++;
+            continue;
+        }
+        us = (uint64_t)(age + ahead) * USEC_PER_SEC / fmt->rate;
+        rt->sumUs += us;
+        rt->maxUs = max(rt->maxUs, us);
+        rt->minUs = min(rt->minUs, us);
+        rt->wakeups++;
+    }
+
+    stream_close(AUDIO_CAPTURE_STREAM);
+    stream_close(AUDIO_RENDER_STREAM);
+    card_release();
+}
+
+static void test_round_trip(void)
+{
+    static const struct TestFormat fmt = { 48000, 2, 16, 240, 4, 0 };
+    struct RoundTrip normal;
+    struct RoundTrip ll;
+
+    round_trip_run(&fmt, false, &normal);
+    round_trip_run(&fmt, true, &ll);
+    host_report("round trip 48k/2ch/16, ADM period 240x4 (5 ms), tasklet 20 us + 0..100 us jitter (virtual):");
+    host_report("  normal      %5.2f ms mean, %5.2f .. %5.2f ms, %u wakeups, %u underruns",
+        (double)normal.sumUs / max(normal.wakeups, 1U) / 1000, (double)normal.minUs / 1000,
+        (double)normal.maxUs / 1000, normal.wakeups, normal.underruns);
+    host_report("  low latency %5.2f ms mean, %5.2f .. %5.2f ms, %u wakeups, %u underruns",
+        (double)ll.sumUs / max(ll.wakeups, 1U) / 1000, (double)ll.minUs / 1000,
+        (double)ll.maxUs / 1000, ll.wakeups, ll.underruns);
+
+    HOST_CHECK_EQ(normal.underruns, 0);
+    HOST_CHECK_EQ(ll.underruns, 0);
+    /* newest frame at most a dma period plus the tasklet old, written a period ahead */
+    HOST_CHECK(ll.maxUs <= 2 * T507_DMA_LL_PERIOD_US + 120 + 1);
+    HOST_CHECK(ll.maxUs < normal.minUs);
+}
+
+#define TEST_CACHE_LINE     64
+
+struct CachedRun {
+    uint32_t wakeups;
+    uint64_t readBytes;
+    uint64_t staleLines;
+    uint64_t dmaBytes;
+    uint32_t syncs;
+    uint64_t syncBytes;
+};
+
+static uint64_t g_line_sync_ns[TEST_CIRBUF_MAX / TEST_CACHE_LINE];
+static dma_addr_t g_sync_ring;
+
+static void cached_sync_hook(dma_addr_t addr, size_t size)
+{
+    uint32_t line;
+
+    for (line = (addr - g_sync_ring) / TEST_CACHE_LINE; line < (addr - g_sync_ring + size) / TEST_CACHE_LINE; line++) {
+        g_line_sync_ns[line] = ktime_get_ns();
+    }
+}
+
+/*
+ * A reader woken per period consumes up to the capture pointer. A line it
+ * reads is stale unless it was handed back to the cpu after the dma last
+ * wrote it; with the fifo at a fixed rate that write time is known exactly.
+ */
+static void cached_run(bool cached, uint64_t taskletNs, struct CachedRun *run)
+{
+    struct HostDmaConfig config = { .canPause = true, .reportResidue = true, .channels = 8 };
+    uint32_t bytesPerSec = g_tdm8.rate * 32;
+    uint32_t bufBytes;
+    uint64_t writeNs;
+    uint64_t start;
+    uint64_t app = 0;
+    uint64_t a;
+    uint32_t avail;
+    uint32_t ptr = 0;
+    u32 *hits;
+
+    test_reset();
+    config.irqToTaskletNs = taskletNs;
+    host_dma_configure(&config);
+    host_hcs_set_bool("cachedCapture", cached);
+    card_init(T507AudioDmaDeviceInit);
+    HOST_CHECK_EQ(stream_open(AUDIO_CAPTURE_STREAM, &g_tdm8), HDF_SUCCESS);
+    /* the cacheable ring is its own reservation, not the write-combined pool */
+    hits = host_debugfs_u32(TEST_DEBUGFS_DIR, "capture_pool_hits");
+    HOST_CHECK(hits != NULL && *hits == (cached ? 0 : 1));
+
+    bufBytes = card_buf(AUDIO_CAPTURE_STREAM)->cirBufSize;
+    g_sync_ring = card_buf(AUDIO_CAPTURE_STREAM)->phyAddr;
+    memset(g_line_sync_ns, 0, sizeof(g_line_sync_ns));
+    host_dma_sync_cpu_hook = cached_sync_hook;
+    memset(run, 0, sizeof(*run));
+
+    start = ktime_get_ns();
+    stream_start(AUDIO_CAPTURE_STREAM);
+    while (ktime_get_ns() < start + 2 * NSEC_PER_SEC) {
+        HOST_CHECK_EQ(T507AudioDmaWaitPeriod(&g_card.data, AUDIO_CAPTURE_STREAM, 100), HDF_SUCCESS);
+        /* a reader that gets the cpu late, up to 3 ms after the wakeup */
+        host_advance(US((run->syncs * 37) % 3000));
+        HOST_CHECK_EQ(T507AudioDmaPointer(&g_card.data, AUDIO_CAPTURE_STREAM, &ptr), HDF_SUCCESS);
+        run->syncs++;
+        avail = (ptr * 32 + bufBytes - (uint32_t)(app % bufBytes)) % bufBytes;
+        for (a = app; a < app + avail; a += TEST_CACHE_LINE) {
+            writeNs = start + (a + TEST_CACHE_LINE) * NSEC_PER_SEC / bytesPerSec;
+            if (g_line_sync_ns[(a % bufBytes) / TEST_CACHE_LINE] < writeNs) {
+                run->staleLines++;
+            }
+        }
+        app += avail;
+        run->readBytes += avail;
+    }
+    run->dmaBytes = host_dma_chan_bytes(stream_chan(AUDIO_CAPTURE_STREAM));
+    run->wakeups = run->syncs;
+    run->syncs = host_dma_sync.forCpu;
+    run->syncBytes = host_dma_sync.cpuBytes;
+
+    host_dma_sync_cpu_hook = NULL;
+    stream_close(AUDIO_CAPTURE_STREAM);
+    card_release();
+    HOST_CHECK_EQ(host_mem_live(), 0);
+}
+
+static void test_cached_capture(void)
+{
+    static const uint64_t tasklets[] = { US(20), MS(25) };
+    uint32_t periodBytes = g_tdm8.periodFrames * 32;
+    struct CachedRun run;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(tasklets); i++) {
+        cached_run(true, tasklets[i], &run);
+        host_report("cached, tasklet %5llu us: read %llu bytes, %llu stale lines, %u syncs for %llu of %llu dma bytes",
+            (unsigned long long)tasklets[i] / 1000, (unsigned long long)run.readBytes,
+            (unsigned long long)run.staleLines, run.syncs, (unsigned long long)run.syncBytes,
+            (unsigned long long)run.dmaBytes);
+        HOST_CHECK(run.readBytes > 0);
+        HOST_CHECK_EQ(run.staleLines, 0);
+        /* everything up to the last reported boundary is invalidated, and only once */
+        HOST_CHECK(run.syncBytes <= run.dmaBytes);
+        HOST_CHECK(run.dmaBytes - run.syncBytes < periodBytes + tasklets[i] * g_tdm8.rate * 32 / NSEC_PER_SEC);
+    }
+
+    cached_run(false, US(20), &run);
+    host_report("write-combined:           read %llu bytes, %u syncs", (unsigned long long)run.readBytes, run.syncs);
+    HOST_CHECK_EQ(run.syncs, 0);
+}
+
+/* rings come from the init reservation; an mmap keeps memory past the card release */
+static void test_pool_and_release(void)
+{
+    struct vm_area_struct ring = { .vm_start = 0x10000, .vm_end = 0x10000 + 16384 };
+    struct vm_area_struct status = {
+        .vm_start = 0x40000, .vm_end = 0x40000 + PAGE_SIZE, .vm_pgoff = T507_DMA_MMAP_STATUS_PGOFF,
+    };
+    u32 *hits;
+    u32 *misses;
+
+    card_init(T507AudioDmaDeviceInit);
+    hits = host_debugfs_u32(TEST_DEBUGFS_DIR, "render_pool_hits");
+    misses = host_debugfs_u32(TEST_DEBUGFS_DIR, "render_pool_misses");
+    HOST_CHECK(hits != NULL && misses != NULL);
+    if (hits == NULL || misses == NULL) {
+        card_release();
+        return;
+    }
+
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &g_stereo48k), HDF_SUCCESS);
+    stream_close(AUDIO_RENDER_STREAM);
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &g_stereo48k), HDF_SUCCESS);
+    HOST_CHECK_EQ(*hits, 2);
+    HOST_CHECK_EQ(*misses, 0);
+    stream_start(AUDIO_RENDER_STREAM);
+
+    HOST_CHECK_EQ(T507AudioDmaMmap(&g_card.data, AUDIO_RENDER_STREAM, &ring), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507AudioDmaMmap(&g_card.data, AUDIO_RENDER_STREAM, &status), HDF_SUCCESS);
+    HOST_CHECK_EQ(T507AudioDmaBufFree(&g_card.data, AUDIO_RENDER_STREAM), HDF_ERR_DEVICE_BUSY);
+    host_advance(MS(100));
+
+    /* the HAL dies with both mappings: release first, munmap later */
+    card_release();
+    HOST_CHECK(host_mem_live() > 0);
+    ring.vm_ops->close(&ring);
+    HOST_CHECK(host_mem_live() > 0);
+    status.vm_ops->close(&status);
+    HOST_CHECK_EQ(host_mem_live(), 0);
+    HOST_CHECK_EQ(host_dma_chans_live(), 0);
+
+    /* init reservation failed: BufAlloc falls back to allocating, counted as a miss */
+    test_reset();
+    host_fail_next(HOST_FAIL_DMA_ALLOC, 1);
+    card_init(T507AudioDmaDeviceInit);
+    misses = host_debugfs_u32(TEST_DEBUGFS_DIR, "render_pool_misses");
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &g_stereo48k), HDF_SUCCESS);
+    HOST_CHECK(misses != NULL && *misses == 1);
+    stream_close(AUDIO_RENDER_STREAM);
+    card_release();
+    HOST_CHECK_EQ(host_mem_live(), 0);
+}
+
+static void test_capture_tap(void)
+{
+    struct dma_chan *chan;
+    struct PtrStats stats;
+    int32_t err;
+    uint32_t bufBytes = 0;
+    uint32_t ptr = 0;
+    uint32_t truth;
+    uint32_t i;
+
+    host_hcs_set_u32("captureTaps", 1);
+    card_init(T507AudioDmaDeviceInit);
+    HOST_CHECK_EQ(stream_open(AUDIO_CAPTURE_STREAM, &g_tdm8), HDF_SUCCESS);
+    stream_start(AUDIO_CAPTURE_STREAM);
+    host_dma_set_fifo_rate(FIFO_AHUB_RX(AHUB_APBIF_1), 48000 * 32, 0);
+    HOST_CHECK_EQ(T507AudioDmaTapStart(&g_card.data, AHUB_APBIF_0, &bufBytes), HDF_FAILURE);
+    HOST_CHECK_EQ(T507AudioDmaTapStart(&g_card.data, AHUB_APBIF_1, &bufBytes), HDF_SUCCESS);
+    HOST_CHECK_EQ(bufBytes, card_buf(AUDIO_CAPTURE_STREAM)->cirBufSize);
+    HOST_CHECK_EQ(T507AudioDmaTapStart(&g_card.data, AHUB_APBIF_2, &bufBytes), HDF_ERR_DEVICE_BUSY);
+    HOST_CHECK(host_impl.tapEnabled[AHUB_APBIF_1]);
+    chan = host_dma_chan_by_fifo(FIFO_AHUB_RX(AHUB_APBIF_1));
+    HOST_CHECK(chan != NULL && chan != stream_chan(AUDIO_CAPTURE_STREAM));
+    if (chan == NULL) {
+        card_release();
+        return;
+    }
+
+    /* the tap runs on its own channel and ring, off its own pointer */
+    memset(&stats, 0, sizeof(stats));
+    for (i = 0; i < 10000; i++) {
+        host_advance(US(97) + US(i % 13));
+        HOST_CHECK_EQ(T507AudioDmaTapPointer(&g_card.data, AHUB_APBIF_1, &ptr), HDF_SUCCESS);
+        truth = (uint32_t)(host_dma_chan_addr(chan) - host_dma_chan_ring(chan)) / 32;
+        err = frames_diff(ptr, truth, bufBytes / 32);
+        stats.samples++;
+        stats.sumAbs += (uint64_t)(err < 0 ? -err : err);
+        stats.maxAhead = max(stats.maxAhead, err);
+        stats.maxBehind = max(stats.maxBehind, -err);
+    }
+    HOST_CHECK(host_dma_chan_bytes(chan) > (uint64_t)bufBytes);
+    ptr_report("tap apbif1 48k/8ch/32 256x8", &stats);
+    ptr_check(&stats, &g_tdm8, 0, 2);
+
+    HOST_CHECK_EQ(T507AudioDmaTapStop(&g_card.data, AHUB_APBIF_1), HDF_SUCCESS);
+    HOST_CHECK(!host_impl.tapEnabled[AHUB_APBIF_1]);
+    HOST_CHECK_EQ(T507AudioDmaTapPointer(&g_card.data, AHUB_APBIF_1, &ptr), HDF_FAILURE);
+    stream_close(AUDIO_CAPTURE_STREAM);
+    card_release();
+    HOST_CHECK_EQ(host_mem_live(), 0);
+}
+
+/* host cost of the hot ops, and what each ADM op asks of the dmaengine */
+static void test_op_cost(void)
+{
+    const uint32_t loops = 1000000;
+    struct HostDmaCalls calls;
+    uint64_t tstamp;
+    uint64_t start;
+    uint32_t frames;
+    uint32_t i;
+
+    card_init(T507AudioDmaDeviceInit);
+    HOST_CHECK_EQ(stream_open(AUDIO_RENDER_STREAM, &g_stereo48k), HDF_SUCCESS);
+    calls = host_dma_calls;
+    stream_start(AUDIO_RENDER_STREAM);
+    host_report("start: %u prep_cyclic, %u submit, %u issue_pending", host_dma_calls.prepCyclic - calls.prepCyclic,
+        host_dma_calls.submit - calls.submit, host_dma_calls.issuePending - calls.issuePending);
+    host_advance(MS(30));
+
+    start = host_wall_ns();
+    for (i = 0; i < loops; i++) {
+        (void)T507AudioDmaPointer(&g_card.data, AUDIO_RENDER_STREAM, &frames);
+    }
+    host_report("DmaPointer         %6.1f ns/op (host)", (double)(host_wall_ns() - start) / loops);
+
+    start = host_wall_ns();
+    for (i = 0; i < loops; i++) {
+        (void)T507AudioDmaGetTimestamp(&g_card.data, AUDIO_RENDER_STREAM, &frames, &tstamp);
+    }
+    host_report("DmaGetTimestamp    %6.1f ns/op (host)", (double)(host_wall_ns() - start) / loops);
+
+    host_trace_enabled = true;
+    start = host_wall_ns();
+    for (i = 0; i < loops; i++) {
+        (void)T507AudioDmaPointer(&g_card.data, AUDIO_RENDER_STREAM, &frames);
+    }
+    host_report("DmaPointer, trace  %6.1f ns/op (host, tracepoint counted only)",
+        (double)(host_wall_ns() - start) / loops);
+    host_trace_enabled = false;
+
+    calls = host_dma_calls;
+    start = host_wall_ns();
+    for (i = 0; i < 10000; i++) {
+        host_advance(1024ULL * NSEC_PER_SEC / 48000 + 1);
+    }
+    host_report("period path        %6.1f ns/period (host, fake irq + tasklet included), %u tx_status per period",
+        (double)(host_wall_ns() - start) / 10000, (host_dma_calls.txStatus - calls.txStatus) / 10000);
+
+    calls = host_dma_calls;
+    start = host_wall_ns();
+    for (i = 0; i < 10000; i++) {
+        (void)T507AudioDmaPause(&g_card.data, AUDIO_RENDER_STREAM);
+        (void)T507AudioDmaResume(&g_card.data, AUDIO_RENDER_STREAM);
+    }
+    host_report("Pause+Resume       %6.1f ns/pair (host), %u dmaengine calls per pair",
+        (double)(host_wall_ns() - start) / 10000,
+        (host_dma_calls.pause - calls.pause + host_dma_calls.resume - calls.resume) / 10000);
+
+    stream_close(AUDIO_RENDER_STREAM);
+    start = host_wall_ns();
+    for (i = 0; i < 10000; i++) {
+        (void)T507AudioDmaBufAlloc(&g_card.data, AUDIO_RENDER_STREAM);
+        (void)T507AudioDmaBufFree(&g_card.data, AUDIO_RENDER_STREAM);
+    }
+    host_report("BufAlloc+BufFree   %6.1f ns/pair (host, pool hit)", (double)(host_wall_ns() - start) / 10000);
+    card_release();
+}
+
+static const struct HostTestCase g_cases[] = {
+    { "pointer_accuracy", test_pointer_accuracy },
+    { "full_duplex", test_full_duplex },
+    { "duplex_stress", test_duplex_stress },
+    { "wait_period", test_wait_period },
+    { "pause_in_place", test_pause_in_place },
+    { "pause_resubmit", test_pause_resubmit },
+    { "burst_select", test_burst_select },
+    { "low_latency_period", test_low_latency_period },
+    { "round_trip", test_round_trip },
+    { "cached_capture", test_cached_capture },
+    { "pool_and_release", test_pool_and_release },
+    { "capture_tap", test_capture_tap },
+    { "op_cost", test_op_cost },
+};
+
+int main(int argc, char **argv)
+{
+    return host_test_main(g_cases, ARRAY_SIZE(g_cases), test_reset, argc, argv);
+}
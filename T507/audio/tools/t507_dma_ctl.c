@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Userspace side of /dev/t507_<platform>, what the HAL does in mmap mode.
+ *
+ * Build:
+ *     aarch64-linux-gnu-gcc -O2 -Wall -I../soc/include -o t507_dma_ctl t507_dma_ctl.c
+ *
+ * Start a stream through the ADM first (e.g. the HAL render test with the
+ * ring size given here), then on the board:
+ *     t507_dma_ctl -d /dev/t507_dma_service_0 -t render -B 16384 -f 4 -s 5
+ *
+ * A capture tap (apbif 1 here) is started by the tool itself while the ADM
+ * capture runs, its ring size comes back from the driver:
+ *     t507_dma_ctl -d /dev/t507_dma_service_0 -t tap1 -s 5
+ *
+ * Stream switches are set with the stream closed and nothing is mapped then:
+ *     t507_dma_ctl -d /dev/t507_dma_service_0 -t render -L 1
+ *
+ * The ring and the status page are mapped, render is fed silence and
+ * capture is drained, appPtr is moved through the status page and every
+ * iteration cross-checks the page against T507_DMA_IOC_SYNC. Iterations are
+ * paced by T507_DMA_IOC_WAIT_PERIOD, and the rate is estimated from the
+ * frames advanced between T507_DMA_IOC_TSTAMP samples.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "t507_dma_uapi.h"
+
+struct DmaCtl {
+    int fd;
+    uint32_t target;
+    uint8_t *ring;
+    size_t ringBytes;
+    uint32_t frameBytes;
+    volatile struct T507DmaMmapStatus *status;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* the driver bumps seq around each update, odd means one is in flight */
+static void status_read(const struct DmaCtl *ctl, uint32_t *hwPtr, uint64_t *tstampNs)
+{
+    uint32_t seq;
+
+    do {
+        seq = __atomic_load_n(&ctl->status->seq, __ATOMIC_ACQUIRE);
+        *hwPtr = ctl->status->hwPtr;
+        *tstampNs = ctl->status->tstampNs;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) != 0 || seq != __atomic_load_n(&ctl->status->seq, __ATOMIC_RELAXED));
+}
+
+/* a switch of the bound stream, -1 when not given */
+struct DmaCtlSet {
+    unsigned long cmd;
+    const char *name;
+    long value;
+};
+
+static int ctl_open(struct DmaCtl *ctl, const char *dev)
+{
+    ctl->fd = open(dev, O_RDWR | O_CLOEXEC);
+    if (ctl->fd < 0) {
+        fprintf(stderr, "open %s: %s\n", dev, strerror(errno));
+        return -1;
+    }
+    if (ioctl(ctl->fd, T507_DMA_IOC_BIND, &ctl->target) < 0) {
+        fprintf(stderr, "bind: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int ctl_set(const struct DmaCtl *ctl, const struct DmaCtlSet *set, size_t num)
+{
+    uint32_t value;
+    size_t i;
+
+    for (i = 0; i < num; i++) {
+        if (set[i].value < 0) {
+            continue;
+        }
+        value = (uint32_t)set[i].value;
+        if (ioctl(ctl->fd, set[i].cmd, &value) < 0) {
+            fprintf(stderr, "%s %u: %s\n", set[i].name, value, strerror(errno));
+            return -1;
+        }
+        printf("%s %u\n", set[i].name, value);
+    }
+
+    return 0;
+}
+
+static int ctl_map(struct DmaCtl *ctl)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    void *addr;
+
+    /* the ring first, its mmap switches the stream to mmap mode and fills the page */
+    addr = mmap(NULL, ctl->ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED, ctl->fd, 0);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "mmap ring: %s\n", strerror(errno));
+        return -1;
+    }
+    ctl->ring = addr;
+    addr = mmap(NULL, (size_t)page, PROT_READ | PROT_WRITE, MAP_SHARED, ctl->fd,
+                (off_t)T507_DMA_MMAP_STATUS_PGOFF * page);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "mmap status: %s\n", strerror(errno));
+        return -1;
+    }
+    ctl->status = addr;
+
+    return 0;
+}
+
+static int ctl_run(struct DmaCtl *ctl, unsigned int seconds)
+{
+    struct T507DmaSync sync;
+    struct T507DmaTstamp last;
+    struct T507DmaTstamp ts;
+    uint32_t timeoutMs = 100;
+    uint32_t frames = ctl->status->bufferFrames;
+    uint32_t period = ctl->status->periodFrames;
+    uint32_t appPtr = ctl->status->appPtr;
+    uint32_t hwPtr;
+    uint32_t avail;
+    uint32_t chunk;
+    uint32_t mismatch = 0;
+    uint64_t moved = 0;
+    uint64_t played = 0;
+    uint32_t timeouts = 0;
+    uint32_t xrunsStart = 0;
+    uint32_t xruns = 0;
+    uint64_t tstampNs;
+    uint64_t end = now_ns() + (uint64_t)seconds * 1000000000ULL;
+    uint64_t start;
+
+    if (frames == 0 || period == 0 || (size_t)frames * ctl->frameBytes > ctl->ringBytes) {
+        fprintf(stderr, "status page: %u frames, period %u, ring %zu bytes / %u\n",
+                frames, period, ctl->ringBytes, ctl->frameBytes);
+        return -1;
+    }
+    if (ioctl(ctl->fd, T507_DMA_IOC_TSTAMP, &last) < 0) {
+        fprintf(stderr, "tstamp: %s\n", strerror(errno));
+        return -1;
+    }
+    start = last.tstampNs;
+    if (ioctl(ctl->fd, T507_DMA_IOC_XRUN_COUNT, &xrunsStart) < 0) {
+        fprintf(stderr, "xrun count: %s\n", strerror(errno));
+        return -1;
+    }
+    while (now_ns() < end) {
+        status_read(ctl, &hwPtr, &tstampNs);
+        if (ctl->target == T507_DMA_TARGET_RENDER) {
+            avail = frames - (appPtr + frames - hwPtr) % frames;
+        } else {
+            avail = (hwPtr + frames - appPtr) % frames;
+        }
+        if (ioctl(ctl->fd, T507_DMA_IOC_SYNC, &sync) < 0) {
+            fprintf(stderr, "sync: %s\n", strerror(errno));
+            return -1;
+        }
+        /* the page may lag the interpolated pointer by up to a period, never lead it */
+        if (sync.appPtr != appPtr || (sync.hwPtr + frames - hwPtr) % frames > period) {
+            mismatch++;
+        }
+        while (avail > 0) {
+            chunk = (avail < frames - appPtr) ? avail : frames - appPtr;
+            if (ctl->target == T507_DMA_TARGET_RENDER) {
+                memset(ctl->ring + (size_t)appPtr * ctl->frameBytes, 0, (size_t)chunk * ctl->frameBytes);
+            } else {
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            }
+            appPtr = (appPtr + chunk) % frames;
+            avail -= chunk;
+            moved += chunk;
+        }
+        __atomic_store_n(&ctl->status->appPtr, appPtr, __ATOMIC_RELEASE);
+        if (ioctl(ctl->fd, T507_DMA_IOC_WAIT_PERIOD, &timeoutMs) < 0) {
+            if (errno != ETIMEDOUT) {
+                fprintf(stderr, "wait: %s\n", strerror(errno));
+                return -1;
+            }
+            timeouts++;
+        }
+        if (ioctl(ctl->fd, T507_DMA_IOC_TSTAMP, &ts) < 0) {
+            fprintf(stderr, "tstamp: %s\n", strerror(errno));
+            return -1;
+        }
+        /* less than a ring between two samples, so the wrap is unambiguous */
+        played += (ts.hwPtr + frames - last.hwPtr) % frames;
+        last = ts;
+    }
+    if (ioctl(ctl->fd, T507_DMA_IOC_XRUN_COUNT, &xruns) < 0) {
+        fprintf(stderr, "xrun count: %s\n", strerror(errno));
+        return -1;
+    }
+    printf("%s: %llu frames moved, page/ioctl mismatches %u, wait timeouts %u, xruns %u (page %u)\n",
+           ctl->target == T507_DMA_TARGET_RENDER ? "render" : "capture", (unsigned long long)moved,
+           mismatch, timeouts, xruns - xrunsStart, ctl->status->xrunCount - xrunsStart);
+    if (last.tstampNs > start) {
+        printf("rate from timestamps: %.2f Hz over %.3f s\n",
+               (double)played * 1e9 / (double)(last.tstampNs - start), (double)(last.tstampNs - start) / 1e9);
+    }
+
+    return 0;
+}
+
+static void ctl_unmap(struct DmaCtl *ctl)
+{
+    if (ctl->status != NULL) {
+        munmap((void *)ctl->status, (size_t)sysconf(_SC_PAGESIZE));
+        ctl->status = NULL;
+    }
+    if (ctl->ring != NULL) {
+        munmap(ctl->ring, ctl->ringBytes);
+        ctl->ring = NULL;
+    }
+}
+
+/* taps have no timestamp or wait ioctl, the rate comes from status page samples */
+static int ctl_run_tap(struct DmaCtl *ctl, unsigned int seconds)
+{
+    struct T507DmaSync sync;
+    uint32_t frames = ctl->status->bufferFrames;
+    uint32_t period = ctl->status->periodFrames;
+    uint32_t appPtr = 0;
+    uint32_t hwPtr;
+    uint32_t lastPtr;
+    uint32_t mismatch = 0;
+    uint64_t captured = 0;
+    uint64_t tstampNs;
+    uint64_t start;
+    uint64_t end = now_ns() + (uint64_t)seconds * 1000000000ULL;
+
+    if (frames == 0 || period == 0) {
+        fprintf(stderr, "status page: %u frames, period %u\n", frames, period);
+        return -1;
+    }
+    status_read(ctl, &lastPtr, &start);
+    tstampNs = start;
+    while (now_ns() < end) {
+        status_read(ctl, &hwPtr, &tstampNs);
+        if (ioctl(ctl->fd, T507_DMA_IOC_SYNC, &sync) < 0) {
+            fprintf(stderr, "sync: %s\n", strerror(errno));
+            return -1;
+        }
+        if (sync.appPtr != appPtr || (sync.hwPtr + frames - hwPtr) % frames > period) {
+            mismatch++;
+        }
+        captured += (hwPtr + frames - lastPtr) % frames;
+        lastPtr = hwPtr;
+        /* drain everything, the data itself is not looked at */
+        appPtr = hwPtr;
+        __atomic_store_n(&ctl->status->appPtr, appPtr, __ATOMIC_RELEASE);
+        usleep(1000);
+    }
+    printf("tap apbif %u: %u frame ring, page/ioctl mismatches %u\n",
+           ctl->target - T507_DMA_TARGET_TAP(0), frames, mismatch);
+    if (tstampNs > start) {
+        printf("rate from status page: %.2f Hz over %.3f s\n",
+               (double)captured * 1e9 / (double)(tstampNs - start), (double)(tstampNs - start) / 1e9);
+    }
+
+    return 0;
+}
+
+static int ctl_tap(struct DmaCtl *ctl, unsigned int seconds)
+{
+    uint32_t bufBytes = 0;
+    int ret;
+
+    if (ioctl(ctl->fd, T507_DMA_IOC_TAP_START, &bufBytes) < 0) {
+        fprintf(stderr, "tap start: %s\n", strerror(errno));
+        return -1;
+    }
+    ctl->ringBytes = bufBytes;
+    ret = ctl_map(ctl);
+    if (ret == 0) {
+        ret = ctl_run_tap(ctl, seconds);
+    }
+    /* the driver refuses to stop a mapped tap */
+    ctl_unmap(ctl);
+    if (ioctl(ctl->fd, T507_DMA_IOC_TAP_STOP) < 0) {
+        fprintf(stderr, "tap stop: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return ret;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s -d /dev/t507_<platform> -t render|capture -B ring_bytes -f frame_bytes "
+            "[-s seconds]\n"
+            "       %s -d /dev/t507_<platform> -t tap0|tap1|tap2 [-s seconds]\n"
+            "       %s -d /dev/t507_<platform> -t render|capture [-L 0|1] [-C 0|1] [-b 0|1|4|8|16]\n", name, name, name);
+}
+
+int main(int argc, char *argv[])
+{
+    struct DmaCtlSet set[] = {
+        { T507_DMA_IOC_SET_LOW_LATENCY, "low latency", -1 },
+        { T507_DMA_IOC_SET_CACHED, "cached", -1 },
+        { T507_DMA_IOC_SET_BURST, "maxburst", -1 },
+    };
+    bool setOnly = false;
+    bool isTap;
+    struct DmaCtl ctl;
+    const char *dev = NULL;
+    unsigned int seconds = 5;
+    int opt;
+
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.fd = -1;
+    ctl.target = T507_DMA_TARGET_RENDER;
+    while ((opt = getopt(argc, argv, "d:t:B:f:s:L:C:b:")) != -1) {
+        switch (opt) {
+            case 'd':
+                dev = optarg;
+                break;
+            case 't':
+                if (strncmp(optarg, "tap", strlen("tap")) == 0) {
+                    ctl.target = T507_DMA_TARGET_TAP(strtoul(optarg + strlen("tap"), NULL, 0));
+                } else {
+                    ctl.target = (strcmp(optarg, "capture") == 0) ? T507_DMA_TARGET_CAPTURE : T507_DMA_TARGET_RENDER;
+                }
+                break;
+            case 'B':
+                ctl.ringBytes = strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                ctl.frameBytes = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seconds = (unsigned int)strtoul(optarg, NULL, 0);
+                break;
+            case 'L':
+                set[0].value = strtol(optarg, NULL, 0);
+                setOnly = true;
+                break;
+            case 'C':
+                set[1].value = strtol(optarg, NULL, 0);
+                setOnly = true;
+                break;
+            case 'b':
+                set[2].value = strtol(optarg, NULL, 0);
+                setOnly = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    isTap = (ctl.target >= T507_DMA_TARGET_TAP(0));
+    if (dev == NULL || (!setOnly && !isTap && (ctl.ringBytes == 0 || ctl.frameBytes == 0))) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (ctl_open(&ctl, dev) != 0) {
+        return 1;
+    }
+    if (isTap) {
+        return (ctl_tap(&ctl, seconds) != 0) ? 1 : 0;
+    }
+    if (setOnly) {
+        return (ctl_set(&ctl, set, sizeof(set) / sizeof(set[0])) != 0) ? 1 : 0;
+    }
+    if (ctl_map(&ctl) != 0 || ctl_run(&ctl, seconds) != 0) {
+        return 1;
+    }
+
+    return 0;
+}
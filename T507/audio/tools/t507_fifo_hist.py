@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+FIFO occupancy histograms from a t507_audio trace.
+
+Capture on the board:
+    echo 1 > /sys/kernel/debug/tracing/events/t507_audio/enable
+    cat /sys/kernel/debug/tracing/trace_pipe > audio.trace
+
+then on the host:
+    t507_fifo_hist.py audio.trace --depth ahub:render=64 --depth codec:render=128
+
+The drivers trace avail, i.e. ready words for capture and free words for
+render. Capture avail is the occupancy as is; render occupancy needs the
+fifo depth given with --depth, without it the free room is shown.
+"""
+
+import argparse
+import re
+import sys
+from collections import defaultdict
+
+EVENT_RE = re.compile(r"(t507_audio_dma_period|t507_audio_trigger):\s+(.*)$")
+FIELD_RE = re.compile(r"(\w+)=(\S+)")
+
+
+def parse(lines):
+    samples = defaultdict(list)
+    for line in lines:
+        match = EVENT_RE.search(line)
+        if match is None:
+            continue
+        fields = dict(FIELD_RE.findall(match.group(2)))
+        if "avail" not in fields or fields.get("dev") == "ahub-tap":
+            continue
+        samples[(fields["dev"], fields["stream"])].append(int(fields["avail"]))
+    return samples
+
+
+def parse_depths(items):
+    depths = {}
+    for item in items:
+        key, _, value = item.partition("=")
+        dev, _, stream = key.partition(":")
+        depths[(dev, stream)] = int(value)
+    return depths
+
+
+def print_hist(key, values, depth, bins, width):
+    label = "occupancy" if depth is not None or key[1] == "capture" else "free room"
+    top = depth if depth is not None else max(values)
+    step = max(1, (top + bins) // bins)
+    counts = defaultdict(int)
+    for value in values:
+        counts[value // step] += 1
+
+    peak = max(counts.values())
+    print("%s %s: %d samples, %s words, min %d max %d" % (key[0], key[1], len(values), label, min(values), max(values)))
+    for i in range(top // step + 1):
+        bar = "#" * (counts[i] * width // peak) if peak else ""
+        print(("  %5d-%-5d %7d %s" % (i * step, (i + 1) * step - 1, counts[i], bar)).rstrip())
+    print("")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="FIFO occupancy histograms from a t507_audio trace")
+    parser.add_argument("trace", nargs="?", help="trace text, stdin if omitted")
+    parser.add_argument("--depth", action="append", default=[], metavar="DEV:STREAM=WORDS",
+                        help="fifo depth, turns render free room into occupancy")
+    parser.add_argument("--bins", type=int, default=16)
+    parser.add_argument("--width", type=int, default=50)
+    args = parser.parse_args()
+
+    depths = parse_depths(args.depth)
+    if args.trace:
+        with open(args.trace) as trace:
+            samples = parse(trace)
+    else:
+        samples = parse(sys.stdin)
+
+    if not samples:
+        print("no t507_audio fifo samples found")
+        return 1
+
+    for key in sorted(samples):
+        values = samples[key]
+        depth = depths.get(key)
+        if depth is not None and key[1] == "render":
+            values = [max(0, depth - value) for value in values]
+        print_hist(key, values, depth, args.bins, args.width)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
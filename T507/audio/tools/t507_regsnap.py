@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2022 VYAGOO TECHNOLOGY Co., Ltd.
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Decode and diff register snapshots of the ahub, codec and ac107 drivers.
+
+Capture on the board, as often as needed, the read does not log:
+    cat /sys/kernel/debug/sunxi-snd-ahub/regs.bin > a.bin
+    ...
+    cat /sys/kernel/debug/sunxi-snd-ahub/regs.bin > b.bin
+    cat /sys/kernel/debug/sunxi-snd-ahub/regs > ahub.txt     # names, once
+
+then on the host:
+    t507_regsnap.py a.bin                       # decode
+    t507_regsnap.py a.bin b.bin --names ahub.txt  # registers that changed
+
+The binary layout is soc/include/t507_regsnap_uapi.h. The text "regs" files
+are accepted wherever a snapshot is, and give the register names. Like
+diff(1) the exit status is 0 when nothing changed, 1 when something did.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x53523554
+VERSION = 1
+HEADER = struct.Struct("<IHHBBHIQ")
+ENTRY = struct.Struct("<HHI")
+F_NOREAD = 0x1
+BLOCKS = {1: "ahub", 2: "codec", 3: "ac107"}
+
+
+class Snapshot:
+    def __init__(self, block, val_bytes, ident=0, tstamp_ns=None):
+        self.block = block
+        self.val_bytes = val_bytes
+        self.ident = ident
+        self.tstamp_ns = tstamp_ns
+        self.regs = []          # (addr, value or None when not read)
+        self.names = {}
+
+    def describe(self):
+        if self.block == 0:
+            return "text snapshot"
+        text = BLOCKS.get(self.block, "block %d" % self.block)
+        if self.block == 3:
+            text += " @0x%02x" % self.ident
+        return text
+
+
+def parse_bin(data, path):
+    if len(data) < HEADER.size:
+        raise ValueError("%s: short snapshot, %d bytes" % (path, len(data)))
+    magic, version, count, block, val_bytes, ident, _, tstamp_ns = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError("%s: not a regs.bin snapshot" % path)
+    if version != VERSION:
+        raise ValueError("%s: snapshot version %d, this tool reads %d" % (path, version, VERSION))
+    if len(data) != HEADER.size + count * ENTRY.size:
+        raise ValueError("%s: %d entries announced, %d bytes present" % (path, count, len(data)))
+
+    snap = Snapshot(block, val_bytes, ident, tstamp_ns)
+    for i in range(count):
+        addr, flags, value = ENTRY.unpack_from(data, HEADER.size + i * ENTRY.size)
+        snap.regs.append((addr, None if flags & F_NOREAD else value))
+    return snap
+
+
+def parse_text(text, path):
+    snap = None
+    for line in text.splitlines():
+        fields = line.split()
+        if len(fields) < 3 or not fields[0].startswith("0x"):
+            continue
+        addr = int(fields[0], 16)
+        value = None if fields[1].startswith("-") else int(fields[1], 16)
+        if snap is None:
+            snap = Snapshot(0, 1 if len(fields[1]) <= 4 else 4)
+        snap.regs.append((addr, value))
+        snap.names[addr] = fields[2]
+    if snap is None:
+        raise ValueError("%s: no \"addr value name\" lines" % path)
+    return snap
+
+
+def load(path):
+    with open(path, "rb") as snap_file:
+        data = snap_file.read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == MAGIC:
+        return parse_bin(data, path)
+    return parse_text(data.decode("ascii", "replace"), path)
+
+
+def fmt_value(snap, value):
+    if value is None:
+        return "-" * (snap.val_bytes * 2 + 2)
+    return "0x%0*x" % (snap.val_bytes * 2, value)
+
+
+def bit_ranges(mask):
+    ranges = []
+    bit = 0
+    while mask >> bit:
+        if mask & (1 << bit):
+            start = bit
+            while mask & (1 << (bit + 1)):
+                bit += 1
+            ranges.append(str(start) if start == bit else "%d-%d" % (bit, start))
+        bit += 1
+    return ",".join(reversed(ranges))
+
+
+def decode(snap, names):
+    header = snap.describe()
+    if snap.tstamp_ns is not None:
+        header += ", %.6f s" % (snap.tstamp_ns / 1e9)
+    print("%s: %d registers" % (header, len(snap.regs)))
+    for addr, value in snap.regs:
+        print(("  0x%03x %s %s" % (addr, fmt_value(snap, value), names.get(addr, ""))).rstrip())
+    return 0
+
+
+def diff(old, new, names, show_all):
+    if old.block and new.block and (old.block, old.ident) != (new.block, new.ident):
+        raise ValueError("snapshots are of %s and %s" % (old.describe(), new.describe()))
+
+    header = "%s: " % (new.describe() if new.block else old.describe())
+    if old.tstamp_ns is not None and new.tstamp_ns is not None:
+        header += "%.3f ms apart, " % ((new.tstamp_ns - old.tstamp_ns) / 1e6)
+    before = dict(old.regs)
+    changed = 0
+    lines = []
+    for addr, value in new.regs:
+        prev = before.pop(addr, None)
+        if prev == value and not show_all:
+            continue
+        mark = " " if prev == value else "*"
+        bits = ""
+        if prev != value and prev is not None and value is not None:
+            bits = "  bits " + bit_ranges(prev ^ value)
+            changed += 1
+        elif prev != value:
+            changed += 1
+        lines.append("%s 0x%03x %s -> %s %-28s%s" % (mark, addr, fmt_value(old, prev), fmt_value(new, value),
+                                                    names.get(addr, ""), bits))
+    for addr, prev in sorted(before.items()):
+        changed += 1
+        lines.append("* 0x%03x %s -> (absent) %s" % (addr, fmt_value(old, prev), names.get(addr, "")))
+
+    print(header + "%d of %d registers changed" % (changed, len(new.regs)))
+    for line in lines:
+        print(line.rstrip())
+    return 1 if changed else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode and diff t507 audio register snapshots")
+    parser.add_argument("snapshot", nargs="+", help="regs.bin or text regs, two to diff")
+    parser.add_argument("--names", action="append", default=[], metavar="REGS",
+                        help="text regs file of the same block, for register names")
+    parser.add_argument("--all", action="store_true", help="diff: list unchanged registers too")
+    args = parser.parse_args()
+
+    if len(args.snapshot) > 2:
+        parser.error("one snapshot to decode or two to diff")
+    try:
+        snaps = [load(path) for path in args.snapshot]
+        names = {}
+        for path in args.names:
+            names.update(load(path).names)
+        for snap in snaps:
+            names.update({addr: name for addr, name in snap.names.items() if addr not in names})
+        if len(snaps) == 1:
+            return decode(snaps[0], names)
+        return diff(snaps[0], snaps[1], names, args.all)
+    except (OSError, ValueError) as err:
+        print("t507_regsnap: %s" % err, file=sys.stderr)
+        return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())